@@ -82,51 +82,19 @@ public:
 
     IRECT padded = mRECT.GetPadded(-2);
 
-    float x = padded.L;
-    float y = padded.T;
-    float w = padded.W();
-    float h = padded.H();
-
-    // TODO: replace with IGraphics::DrawData, make it work with lice
-
-    g.PathMoveTo(x, y+h);
-
-    if (mStyle == kFPS)
-    {
-      for (int i = 0; i < MAXBUF; i++) {
-        float v = 1.0f / (0.00001f + mBuffer[(mReadPos+i) % MAXBUF]);
-        float vx, vy;
-        if (v > 80.0f) v = 80.0f;
-        vx = x + ((float)i/(MAXBUF-1)) * w;
-        vy = y + h - ((v / 80.0f) * h);
-        g.PathLineTo(vx, vy);
-      }
-    }
-    else if (mStyle == kPercentage)
-    {
-      for (int i = 0; i < MAXBUF; i++) {
-        float v = mBuffer[(mReadPos+i) % MAXBUF] * 1.0f;
-        float vx, vy;
-        if (v > 100.0f) v = 100.0f;
-        vx = x + ((float)i/(MAXBUF-1)) * w;
-        vy = y + h - ((v / 100.0f) * h);
-        g.PathLineTo(vx, vy);
-      }
-    }
-    else
+    for (int i = 0; i < MAXBUF; i++)
     {
-      for (int i = 0; i < MAXBUF; i++) {
-        float v = mBuffer[(mReadPos+i) % MAXBUF] * 1000.0f;
-        float vx, vy;
-        if (v > 20.0f) v = 20.0f;
-        vx = x + ((float)i/(MAXBUF-1)) * w;
-        vy = y + h - ((v / 20.0f) * h);
-        g.PathLineTo(vx, vy);
-      }
+      const float t = mBuffer[(mReadPos+i) % MAXBUF];
+
+      if (mStyle == kFPS)
+        mNormPoints[i] = std::min(1.0f / (0.00001f + t), 80.0f) / 80.0f;
+      else if (mStyle == kPercentage)
+        mNormPoints[i] = std::min(t, 100.0f) / 100.0f;
+      else
+        mNormPoints[i] = std::min(t * 1000.0f, 20.0f) / 20.0f;
     }
 
-    g.PathLineTo(mRECT.R, mRECT.B);
-    g.PathFill(GetColor(kFG));
+    g.FillData(GetColor(kFG), padded, mNormPoints, MAXBUF);
 
     g.DrawText(mAPILabelText, g.GetDrawingAPIStr(), padded);
 
@@ -158,6 +126,7 @@ private:
   int mStyle;
   WDL_String mNameLabel;
   float mBuffer[MAXBUF] = {};
+  float mNormPoints[MAXBUF] = {};
   int mReadPos = 0;
 
   float mPadding = 1.f;
@@ -0,0 +1,150 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+#pragma once
+
+/**
+ * @file
+ * @ingroup SpecialControls
+ * @copydoc IProcessLoadDisplayControl
+ */
+
+#include "IControl.h"
+#include "IPlugProcessTiming.h"
+
+BEGIN_IPLUG_NAMESPACE
+BEGIN_IGRAPHICS_NAMESPACE
+
+/** Displays the audio processing load measured by an IProcessTiming, e.g. GetProcessTiming() of the plug-in.
+ * Click to switch between the load history and the histogram of block loads, alt-click to reset the results.
+ * The timing is read directly, so this does not work with distributed (e.g. VST3 split) UIs
+ * @ingroup SpecialControls */
+class IProcessLoadDisplayControl : public IControl
+                                 , public IVectorBase
+{
+private:
+  static constexpr int MAXBUF = 100;
+public:
+  enum EStyle
+  {
+    kHistory,
+    kHistogram,
+    kNumStyles
+  };
+
+  IProcessLoadDisplayControl(const IRECT& bounds, IProcessTiming& timing, EStyle style = EStyle::kHistory, const char* label = "DSP Load")
+  : IControl(bounds)
+  , mTiming(timing)
+  , mStyle(style)
+  , mNameLabel(label)
+  {
+    AttachIControl(this, label);
+
+    SetColor(kBG, COLOR_WHITE);
+
+    mNameLabelText = IText(14, GetColor(kFR), DEFAULT_FONT, EAlign::Near, EVAlign::Bottom);
+  }
+
+  void OnMouseDown(float x, float y, const IMouseMod& mod) override
+  {
+    if (mod.A)
+    {
+      mTiming.Reset();
+      return;
+    }
+
+    mStyle++;
+
+    if(mStyle == kNumStyles)
+      mStyle = kHistory;
+  }
+
+  bool IsDirty() override
+  {
+    return true;
+  }
+
+  void Draw(IGraphics& g) override
+  {
+    mTiming.GetSnapshot(mSnapshot);
+
+    // only add to the history when the audio thread has processed something since the last frame
+    if (mSnapshot.numBlocks != mLastNumBlocks)
+    {
+      mReadPos = (mReadPos+1) % MAXBUF;
+      mBuffer[mReadPos] = (float) mSnapshot.averageLoad;
+      mLastNumBlocks = mSnapshot.numBlocks;
+    }
+
+    g.FillRect(GetColor(kBG), mRECT);
+    g.DrawRect(COLOR_BLACK, mRECT);
+
+    IRECT padded = mRECT.GetPadded(-2);
+
+    if (mStyle == kHistory)
+    {
+      for (int i = 0; i < MAXBUF; i++)
+        mNormPoints[i] = std::min(mBuffer[(mReadPos+i+1) % MAXBUF], 1.0f);
+
+      g.FillData(GetColor(kFG), padded, mNormPoints, MAXBUF);
+    }
+    else
+    {
+      int64_t maxCount = 1;
+
+      for (int i = 0; i < IProcessTiming::kNumHistogramBins; i++)
+        maxCount = std::max(maxCount, mSnapshot.histogram[i]);
+
+      for (int i = 0; i < IProcessTiming::kNumHistogramBins; i++)
+      {
+        const IRECT bar = padded.SubRectHorizontal(IProcessTiming::kNumHistogramBins, i).GetPadded(-1.f);
+        const float norm = (float) mSnapshot.histogram[i] / (float) maxCount;
+        g.FillRect(i == IProcessTiming::kNumHistogramBins - 1 ? COLOR_RED : GetColor(kFG), bar.FracRectVertical(norm));
+      }
+    }
+
+    if (mNameLabel.GetLength())
+      g.DrawText(mNameLabelText, mNameLabel.Get(), padded);
+
+    WDL_String str;
+
+    if (!mTiming.GetEnabled())
+    {
+      g.DrawText(mTopLabelText, "Off", padded);
+      return;
+    }
+
+    str.SetFormatted(32, "%.1f %%", mSnapshot.averageLoad * 100.);
+    g.DrawText(mTopLabelText, str.Get(), padded);
+
+    str.SetFormatted(64, "max %.1f %%", mSnapshot.worstLoad * 100.);
+    g.DrawText(mTopLeftLabelText, str.Get(), padded);
+
+    str.SetFormatted(64, "%lld over, %lld xruns", (long long) mSnapshot.numOverruns, (long long) mSnapshot.numXruns);
+    g.DrawText(mBottomLabelText, str.Get(), padded);
+  }
+private:
+  IProcessTiming& mTiming;
+  IProcessTiming::Snapshot mSnapshot;
+  int64_t mLastNumBlocks = 0;
+  int mStyle;
+  WDL_String mNameLabel;
+  float mBuffer[MAXBUF] = {};
+  float mNormPoints[MAXBUF] = {};
+  int mReadPos = 0;
+
+  IText& mNameLabelText = mText;
+  IText mTopLeftLabelText = IText(14, GetColor(kFR), DEFAULT_FONT, EAlign::Near, EVAlign::Top);
+  IText mTopLabelText = IText(18, GetColor(kFR), DEFAULT_FONT, EAlign::Far, EVAlign::Top);
+  IText mBottomLabelText = IText(15, GetColor(kFR), DEFAULT_FONT, EAlign::Far, EVAlign::Bottom);
+};
+
+END_IGRAPHICS_NAMESPACE
+END_IPLUG_NAMESPACE
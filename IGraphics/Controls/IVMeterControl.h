@@ -17,7 +17,7 @@
  */
 
 #include "IControl.h"
-#include "IPlugQueue.h"
+#include "IPlugMessageArena.h"
 #include "IPlugStructs.h"
 
 BEGIN_IPLUG_NAMESPACE
@@ -63,7 +63,9 @@ public:
 
     void ProcessBlock(sample** inputs, int nFrames)
     {
-      Data d;
+      Data* pData = mArena.template Reserve<Data>(mControlTag, kUpdateMessage);
+      Data scratch;
+      Data& d = pData ? *pData : scratch; // if the queue is full, measure anyway to keep the threshold state
 
       for (auto s = 0; s < nFrames; s++)
       {
@@ -78,32 +80,40 @@ public:
         d.vals[c] /= (float) nFrames;
       }
 
-      if(mPrevAboveThreshold)
-        mQueue.Push(d); // TODO: expensive?
+      if(pData && mPrevAboveThreshold)
+        mArena.Commit();
+      else
+        mArena.Cancel();
 
       mPrevAboveThreshold = d.AboveThreshold();
     }
 
-    void ProcessData(Data d)
+    void ProcessData(const Data& d)
     {
-      mQueue.Push(d);
+      Data* pData = mArena.template Reserve<Data>(mControlTag, kUpdateMessage);
+
+      if(pData)
+      {
+        *pData = d;
+        mArena.Commit();
+      }
     }
 
     // this must be called on the main thread - typically in MyPlugin::OnIdle()
     void TransmitData(IEditorDelegate& dlg)
     {
-      while(mQueue.ElementsAvailable())
-      {
-        Data d;
-        mQueue.Pop(d);
-        dlg.SendControlMsgFromDelegate(mControlTag, kUpdateMessage, sizeof(Data), (void*) &d);
-      }
+      mArena.Drain([&](int controlTag, int messageTag, int dataSize, const void* pData) {
+        dlg.SendControlMsgFromDelegate(controlTag, messageTag, dataSize, pData);
+      });
     }
 
+    /** @return Statistics about the messages sent, such as the number dropped because the queue was full */
+    const IPlugMessageArena::Stats* GetStats() const { return mArena.GetStats(mControlTag); }
+
   private:
     int mControlTag;
     bool mPrevAboveThreshold = true;
-    IPlugQueue<Data> mQueue {QUEUE_SIZE};
+    IPlugMessageArena mArena {QUEUE_SIZE * IPlugMessageArena::GetMessageSize(sizeof(Data))};
   };
 
   IVMeterControl(const IRECT& bounds, const char* label, const IVStyle& style = DEFAULT_STYLE, EDirection dir = EDirection::Vertical, const char* trackNames = 0, ...)
@@ -126,18 +136,15 @@ public:
 
   void OnMsgFromDelegate(int messageTag, int dataSize, const void* pData) override
   {
-    IByteStream stream(pData, dataSize);
+    if(messageTag != kUpdateMessage || dataSize != sizeof(Data))
+      return;
 
-    int pos = 0;
     Data data;
-    pos = stream.Get(&data.nchans, pos);
+    memcpy(&data, pData, sizeof(Data)); // pData may not be aligned, if it was transferred between processes
 
-    while(pos < stream.Size())
+    for (auto i = 0; i < data.nchans; i++)
     {
-      for (auto i = 0; i < data.nchans; i++) {
-        pos = stream.Get(&data.vals[i], pos);
-        SetValue(Clip(data.vals[i], 0.f, 1.f), i);
-      }
+      SetValue(Clip(data.vals[i], 0.f, 1.f), i);
     }
 
     SetDirty(false);
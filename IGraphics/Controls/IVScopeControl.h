@@ -18,7 +18,7 @@
 
 #include "IControl.h"
 #include "IPlugStructs.h"
-#include "IPlugQueue.h"
+#include "IPlugMessageArena.h"
 
 BEGIN_IPLUG_NAMESPACE
 BEGIN_IGRAPHICS_NAMESPACE
@@ -56,7 +56,8 @@ public:
     }
   };
 
-  /** Used on the DSP side in order to queue sample values and transfer data to low priority thread. */
+  /** Used on the DSP side in order to queue sample values and transfer data to low priority thread.
+   * Samples are written directly into a slot reserved in a preallocated message arena, so no copies are made on the audio thread */
   class Sender
   {
   public:
@@ -70,18 +71,14 @@ public:
     void Process(sample* inputs)
     {
       if(mBufCount == MAXBUF)
-      {
-        if(mPrevAboveThreshold)
-          mQueue.Push(mBuf); // TODO: expensive?
-        
-        mPrevAboveThreshold = mBuf.AboveThreshold();
-        
-        mBufCount = 0;
-      }
+        Flush();
+      
+      if(mBufCount == 0)
+        Reserve();
       
       for (auto c = 0; c < MAXNC; c++)
       {
-        mBuf.vals[c][mBufCount] = (float) inputs[c];
+        mpBuf->vals[c][mBufCount] = (float) inputs[c];
       }
       
       mBufCount++;
@@ -92,44 +89,74 @@ public:
    * @param nFrames number of frames to process **/
     void ProcessBlock(sample** inputs, int nFrames)
     {
-      for (auto s = 0; s < nFrames; s++)
+      int s = 0;
+
+      while (s < nFrames)
       {
         if(mBufCount == MAXBUF)
-        {
-          if(mPrevAboveThreshold)
-            mQueue.Push(mBuf); // TODO: expensive?
+          Flush();
 
-          mPrevAboveThreshold = mBuf.AboveThreshold();
+        if(mBufCount == 0)
+          Reserve();
 
-          mBufCount = 0;
-        }
+        const int n = std::min(MAXBUF - mBufCount, nFrames - s);
 
         for (auto c = 0; c < MAXNC; c++)
         {
-          mBuf.vals[c][mBufCount] = (float) inputs[c][s];
+          float* pDest = mpBuf->vals[c] + mBufCount;
+          const sample* pSrc = inputs[c] + s;
+
+          for (auto i = 0; i < n; i++)
+          {
+            pDest[i] = (float) pSrc[i];
+          }
         }
 
-        mBufCount++;
+        mBufCount += n;
+        s += n;
       }
     }
 
     /** Sends data in the queue via IEditorDelegate. This must be called on the main thread - typically in MyPlugin::OnIdle() */
     void TransmitData(IEditorDelegate& dlg)
     {
-      Data d;
-
-      while(mQueue.ElementsAvailable())
-      {
-        mQueue.Pop(d);
-        dlg.SendControlMsgFromDelegate(mControlTag, kUpdateMessage, sizeof(Data), (void*) &d);
-      }
+      mArena.Drain([&](int controlTag, int messageTag, int dataSize, const void* pData) {
+        dlg.SendControlMsgFromDelegate(controlTag, messageTag, dataSize, pData);
+      });
     }
 
+    /** @return Statistics about the messages sent, such as the number dropped because the queue was full */
+    const IPlugMessageArena::Stats* GetStats() const { return mArena.GetStats(mControlTag); }
+
   private:
-    Data mBuf;
+    /** Start a new buffer, in the arena if there is space, otherwise in mScratch, which will be discarded */
+    void Reserve()
+    {
+      mpBuf = mArena.template Reserve<Data>(mControlTag, kUpdateMessage);
+
+      if(!mpBuf)
+        mpBuf = &mScratch;
+    }
+
+    /** Send the full buffer, if it or the previous one had any content */
+    void Flush()
+    {
+      const bool aboveThreshold = mpBuf->AboveThreshold();
+
+      if(mpBuf != &mScratch && mPrevAboveThreshold)
+        mArena.Commit();
+      else
+        mArena.Cancel();
+
+      mPrevAboveThreshold = aboveThreshold;
+      mBufCount = 0;
+    }
+
+    Data* mpBuf = nullptr;
+    Data mScratch;
     int mControlTag;
     int mBufCount = 0;
-    IPlugQueue<Data> mQueue {QUEUE_SIZE};
+    IPlugMessageArena mArena {QUEUE_SIZE * IPlugMessageArena::GetMessageSize(sizeof(Data))};
     bool mPrevAboveThreshold = true;
   };
 
@@ -160,26 +187,14 @@ public:
     
     IRECT r = mWidgetBounds.GetPadded(-mPadding);
 
-    const float maxY = (r.H() / 2.f); // y +/- centre
-
-    float xPerData = r.W() / (float) MAXBUF;
-
     for (int c = 0; c < mBuf.nchans; c++)
     {
-      float xHi = 0.f;
-      float yHi = mBuf.vals[c][0] * maxY;
-      yHi = Clip(yHi, -maxY, maxY);
-
-      g.PathMoveTo(r.L + xHi, r.MH() - yHi);
-      for (int s = 1; s < MAXBUF; s++)
+      for (int s = 0; s < MAXBUF; s++)
       {
-        xHi = ((float) s * xPerData);
-        yHi = mBuf.vals[c][s] * maxY;
-        yHi = Clip(yHi, -maxY, maxY);
-        g.PathLineTo(r.L + xHi, r.MH() - yHi);
+        mNormPoints[s] = 0.5f + 0.5f * Clip(mBuf.vals[c][s], -1.f, 1.f);
       }
-      
-      g.PathStroke(GetColor(kFG), 1.0);
+
+      g.DrawData(GetColor(kFG), r, mNormPoints, MAXBUF);
     }
   }
   
@@ -191,24 +206,16 @@ public:
 
   void OnMsgFromDelegate(int messageTag, int dataSize, const void* pData) override
   {
-    IByteStream stream(pData, dataSize);
-
-    int pos = stream.Get(&mBuf.nchans, 0);
-
-    while(pos < stream.Size())
+    if(messageTag == kUpdateMessage && dataSize == sizeof(Data))
     {
-      for (auto ch = 0; ch < mBuf.nchans; ch++) {
-        for (auto s = 0; s < MAXBUF; s++) {
-          pos = stream.Get(&mBuf.vals[ch][s], pos);
-        }
-      }
+      memcpy(&mBuf, pData, sizeof(Data));
+      SetDirty(false);
     }
-
-    SetDirty(false);
   }
 
 private:
   Data mBuf;
+  float mNormPoints[MAXBUF] = {};
   float mPadding = 2.f;
 };
 
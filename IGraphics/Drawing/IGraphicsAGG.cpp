@@ -582,22 +582,33 @@ void IGraphicsAGG::PrepareAndMeasureText(const IText& text, const char* str, IRE
   const double ascender = text.mSize * pFont->GetAscender() / EMHeight;
   const double descender = text.mSize * pFont->GetDescender() / EMHeight;
   
-  mFontManager.reset_last_glyph();
   double textWidth = 0.0;
   
-  for (int i = 0; str[i]; i++)
+  if (const MeasuredTextCache::Measurement* pMeasurement = mMeasuredText.Find(pFont, text.mSize, str))
   {
-    const agg::glyph_cache* pGlyph = mFontManager.glyph(str[i]);
+    textWidth = pMeasurement->width;
+  }
+  else
+  {
+    mFontManager.reset_last_glyph();
     
-    if (textKerning)
+    for (int i = 0; str[i]; i++)
     {
-      double dx = 0.0;
-      double dy = 0.0;
-      mFontManager.add_kerning(&dx, &dy);
-      textWidth += dx;
+      const agg::glyph_cache* pGlyph = mFontManager.glyph(str[i]);
+      
+      if (textKerning)
+      {
+        double dx = 0.0;
+        double dy = 0.0;
+        mFontManager.add_kerning(&dx, &dy);
+        textWidth += dx;
+      }
+      
+      textWidth += pGlyph->advance_x;
     }
     
-    textWidth += pGlyph->advance_x;
+    mFontManager.reset_last_glyph();
+    mMeasuredText.Add(pFont, text.mSize, str, {static_cast<float>(textWidth), static_cast<float>(textHeight)});
   }
   
   switch (text.mAlign)
@@ -290,6 +290,7 @@ private:
   IRECT mClipRECT;
   mutable FontEngineType mFontEngine;
   mutable FontManagerType mFontManager;
+  mutable MeasuredTextCache mMeasuredText;
   agg::rendering_buffer mRenBuf;
   agg::path_storage mPath;
   agg::trans_affine mTransform;
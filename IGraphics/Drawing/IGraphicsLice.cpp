@@ -183,6 +183,8 @@ IGraphicsLice::IGraphicsLice(IGEditorDelegate& dlg, int w, int h, int fps, float
 
 IGraphicsLice::~IGraphicsLice() 
 {
+  mFontLookups.Empty(true);
+
   StaticStorage<LICE_IFont>::Accessor fontStorage(sFontCache);
   StaticStorage<FontInfo>::Accessor fontInfoStorage(sFontInfoCache);
   fontStorage.Release();
@@ -244,11 +246,19 @@ void IGraphicsLice::DrawBitmap(const IBitmap& bitmap, const IRECT& bounds, int s
   
   srcX = (srcX * ds) + r.L - sr.L;
   srcY = (srcY * ds) + r.T - sr.T;
-  
-  if (preMultiplied)
-    PreMulBlit(mRenderBitmap, bitmap.GetAPIBitmap()->GetBitmap(), r.L, r.T, srcX, srcY, r.W(), r.H(), BlendWeight(pBlend), LiceBlendMode(pBlend));
-  else
-    LICE_Blit(mRenderBitmap, bitmap.GetAPIBitmap()->GetBitmap(), r.L, r.T, srcX, srcY, r.W(), r.H(), BlendWeight(pBlend), LiceBlendMode(pBlend));
+
+  LICE_IBitmap* pDest = mRenderBitmap;
+  LICE_IBitmap* pSrc = bitmap.GetAPIBitmap()->GetBitmap();
+  const int x = r.L, y = r.T, w = r.W(), h = r.H();
+  const float weight = BlendWeight(pBlend);
+  const int mode = LiceBlendMode(pBlend);
+
+  ForEachTile(y, h, w, [=](int tileTop, int tileHeight) {
+    if (preMultiplied)
+      PreMulBlit(pDest, pSrc, x, tileTop, srcX, srcY + tileTop - y, w, tileHeight, weight, mode);
+    else
+      LICE_Blit(pDest, pSrc, x, tileTop, srcX, srcY + tileTop - y, w, tileHeight, weight, mode);
+  });
 }
 
 void IGraphicsLice::DrawRotatedBitmap(const IBitmap& bitmap, float destCtrX, float destCtrY, double angle, int yOffsetZeroDeg, const IBlend* pBlend)
@@ -397,7 +407,15 @@ void IGraphicsLice::FillRect(const IColor& color, const IRECT& bounds, const IBl
 {
   IRECT r = TransformRECT(bounds).Intersect(mDrawRECT.GetScaled(GetScreenScale()));
 
-  LICE_FillRect(mRenderBitmap, r.L, r.T, r.W(), r.H(), LiceColor(color), BlendWeight(pBlend), LiceBlendMode(pBlend));
+  LICE_IBitmap* pDest = mRenderBitmap;
+  const int x = r.L, y = r.T, w = r.W(), h = r.H();
+  const LICE_pixel liceColor = LiceColor(color);
+  const float weight = BlendWeight(pBlend);
+  const int mode = LiceBlendMode(pBlend);
+
+  ForEachTile(y, h, w, [=](int tileTop, int tileHeight) {
+    LICE_FillRect(pDest, x, tileTop, w, tileHeight, liceColor, weight, mode);
+  });
 }
 
 //TODO: review floating point input support
@@ -468,6 +486,96 @@ void IGraphicsLice::FillConvexPolygon(const IColor& color, float* x, float* y, i
   LICE_FillConvexPolygon(mRenderBitmap, xpoints, ypoints, npoints, LiceColor(color), BlendWeight(pBlend), LiceBlendMode(pBlend));
 }
 
+void IGraphicsLice::DrawData(const IColor& color, const IRECT& bounds, float* normYPoints, int nPoints, float* normXPoints, const IBlend* pBlend, float thickness)
+{
+  if (!mClipRECT.Contains(bounds))
+    NeedsClipping();
+
+  if (!OpacityCheck(color, pBlend))
+  {
+    OpacityLayer(&IGraphicsLice::DrawData, pBlend, color, bounds, normYPoints, nPoints, normXPoints, nullptr, thickness);
+    return;
+  }
+
+  const float* pX;
+  const float* pY;
+  const int n = DecimateData(bounds, normYPoints, nPoints, normXPoints, pX, pY);
+  const LICE_pixel liceColor = LiceColor(color);
+  const float weight = BlendWeight(pBlend);
+  const int mode = LiceBlendMode(pBlend);
+
+  for (auto i = 1; i < n; i++)
+    LICE_FLine(mRenderBitmap, TransformX(pX[i - 1]), TransformY(pY[i - 1]), TransformX(pX[i]), TransformY(pY[i]), liceColor, weight, mode, true);
+}
+
+void IGraphicsLice::FillData(const IColor& color, const IRECT& bounds, float* normYPoints, int nPoints, float* normXPoints, const IBlend* pBlend)
+{
+  if (!mClipRECT.Contains(bounds))
+    NeedsClipping();
+
+  const float* pX;
+  const float* pY;
+  const int n = DecimateData(bounds, normYPoints, nPoints, normXPoints, pX, pY);
+
+  if (n < 1)
+    return;
+
+  // find the top of the area in each pixel column, then fill each column with a single rect, so no pixel is blended twice
+  const int left = static_cast<int>(std::floor(TransformX(bounds.L)));
+  const int nColumns = static_cast<int>(std::ceil(TransformX(bounds.R))) - left + 1;
+  const float bottom = TransformY(bounds.B);
+
+  mDataColumnTops.Resize(nColumns, false);
+  float* pTops = mDataColumnTops.Get();
+
+  for (auto c = 0; c < nColumns; c++)
+    pTops[c] = bottom;
+
+  auto addPoint = [&](float x, float y) {
+    const int c = Clip(static_cast<int>(std::floor(x)) - left, 0, nColumns - 1);
+    pTops[c] = std::min(pTops[c], y);
+  };
+
+  float x0 = TransformX(pX[0]);
+  float y0 = TransformY(pY[0]);
+  addPoint(x0, y0);
+
+  for (auto i = 1; i < n; i++)
+  {
+    const float x1 = TransformX(pX[i]);
+    const float y1 = TransformY(pY[i]);
+    addPoint(x1, y1);
+
+    // sample the segment at the centre of each column it crosses
+    if (x1 - x0 > 0.f)
+    {
+      const float slope = (y1 - y0) / (x1 - x0);
+
+      for (float xc = std::floor(x0) + 0.5f; xc < x1; xc += 1.f)
+      {
+        if (xc > x0)
+          addPoint(xc, y0 + (xc - x0) * slope);
+      }
+    }
+
+    x0 = x1;
+    y0 = y1;
+  }
+
+  const LICE_pixel liceColor = LiceColor(color);
+  const float weight = BlendWeight(pBlend);
+  const int mode = LiceBlendMode(pBlend);
+  const int b = static_cast<int>(std::round(bottom));
+
+  for (auto c = 0; c < nColumns; c++)
+  {
+    const int t = static_cast<int>(std::round(pTops[c]));
+
+    if (t < b)
+      LICE_FillRect(mRenderBitmap, left + c, t, 1, b - t, liceColor, weight, mode);
+  }
+}
+
 //TODO: review floating point input support
 void IGraphicsLice::FillCircle(const IColor& color, float cx, float cy, float r, const IBlend* pBlend)
 {
@@ -534,13 +642,21 @@ IColor IGraphicsLice::GetPoint(int x, int y)
 void IGraphicsLice::PrepareAndMeasureText(const IText& text, const char* str, IRECT& r, LICE_IFont*& pFont) const
 {
   pFont = CacheFont(text);
-  RECT R = {0, 0, 0, 0};
-  UINT fmt = DT_NOCLIP | DT_TOP | DT_LEFT | LICE_DT_USEFGALPHA;
-  
-  pFont->DrawText(mRenderBitmap, str, -1, &R, fmt | DT_CALCRECT);
-  
-  const float textWidth = R.right / static_cast<float>(GetScreenScale());
-  const float textHeight = R.bottom / static_cast<float>(GetScreenScale());
+
+  const MeasuredTextCache::Measurement* pMeasurement = mMeasuredText.Find(pFont, 0.f, str);
+
+  if (!pMeasurement)
+  {
+    RECT R = {0, 0, 0, 0};
+    UINT fmt = DT_NOCLIP | DT_TOP | DT_LEFT | LICE_DT_USEFGALPHA;
+
+    pFont->DrawText(mRenderBitmap, str, -1, &R, fmt | DT_CALCRECT);
+    mMeasuredText.Add(pFont, 0.f, str, {static_cast<float>(R.right), static_cast<float>(R.bottom)});
+    pMeasurement = mMeasuredText.Find(pFont, 0.f, str);
+  }
+
+  const float textWidth = pMeasurement->width / static_cast<float>(GetScreenScale());
+  const float textHeight = pMeasurement->height / static_cast<float>(GetScreenScale());
   float x = 0.f;
   float y = 0.f;
 
@@ -669,10 +785,16 @@ void IGraphicsLice::CompleteRegion(const IRECT& r)
   if (mClippingLayer)
   {
     const int mode = LICE_BLIT_MODE_COPY | LICE_BLIT_USE_ALPHA;
+    LICE_IBitmap* pDest = mDrawBitmap.get();
     LICE_IBitmap* bitmap = mClippingLayer->GetAPIBitmap()->GetBitmap();
     int x = mDrawOffsetX * GetScreenScale();
     int y = mDrawOffsetY * GetScreenScale();
-    PreMulBlit(mDrawBitmap.get(), bitmap, x, y, 0, 0, bitmap->getWidth(), bitmap->getHeight(), 1.f, mode);
+    const int w = bitmap->getWidth();
+
+    ForEachTile(y, bitmap->getHeight(), w, [=](int tileTop, int tileHeight) {
+      PreMulBlit(pDest, bitmap, x, tileTop, 0, tileTop - y, w, tileHeight, 1.f, mode);
+    });
+
     mClippingLayer = nullptr;
   }
   UpdateLayer();
@@ -689,6 +811,24 @@ void IGraphicsLice::UpdateLayer()
 }
 
 LICE_IFont* IGraphicsLice::CacheFont(const IText& text) const
+{
+  for (auto i = 0; i < mFontLookups.GetSize(); i++)
+  {
+    const FontLookup* pLookup = mFontLookups.Get(i);
+
+    if (pLookup->mSize == text.mSize && pLookup->mScale == GetScreenScale() && !strcmp(pLookup->mFontID.Get(), text.mFont))
+      return pLookup->mFont;
+  }
+
+  LICE_IFont* pFont = CacheStaticFont(text);
+
+  if (pFont)
+    mFontLookups.Add(new FontLookup {WDL_String(text.mFont), text.mSize, GetScreenScale(), pFont});
+
+  return pFont;
+}
+
+LICE_IFont* IGraphicsLice::CacheStaticFont(const IText& text) const
 {
   StaticStorage<FontInfo>::Accessor fontInfoStorage(sFontInfoCache);
   FontInfo* pFontInfo = fontInfoStorage.Find(text.mFont);
@@ -906,6 +1046,17 @@ void IGraphicsLice::ApplyShadowMask(ILayerPtr& layer, RawBitmapData& mask, const
   }
 }
 
+void IGraphicsLice::SetNumDrawingThreads(int numThreads)
+{
+  if (numThreads <= 0)
+    numThreads = std::max(static_cast<int>(std::thread::hardware_concurrency()), 1);
+
+  if (numThreads == (mTilePool ? mTilePool->NThreads() : 1))
+    return;
+
+  mTilePool = numThreads > 1 ? std::make_unique<TileWorkerPool>(numThreads) : nullptr;
+}
+
 void IGraphicsLice::EndFrame()
 {
 #ifdef OS_MAC
@@ -65,6 +65,7 @@ public:
   void DrawArc(const IColor& color, float cx, float cy, float r, float a1, float a2,  const IBlend* pBlend, float thickness) override;
   void DrawCircle(const IColor& color, float cx, float cy, float r,const IBlend* pBlend, float thickness) override;
   void DrawDottedRect(const IColor& color, const IRECT& bounds, const IBlend* pBlend, float thickness, float dashLen) override;
+  void DrawData(const IColor& color, const IRECT& bounds, float* normYPoints, int nPoints, float* normXPoints, const IBlend* pBlend, float thickness) override;
 
   void FillTriangle(const IColor& color, float x1, float y1, float x2, float y2, float x3, float y3, const IBlend* pBlend) override;
   void FillRect(const IColor& color, const IRECT& bounds, const IBlend* pBlend) override;
@@ -72,6 +73,7 @@ public:
   void FillConvexPolygon(const IColor& color, float* x, float* y, int npoints, const IBlend* pBlend) override;
   void FillArc(const IColor& color, float cx, float cy, float r, float a1, float a2,  const IBlend* pBlend) override;
   void FillCircle(const IColor& color, float cx, float cy, float r, const IBlend* pBlend) override;
+  void FillData(const IColor& color, const IRECT& bounds, float* normYPoints, int nPoints, float* normXPoints, const IBlend* pBlend) override;
     
   IColor GetPoint(int x, int y) override;
   void* GetDrawContext() override { return mDrawBitmap.get(); }
@@ -101,6 +103,8 @@ protected:
   void DoDrawText(const IText& text, const char* str, const IRECT& bounds, const IBlend* pBlend) override;
 
   void EndFrame() override;
+
+  void SetNumDrawingThreads(int numThreads) override;
     
   float GetBackingPixelScale() const override { return (float) GetScreenScale(); };
 
@@ -133,6 +137,29 @@ private:
     return tr;
   }
     
+  /** Split rows into horizontal tiles, and call func(tileTop, tileHeight) for each one, on the drawing threads if the area is large enough.
+   * Only use this for operations where each pixel doesn't depend on the others, so that the result is the same however the rows are split */
+  template <typename F>
+  void ForEachTile(int top, int height, int width, F&& func)
+  {
+    const int64_t area = static_cast<int64_t>(width) * height;
+    const int numTiles = mTilePool ? static_cast<int>(std::min<int64_t>({ area / TILE_MIN_PIXELS, height, mTilePool->NThreads() * 2 })) : 1;
+
+    if (numTiles <= 1)
+    {
+      func(top, height);
+      return;
+    }
+
+    auto tileFunc = [&](int tileIdx) {
+      const int tileTop = top + height * tileIdx / numTiles;
+      const int tileBottom = top + height * (tileIdx + 1) / numTiles;
+      func(tileTop, tileBottom - tileTop);
+    };
+
+    mTilePool->ForEachTile(numTiles, tileFunc);
+  }
+
   void NeedsClipping();
   void PrepareRegion(const IRECT& r) override;
   void CompleteRegion(const IRECT& r) override;
@@ -140,6 +167,7 @@ private:
   void UpdateLayer() override;
     
   LICE_IFont* CacheFont(const IText& text) const;
+  LICE_IFont* CacheStaticFont(const IText& text) const;
 
   IRECT mDrawRECT;
   IRECT mClipRECT;
@@ -155,6 +183,23 @@ private:
   LICE_IBitmap* mRenderBitmap = nullptr;
     
   ILayerPtr mClippingLayer;
+
+  std::unique_ptr<TileWorkerPool> mTilePool;
+
+  /** Fonts previously used by this instance, so that drawing text doesn't need to lock and search the static font caches.
+   * Each LICE_CachedFont keeps the glyphs it has rendered, so this also acts as a glyph atlas per font, size and scale */
+  struct FontLookup
+  {
+    WDL_String mFontID;
+    float mSize;
+    int mScale;
+    LICE_IFont* mFont;
+  };
+
+  mutable WDL_PtrList<FontLookup> mFontLookups;
+  mutable MeasuredTextCache mMeasuredText;
+
+  WDL_TypedBuf<float> mDataColumnTops; // scratch for FillData()
   
   static StaticStorage<LICE_IFont> sFontCache;
   static StaticStorage<FontInfo> sFontInfoCache;
@@ -97,6 +97,20 @@ IControl::IControl(const IRECT& bounds, IActionFunction actionFunc)
 {
 }
 
+IControl::~IControl()
+{
+  if (mCachedLayer && mGraphics)
+    mGraphics->ReleaseCachedLayer(*this);
+}
+
+void IControl::SetUseLayerCache(bool use)
+{
+  mUseLayerCache = use;
+
+  if (!use && mCachedLayer && mGraphics)
+    mGraphics->ReleaseCachedLayer(*this);
+}
+
 int IControl::GetParamIdx(int valIdx) const
 {
   assert(valIdx > kNoValIdx && valIdx < NVals());
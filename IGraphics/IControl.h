@@ -75,7 +75,7 @@ public:
   void operator=(const IControl&) = delete;
   
   /** Destructor. Clean up any resources that your control owns. */
-  virtual ~IControl() {}
+  virtual ~IControl();
 
   /** Implement this method to respond to a mouse down event on this control. 
    * @param x The X coordinate of the mouse event
@@ -388,6 +388,16 @@ public:
   /** @return /c true if this control wants to know about MIDI messages send to the UI. See OnMIDIMsg() */
   bool GetWantsMidi() const { return mWantsMidi; }
 
+  /** Have IGraphics draw this control into a cached layer, and draw the layer when the control is redrawn because something overlapping it changed.
+   * The layer is drawn again when the control is dirty (its value, style etc. changed), when its bounds change or when the scale changes.
+   * Useful for static backgrounds, panels, labels and SVGs that are expensive to draw. Not suitable for controls that are dirty every frame, or that blend with what is drawn beneath them.
+   * Cached layers are released, least recently drawn first, to stay within IGraphics::SetLayerCacheBudget()
+   * @param use \c true to cache this control's drawing */
+  void SetUseLayerCache(bool use);
+
+  /** @return \c true if this control's drawing is cached in a layer, see SetUseLayerCache() */
+  bool GetUseLayerCache() const { return mUseLayerCache; }
+
   /** Gets a pointer to the class implementing the IEditorDelegate interface that handles parameter changes from this IGraphics instance.
    * If you need to call other methods on that class, you can use static_cast<PLUG_CLASS_NAME>(GetDelegate();
    * @return The class implementing the IEditorDelegate interface that handles communication to/from from this IGraphics instance.*/
@@ -522,8 +532,13 @@ protected:
 #endif
   
 private:
+  friend IGraphics;
+
   IGEditorDelegate* mDelegate = nullptr;
   IGraphics* mGraphics = nullptr;
+  bool mUseLayerCache = false;
+  ILayerPtr mCachedLayer; // see SetUseLayerCache(), managed by IGraphics
+  uint32_t mCachedLayerLastUsed = 0;
   IActionFunction mActionFunc = nullptr;
   IAnimationFunction mAnimationFunc = nullptr;
   TimePoint mAnimationStartTime;
@@ -615,11 +615,125 @@ void IGraphics::DrawGrid(const IColor& color, const IRECT& bounds, float gridSiz
 
 void IGraphics::DrawData(const IColor& color, const IRECT& bounds, float* normYPoints, int nPoints, float* normXPoints, const IBlend* pBlend, float thickness)
 {
-  //TODO:
+  const float* pX;
+  const float* pY;
+  const int n = DecimateData(bounds, normYPoints, nPoints, normXPoints, pX, pY);
+
+  for (auto i = 1; i < n; i++)
+    DrawLine(color, pX[i - 1], pY[i - 1], pX[i], pY[i], pBlend, thickness);
+}
+
+void IGraphics::FillData(const IColor& color, const IRECT& bounds, float* normYPoints, int nPoints, float* normXPoints, const IBlend* pBlend)
+{
+  const float* pX;
+  const float* pY;
+  const int n = DecimateData(bounds, normYPoints, nPoints, normXPoints, pX, pY);
+
+  for (auto i = 1; i < n; i++)
+  {
+    float x[4] = {pX[i - 1], pX[i], pX[i], pX[i - 1]};
+    float y[4] = {pY[i - 1], pY[i], bounds.B, bounds.B};
+    FillConvexPolygon(color, x, y, 4, pBlend);
+  }
+}
+
+int IGraphics::DecimateData(const IRECT& bounds, const float* normYPoints, int nPoints, const float* normXPoints, const float*& pX, const float*& pY)
+{
+  const float pixelScale = GetBackingPixelScale();
+  const int nColumns = std::max(1, static_cast<int>(std::ceil(bounds.W() * pixelScale)));
+  // at most four points are kept per column, so only decimate when that reduces the count
+  const int maxPoints = (nPoints > nColumns * 4) ? nColumns * 4 : nPoints;
+
+  mDecimatedData.Resize(std::max(maxPoints, 1) * 2, false);
+  float* pOutX = mDecimatedData.Get();
+  float* pOutY = pOutX + maxPoints;
+  pX = pOutX;
+  pY = pOutY;
+
+  auto getX = [&](int i) {
+    if (normXPoints)
+      return bounds.L + bounds.W() * normXPoints[i];
+    else
+      return bounds.L + (nPoints > 1 ? bounds.W() * (float) i / (float) (nPoints - 1) : 0.f);
+  };
+
+  auto getY = [&](int i) {
+    return bounds.B - bounds.H() * normYPoints[i];
+  };
+
+  if (maxPoints == nPoints)
+  {
+    for (auto i = 0; i < nPoints; i++)
+    {
+      pOutX[i] = getX(i);
+      pOutY[i] = getY(i);
+    }
+
+    return nPoints;
+  }
+
+  int n = 0;
+  int column = -1;
+  int first = 0, last = 0, min = 0, max = 0;
+
+  auto addPoint = [&](int i) {
+    pOutX[n] = getX(i);
+    pOutY[n] = getY(i);
+    n++;
+  };
+
+  // emit the points of a column in the order they occur in the data, so that the line doesn't double back
+  auto flushColumn = [&]() {
+    const int lo = std::min(min, max);
+    const int hi = std::max(min, max);
+
+    addPoint(first);
+
+    if (lo != first)
+      addPoint(lo);
+
+    if (hi != lo && hi != first)
+      addPoint(hi);
+
+    if (last != hi && last != first)
+      addPoint(last);
+  };
+
+  for (auto i = 0; i < nPoints; i++)
+  {
+    const int c = Clip(static_cast<int>((getX(i) - bounds.L) * pixelScale), 0, nColumns - 1);
+
+    if (c != column)
+    {
+      if (column >= 0 && n + 4 <= maxPoints)
+        flushColumn();
+
+      column = c;
+      first = last = min = max = i;
+    }
+    else
+    {
+      last = i;
+
+      if (normYPoints[i] < normYPoints[min])
+        min = i;
+
+      if (normYPoints[i] > normYPoints[max])
+        max = i;
+    }
+  }
+
+  if (column >= 0 && n + 4 <= maxPoints)
+    flushColumn();
+
+  return n;
 }
 
 bool IGraphics::IsDirty(IRECTList& rects)
 {
+  if (mDelegate)
+    mDelegate->OnUIFrame();
+
   bool dirty = false;
     
   auto func = [&dirty, &rects](IControl& control)
@@ -629,6 +743,9 @@ bool IGraphics::IsDirty(IRECTList& rects)
       // N.B padding outlines for single line outlines
       rects.Add(control.GetRECT().GetPadded(0.75));
       dirty = true;
+
+      if (control.mCachedLayer)
+        control.mCachedLayer->Invalidate();
     }
   };
     
@@ -682,7 +799,12 @@ void IGraphics::DrawControl(IControl* pControl, const IRECT& bounds, float scale
       return;
     
     PrepareRegion(clipBounds);
-    pControl->Draw(*this);
+
+    if (pControl->GetUseLayerCache() && mLayers.empty())
+      DrawCachedControl(pControl);
+    else
+      pControl->Draw(*this);
+
 #ifdef AAX_API
     pControl->DrawPTHighlight(*this);
 #endif
@@ -698,6 +820,97 @@ void IGraphics::DrawControl(IControl* pControl, const IRECT& bounds, float scale
   }
 }
 
+static int64_t GetLayerBytes(const ILayerPtr& layer)
+{
+  const APIBitmap* pBitmap = layer->GetAPIBitmap();
+  return pBitmap ? static_cast<int64_t>(pBitmap->GetWidth()) * pBitmap->GetHeight() * 4 : 0;
+}
+
+void IGraphics::DrawCachedControl(IControl* pControl)
+{
+  ILayerPtr& layer = pControl->mCachedLayer;
+
+  if (CheckLayer(layer))
+  {
+    mLayerCacheStats.hits++;
+  }
+  else
+  {
+    if (layer)
+      ReleaseCachedLayer(*pControl);
+
+    mLayerCacheStats.misses++;
+
+    // N.B. the same padding as DrawControl() allows single line outlines
+    const IRECT bounds = pControl->GetRECT().GetPadded(0.75);
+    const IRECT alignedBounds = bounds.GetPixelAligned(GetBackingPixelScale());
+    const int64_t w = static_cast<int64_t>(std::ceil(GetBackingPixelScale() * std::ceil(alignedBounds.W())));
+    const int64_t h = static_cast<int64_t>(std::ceil(GetBackingPixelScale() * std::ceil(alignedBounds.H())));
+    const int64_t bytes = w * h * 4;
+
+    if (bytes > mLayerCacheBudget)
+    {
+      pControl->Draw(*this);
+      return;
+    }
+
+    EvictCachedLayers(mLayerCacheBudget - bytes);
+
+    StartLayer(pControl, bounds);
+    pControl->Draw(*this);
+    layer = EndLayer();
+
+    mLayerCacheStats.numLayers++;
+    mLayerCacheStats.bytesResident += GetLayerBytes(layer);
+  }
+
+  pControl->mCachedLayerLastUsed = ++mLayerCacheClock;
+  DrawLayer(layer);
+}
+
+void IGraphics::EvictCachedLayers(int64_t maxBytes)
+{
+  while (mLayerCacheStats.bytesResident > maxBytes)
+  {
+    IControl* pOldest = nullptr;
+
+    // the clock can wrap, so compare ages rather than times
+    ForAllControlsFunc([&](IControl& control) {
+      if (control.mCachedLayer && (!pOldest || mLayerCacheClock - control.mCachedLayerLastUsed > mLayerCacheClock - pOldest->mCachedLayerLastUsed))
+        pOldest = &control;
+    });
+
+    if (!pOldest)
+      break;
+
+    ReleaseCachedLayer(*pOldest);
+    mLayerCacheStats.evictions++;
+  }
+}
+
+void IGraphics::ReleaseCachedLayer(IControl& control)
+{
+  if (!control.mCachedLayer)
+    return;
+
+  mLayerCacheStats.numLayers--;
+  mLayerCacheStats.bytesResident -= GetLayerBytes(control.mCachedLayer);
+  control.mCachedLayer = nullptr;
+}
+
+void IGraphics::SetLayerCacheBudget(int64_t bytes)
+{
+  mLayerCacheBudget = bytes;
+  EvictCachedLayers(bytes);
+}
+
+void IGraphics::ResetLayerCacheStats()
+{
+  mLayerCacheStats.hits = 0;
+  mLayerCacheStats.misses = 0;
+  mLayerCacheStats.evictions = 0;
+}
+
 void IGraphics::Draw(const IRECT& bounds, float scale)
 {
   ForAllControlsFunc([this, bounds, scale](IControl& control) { DrawControl(&control, bounds, scale); });
@@ -1602,83 +1815,62 @@ void IGraphics::DrawRotatedLayer(const ILayerPtr& layer, double angle)
 
 void IGraphics::ApplyLayerDropShadow(ILayerPtr& layer, const IShadow& shadow)
 {
-  auto GaussianBlurSwap = [](uint8_t* out, uint8_t* in, uint8_t* kernel, int width, int height,
-                             int outStride, int inStride, int kernelSize, uint32_t norm)
-  {
-    for (int i = 0; i < height; i++, in += inStride)
-    {
-      for (int j = 0; j < kernelSize - 1; j++)
-      {
-        uint32_t accum = in[j * 4] * kernel[0];
-        for (int k = 1; k < j + 1; k++)
-          accum += kernel[k] * in[(j - k) * 4];
-        for (int k = 1; k < kernelSize; k++)
-          accum += kernel[k] * in[(j + k) * 4];
-        out[j * outStride + (i * 4)] = static_cast<uint8_t>(std::min(static_cast<uint32_t>(255), accum / norm));
-      }
-      for (int j = kernelSize - 1; j < (width - kernelSize) + 1; j++)
-      {
-        uint32_t accum = in[j * 4] * kernel[0];
-        for (int k = 1; k < kernelSize; k++)
-          accum += kernel[k] * (in[(j - k) * 4] + in[(j + k) * 4]);
-        out[j * outStride + (i * 4)] = static_cast<uint8_t>(std::min(static_cast<uint32_t>(255), accum / norm));
-      }
-      for (int j = (width - kernelSize) + 1; j < width; j++)
-      {
-        uint32_t accum = in[j * 4] * kernel[0];
-        for (int k = 1; k < kernelSize; k++)
-          accum += kernel[k] * in[(j - k) * 4];
-        for (int k = 1; k < width - j; k++)
-          accum += kernel[k] * in[(j + k) * 4];
-        out[j * outStride + (i * 4)] = static_cast<uint8_t>(std::min(static_cast<uint32_t>(255), accum / norm));
-      }
-    }
-  };
+  RawBitmapData& data = mShadowData;
   
-  RawBitmapData temp1;
-  RawBitmapData temp2;
-  RawBitmapData kernel;
-    
   // Get bitmap in 32-bit form
-  GetLayerBitmapData(layer, temp1);
+  GetLayerBitmapData(layer, data);
     
-  if (!temp1.GetSize())
+  if (!data.GetSize())
       return;
-  temp2.Resize(temp1.GetSize());
     
-  // Form kernel (reference blurSize from zero (which will be no blur))
+  // The blur approximates a gaussian kernel of size blurSize (from zero, which will be no blur) that extends to three standard deviations
   bool flipped = FlippedBitmap();
   float scale = layer->GetAPIBitmap()->GetScale() * layer->GetAPIBitmap()->GetDrawScale();
   float blurSize = std::max(1.f, (shadow.mBlurSize * scale) + 1.f);
-  float blurConst = 4.5f / (blurSize * blurSize);
-  int iSize = static_cast<int>(ceil(blurSize));
+  float sigma = blurSize / 3.f;
   int width = layer->GetAPIBitmap()->GetWidth();
   int height = layer->GetAPIBitmap()->GetHeight();
-  int stride1 = temp1.GetSize() / width;
-  int stride2 = flipped ? -temp1.GetSize() / height : temp1.GetSize() / height;
-  int stride3 = flipped ? -stride2 : stride2;
+  int stride = data.GetSize() / height;
+  int inStride = flipped ? -stride : stride;
 
-  kernel.Resize(iSize);
-        
-  for (int i = 0; i < iSize; i++)
-    kernel.Get()[i] = static_cast<uint8_t>(std::round(255.f * std::expf(-(i * i) * blurConst)));
-  
-  // Kernel normalisation
-  int normFactor = kernel.Get()[0];
-    
-  for (int i = 1; i < iSize; i++)
-    normFactor += kernel.Get()[i] + kernel.Get()[i];
-  
-  // Do blur
-  uint8_t* asRows = temp1.Get() + AlphaChannel();
-  uint8_t* inRows = flipped ? asRows + stride3 * (height - 1) : asRows;
-  uint8_t* asCols = temp2.Get() + AlphaChannel();
-  
-  GaussianBlurSwap(asCols, inRows, kernel.Get(), width, height, stride1, stride2, iSize, normFactor);
-  GaussianBlurSwap(asRows, asCols, kernel.Get(), height, width, stride3, stride1, iSize, normFactor);
+  mShadowPlane.Resize(width * height, false);
+
+  if (mShadowPlane.GetSize() != width * height)
+    return;
+
+  // Gather the alpha channel into a plane, the right way up, and blur it unless the same plane was blurred recently
+  uint8_t* alpha = data.Get() + AlphaChannel();
+  uint8_t* inRows = flipped ? alpha + stride * (height - 1) : alpha;
+  uint8_t* plane = mShadowPlane.Get();
+
+  for (int i = 0; i < height; i++, inRows += inStride)
+  {
+    for (int j = 0; j < width; j++)
+      plane[i * width + j] = inRows[j * 4];
+  }
+
+  const uint64_t hash = ShadowMaskCache::Hash(plane, width * height);
+
+  if (const uint8_t* cached = mShadowMaskCache.Find(hash, width, height, sigma))
+  {
+    memcpy(plane, cached, width * height);
+  }
+  else
+  {
+    mShadowBlur.Process(plane, width, height, sigma);
+    mShadowMaskCache.Add(hash, width, height, sigma, plane);
+  }
+
+  for (int i = 0; i < height; i++)
+  {
+    uint8_t* outRow = alpha + i * stride;
+
+    for (int j = 0; j < width; j++)
+      outRow[j * 4] = plane[i * width + j];
+  }
   
   // Apply alphas to the pattern and recombine/replace the image
-  ApplyShadowMask(layer, temp1, shadow);
+  ApplyShadowMask(layer, data, shadow);
 }
 
 bool IGraphics::LoadFont(const char* fontID, const char* fileNameOrResID)
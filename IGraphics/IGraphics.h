@@ -459,15 +459,25 @@ public:
    * @param thickness Optional line thickness */
   virtual void DrawGrid(const IColor& color, const IRECT& bounds, float gridSizeH, float gridSizeV, const IBlend* pBlend = 0, float thickness = 1.f);
 
-  /** /todo
-   * @param color /todo
-   * @param bounds /todo
-   * @param normYPoints /todo
-   * @param nPoints /todo
-   * @param normXPoints /todo
-   * @param pBlend /todo
-   * @param thickness /todo */
+  /** Draw a line through a series of data points, for example a waveform or a spectrum. When there are more points than pixels, the data is
+   * reduced to the first, minimum, maximum and last point within each pixel column before drawing, so the cost depends on the width of bounds rather than on nPoints
+   * @param color The color to draw the line with
+   * @param bounds The rectangular region to draw the data in
+   * @param normYPoints Array of nPoints normalized y values, 0 is the bottom of bounds and 1 the top
+   * @param nPoints The number of data points
+   * @param normXPoints Optional array of nPoints normalized, increasing x values. If nullptr the points are spread evenly across bounds
+   * @param pBlend Optional blend method, see IBlend documentation
+   * @param thickness Optional line thickness */
   virtual void DrawData(const IColor& color, const IRECT& bounds, float* normYPoints, int nPoints, float* normXPoints = nullptr, const IBlend* pBlend = 0, float thickness = 1.f);
+
+  /** Fill the area between a series of data points and the bottom of bounds, for example a spectrum. The data is decimated in the same way as DrawData()
+   * @param color The color to fill the area with
+   * @param bounds The rectangular region to fill the data in
+   * @param normYPoints Array of nPoints normalized y values, 0 is the bottom of bounds and 1 the top
+   * @param nPoints The number of data points
+   * @param normXPoints Optional array of nPoints normalized, increasing x values. If nullptr the points are spread evenly across bounds
+   * @param pBlend Optional blend method, see IBlend documentation */
+  virtual void FillData(const IColor& color, const IRECT& bounds, float* normYPoints, int nPoints, float* normXPoints = nullptr, const IBlend* pBlend = 0);
   
   /** Load a font to be used by the graphics context
    * @param fontID A CString that will be used to reference the font
@@ -517,7 +527,7 @@ public:
    * @param angle /todo */
   void DrawRotatedLayer(const ILayerPtr& layer, double angle);
     
-  /** Applies a dropshadow directly onto a layer
+  /** Applies a dropshadow directly onto a layer. The blurred shadows of recent layers are cached, so reapplying the same shadow to a layer with the same content is cheap
   * @param layer - the layer to add the shadow to 
   * @param shadow - the shadow to add */
   void ApplyLayerDropShadow(ILayerPtr& layer, const IShadow& shadow);
@@ -906,6 +916,23 @@ public:
    * @param valIdx The value index for the control value that the prompt relates to */
   void PromptUserInput(IControl& control, const IRECT& bounds, int valIdx = 0);
 
+  /** Set the memory budget for the layers cached by controls that use IControl::SetUseLayerCache(). The least recently drawn layers are released to stay within it
+   * @param bytes The budget in bytes of backing pixels, so a layer takes 4 bytes per pixel at the current screen and draw scale */
+  void SetLayerCacheBudget(int64_t bytes);
+
+  /** @return The memory budget for cached layers in bytes */
+  int64_t GetLayerCacheBudget() const { return mLayerCacheBudget; }
+
+  /** @return Statistics for the cached layers, e.g. to check that a control is worth caching */
+  const ILayerCacheStats& GetLayerCacheStats() const { return mLayerCacheStats; }
+
+  /** Reset the hit, miss and eviction counts of the cached layer statistics */
+  void ResetLayerCacheStats();
+
+  /** Release a control's cached layer. Called when the control is deleted or stops using the cache
+   * @param control The control */
+  void ReleaseCachedLayer(IControl& control);
+
   /** Shows a pop up/contextual menu in relation to a rectangular region of the graphics context
    * @param control A reference to the IControl creating this pop-up menu. If it exists IControl::OnPopupMenuSelection() will be called on successful selection
    * @param menu Reference to an IPopupMenu class populated with the items for the platform menu
@@ -970,6 +997,11 @@ public:
   /** Enables strict drawing mode. \todo explain strict drawing
    * @param strict Set /true to enable strict drawing mode */
   void SetStrictDrawing(bool strict);
+
+  /** Set how many threads a software backend uses to rasterize large areas, such as full size bitmaps, fills and the composite of clipped regions.
+   * Controls are still drawn on the UI thread, and the result is identical to using a single thread. Only IGraphicsLice supports this, other backends ignore it
+   * @param numThreads The number of threads including the UI thread, 1 to only use the UI thread or 0 to use one thread per processor core */
+  virtual void SetNumDrawingThreads(int numThreads) {}
   
   void SetLayoutOnResize(bool layoutOnResize);
 
@@ -1095,6 +1127,14 @@ private:
    * @param bounds /todo
    * @param scale /todo */
   void DrawControl(IControl* pControl, const IRECT& bounds, float scale);
+
+  /** Draw a control that uses IControl::SetUseLayerCache(), from its cached layer if it is still valid
+   * @param pControl The control */
+  void DrawCachedControl(IControl* pControl);
+
+  /** Release the least recently drawn cached layers until the cached layers use at most maxBytes
+   * @param maxBytes The size to shrink the cache to */
+  void EvictCachedLayers(int64_t maxBytes);
   
   /** Shows a pop up/contextual menu in relation to a rectangular region of the graphics context
    * @param control A reference to the IControl creating this pop-up menu. If it exists IControl::OnPopupMenuSelection() will be called on successful selection
@@ -1481,6 +1521,16 @@ protected:
   
   /** @return float /todo */
   virtual float GetBackingPixelScale() const = 0;
+
+  /** Convert data points for DrawData() or FillData() to coordinates within bounds, keeping only the first, minimum, maximum and last point in each pixel column when there are more points than pixels
+   * @param bounds The rectangular region the data is drawn in
+   * @param normYPoints Array of nPoints normalized y values
+   * @param nPoints The number of data points
+   * @param normXPoints Optional array of nPoints normalized, increasing x values, or nullptr to spread the points evenly
+   * @param pX Set to an array of the resulting x coordinates, valid until the next call
+   * @param pY Set to an array of the resulting y coordinates, valid until the next call
+   * @return The number of resulting points */
+  int DecimateData(const IRECT& bounds, const float* normYPoints, int nPoints, const float* normXPoints, const float*& pX, const float*& pY);
   
 #pragma mark -
 
@@ -1493,6 +1543,11 @@ private:
   
   WDL_PtrList<IControl> mControls;
 
+  // Layers cached by controls that use IControl::SetUseLayerCache(), declared before the special controls below so it outlives them
+  ILayerCacheStats mLayerCacheStats;
+  int64_t mLayerCacheBudget = LAYER_CACHE_BUDGET;
+  uint32_t mLayerCacheClock = 0;
+
   // Order (front-to-back) ToolTip / PopUp / TextEntry / LiveEdit / Corner / PerfDisplay
   std::unique_ptr<ICornerResizerControl> mCornerResizer;
   std::unique_ptr<IPopupMenuControl> mPopupControl;
@@ -1501,6 +1556,12 @@ private:
   std::unique_ptr<IControl> mLiveEdit;
   
   IPopupMenu mPromptPopupMenu;
+
+  // Scratch memory and cache for ApplyLayerDropShadow()
+  RawBitmapData mShadowData;
+  RawBitmapData mShadowPlane;
+  AlphaBoxBlur mShadowBlur;
+  ShadowMaskCache mShadowMaskCache;
   
   WDL_String mSharedResourcesSubPath;
   
@@ -1539,6 +1600,7 @@ private:
   EUIResizerMode mGUISizeMode = EUIResizerMode::Scale;
   double mPrevTimestamp = 0.;
   IKeyHandlerFunc mKeyHandlerFunc = nullptr;
+  WDL_TypedBuf<float> mDecimatedData; // x coordinates followed by y coordinates, see DecimateData()
 protected:
   IGEditorDelegate* mDelegate;
   void* mPlatformContext = nullptr;
@@ -23,6 +23,14 @@ static constexpr int IDLE_TICKS = 20;
 
 static constexpr int DEFAULT_ANIMATION_DURATION = 100;
 
+#ifndef LAYER_CACHE_BUDGET
+#define LAYER_CACHE_BUDGET (32 * 1024 * 1024) // bytes of backing pixels for layers cached by controls that use IControl::SetUseLayerCache()
+#endif
+
+#ifndef TILE_MIN_PIXELS
+#define TILE_MIN_PIXELS (64 * 1024) // the smallest tile, in backing pixels, that software backends give to a drawing thread. See IGraphics::SetNumDrawingThreads()
+#endif
+
 #ifndef CONTROL_BOUNDS_COLOR
 #define CONTROL_BOUNDS_COLOR COLOR_GREEN
 #endif
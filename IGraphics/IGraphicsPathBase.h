@@ -88,24 +88,41 @@ public:
   
   void DrawData(const IColor& color, const IRECT& bounds, float* normYPoints, int nPoints, float* normXPoints, const IBlend* pBlend, float thickness) override
   {
-    PathClear();
-    
-    float xPos = bounds.L;
+    const float* pX;
+    const float* pY;
+    const int n = DecimateData(bounds, normYPoints, nPoints, normXPoints, pX, pY);
 
-    PathMoveTo(xPos, bounds.B - (bounds.H() * normYPoints[0]));
+    if (n < 2)
+      return;
 
-    for (auto i = 1; i < nPoints; i++)
-    {
-      if(normXPoints)
-        xPos = bounds.L + (bounds.W() * normXPoints[i]);
-      else
-        xPos = bounds.L + ((bounds.W() / (float) (nPoints - 1) * i));
-      
-      PathLineTo(xPos, bounds.B - (bounds.H() * normYPoints[i]));
-    }
+    PathClear();
+    PathMoveTo(pX[0], pY[0]);
+
+    for (auto i = 1; i < n; i++)
+      PathLineTo(pX[i], pY[i]);
     
     PathStroke(color, thickness, IStrokeOptions(), pBlend);
   }
+
+  void FillData(const IColor& color, const IRECT& bounds, float* normYPoints, int nPoints, float* normXPoints, const IBlend* pBlend) override
+  {
+    const float* pX;
+    const float* pY;
+    const int n = DecimateData(bounds, normYPoints, nPoints, normXPoints, pX, pY);
+
+    if (n < 2)
+      return;
+
+    PathClear();
+    PathMoveTo(pX[0], bounds.B);
+
+    for (auto i = 0; i < n; i++)
+      PathLineTo(pX[i], pY[i]);
+
+    PathLineTo(pX[n - 1], bounds.B);
+    PathClose();
+    PathFill(color, IFillOptions(), pBlend);
+  }
   
   void DrawDottedLine(const IColor& color, float x1, float y1, float x2, float y2, const IBlend* pBlend, float thickness, float dashLen) override
   {
@@ -15,9 +15,18 @@
  * @{
  */
 
+#include <algorithm>
+#include <atomic>
+#include <cmath>
 #include <codecvt>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
 #include <string>
 #include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 #include "mutex.h"
 #include "wdlstring.h"
@@ -599,6 +608,579 @@ private:
   WDL_PtrList<DataKey> mDatas;
 };
 
+/** A least recently used cache of text measurements, keyed by font, size and string.
+ * Labels and parameter readouts are redrawn with the same text far more often than it changes, so each string only needs to be measured once.
+ * Not thread safe - each IGraphics instance owns one, which is only used on the main thread */
+class MeasuredTextCache
+{
+public:
+  /** The measured size of a string, in the units used by the backend */
+  struct Measurement
+  {
+    float width;
+    float height;
+  };
+
+  /** @param capacity The maximum number of strings to keep */
+  MeasuredTextCache(int capacity = 256)
+  : mCapacity(capacity)
+  {
+    mEntries.resize(capacity);
+    mBuckets.resize(capacity * 2);
+    Clear();
+  }
+
+  MeasuredTextCache(const MeasuredTextCache&) = delete;
+  MeasuredTextCache& operator=(const MeasuredTextCache&) = delete;
+
+  /** @param pFont Identifies the font, e.g. a pointer to the backend's font object
+   * @param size The font size, or 0 if pFont already identifies the size
+   * @param str The string
+   * @return The cached measurement, or nullptr if the string hasn't been measured with this font and size */
+  const Measurement* Find(const void* pFont, float size, const char* str)
+  {
+    const uint32_t hash = Hash(pFont, size, str);
+
+    for (int i = mBuckets[hash % mBuckets.size()]; i >= 0; i = mEntries[i].bucketNext)
+    {
+      Entry& entry = mEntries[i];
+
+      if (entry.hash == hash && entry.pFont == pFont && entry.size == size && !strcmp(entry.str.Get(), str))
+      {
+        MoveToFront(i);
+        return &entry.measurement;
+      }
+    }
+
+    return nullptr;
+  }
+
+  /** Add a measurement, evicting the least recently used one if the cache is full */
+  void Add(const void* pFont, float size, const char* str, const Measurement& measurement)
+  {
+    int i;
+
+    if (mNumUsed < mCapacity)
+    {
+      i = mNumUsed++;
+    }
+    else
+    {
+      i = mTail;
+      Unlink(i);
+      RemoveFromBucket(i);
+    }
+
+    Entry& entry = mEntries[i];
+    entry.hash = Hash(pFont, size, str);
+    entry.pFont = pFont;
+    entry.size = size;
+    entry.str.Set(str);
+    entry.measurement = measurement;
+
+    int& bucket = mBuckets[entry.hash % mBuckets.size()];
+    entry.bucketNext = bucket;
+    bucket = i;
+
+    LinkAtFront(i);
+  }
+
+  /** Remove all measurements, e.g. when fonts are unloaded */
+  void Clear()
+  {
+    std::fill(mBuckets.begin(), mBuckets.end(), -1);
+
+    mNumUsed = 0;
+    mHead = mTail = -1;
+  }
+
+private:
+  struct Entry
+  {
+    uint32_t hash;
+    const void* pFont;
+    float size;
+    WDL_FastString str;
+    Measurement measurement;
+    int prev, next; // LRU list, most recently used at the head
+    int bucketNext; // hash chain
+  };
+
+  static uint32_t Hash(const void* pFont, float size, const char* str)
+  {
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    auto add = [&hash](const unsigned char* pBytes, size_t n) {
+      for (size_t i = 0; i < n; i++)
+        hash = (hash ^ pBytes[i]) * 16777619u;
+    };
+
+    add((const unsigned char*) &pFont, sizeof(pFont));
+    add((const unsigned char*) &size, sizeof(size));
+    add((const unsigned char*) str, strlen(str));
+
+    return hash;
+  }
+
+  void Unlink(int i)
+  {
+    Entry& entry = mEntries[i];
+
+    if (entry.prev >= 0) mEntries[entry.prev].next = entry.next;
+    else mHead = entry.next;
+
+    if (entry.next >= 0) mEntries[entry.next].prev = entry.prev;
+    else mTail = entry.prev;
+  }
+
+  void LinkAtFront(int i)
+  {
+    Entry& entry = mEntries[i];
+    entry.prev = -1;
+    entry.next = mHead;
+
+    if (mHead >= 0)
+      mEntries[mHead].prev = i;
+
+    mHead = i;
+
+    if (mTail < 0)
+      mTail = i;
+  }
+
+  void MoveToFront(int i)
+  {
+    if (mHead != i)
+    {
+      Unlink(i);
+      LinkAtFront(i);
+    }
+  }
+
+  void RemoveFromBucket(int i)
+  {
+    int* pLink = &mBuckets[mEntries[i].hash % mBuckets.size()];
+
+    while (*pLink != i)
+      pLink = &mEntries[*pLink].bucketNext;
+
+    *pLink = mEntries[i].bucketNext;
+  }
+
+  int mCapacity;
+  int mNumUsed = 0;
+  int mHead = -1;
+  int mTail = -1;
+  std::vector<Entry> mEntries;
+  std::vector<int> mBuckets;
+};
+
+/** Blurs an 8-bit plane with three successive box blurs, which approximate a Gaussian blur at a cost per pixel that doesn't depend on the blur size.
+ * Each box blur is a running sum, horizontally along rows and then vertically with a row of sums. The vertical passes work on whole rows at a time, in 16-bit lanes for radii up to 127, so compilers vectorize them. Pixels outside the plane count as zero.
+ * The scratch memory is kept between calls */
+class AlphaBoxBlur
+{
+public:
+  static constexpr int kNumPasses = 3;
+
+  /** Blur a plane in place
+   * @param pPlane The plane, width * height bytes with no padding
+   * @param width The width of the plane
+   * @param height The height of the plane
+   * @param sigma The standard deviation of the Gaussian blur to approximate, in pixels */
+  void Process(uint8_t* pPlane, int width, int height, float sigma)
+  {
+    int radii[kNumPasses];
+
+    if (!GetRadii(sigma, radii) || width <= 0 || height <= 0)
+      return;
+
+    if (!mLine.ResizeOK(width, false) || !mTemp.ResizeOK(width * height, false))
+      return;
+
+    uint8_t* pSrc = pPlane;
+    uint8_t* pDst = mTemp.Get();
+
+    for (auto y = 0; y < height; y++)
+    {
+      uint8_t* pRow = pPlane + y * width;
+      BlurRow(pRow, mLine.Get(), width, radii[0]);
+      BlurRow(mLine.Get(), pRow, width, radii[1]);
+      BlurRow(pRow, mLine.Get(), width, radii[2]);
+      memcpy(pRow, mLine.Get(), width);
+    }
+
+    for (auto i = 0; i < kNumPasses; i++)
+    {
+      BlurColumns(pSrc, pDst, width, height, radii[i]);
+      std::swap(pSrc, pDst);
+    }
+
+    if (pSrc != pPlane)
+      memcpy(pPlane, pSrc, width * height);
+  }
+
+  /** @param sigma The standard deviation of the Gaussian blur
+   * @param radii Receives the radius of each box blur
+   * @return \c false if the blur has no effect */
+  static bool GetRadii(float sigma, int* radii)
+  {
+    // box widths whose variances sum to sigma^2, see "Fast Almost-Gaussian Filtering" (Kovesi)
+    const float n = static_cast<float>(kNumPasses);
+    int lower = static_cast<int>(std::floor(std::sqrt(12.f * sigma * sigma / n + 1.f)));
+
+    if (lower % 2 == 0)
+      lower--;
+
+    const int numLower = static_cast<int>(std::round((12.f * sigma * sigma - n * lower * lower - 4.f * n * lower - 3.f * n) / (-4.f * lower - 4.f)));
+    bool blur = false;
+
+    for (auto i = 0; i < kNumPasses; i++)
+    {
+      radii[i] = ((i < numLower ? lower : lower + 2) - 1) / 2;
+      blur |= radii[i] > 0;
+    }
+
+    return blur;
+  }
+
+private:
+  // below this radius box sums fit in 16 bits, and (sum * scale) >> 16 never exceeds 255 when the scale is rounded up, so the column passes can use 16-bit lanes
+  static constexpr int kMaxRadius16 = 127;
+
+  static uint32_t GetScale(int radius) { return (65536 + 2 * radius) / (2 * radius + 1); }
+
+  static void BlurRow(const uint8_t* pSrc, uint8_t* pDst, int width, int radius)
+  {
+    if (radius <= 0)
+    {
+      memcpy(pDst, pSrc, width);
+      return;
+    }
+
+    const uint32_t scale = GetScale(radius);
+    const int lead = std::min(radius, width);
+    uint32_t sum = 0;
+    int x = 0;
+
+    for (; x < lead; x++)
+      sum += pSrc[x];
+
+    // the window enters the row, passes along it, then leaves it
+    for (x = 0; x < std::min(width - radius, radius); x++)
+    {
+      sum += pSrc[x + radius];
+      pDst[x] = std::min((sum * scale) >> 16, 255u);
+    }
+
+    for (; x < width - radius; x++)
+    {
+      sum += pSrc[x + radius];
+      pDst[x] = std::min((sum * scale) >> 16, 255u);
+      sum -= pSrc[x - radius];
+    }
+
+    for (; x < width; x++)
+    {
+      pDst[x] = std::min((sum * scale) >> 16, 255u);
+
+      if (x - radius >= 0)
+        sum -= pSrc[x - radius];
+    }
+  }
+
+  void BlurColumns(const uint8_t* pSrc, uint8_t* pDst, int width, int height, int radius)
+  {
+    if (radius <= 0)
+      memcpy(pDst, pSrc, width * height);
+    else if (radius <= kMaxRadius16)
+      BlurColumns(pSrc, pDst, width, height, radius, mSums16.ResizeOK(width, false));
+    else
+      BlurColumns(pSrc, pDst, width, height, radius, mSums32.ResizeOK(width, false));
+  }
+
+  template <typename T>
+  static void BlurColumns(const uint8_t* pSrc, uint8_t* pDst, int width, int height, int radius, T* pSums)
+  {
+    if (!pSums)
+      return;
+
+    const T scale = static_cast<T>(GetScale(radius));
+
+    std::fill(pSums, pSums + width, T(0));
+
+    for (auto y = 0; y < std::min(radius, height); y++)
+      AddRow(pSums, pSrc + y * width, width);
+
+    for (auto y = 0; y < height; y++)
+    {
+      if (y + radius < height)
+        AddRow(pSums, pSrc + (y + radius) * width, width);
+
+      uint8_t* pOut = pDst + y * width;
+
+      for (auto x = 0; x < width; x++)
+        pOut[x] = Scale(pSums[x], scale);
+
+      if (y - radius >= 0)
+      {
+        const uint8_t* pOld = pSrc + (y - radius) * width;
+
+        for (auto x = 0; x < width; x++)
+          pSums[x] -= pOld[x];
+      }
+    }
+  }
+
+  static uint8_t Scale(uint16_t sum, uint16_t scale) { return static_cast<uint8_t>((static_cast<uint32_t>(sum) * scale) >> 16); }
+
+  static uint8_t Scale(uint32_t sum, uint32_t scale) { return static_cast<uint8_t>(std::min((sum * scale) >> 16, 255u)); }
+
+  template <typename T>
+  static void AddRow(T* pSums, const uint8_t* pRow, int width)
+  {
+    for (auto x = 0; x < width; x++)
+      pSums[x] += pRow[x];
+  }
+
+  WDL_TypedBuf<uint8_t> mLine;
+  WDL_TypedBuf<uint8_t> mTemp;
+  WDL_TypedBuf<uint16_t> mSums16;
+  WDL_TypedBuf<uint32_t> mSums32;
+};
+
+/** Keeps recently blurred shadow masks, so that redrawing a layer with the same content and shadow doesn't blur it again.
+ * The key is a hash of the unblurred plane, its size and the blur, so any change to the content of the layer misses the cache */
+class ShadowMaskCache
+{
+public:
+  /** @param maxEntries The maximum number of masks to keep
+   * @param maxBytes The maximum total size of the masks to keep */
+  ShadowMaskCache(int maxEntries = 8, int maxBytes = 16 * 1024 * 1024)
+  : mMaxEntries(maxEntries)
+  , mMaxBytes(maxBytes)
+  {}
+
+  ShadowMaskCache(const ShadowMaskCache&) = delete;
+  ShadowMaskCache& operator=(const ShadowMaskCache&) = delete;
+
+  ~ShadowMaskCache() { Clear(); }
+
+  /** @param pPlane The unblurred plane
+   * @param size The size of the plane in bytes
+   * @return A hash of the plane to pass to Find() and Add() */
+  static uint64_t Hash(const uint8_t* pPlane, int size)
+  {
+    uint64_t hash = 0xcbf29ce484222325ull ^ static_cast<uint64_t>(size);
+    int i = 0;
+
+    for (; i + 8 <= size; i += 8)
+    {
+      uint64_t word;
+      memcpy(&word, pPlane + i, 8);
+      hash = (hash ^ word) * 0x100000001b3ull;
+      hash ^= hash >> 29;
+    }
+
+    for (; i < size; i++)
+      hash = (hash ^ pPlane[i]) * 0x100000001b3ull;
+
+    return hash;
+  }
+
+  /** @return The blurred plane, or nullptr if it isn't cached */
+  const uint8_t* Find(uint64_t hash, int width, int height, float sigma)
+  {
+    for (auto i = 0; i < mEntries.GetSize(); i++)
+    {
+      Entry* pEntry = mEntries.Get(i);
+
+      if (pEntry->hash == hash && pEntry->width == width && pEntry->height == height && pEntry->sigma == sigma)
+      {
+        // most recently used first
+        mEntries.Delete(i);
+        mEntries.Insert(0, pEntry);
+        return pEntry->plane.Get();
+      }
+    }
+
+    return nullptr;
+  }
+
+  /** Add a blurred plane, evicting the least recently used ones to stay within the limits */
+  void Add(uint64_t hash, int width, int height, float sigma, const uint8_t* pPlane)
+  {
+    const int size = width * height;
+
+    if (size > mMaxBytes)
+      return;
+
+    while (mEntries.GetSize() && (mEntries.GetSize() >= mMaxEntries || mNumBytes + size > mMaxBytes))
+    {
+      Entry* pEntry = mEntries.Get(mEntries.GetSize() - 1);
+      mNumBytes -= pEntry->plane.GetSize();
+      mEntries.Delete(mEntries.GetSize() - 1, true);
+    }
+
+    Entry* pEntry = new Entry;
+    pEntry->hash = hash;
+    pEntry->width = width;
+    pEntry->height = height;
+    pEntry->sigma = sigma;
+    pEntry->plane.Resize(size, false);
+
+    if (pEntry->plane.GetSize() != size)
+    {
+      delete pEntry;
+      return;
+    }
+
+    memcpy(pEntry->plane.Get(), pPlane, size);
+    mEntries.Insert(0, pEntry);
+    mNumBytes += size;
+  }
+
+  void Clear()
+  {
+    mEntries.Empty(true);
+    mNumBytes = 0;
+  }
+
+private:
+  struct Entry
+  {
+    uint64_t hash;
+    int width;
+    int height;
+    float sigma;
+    WDL_TypedBuf<uint8_t> plane;
+  };
+
+  int mMaxEntries;
+  int mMaxBytes;
+  int mNumBytes = 0;
+  WDL_PtrList<Entry> mEntries;
+};
+
+/** A pool of worker threads used by the software backends to rasterize the tiles of a large area in parallel.
+ * The calling thread works on tiles too, and ForEachTile() only returns once every tile is done, so tiles can use data on the caller's stack */
+class TileWorkerPool
+{
+public:
+  /** @param numThreads The total number of threads, including the one that calls ForEachTile() */
+  TileWorkerPool(int numThreads)
+  {
+    for (auto i = 1; i < numThreads; i++)
+      mThreads.emplace_back([this]() { WorkerLoop(); });
+  }
+
+  TileWorkerPool(const TileWorkerPool&) = delete;
+  TileWorkerPool& operator=(const TileWorkerPool&) = delete;
+
+  ~TileWorkerPool()
+  {
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      mQuit = true;
+    }
+
+    mWakeCondition.notify_all();
+
+    for (auto& thread : mThreads)
+      thread.join();
+  }
+
+  /** @return The total number of threads, including the calling thread */
+  int NThreads() const { return static_cast<int>(mThreads.size()) + 1; }
+
+  /** Call func(tileIdx) once for each tile, spread across the threads. Must only be called from one thread at a time
+   * @param numTiles The number of tiles
+   * @param func The function to call, which must be safe to call concurrently for different tiles */
+  template <typename F>
+  void ForEachTile(int numTiles, F& func)
+  {
+    if (numTiles <= 1 || mThreads.empty())
+    {
+      for (auto i = 0; i < numTiles; i++)
+        func(i);
+
+      return;
+    }
+
+    Job job;
+    job.func = [](void* pArg, int tileIdx) { (*static_cast<F*>(pArg))(tileIdx); };
+    job.arg = &func;
+    job.numTiles = numTiles;
+
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      mJob = &job;
+      mGeneration++;
+    }
+
+    mWakeCondition.notify_all();
+    RunJob(job);
+
+    // workers that haven't picked up the job yet no longer can, wait for the ones that did
+    std::unique_lock<std::mutex> lock(mMutex);
+    mJob = nullptr;
+    mDoneCondition.wait(lock, [this]() { return mNumActive == 0; });
+  }
+
+private:
+  struct Job
+  {
+    void (*func)(void*, int);
+    void* arg;
+    int numTiles;
+    std::atomic<int> nextTile {0};
+  };
+
+  static void RunJob(Job& job)
+  {
+    for (int i = job.nextTile++; i < job.numTiles; i = job.nextTile++)
+      job.func(job.arg, i);
+  }
+
+  void WorkerLoop()
+  {
+    uint64_t generation = 0;
+
+    while (true)
+    {
+      Job* pJob;
+
+      {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mWakeCondition.wait(lock, [&]() { return mQuit || (mJob && mGeneration != generation); });
+
+        if (mQuit)
+          return;
+
+        generation = mGeneration;
+        pJob = mJob;
+        mNumActive++;
+      }
+
+      RunJob(*pJob);
+
+      std::lock_guard<std::mutex> lock(mMutex);
+
+      if (--mNumActive == 0)
+        mDoneCondition.notify_all();
+    }
+  }
+
+  std::vector<std::thread> mThreads;
+  std::mutex mMutex;
+  std::condition_variable mWakeCondition;
+  std::condition_variable mDoneCondition;
+  Job* mJob = nullptr;
+  uint64_t mGeneration = 0;
+  int mNumActive = 0;
+  bool mQuit = false;
+};
+
 struct Vec2
 {
   float x, y;
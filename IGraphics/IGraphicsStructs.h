@@ -2006,6 +2006,16 @@ private:
 /** ILayerPtr is a managed pointer for transferring the ownership of layers */
 using ILayerPtr = std::unique_ptr<ILayer>;
 
+/** Statistics for the layers that IGraphics caches for controls that use IControl::SetUseLayerCache() */
+struct ILayerCacheStats
+{
+  int64_t hits = 0; // draws that reused a cached layer
+  int64_t misses = 0; // draws that rendered the control into a new layer
+  int64_t evictions = 0; // layers released to stay within the budget
+  int numLayers = 0; // layers currently cached
+  int64_t bytesResident = 0; // size of the cached layers' backing pixels
+};
+
 /** Used to specify a gaussian drop-shadow. */
 struct IShadow
 {
@@ -9,15 +9,20 @@
 */
 
 #include "IPlugAPP.h"
+
+#ifndef APP_OFFLINE
 #include "IPlugAPP_host.h"
 
 #if defined OS_MAC || defined OS_LINUX
 #include <IPlugSWELL.h>
 #endif
+#endif
 
 using namespace iplug;
 
+#ifndef APP_OFFLINE
 extern HWND gHWND;
+#endif
 
 IPlugAPP::IPlugAPP(const InstanceInfo& info, const Config& config)
 : IPlugAPIBase(config, kAPIAPP)
@@ -56,6 +61,9 @@ bool IPlugAPP::EditorResizeFromDelegate(int viewWidth, int viewHeight)
 
 bool IPlugAPP::SendMidiMsg(const IMidiMsg& msg)
 {
+#ifdef APP_OFFLINE
+  return false; // there is no MIDI output when rendering offline
+#else
   if (DoesMIDIOut() && mAppHost->mMidiOut)
   {
     //TODO: midi out channel
@@ -76,10 +84,14 @@ bool IPlugAPP::SendMidiMsg(const IMidiMsg& msg)
   }
 
   return false;
+#endif
 }
 
 bool IPlugAPP::SendSysEx(const ISysEx& msg)
 {
+#ifdef APP_OFFLINE
+  return false;
+#else
   if (DoesMIDIOut() && mAppHost->mMidiOut)
   {
     //TODO: midi out channel
@@ -95,6 +107,7 @@ bool IPlugAPP::SendSysEx(const ISysEx& msg)
   }
   
   return false;
+#endif
 }
 
 void IPlugAPP::SendSysexMsgFromUI(const ISysEx& msg)
@@ -106,8 +119,8 @@ void IPlugAPP::AppProcess(double** inputs, double** outputs, int nFrames)
 {
   SetChannelConnections(ERoute::kInput, 0, MaxNChannels(ERoute::kInput), !IsInstrument()); //TODO: go elsewhere - enable inputs
   SetChannelConnections(ERoute::kOutput, 0, MaxNChannels(ERoute::kOutput), true); //TODO: go elsewhere
-  AttachBuffers(ERoute::kInput, 0, NChannelsConnected(ERoute::kInput), inputs, GetBlockSize());
-  AttachBuffers(ERoute::kOutput, 0, NChannelsConnected(ERoute::kOutput), outputs, GetBlockSize());
+  AttachBuffers(ERoute::kInput, 0, NChannelsConnected(ERoute::kInput), inputs, nFrames);
+  AttachBuffers(ERoute::kOutput, 0, NChannelsConnected(ERoute::kOutput), outputs, nFrames);
   
   if(mMidiMsgsFromCallback.ElementsAvailable())
   {
@@ -145,6 +158,6 @@ void IPlugAPP::AppProcess(double** inputs, double** outputs, int nFrames)
   //Do not handle Sysex messages here - SendSysexMsgFromUI overridden
 
   ENTER_PARAMS_MUTEX
-  ProcessBuffers(0.0, GetBlockSize());
+  ProcessBuffers(0.0, nFrames);
   LEAVE_PARAMS_MUTEX
 }
@@ -29,6 +29,7 @@ struct InstanceInfo
 };
 
 class IPlugAPPHost;
+class IPlugAPPOffline;
 
 /**  Standalone application base class for an IPlug plug-in
 *   @ingroup APIClasses */
@@ -53,6 +54,8 @@ public:
   bool SendSysEx(const ISysEx& msg) override;
   
   //IPlugAPP
+  /** Process a block of audio and any queued MIDI
+   * @param nFrames The number of frames, up to the block size */
   void AppProcess(double** inputs, double** outputs, int nFrames);
 
 private:
@@ -61,6 +64,7 @@ private:
   IPlugQueue<SysExData> mSysExMsgsFromCallback {SYSEX_TRANSFER_SIZE};
 
   friend class IPlugAPPHost;
+  friend class IPlugAPPOffline;
 };
 
 IPlugAPP* MakePlug(const InstanceInfo& info);
@@ -667,6 +667,9 @@ int IPlugAPPHost::AudioCallback(void* pOutputBuffer, void* pInputBuffer, uint32_
   double* pInputBufferD = static_cast<double*>(pInputBuffer);
   double* pOutputBufferD = static_cast<double*>(pOutputBuffer);
 
+  if (status) // RTAUDIO_INPUT_OVERFLOW or RTAUDIO_OUTPUT_UNDERFLOW
+    _this->mIPlug->GetProcessTiming().AddXrun();
+
   if (_this->mVecElapsed > APP_N_VECTOR_WAIT ) // wait APP_N_VECTOR_WAIT * iovs before processing audio, to avoid clicks
   {
     for (int i=0; i<nFrames; i++)
@@ -0,0 +1,422 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "heapbuf.h"
+#include "pcmfmtcvt.h"
+#include "wavwrite.h"
+
+#include "IPlugAPP_offline.h"
+
+using namespace iplug;
+
+namespace
+{
+
+/** Reads the frames of a RIFF WAVE file in order, converted to a double buffer per channel */
+class WaveFileReader
+{
+public:
+  ~WaveFileReader()
+  {
+    if (mFile)
+      fclose(mFile);
+  }
+
+  /** @return \c true if the file is a 16, 24 or 32 bit integer or 32 or 64 bit float WAVE file */
+  bool Open(const char* path)
+  {
+    unsigned char header[12];
+    mFile = fopen(path, "rb");
+
+    if (!mFile || fread(header, 1, 12, mFile) != 12 || memcmp(header, "RIFF", 4) || memcmp(header + 8, "WAVE", 4))
+      return false;
+
+    int format = 0;
+
+    while (true)
+    {
+      unsigned char chunk[8];
+
+      if (fread(chunk, 1, 8, mFile) != 8)
+        return false;
+
+      const uint32_t chunkSize = ReadLE32(chunk + 4);
+      uint32_t skip = chunkSize + (chunkSize & 1);
+
+      if (!memcmp(chunk, "fmt ", 4))
+      {
+        unsigned char fmt[26] = {};
+        const uint32_t fmtSize = std::min<uint32_t>(chunkSize, sizeof(fmt));
+
+        if (chunkSize < 16 || fread(fmt, 1, fmtSize, mFile) != fmtSize)
+          return false;
+
+        format = ReadLE16(fmt);
+        mNChans = ReadLE16(fmt + 2);
+        mSampleRate = ReadLE32(fmt + 4);
+        mBitsPerSample = ReadLE16(fmt + 14);
+
+        if (format == 0xFFFE && chunkSize >= 26) // WAVE_FORMAT_EXTENSIBLE, the format is at the start of the sub-format GUID
+          format = ReadLE16(fmt + 24);
+
+        skip -= fmtSize;
+      }
+      else if (!memcmp(chunk, "data", 4))
+      {
+        mIsFloat = format == 3;
+
+        if (mNChans <= 0 || mSampleRate <= 0 || (format != 1 && format != 3) || (mIsFloat && mBitsPerSample != 32 && mBitsPerSample != 64) || (!mIsFloat && mBitsPerSample != 16 && mBitsPerSample != 24 && mBitsPerSample != 32))
+          return false;
+
+        mFrameBytes = mNChans * mBitsPerSample / 8;
+        mNFrames = chunkSize / mFrameBytes;
+        mFramesLeft = mNFrames;
+        return true;
+      }
+
+      if (fseek(mFile, skip, SEEK_CUR))
+        return false;
+    }
+  }
+
+  int NChans() const { return mNChans; }
+  int GetSampleRate() const { return mSampleRate; }
+
+  /** @return The number of frames according to the header. Read() stops early if the file is shorter */
+  int64_t NFrames() const { return mNFrames; }
+
+  /** Read the next frames of all channels
+   * @param pDest A buffer per channel, for at least nFrames frames
+   * @return The number of frames read, which is less than nFrames at the end of the file */
+  int Read(double** pDest, int nFrames)
+  {
+    const int n = static_cast<int>(std::min<int64_t>(nFrames, mFramesLeft));
+
+    if (n <= 0)
+      return 0;
+
+    char* pBuf = static_cast<char*>(mBuf.ResizeOK(n * mFrameBytes, false));
+
+    if (!pBuf)
+      return 0;
+
+    const int nRead = static_cast<int>(fread(pBuf, mFrameBytes, n, mFile));
+    mFramesLeft = nRead < n ? 0 : mFramesLeft - nRead;
+
+    if (!mIsFloat)
+      pcmToDoublesNI(pBuf, mNChans, nRead, mBitsPerSample, pDest);
+    else if (mBitsPerSample == 32)
+    {
+      for (auto c = 0; c < mNChans; c++)
+      {
+        for (auto s = 0; s < nRead; s++)
+        {
+          float v;
+          memcpy(&v, pBuf + (s * mNChans + c) * sizeof(float), sizeof(float));
+          pDest[c][s] = v;
+        }
+      }
+    }
+    else
+    {
+      for (auto c = 0; c < mNChans; c++)
+      {
+        for (auto s = 0; s < nRead; s++)
+          memcpy(pDest[c] + s, pBuf + (s * mNChans + c) * sizeof(double), sizeof(double));
+      }
+    }
+
+    return nRead;
+  }
+
+private:
+  static int ReadLE16(const unsigned char* p) { return p[0] | (p[1] << 8); }
+  static uint32_t ReadLE32(const unsigned char* p) { return (uint32_t) p[0] | ((uint32_t) p[1] << 8) | ((uint32_t) p[2] << 16) | ((uint32_t) p[3] << 24); }
+
+  FILE* mFile = nullptr;
+  WDL_HeapBuf mBuf;
+  int mNChans = 0;
+  int mSampleRate = 0;
+  int mBitsPerSample = 0;
+  int mFrameBytes = 0;
+  bool mIsFloat = false;
+  int64_t mNFrames = 0;
+  int64_t mFramesLeft = 0;
+};
+
+} // namespace
+
+IPlugAPPOffline::IPlugAPPOffline()
+: mIPlug(MakePlug(InstanceInfo{nullptr}))
+{
+  mIPlug->SetHost("standalone", mIPlug->GetPluginVersion(false));
+}
+
+IPlugAPPOffline::~IPlugAPPOffline() = default;
+
+bool IPlugAPPOffline::LoadState(const Settings& settings)
+{
+  IPlugAPP* pPlug = mIPlug.get();
+
+  if (settings.presetIdx > -1 && (settings.presetIdx >= pPlug->NPresets() || !pPlug->RestorePreset(settings.presetIdx)))
+  {
+    mError.SetFormatted(64, "There is no preset %i", settings.presetIdx);
+    return false;
+  }
+
+  if (!settings.statePath.GetLength())
+    return true;
+
+  const char* path = settings.statePath.Get();
+  const char* fileExt = settings.statePath.get_fileext();
+  char ext[16] = "";
+
+  if (strlen(fileExt) < sizeof(ext))
+    ToLower(ext, fileExt);
+
+  bool loaded = false;
+
+#ifndef NO_PRESETS
+  if (!strcmp(ext, ".fxp"))
+    loaded = pPlug->LoadProgramFromFXP(path);
+  else if (!strcmp(ext, ".vstpreset"))
+    loaded = pPlug->LoadProgramFromVSTPreset(path);
+  else
+#endif
+  {
+    FILE* fp = fopen(path, "rb");
+
+    if (fp)
+    {
+      IByteChunk chunk;
+      fseek(fp, 0, SEEK_END);
+      chunk.Resize(static_cast<int>(ftell(fp)));
+      rewind(fp);
+
+      if (fread(chunk.GetData(), 1, chunk.Size(), fp) == static_cast<size_t>(chunk.Size()))
+        loaded = pPlug->UnserializeState(chunk, 0) > 0;
+
+      fclose(fp);
+    }
+  }
+
+  if (!loaded)
+  {
+    mError.SetFormatted(4096, "Can't load the state in %s", path);
+    return false;
+  }
+
+  pPlug->OnRestoreState();
+  return true;
+}
+
+bool IPlugAPPOffline::Render(const Settings& settings, Stats& stats)
+{
+  using Clock = std::chrono::steady_clock;
+  const auto renderStart = Clock::now();
+  IPlugAPP* pPlug = mIPlug.get();
+  WaveFileReader input;
+  const bool hasInput = settings.inputPath.GetLength() > 0;
+
+  stats = Stats();
+  mError.Set("");
+
+  if (hasInput && !input.Open(settings.inputPath.Get()))
+  {
+    mError.SetFormatted(4096, "Can't read %s, which needs to be a 16, 24 or 32 bit integer or 32 or 64 bit float WAVE file", settings.inputPath.Get());
+    return false;
+  }
+
+  const int bitsPerSample = settings.outputBitsPerSample;
+  const int blockSize = std::max(settings.blockSize, 1);
+  const double sampleRate = hasInput ? input.GetSampleRate() : settings.sampleRate;
+  const int nInputs = pPlug->MaxNChannels(ERoute::kInput);
+  const int nOutputs = pPlug->MaxNChannels(ERoute::kOutput);
+  const int nFileChans = hasInput ? input.NChans() : 0;
+
+  if (bitsPerSample != 16 && bitsPerSample != 24 && bitsPerSample != 32)
+  {
+    mError.SetFormatted(64, "Can't write %i bit files", bitsPerSample);
+    return false;
+  }
+
+  if (sampleRate <= 0. || nOutputs < 1)
+  {
+    mError.Set("The sample rate and the number of outputs need to be more than 0");
+    return false;
+  }
+
+  pPlug->SetSampleRate(sampleRate);
+  pPlug->SetBlockSize(blockSize);
+  pPlug->SetRenderingOffline(true);
+
+  if (!LoadState(settings))
+    return false;
+
+  pPlug->OnParamReset(kReset);
+  pPlug->OnActivate(true);
+  pPlug->OnReset();
+
+  // the file's channels are read into the first input buffers, and repeated for any other inputs
+  const int nInputBufs = std::max(nInputs, nFileChans);
+  WDL_TypedBuf<double> buffers;
+  std::vector<double*> inputs(nInputBufs), outputs(nOutputs);
+  buffers.Resize((nInputBufs + nOutputs) * blockSize);
+
+  for (auto c = 0; c < nInputBufs; c++)
+    inputs[c] = buffers.Get() + c * blockSize;
+
+  for (auto c = 0; c < nOutputs; c++)
+    outputs[c] = buffers.Get() + (nInputBufs + c) * blockSize;
+
+  const int64_t nInputFrames = hasInput ? input.NFrames() : static_cast<int64_t>(std::max(settings.lengthSeconds, 0.) * sampleRate + 0.5);
+  const int64_t nOutputFrames = nInputFrames + static_cast<int64_t>(std::max(settings.tailSeconds, 0.) * sampleRate + 0.5);
+  const int latency = settings.compensateLatency ? pPlug->GetLatency() : 0;
+  const int64_t nRenderFrames = nOutputFrames + latency;
+  Clock::duration processTime {0};
+  ITimeInfo timeInfo;
+  timeInfo.mTransportIsRunning = true;
+
+  {
+    WaveWriter output(settings.outputPath.Get(), bitsPerSample, nOutputs, static_cast<int>(sampleRate), 0);
+
+    if (!output.Status())
+    {
+      mError.SetFormatted(4096, "Can't write %s", settings.outputPath.Get());
+      return false;
+    }
+
+    for (int64_t pos = 0; pos < nRenderFrames;)
+    {
+      const int nFrames = static_cast<int>(std::min<int64_t>(blockSize, nRenderFrames - pos));
+      const int nRead = hasInput ? input.Read(inputs.data(), nFrames) : 0;
+
+      for (auto c = 0; c < nInputBufs; c++)
+      {
+        if (c < nFileChans || !nFileChans)
+          std::fill(inputs[c] + nRead, inputs[c] + nFrames, 0.);
+        else
+          std::copy(inputs[c % nFileChans], inputs[c % nFileChans] + nFrames, inputs[c]);
+      }
+
+      timeInfo.mSamplePos = static_cast<double>(pos);
+      timeInfo.mPPQPos = pos / sampleRate * timeInfo.mTempo / 60.;
+      pPlug->SetTimeInfo(timeInfo);
+
+      const auto processStart = Clock::now();
+      pPlug->AppProcess(inputs.data(), outputs.data(), nFrames);
+      processTime += Clock::now() - processStart;
+
+      const int skip = static_cast<int>(std::min<int64_t>(std::max<int64_t>(latency - pos, 0), nFrames));
+
+      if (skip < nFrames)
+        output.WriteDoublesNI(outputs.data(), skip, nFrames - skip, nOutputs);
+
+      pos += nFrames;
+    }
+  }
+
+  pPlug->OnActivate(false);
+
+  stats.nFrames = nOutputFrames;
+  stats.sampleRate = sampleRate;
+  stats.processSeconds = std::chrono::duration<double>(processTime).count();
+  stats.totalSeconds = std::chrono::duration<double>(Clock::now() - renderStart).count();
+  return true;
+}
+
+#pragma mark - main
+
+static void PrintUsage(const char* program)
+{
+  fprintf(stderr,
+          "Usage: %s [options] input.wav output.wav\n"
+          "Renders input.wav through the plug-in as fast as possible. An input of - renders silence, for the length given with -l\n"
+          "  -s file    Load the state of the plug-in from an .fxp or .vstpreset file, or a chunk as written by SerializeState()\n"
+          "  -p index   Restore a factory preset, before the state\n"
+          "  -b frames  The block size (default 4096)\n"
+          "  -d bits    The bit depth of the output, 16, 24 or 32 (default 24)\n"
+          "  -r rate    The sample rate without an input file (default 44100)\n"
+          "  -l seconds The length without an input file\n"
+          "  -t seconds The length of the tail that is rendered after the input (default 0)\n"
+          "  -n         Don't compensate for the plug-in's latency\n", program);
+}
+
+int main(int argc, char* argv[])
+{
+  IPlugAPPOffline::Settings settings;
+  std::vector<const char*> paths;
+
+  for (auto i = 1; i < argc; i++)
+  {
+    const char* arg = argv[i];
+
+    if (arg[0] == '-' && arg[1] && !arg[2])
+    {
+      const bool hasValue = i + 1 < argc;
+      const char* value = hasValue ? argv[i + 1] : "";
+
+      switch (arg[1])
+      {
+        case 's': settings.statePath.Set(value); break;
+        case 'p': settings.presetIdx = atoi(value); break;
+        case 'b': settings.blockSize = atoi(value); break;
+        case 'd': settings.outputBitsPerSample = atoi(value); break;
+        case 'r': settings.sampleRate = atof(value); break;
+        case 'l': settings.lengthSeconds = atof(value); break;
+        case 't': settings.tailSeconds = atof(value); break;
+        case 'n': settings.compensateLatency = false; continue;
+        default: PrintUsage(argv[0]); return 1;
+      }
+
+      if (!hasValue)
+      {
+        PrintUsage(argv[0]);
+        return 1;
+      }
+
+      i++;
+    }
+    else
+      paths.push_back(arg);
+  }
+
+  if (paths.size() != 2)
+  {
+    PrintUsage(argv[0]);
+    return 1;
+  }
+
+  if (strcmp(paths[0], "-"))
+    settings.inputPath.Set(paths[0]);
+
+  settings.outputPath.Set(paths[1]);
+
+  IPlugAPPOffline offline;
+  IPlugAPPOffline::Stats stats;
+
+  if (!offline.Render(settings, stats))
+  {
+    fprintf(stderr, "%s\n", offline.GetError());
+    return 1;
+  }
+
+  printf("Rendered %.3f s at %g Hz in %.3f s, %.1fx realtime (%.3f s including file I/O)\n",
+         stats.nFrames / stats.sampleRate, stats.sampleRate, stats.processSeconds, stats.GetRealtimeFactor(), stats.totalSeconds);
+
+  return 0;
+}
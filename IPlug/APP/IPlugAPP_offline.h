@@ -0,0 +1,94 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+#pragma once
+
+/**
+ * @file
+ * @copydoc IPlugAPPOffline
+ */
+
+#include <cstdint>
+#include <memory>
+
+#include "wdlstring.h"
+
+#include "IPlugAPP.h"
+
+BEGIN_IPLUG_NAMESPACE
+
+/** Renders WAVE files through the plug-in of an APP target as fast as it will go, without an audio device, MIDI or a window, e.g. to batch process files or to regression test DSP on a server.
+ * It replaces IPlugAPPHost and RtAudio when APP_OFFLINE is defined: build the plug-in with APP_API, APP_OFFLINE and NO_IGRAPHICS, with IPlugAPP.cpp and IPlugAPP_offline.cpp instead of the other IPlugAPP_*.cpp files.
+ * common-offline.mk does this on Linux. IPlugAPP_offline.cpp also has the main() of the command line program */
+class IPlugAPPOffline
+{
+public:
+  struct Settings
+  {
+    /** The WAVE file to process, 16, 24 or 32 bit integer or 32 or 64 bit float. If it's empty the input is silent, for lengthSeconds, e.g. for an instrument.
+     * If the plug-in has more inputs than the file has channels, the channels are repeated, so a mono file is fed to every input */
+    WDL_String inputPath;
+    /** The WAVE file to write, with a channel for each output of the plug-in */
+    WDL_String outputPath;
+    /** An .fxp or .vstpreset file, or a chunk as written by SerializeState(), that is loaded after presetIdx. If it's empty the plug-in keeps its default state */
+    WDL_String statePath;
+    /** A factory preset to restore, or -1 */
+    int presetIdx = -1;
+    int blockSize = 4096;
+    /** 16, 24 or 32 */
+    int outputBitsPerSample = 24;
+    /** The sample rate without an input file. An input file is processed at its own sample rate */
+    double sampleRate = 44100.;
+    /** The length of the silent input without an input file */
+    double lengthSeconds = 0.;
+    /** The length of the silence that is processed after the input, e.g. for the tail of a reverb */
+    double tailSeconds = 0.;
+    /** If \c true the plug-in's latency is removed from the start of the output, and rendered at its end instead */
+    bool compensateLatency = true;
+  };
+
+  struct Stats
+  {
+    int64_t nFrames = 0;
+    double sampleRate = 0.;
+    /** The time spent in the plug-in */
+    double processSeconds = 0.;
+    /** The time of the whole render, including reading and writing the files */
+    double totalSeconds = 0.;
+
+    /** @return The seconds of audio rendered per second spent in the plug-in */
+    double GetRealtimeFactor() const { return processSeconds > 0. ? nFrames / sampleRate / processSeconds : 0.; }
+  };
+
+  IPlugAPPOffline();
+  ~IPlugAPPOffline();
+
+  IPlugAPPOffline(const IPlugAPPOffline&) = delete;
+  IPlugAPPOffline& operator=(const IPlugAPPOffline&) = delete;
+
+  /** Render a file. This can be called again, e.g. to process a batch of files with the same instance
+   * @param settings The files and how to render them
+   * @param stats Filled in with the length of the output and the time it took
+   * @return \c true on success, otherwise GetError() describes the failure */
+  bool Render(const Settings& settings, Stats& stats);
+
+  /** @return The reason for the last failure of Render() */
+  const char* GetError() const { return mError.Get(); }
+
+  IPlugAPP* GetPlug() { return mIPlug.get(); }
+
+private:
+  bool LoadState(const Settings& settings);
+
+  std::unique_ptr<IPlugAPP> mIPlug;
+  WDL_String mError;
+};
+
+END_IPLUG_NAMESPACE
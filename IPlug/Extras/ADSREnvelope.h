@@ -8,6 +8,10 @@
  ==============================================================================
  */
 
+#include <algorithm>
+#include <climits>
+#include <cmath>
+
 #include "IPlugPlatform.h"
 
 BEGIN_IPLUG_NAMESPACE
@@ -33,6 +37,13 @@ public:
   static constexpr T MAX_ENV_TIME_MS = 60000.;
   static constexpr T ENV_VALUE_LOW = 0.000001; // -120dB
   static constexpr T ENV_VALUE_HIGH = 0.999;
+
+  /** A stage transition that happened during ProcessBlock() */
+  struct StageChange
+  {
+    int offset; // the frame within the block at which the new stage started
+    int stage; // the new stage /see EStage
+  };
   
 private:
 #if DEBUG_ENV
@@ -101,6 +112,12 @@ public:
     return mStage != kIdle;
   }
 
+  /** @return the current stage /see EStage */
+  int GetStage() const
+  {
+    return mStage;
+  }
+
   /** @return the previously output value */
   T GetPrevOutput() const
   {
@@ -286,7 +303,199 @@ public:
     return mPrevOutput;
   }
 
+  /** Process a block of the envelope. Produces the same output as calling Process() nFrames times, but renders each stage segment in one go, using closed form expressions for the ramps.
+   * Only the frames where the stage changes go through Process(), so the reset and end release functions are still called at the right time
+   * @param pOutput Buffer of nFrames values to fill
+   * @param nFrames The number of frames to process
+   * @param sustainLevel The sustain level, constant for the block
+   * @param pChanges Optional array to receive the sample accurate stage changes in this block
+   * @param maxChanges The size of pChanges, further changes are not reported
+   * @return The number of stage changes written to pChanges */
+  int ProcessBlock(T* pOutput, int nFrames, T sustainLevel = 0., StageChange* pChanges = nullptr, int maxChanges = 0)
+  {
+    int pos = 0;
+    int nChanges = 0;
+
+    while (pos < nFrames)
+    {
+      const int remaining = nFrames - pos;
+      T* pOut = pOutput + pos;
+      int nUntilChange = INT_MAX; // the frame (counting from 1) at which the current stage ends
+
+      switch(mStage)
+      {
+        case kIdle:
+          Fill(pOut, remaining, mEnvValue * mLevel);
+          mPrevResult = mEnvValue;
+          break;
+        case kSustain:
+          Fill(pOut, remaining, sustainLevel * mLevel);
+          mPrevResult = sustainLevel;
+          break;
+        case kAttack:
+        {
+          const T incr = mAttackIncr * mScalar;
+          nUntilChange = (mAttackIncr == 0.) ? 1 : FramesUntilLinearAbove(mEnvValue, incr, ENV_VALUE_HIGH);
+          const int n = std::min(nUntilChange - 1, remaining);
+          if (n > 0)
+          {
+            mEnvValue = RenderLinear(pOut, n, mEnvValue, incr, mLevel);
+            mPrevResult = mEnvValue;
+          }
+          break;
+        }
+        case kDecay:
+        {
+          const T k = 1. - mDecayIncr * mScalar;
+          nUntilChange = FramesUntilExpBelow(mEnvValue, k, ENV_VALUE_LOW);
+          const int n = std::min(nUntilChange - 1, remaining);
+          if (n > 0)
+          {
+            mEnvValue = RenderExp(pOut, n, mEnvValue, k, (1. - sustainLevel) * mLevel, sustainLevel * mLevel);
+            mPrevResult = (mEnvValue * (1. - sustainLevel)) + sustainLevel;
+          }
+          break;
+        }
+        case kRelease:
+        {
+          const T k = 1. - mReleaseIncr * mScalar;
+          nUntilChange = (mReleaseIncr == 0.) ? 1 : FramesUntilExpBelow(mEnvValue, k, ENV_VALUE_LOW);
+          const int n = std::min(nUntilChange - 1, remaining);
+          if (n > 0)
+          {
+            mEnvValue = RenderExp(pOut, n, mEnvValue, k, mReleaseLevel * mLevel, 0.);
+            mPrevResult = mEnvValue * mReleaseLevel;
+          }
+          break;
+        }
+        case kReleasedToRetrigger:
+        case kReleasedToEndEarly:
+        {
+          const T incr = (mStage == kReleasedToRetrigger) ? -mRetriggerReleaseIncr : -mEarlyReleaseIncr;
+          nUntilChange = FramesUntilLinearBelow(mEnvValue, incr, ENV_VALUE_LOW);
+          const int n = std::min(nUntilChange - 1, remaining);
+          if (n > 0)
+          {
+            mEnvValue = RenderLinear(pOut, n, mEnvValue, incr, mReleaseLevel * mLevel);
+            mPrevResult = mEnvValue * mReleaseLevel;
+          }
+          break;
+        }
+        default:
+          Fill(pOut, remaining, mEnvValue * mLevel);
+          mPrevResult = mEnvValue;
+          break;
+      }
+
+      if (nUntilChange > remaining)
+      {
+        mPrevOutput = pOut[remaining - 1];
+        pos = nFrames;
+      }
+      else
+      {
+        // render the frame where the stage ends with the per-sample code, so that transitions and callbacks behave identically
+        pos += nUntilChange - 1;
+        const int prevStage = mStage;
+        pOutput[pos] = Process(sustainLevel);
+
+        if (pChanges && mStage != prevStage && nChanges < maxChanges)
+          pChanges[nChanges++] = {pos, mStage};
+
+        pos++;
+      }
+    }
+
+    return nChanges;
+  }
+
 private:
+  static inline void Fill(T* pOut, int n, T value)
+  {
+    for (auto i = 0; i < n; i++)
+      pOut[i] = value;
+  }
+
+  /** pOut[i] = (start + (i+1) * incr) * scale
+   * @return The value of the ramp after n frames */
+  static inline T RenderLinear(T* pOut, int n, T start, T incr, T scale)
+  {
+    for (auto i = 0; i < n; i++)
+      pOut[i] = (start + (T) (i + 1) * incr) * scale;
+
+    return start + (T) n * incr;
+  }
+
+  /** pOut[i] = start * k^(i+1) * scale + offset, computed in four independent lanes so that the loop vectorizes
+   * @return The value of the curve after n frames */
+  static inline T RenderExp(T* pOut, int n, T start, T k, T scale, T offset)
+  {
+    const T k2 = k * k;
+    const T k4 = k2 * k2;
+    T lanes[4] = {start * k, start * k2, start * k2 * k, start * k4};
+    T last = start;
+    int i = 0;
+
+    for (; i + 4 <= n; i += 4)
+    {
+      for (auto j = 0; j < 4; j++)
+        pOut[i + j] = lanes[j] * scale + offset;
+
+      last = lanes[3];
+
+      for (auto j = 0; j < 4; j++)
+        lanes[j] *= k4;
+    }
+
+    for (auto j = 0; i + j < n; j++)
+    {
+      pOut[i + j] = lanes[j] * scale + offset;
+      last = lanes[j];
+    }
+
+    return last;
+  }
+
+  /** @return The first frame (counting from 1) at which start + frame * incr > threshold, or INT_MAX if it is never reached */
+  static inline int FramesUntilLinearAbove(T start, T incr, T threshold)
+  {
+    if (!(incr > 0.))
+      return INT_MAX;
+
+    return ClampFrames(std::floor((threshold - start) / incr) + 1.);
+  }
+
+  /** @return The first frame (counting from 1) at which start + frame * incr < threshold, or INT_MAX if it is never reached */
+  static inline int FramesUntilLinearBelow(T start, T incr, T threshold)
+  {
+    if (!(incr < 0.))
+      return INT_MAX;
+
+    return ClampFrames(std::floor((threshold - start) / incr) + 1.);
+  }
+
+  /** @return The first frame (counting from 1) at which start * k^frame < threshold, or INT_MAX if it is never reached */
+  static inline int FramesUntilExpBelow(T start, T k, T threshold)
+  {
+    if (k <= 0. || start < threshold)
+      return 1;
+
+    if (!(k < 1.))
+      return INT_MAX;
+
+    return ClampFrames(std::floor(std::log(threshold / start) / std::log(k)) + 1.);
+  }
+
+  static inline int ClampFrames(double frames)
+  {
+    if (frames < 1.)
+      return 1;
+    else if (frames >= (double) INT_MAX)
+      return INT_MAX;
+    else
+      return (int) frames;
+  }
+
   inline T CalcIncrFromTimeLinear(T timeMS, T sr) const
   {
     if (timeMS <= 0.) return 0.;
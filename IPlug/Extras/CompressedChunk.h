@@ -0,0 +1,162 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+#pragma once
+
+/**
+ * @file
+ * @copydoc ICompressedChunk
+ */
+
+#include <cstdint>
+
+#include "zlib/zlib.h"
+
+#include "IPlugStructs.h"
+
+BEGIN_IPLUG_NAMESPACE
+
+/** Helpers for storing a block of state in an IByteChunk compressed with zlib, behind a versioned header.
+ * Useful for plug-ins with lots of parameters or large custom state, since hosts save state often. The project must link zlib (WDL/zlib or the system library).
+ *
+ * A plug-in that does state chunks can use it in its SerializeState()/UnserializeState() overrides:
+ * @code
+ * bool SerializeState(IByteChunk& chunk) const override
+ * {
+ *   IByteChunk state;
+ *   SerializeParams(state);
+ *   // ... custom data
+ *   return ICompressedChunk::Put(chunk, state, kStateVersion);
+ * }
+ *
+ * int UnserializeState(const IByteChunk& chunk, int startPos) override
+ * {
+ *   if (!ICompressedChunk::IsCompressed(chunk, startPos))
+ *     return UnserializeParams(chunk, startPos); // state saved before compression was used
+ *
+ *   IByteChunk state;
+ *   int stateVersion = 0;
+ *   const int endPos = ICompressedChunk::Get(chunk, startPos, state, &stateVersion);
+ *
+ *   if (endPos < 0 || UnserializeParams(state, 0) < 0)
+ *     return -1;
+ *
+ *   // ... custom data
+ *   return endPos;
+ * }
+ * @endcode */
+class ICompressedChunk
+{
+public:
+  static constexpr int kMagic = ('I' << 24) | ('P' << 16) | ('z' << 8) | 'c';
+  static constexpr int kFormatVersion = 1;
+
+  /** The header that precedes the compressed data. Stored in the same byte order as the rest of IByteChunk */
+  struct Header
+  {
+    int magic;
+    int formatVersion; // the version of this header, kFormatVersion
+    int stateVersion; // the plug-in's own state version, to allow migrating old state
+    int uncompressedSize;
+    int compressedSize;
+    uint32_t checksum; // adler32 of the uncompressed data
+  };
+
+  /** Compress data and append it to chunk, preceded by a Header
+   * @param chunk The chunk to append to
+   * @param data The data to compress
+   * @param stateVersion A version number for the data, returned by Get()
+   * @param level The zlib compression level, 1 (fastest) to 9 (smallest), or Z_DEFAULT_COMPRESSION
+   * @return \c true on success */
+  static bool Put(IByteChunk& chunk, const IByteChunk& data, int stateVersion = 0, int level = Z_DEFAULT_COMPRESSION)
+  {
+    const int startPos = chunk.Size();
+    const uLong bound = compressBound((uLong) data.Size());
+
+    chunk.Resize(startPos + (int) sizeof(Header) + (int) bound);
+
+    if (chunk.Size() != startPos + (int) sizeof(Header) + (int) bound)
+    {
+      chunk.Resize(startPos);
+      return false;
+    }
+
+    uLongf compressedSize = bound;
+
+    if (compress2(chunk.GetData() + startPos + sizeof(Header), &compressedSize, data.GetData(), (uLong) data.Size(), level) != Z_OK)
+    {
+      chunk.Resize(startPos);
+      return false;
+    }
+
+    const Header header { kMagic, kFormatVersion, stateVersion, data.Size(), (int) compressedSize, GetChecksum(data.GetData(), data.Size()) };
+    memcpy(chunk.GetData() + startPos, &header, sizeof(Header));
+    chunk.Resize(startPos + (int) sizeof(Header) + (int) compressedSize);
+
+    return true;
+  }
+
+  /** Decompress data appended by Put()
+   * @param chunk The chunk to read from
+   * @param startPos The position of the Header in chunk
+   * @param data The chunk to store the uncompressed data in. It is cleared first
+   * @param pStateVersion Optional, receives the stateVersion passed to Put()
+   * @return The position after the compressed data, or -1 if the data is not compressed, truncated, corrupted or a newer format */
+  static int Get(const IByteChunk& chunk, int startPos, IByteChunk& data, int* pStateVersion = nullptr)
+  {
+    Header header;
+    const int dataPos = chunk.GetBytes(&header, sizeof(Header), startPos);
+
+    data.Clear();
+
+    if (dataPos < 0 || header.magic != kMagic || header.formatVersion > kFormatVersion
+        || header.uncompressedSize < 0 || header.compressedSize < 0 || header.compressedSize > chunk.Size() - dataPos)
+      return -1;
+
+    data.Resize(header.uncompressedSize);
+
+    if (data.Size() != header.uncompressedSize)
+      return -1;
+
+    uLongf uncompressedSize = (uLongf) header.uncompressedSize;
+
+    // zlib rejects an empty output buffer, so empty data is only checked against the checksum
+    if ((header.uncompressedSize > 0
+         && (uncompress(data.GetData(), &uncompressedSize, chunk.GetData() + dataPos, (uLong) header.compressedSize) != Z_OK
+             || (int) uncompressedSize != header.uncompressedSize))
+        || GetChecksum(data.GetData(), data.Size()) != header.checksum)
+    {
+      data.Clear();
+      return -1;
+    }
+
+    if (pStateVersion)
+      *pStateVersion = header.stateVersion;
+
+    return dataPos + header.compressedSize;
+  }
+
+  /** @param chunk The chunk to check
+   * @param startPos The position to check at
+   * @return \c true if there is a compressed chunk Header at startPos */
+  static bool IsCompressed(const IByteChunk& chunk, int startPos)
+  {
+    int magic = 0;
+    return chunk.Get(&magic, startPos) > 0 && magic == kMagic;
+  }
+
+private:
+  static uint32_t GetChecksum(const uint8_t* pData, int size)
+  {
+    return (uint32_t) adler32(adler32(0L, Z_NULL, 0), pData, (uInt) size);
+  }
+};
+
+END_IPLUG_NAMESPACE
@@ -16,10 +16,13 @@
  */
 
 #include <memory>
+#include <algorithm>
+#include <atomic>
+#include <thread>
 
 #include "faust/gui/UI.h"
 #include "faust/gui/MidiUI.h"
-#include "assocarray.h"
+#include "hasharray.h"
 
 #include "IPlugAPIBase.h"
 
@@ -45,14 +48,14 @@ public:
   : mNVoices(nVoices)
   {
     if(rate > 1)
-      mOverSampler = std::make_unique<OverSampler<sample>>(OverSampler<sample>::RateToFactor(rate), true, 2 /* TODO: flexible channel count */);
+      mOverSampler = std::make_unique<OverSampler<sample>>(OverSampler<sample>::RateToFactor(rate), true, 2); // channel count is updated when it is known, see SetMaxChannelCount()
     
     mName.Set(name);
   }
 
   virtual ~IPlugFaust()
   {
-    mParams.Empty(true);
+    delete mBindings.load();
   }
 
   IPlugFaust(const IPlugFaust&) = delete;
@@ -60,8 +63,13 @@ public:
     
   virtual void Init() = 0;
 
-  // NO-OP in the base class
-  virtual void SetMaxChannelCount(int maxNInputs, int maxNOutputs) {}
+  /** Call this method after constructing the class to inform IPlugFaust what the maximum I/O count is, so that the OverSampler can be allocated for enough channels up front
+   * @param maxNInputs The maximum number of inputs the hosting code can accommodate
+   * @param maxNOutputs The maximum number of outputs the hosting code can accommodate */
+  virtual void SetMaxChannelCount(int maxNInputs, int maxNOutputs)
+  {
+    ResizeOverSampler(std::max(maxNInputs, maxNOutputs));
+  }
   
   /** In FaustGen this is implemented, so that the SVG files generated by a specific instance can be located. The path to the SVG file for process.svg will be returned.
    * There is a NO-OP implementation here so that when not using the JIT compiler, the same class can be used interchangeably
@@ -78,17 +86,30 @@ public:
   void FreeDSP()
   {
     mDSP = nullptr;
+    mBindings.load()->zones.Empty(); // the zones belonged to the DSP
   }
   
+  /** Change the over sampling rate. This doesn't allocate, so it can be called on the audio thread. The DSP's sample rate dependent constants are updated, parameter values are kept
+   * @param rate The new rate, 1, 2, 4, 8 or 16 */
   void SetOverSamplingRate(int rate)
   {
-    if(mOverSampler)
+    if(mOverSampler && mOverSampler->GetRate() != rate)
+    {
       mOverSampler->SetOverSampling(OverSampler<sample>::RateToFactor(rate));
+      
+      if (mDSP)
+      {
+        mDSP->instanceConstants(((int) mSampleRate) * rate);
+        mDSP->instanceClear();
+      }
+    }
   }
 
   // Unique methods
   void SetSampleRate(double sampleRate)
   {
+    mSampleRate = sampleRate;
+    
     int multiplier = 1;
     
     if(mOverSampler)
@@ -110,46 +131,52 @@ public:
       assert(mDSP->getSampleRate() != 0); // did you forget to call SetSampleRate?
       
       if(mOverSampler)
-        mOverSampler->ProcessBlock(inputs, outputs, nFrames, 2 /* TODO: flexible channel count */,
-                                   [&](sample** inputs, sample** outputs, int nFrames) //TODO:: badness capture = allocated
+        mOverSampler->ProcessBlock(inputs, outputs, nFrames, mDSP->getNumInputs(), mDSP->getNumOutputs(),
+                                   [this](sample** inputs, sample** outputs, int nFrames)
                                    {
-                                     mDSP->compute(nFrames, inputs, outputs);
+                                     Compute(nFrames, inputs, outputs);
                                    });
       else
-        mDSP->compute(nFrames, inputs, outputs);
+        Compute(nFrames, inputs, outputs);
     }
 //    else silence?
   }
 
   void SetParameterValueNormalised(int paramIdx, double normalizedValue)
   {
-    if(paramIdx > kNoParameter && paramIdx >= NParams())
+    ScopedBindings scoped(*this);
+    Bindings& bindings = scoped.Get();
+    
+    if(paramIdx > kNoParameter && paramIdx >= bindings.params.GetSize())
     {
       DBGMSG("IPlugFaust-%s:: No parameter %i\n", mName.Get(), paramIdx);
     }
     else
     {
-      mParams.Get(paramIdx)->SetNormalized(normalizedValue);
+      bindings.params.Get(paramIdx)->SetNormalized(normalizedValue);
     
-      if(mZones.GetSize() == NParams())
-        *(mZones.Get(paramIdx)) = mParams.Get(paramIdx)->Value();
+      if(paramIdx < bindings.zones.GetSize())
+        *(bindings.zones.Get(paramIdx)) = bindings.params.Get(paramIdx)->Value();
       else
-        DBGMSG("IPlugFaust-%s:: Missing zone for parameter %s\n", mName.Get(), mParams.Get(paramIdx)->GetNameForHost());
+        DBGMSG("IPlugFaust-%s:: Missing zone for parameter %s\n", mName.Get(), bindings.params.Get(paramIdx)->GetNameForHost());
     }
   }
   
   void SetParameterValue(int paramIdx, double nonNormalizedValue)
   {
-    if(NParams()) {
+    ScopedBindings scoped(*this);
+    Bindings& bindings = scoped.Get();
+    
+    if(bindings.params.GetSize()) {
       
-    assert(paramIdx < NParams()); // Seems like we don't have enough parameters!
+    assert(paramIdx < bindings.params.GetSize()); // Seems like we don't have enough parameters!
     
-    mParams.Get(paramIdx)->Set(nonNormalizedValue);
+    bindings.params.Get(paramIdx)->Set(nonNormalizedValue);
 
-    if(mZones.GetSize() == NParams())
-      *(mZones.Get(paramIdx)) = nonNormalizedValue;
+    if(paramIdx < bindings.zones.GetSize())
+      *(bindings.zones.Get(paramIdx)) = nonNormalizedValue;
     else
-      DBGMSG("IPlugFaust-%s:: Missing zone for parameter %s\n", mName.Get(), mParams.Get(paramIdx)->GetNameForHost());
+      DBGMSG("IPlugFaust-%s:: Missing zone for parameter %s\n", mName.Get(), bindings.params.Get(paramIdx)->GetNameForHost());
     }
     else
       DBGMSG("SetParameterValue called with no FAUST params\n");
@@ -157,12 +184,13 @@ public:
 
   void SetParameterValue(const char* labelToLookup, double nonNormalizedValue)
   {
-    FAUSTFLOAT* dest = nullptr;
-    dest = mMap.Get(labelToLookup, nullptr);
+    ScopedBindings scoped(*this);
+    Bindings& bindings = scoped.Get();
+    const int paramIdx = bindings.indices.Get(labelToLookup, -1);
 //    mParams.Get(paramIdx)->Set(nonNormalizedValue); // TODO: we are not updating the IPlug parameter
 
-    if(dest)
-      *dest = nonNormalizedValue;
+    if(paramIdx > -1 && paramIdx < bindings.zones.GetSize())
+      *(bindings.zones.Get(paramIdx)) = nonNormalizedValue;
     else
       DBGMSG("IPlugFaust-%s:: No parameter named %s\n", mName.Get(), labelToLookup);
   }
@@ -187,7 +215,7 @@ public:
 
       IParam* pParam = pPlug->GetParam(plugParamIdx + p);
       const double currentValueNormalised = pParam->GetNormalized();
-      pParam->Init(*mParams.Get(p));
+      pParam->Init(*mBindings.load()->params.Get(p));
       if(setToDefault)
         pParam->SetToDefault();
       else
@@ -197,9 +225,10 @@ public:
     return plugParamIdx;
   }
 
+  /** @return The number of parameters of the DSP in use */
   int NParams()
   {
-    return mParams.GetSize();
+    return mBindings.load()->params.GetSize();
   }
 
   // Meta
@@ -247,14 +276,29 @@ public:
   void addSoundfile(const char *label, const char *filename, Soundfile **sf_zone) override {}
 
 protected:
+  /** Reallocates the OverSampler if it can't process nChans, keeping the current rate. Not safe to call while processing
+   * @param nChans The number of channels the OverSampler needs to handle */
+  void ResizeOverSampler(int nChans)
+  {
+    if(mOverSampler && nChans > mOverSampler->GetNChannels())
+      mOverSampler = std::make_unique<OverSampler<sample>>(OverSampler<sample>::RateToFactor(mOverSampler->GetRate()), true, nChans);
+  }
+  
+  /** Called from ProcessBlock (at the oversampled rate, if oversampling) to run the FAUST DSP. Override this to do something other than a straight compute(), e.g. crossfade between DSP instances */
+  virtual void Compute(int nFrames, sample** inputs, sample** outputs)
+  {
+    mDSP->compute(nFrames, inputs, outputs);
+  }
+
   void AddOrUpdateParam(IParam::EParamType type, const char *label, FAUSTFLOAT *zone, FAUSTFLOAT init = 0., FAUSTFLOAT min = 0., FAUSTFLOAT max = 0., FAUSTFLOAT step = 1.)
   {
+    Bindings& bindings = GetBuildBindings();
     IParam* pParam = nullptr;
     
     const int idx = FindExistingParameterWithName(label);
     
     if(idx > -1)
-      pParam = mParams.Get(idx);
+      pParam = bindings.params.Get(idx);
     else
       pParam = new IParam();
     
@@ -278,34 +322,41 @@ protected:
     }
     
     if(idx == -1)
-      mParams.Add(pParam);
+      bindings.params.Add(pParam);
     
-    mZones.Add(zone);
+    bindings.zones.Add(zone);
   }
   
   void BuildParameterMap()
   {
-    for(auto p = 0; p < NParams(); p++)
+    Bindings& bindings = GetBuildBindings();
+    bindings.indices.DeleteAll();
+    bindings.indices.Reserve(bindings.params.GetSize());
+    
+    for(auto p = 0; p < bindings.params.GetSize(); p++)
     {
-      mMap.Insert(mParams.Get(p)->GetNameForHost(), mZones.Get(p)); // insert will overwrite keys with the same name
+      bindings.indices.Insert(bindings.params.Get(p)->GetNameForHost(), p); // insert will overwrite keys with the same name
     }
     
-    if(mIPlugParamStartIdx > -1 && mPlug != nullptr) // if we've allready linked parameters
+    // FaustGen links the parameters of a DSP that is waiting to be swapped in once the audio thread has swapped it in
+    if(!mBuildBindings && mIPlugParamStartIdx > -1 && mPlug != nullptr) // if we've allready linked parameters
     {
-      CreateIPlugParameters(mPlug, mIPlugParamStartIdx);
+      CreateIPlugParameters(mPlug, mIPlugParamStartIdx, -1, false); // keep the current values when re-linking after a recompile
     }
     
-    for(auto p = 0; p < NParams(); p++)
+    for(auto p = 0; p < bindings.params.GetSize(); p++)
     {
-      DBGMSG("%i %s\n", p, mParams.Get(p)->GetNameForHost());
+      DBGMSG("%i %s\n", p, bindings.params.Get(p)->GetNameForHost());
     }
   }
 
   int FindExistingParameterWithName(const char* name) // TODO: this needs to check meta data too - incase of grouping
   {
-    for(auto p = 0; p < NParams(); p++)
+    Bindings& bindings = GetBuildBindings();
+    
+    for(auto p = 0; p < bindings.params.GetSize(); p++)
     {
-      if(strcmp(name, mParams.Get(p)->GetNameForHost()) == 0)
+      if(strcmp(name, bindings.params.Get(p)->GetNameForHost()) == 0)
       {
         return p;
       }
@@ -314,14 +365,80 @@ protected:
     return -1;
   }
   
+  /** The parameters of a DSP instance and their zones. FaustGen builds a complete set for a recompiled DSP on the main thread and swaps it in on the audio thread, so the set in use is never modified, only the parameter values */
+  struct Bindings
+  {
+    ~Bindings() { params.Empty(true); }
+    
+    WDL_PtrList<IParam> params;
+    WDL_PtrList<FAUSTFLOAT> zones; // in parameter order
+    WDL_StringKeyedHashArray<int> indices; // parameter indices by name
+  };
+  
+  /** Holds on to the bindings in use while a parameter is set, so that FaustGen doesn't swap them in the meantime.
+   * The setter counts itself and then checks for a swap, the swap is flagged and then checks for setters, so one of them always sees the other. A setter waits for a swap that has started, which doesn't block or allocate, while a swap is skipped if a setter is active */
+  class ScopedBindings
+  {
+  public:
+    ScopedBindings(IPlugFaust& faust)
+    : mFaust(faust)
+    {
+      while (true)
+      {
+        mFaust.mNumSetters.fetch_add(1);
+        
+        if (!mFaust.mSwappingBindings.load())
+          break;
+        
+        mFaust.mNumSetters.fetch_sub(1);
+        
+        while (mFaust.mSwappingBindings.load())
+          std::this_thread::yield();
+      }
+    }
+    
+    ~ScopedBindings()
+    {
+      mFaust.mNumSetters.fetch_sub(1, std::memory_order_release);
+    }
+    
+    ScopedBindings(const ScopedBindings&) = delete;
+    ScopedBindings& operator=(const ScopedBindings&) = delete;
+    
+    Bindings& Get() const { return *mFaust.mBindings.load(); }
+    
+  private:
+    IPlugFaust& mFaust;
+  };
+  
+  /** Called on the audio thread before replacing mBindings
+   * @return \c true if no parameter is being set. Call EndBindingsSwap() when done, otherwise try again in a later block */
+  bool TryBeginBindingsSwap()
+  {
+    mSwappingBindings.store(true);
+    
+    if (mNumSetters.load() == 0)
+      return true;
+    
+    mSwappingBindings.store(false, std::memory_order_release);
+    return false;
+  }
+  
+  void EndBindingsSwap() { mSwappingBindings.store(false, std::memory_order_release); }
+  
+  /** @return The bindings that buildUserInterface() and BuildParameterMap() fill in, which are the ones in use unless FaustGen is binding a DSP that hasn't been swapped in yet */
+  Bindings& GetBuildBindings() { return mBuildBindings ? *mBuildBindings : *mBindings.load(); }
+  
   std::unique_ptr<OverSampler<sample>> mOverSampler;
   WDL_String mName;
   int mNVoices;
+  double mSampleRate = DEFAULT_SAMPLE_RATE;
   std::unique_ptr<::dsp> mDSP;
   std::unique_ptr<MidiUI> mMidiUI;
-  WDL_PtrList<IParam> mParams;
-  WDL_PtrList<FAUSTFLOAT> mZones;
-  WDL_StringKeyedArray<FAUSTFLOAT*> mMap; // map is used for setting FAUST parameters by name, also used to reconnect existing parameters
+  std::atomic<Bindings*> mBindings {new Bindings}; // the parameters and zones of mDSP, owned. Only replaced on the audio thread, while processing
+  Bindings* mBuildBindings = nullptr; // if set, the bindings of a DSP instance that is waiting to replace mDSP
+  std::atomic<int> mNumSetters {0};
+  std::atomic<bool> mSwappingBindings {false};
   int mIPlugParamStartIdx = -1; // if this is negative, it means there is no linking
   IPlugAPIBase* mPlug = nullptr;
   bool mInitialized = false;
@@ -23,6 +23,7 @@
 using namespace iplug;
 
 int FaustGen::sFaustGenCounter = 0;
+int FaustGen::sTimerTicks = 0;
 int FaustGen::Factory::sFactoryCounter = 0;
 bool FaustGen::sAutoRecompile = false;
 std::map<std::string, FaustGen::Factory *> FaustGen::Factory::sFactoryMap;
@@ -31,6 +32,10 @@ Timer* FaustGen::sTimer = nullptr;
 
 FaustGen::Factory::Factory(const char* name, const char* libraryPath, const char* drawPath, const char* inputDSP)
 {
+  // Factories are compiled on background threads, possibly several at once, libfaust needs to know that before the first one
+  static const bool sMTFactoriesStarted = startMTDSPFactories();
+  assert(sMTFactoriesStarted);
+  
   mPreviousTime = TimeZero();
   mName.Set(name);
   mInstanceIdx = sFactoryCounter++;
@@ -45,6 +50,7 @@ FaustGen::Factory::Factory(const char* name, const char* libraryPath, const char
 
 FaustGen::Factory::~Factory()
 {
+  JoinCompileThread();
   FreeDSPFactory();
   mSourceCodeStr.Set("");
   mBitCodeStr.Set("");
@@ -53,6 +59,8 @@ FaustGen::Factory::~Factory()
 
 void FaustGen::Factory::FreeDSPFactory()
 {
+  CancelCompile();
+  
   WDL_MutexLock lock(&mDSPMutex);
 
   for (auto inst : mInstances)
@@ -65,6 +73,13 @@ void FaustGen::Factory::FreeDSPFactory()
     deleteDSPFactory(mLLVMFactory); // this is commented in faustgen~
     mLLVMFactory = nullptr;
   }
+  
+  for (auto pFactory : mRetiredFactories)
+  {
+    deleteDSPFactory(pFactory);
+  }
+  
+  mRetiredFactories.clear();
 }
 
 llvm_dsp_factory* FaustGen::Factory::CreateFactoryFromBitCode()
@@ -115,26 +130,12 @@ llvm_dsp_factory *FaustGen::Factory::CreateFactoryFromSourceCode()
 
   llvm_dsp_factory* pFactory = createDSPFactoryFromString(name.Get(), mSourceCodeStr.Get(), N, argv, GetLLVMArchStr(), error, mOptimizationLevel);
 
-  assert(pFactory);
-
   if (pFactory)
   {
-    // Update all instances
-    for (auto inst : mInstances)
-    {
-      inst->SetErrored(false);
-    }
-    
     return pFactory;
   }
   else
   {
-    // Update all instances
-    for (auto inst : mInstances)
-    {
-      inst->SetErrored(true);
-    }
-
     //WHAT IS THIS?
 //    if (mInstances.begin() != mInstances.end())
 //    {
@@ -145,9 +146,9 @@ llvm_dsp_factory *FaustGen::Factory::CreateFactoryFromSourceCode()
   }
 }
 
-::dsp *FaustGen::Factory::CreateDSPInstance(int nVoices)
+::dsp *FaustGen::Factory::CreateDSPInstance(llvm_dsp_factory* pFactory, int nVoices)
 {
-  ::dsp* pMonoDSP = mLLVMFactory->createDSPInstance();
+  ::dsp* pMonoDSP = pFactory->createDSPInstance();
 
   // Check 'nvoices' metadata
   if (nVoices == 0)
@@ -172,10 +173,13 @@ llvm_dsp_factory *FaustGen::Factory::CreateFactoryFromSourceCode()
   FMeta meta;
   std::string error;
 
+  // Don't compile the same source code on two threads at once
+  JoinCompileThread();
+
   // Factory already allocated
   if (mLLVMFactory)
   {
-    pDSP = CreateDSPInstance();
+    pDSP = CreateDSPInstance(mLLVMFactory);
     DBGMSG("FaustGen-%s: Factory already allocated, %i input(s), %i output(s)\n", mName.Get(), pDSP->getNumInputs(), pDSP->getNumOutputs());
     goto end;
   }
@@ -186,7 +190,7 @@ llvm_dsp_factory *FaustGen::Factory::CreateFactoryFromSourceCode()
     mLLVMFactory = CreateFactoryFromBitCode();
     if (mLLVMFactory)
     {
-      pDSP = CreateDSPInstance();
+      pDSP = CreateDSPInstance(mLLVMFactory);
       pDSP->metadata(&meta);
       DBGMSG("FaustGen-%s: Compilation from bitcode succeeded, %i input(s), %i output(s)\n", mName.Get(), pDSP->getNumInputs(), pDSP->getNumOutputs());
       goto end;
@@ -197,9 +201,18 @@ llvm_dsp_factory *FaustGen::Factory::CreateFactoryFromSourceCode()
   if (mSourceCodeStr.GetLength())
   {
     mLLVMFactory = CreateFactoryFromSourceCode();
+    
+    assert(mLLVMFactory);
+    
+    // Update all instances
+    for (auto inst : mInstances)
+    {
+      inst->SetErrored(mLLVMFactory == nullptr);
+    }
+    
     if (mLLVMFactory)
     {
-      pDSP = CreateDSPInstance();
+      pDSP = CreateDSPInstance(mLLVMFactory);
       pDSP->metadata(&meta);
       DBGMSG("FaustGen-%s: Compilation from source code succeeded, %i input(s), %i output(s)\n", mName.Get(), pDSP->getNumInputs(), pDSP->getNumOutputs());
       goto end;
@@ -210,7 +223,7 @@ llvm_dsp_factory *FaustGen::Factory::CreateFactoryFromSourceCode()
   mSourceCodeStr.SetFormatted(256, maxInputs == 0 ? DEFAULT_SOURCE_CODE_FMT_STR_INSTRUMENT : DEFAULT_SOURCE_CODE_FMT_STR_FX, maxOutputs);
   mLLVMFactory = createDSPFactoryFromString("default", mSourceCodeStr.Get(), 0, 0, GetLLVMArchStr(), error, 0);
 
-  pDSP = CreateDSPInstance();
+  pDSP = CreateDSPInstance(mLLVMFactory);
   DBGMSG("FaustGen-%s: Allocation of default DSP succeeded, %i input(s), %i output(s)\n", mName.Get(), pDSP->getNumInputs(), pDSP->getNumOutputs());
 
 end:
@@ -316,19 +329,15 @@ void FaustGen::Factory::UpdateSourceCode(const char* str)
     //      inst->hilight_off();
     //    }
 
-    // Delete the existing Faust module
-    FreeDSPFactory();
-
+    JoinCompileThread();
+    
     mSourceCodeStr.Set(str);
 
     // Free the memory allocated for fBitCode
     mBitCodeStr.Set("");
 
-    // Update all instances
-    for (auto inst : mInstances)
-    {
-      inst->Init();
-    }
+    // Instances keep running the existing Faust module until the new one is swapped in
+    CompileInBackground();
   }
   else
   {
@@ -352,6 +361,35 @@ bool FaustGen::Factory::LoadFile(const char* file)
 {
   // Delete the existing Faust module
   //FreeDSPFactory();
+  if (ReadFile(file))
+  {
+    // Instances that are already running hot-swap to the new code, Init() would replace their DSP under the audio thread
+    for (auto inst : mInstances)
+    {
+      if (inst->mDSP)
+      {
+        CompileInBackground();
+        return true;
+      }
+    }
+    
+    // Update all instances
+    for (auto inst : mInstances)
+    {
+      inst->Init();
+    }
+    
+    return true;
+  }
+  
+  return false;
+}
+
+bool FaustGen::Factory::ReadFile(const char* file)
+{
+  // The compile thread reads the source code, and whatever it compiled is out of date now
+  CancelCompile();
+  
   WDL_String fileStr(file);
 
   mBitCodeStr.Set("");
@@ -376,12 +414,6 @@ bool FaustGen::Factory::LoadFile(const char* file)
     
     mInputDSPFile.Set(file);
     
-    // Update all instances
-    for (auto inst : mInstances)
-    {
-      inst->Init();
-    }
-    
     return true;
   }
   
@@ -395,6 +427,122 @@ bool FaustGen::Factory::WriteToFile(const char* file)
   return false;
 }
 
+void FaustGen::Factory::CompileInBackground()
+{
+  // Throw away the result of a previous compile that was never committed
+  CancelCompile();
+  
+  // Snapshot the instances on the main thread, together with the rate their DSP runs at
+  std::vector<std::pair<FaustGen*, double>> targets;
+  
+  for (auto inst : mInstances)
+  {
+    targets.push_back({inst, inst->GetDSPSampleRate()});
+  }
+  
+  mCompileFinished = false;
+  
+  mCompileThread = std::thread([this, targets]() {
+    DBGMSG("FaustGen-%s: JIT compiling on background thread\n", mName.Get());
+    
+    mCompiledFactory = CreateFactoryFromSourceCode();
+    
+    if (mCompiledFactory)
+    {
+      for (auto& target : targets)
+      {
+        target.first->PrepareDSP(mCompiledFactory, target.second);
+      }
+    }
+    
+    mCompileFinished = true;
+  });
+}
+
+void FaustGen::Factory::JoinCompileThread()
+{
+  if (mCompileThread.joinable())
+    mCompileThread.join();
+}
+
+void FaustGen::Factory::CancelCompile()
+{
+  JoinCompileThread();
+  mCompileFinished = false;
+  
+  if (mCompiledFactory)
+  {
+    for (auto inst : mInstances)
+    {
+      inst->mPreparedDSP = nullptr;
+    }
+    
+    deleteDSPFactory(mCompiledFactory);
+    mCompiledFactory = nullptr;
+  }
+}
+
+bool FaustGen::Factory::CommitCompile()
+{
+  JoinCompileThread();
+  mCompileFinished = false;
+  
+  if (!mCompiledFactory)
+  {
+    DBGMSG("FaustGen-%s: JIT compile failed, keeping the existing DSP\n", mName.Get());
+    return false;
+  }
+  
+  if (mLLVMFactory)
+    mRetiredFactories.push_back(mLLVMFactory);
+  
+  mLLVMFactory = mCompiledFactory;
+  mCompiledFactory = nullptr;
+  
+  for (auto inst : mInstances)
+  {
+    // Instances added during the compile still need a DSP from the new factory, since the old one will be deleted
+    if (!inst->mPreparedDSP && inst->mDSP)
+      inst->PrepareDSP(mLLVMFactory, inst->GetDSPSampleRate());
+    
+    if (inst->mPreparedDSP)
+    {
+      mNInputs = inst->mPreparedDSP->getNumInputs();
+      mNOutputs = inst->mPreparedDSP->getNumOutputs();
+    }
+    
+    inst->CommitPreparedDSP();
+  }
+  
+  DBGMSG("FaustGen-%s: Hot-swapping DSP, %i input(s), %i output(s)\n", mName.Get(), mNInputs, mNOutputs);
+  
+  return true;
+}
+
+void FaustGen::Factory::ReclaimRetired()
+{
+  for (auto inst : mInstances)
+  {
+    inst->ReclaimRetiredDSP();
+  }
+  
+  if (mRetiredFactories.size() == 0)
+    return;
+  
+  for (auto inst : mInstances)
+  {
+    if (inst->IsSwapping())
+      return;
+  }
+  
+  for (auto pFactory : mRetiredFactories)
+  {
+    deleteDSPFactory(pFactory);
+  }
+  
+  mRetiredFactories.clear();
+}
+
 void FaustGen::Factory::SetCompileOptions(std::initializer_list<const char*> options)
 {
   DBGMSG("FaustGen-%s: Compiler options modified for FaustGen\n", mName.Get());
@@ -460,6 +608,9 @@ FaustGen::FaustGen(const char* name, const char* inputDSPFile, int nVoices, int
 
 FaustGen::~FaustGen()
 {
+  if (mFactory)
+    mFactory->JoinCompileThread();
+  
   if (--sFaustGenCounter <= 0)
   {
     SetAutoRecompile(false);
@@ -471,17 +622,32 @@ FaustGen::~FaustGen()
     mFactory->RemoveInstance(this);
 }
 
-void FaustGen::Init()
+void FaustGen::SetMaxChannelCount(int maxNInputs, int maxNOutputs)
 {
-  mZones.Empty(); // remove existing pointers to zones
+  IPlugFaust::SetMaxChannelCount(maxNInputs, maxNOutputs);
+  
+  mMaxNInputs = maxNInputs;
+  mMaxNOutputs = maxNOutputs;
   
+  // Allocated up front, so that a crossfade never allocates on the audio thread
+  mXFadeBuffer.resize(maxNOutputs * FAUST_XFADE_CHUNK);
+  mXFadeInputs.resize(maxNInputs);
+  mXFadeOutputs.resize(maxNOutputs);
+  mChunkInputs.resize(maxNInputs);
+  mChunkOutputs.resize(maxNOutputs);
+  
+  for (auto c = 0; c < maxNOutputs; c++)
+  {
+    mXFadeOutputs[c] = mXFadeBuffer.data() + (c * FAUST_XFADE_CHUNK);
+  }
+}
+
+void FaustGen::Init()
+{
   mDSP = std::unique_ptr<::dsp>(mFactory->GetDSP(mMaxNInputs, mMaxNOutputs));
   assert(mDSP);
 
-//    AddMidiHandler();
-//    mDSP->buildUserInterface(mMidiUI);
-  mDSP->buildUserInterface(this);
-  mDSP->init(DEFAULT_SAMPLE_RATE);
+  mDSP->init((int) GetDSPSampleRate());
 
   assert((mDSP->getNumInputs() <= mMaxNInputs) && (mDSP->getNumOutputs() <= mMaxNOutputs)); // don't have enough buffers to process the DSP
   
@@ -490,9 +656,106 @@ void FaustGen::Init()
     //TODO: do something when I/O is wrong
   }
   
+  BindDSP(mDSP.get());
+}
+
+void FaustGen::LoadFile(const char* path)
+{
+  if (mFactory->ReadFile(path))
+    mFactory->CompileInBackground();
+}
+
+void FaustGen::FreeDSP()
+{
+  // The compile thread writes mPreparedDSP
+  if (mFactory)
+    mFactory->JoinCompileThread();
+  
+  mPreparedDSP = nullptr;
+  delete mPendingDSP.exchange(nullptr);
+  delete mRetiredDSP.exchange(nullptr);
+  delete mFadingDSP;
+  mFadingDSP = nullptr;
+  mFading = false;
+  mSwappedIn = false;
+  IPlugFaust::FreeDSP();
+}
+
+double FaustGen::GetDSPSampleRate() const
+{
+  return mSampleRate * (mOverSampler ? mOverSampler->GetRate() : 1);
+}
+
+void FaustGen::PrepareDSP(llvm_dsp_factory* pFactory, double sampleRate)
+{
+  mPreparedDSP = std::unique_ptr<::dsp>(mFactory->CreateDSPInstance(pFactory));
+  mPreparedDSP->init((int) sampleRate);
+  
+  assert((mPreparedDSP->getNumInputs() <= mMaxNInputs) && (mPreparedDSP->getNumOutputs() <= mMaxNOutputs)); // don't have enough buffers to process the DSP
+}
+
+void FaustGen::CommitPreparedDSP()
+{
+  if (!mPreparedDSP)
+    return;
+  
+  // The audio thread keeps using the current zones until it swaps in the DSP they belong to
+  SwapDSP* pSwap = new SwapDSP;
+  pSwap->dsp = std::move(mPreparedDSP);
+  pSwap->bindings = std::make_unique<Bindings>();
+  
+  BindDSP(pSwap->dsp.get(), pSwap->bindings.get());
+  SetErrored(false);
+  
+  // If the audio thread never picked up the previous DSP, it never will
+  delete mPendingDSP.exchange(pSwap);
+}
+
+void FaustGen::BindDSP(::dsp* pDSP, Bindings* pBindings)
+{
+  // The bindings in use are only ever replaced on the audio thread, and deleted on this thread, so they can be read here
+  Bindings& current = *mBindings.load();
+  WDL_StringKeyedHashArray<double> previousValues;
+  previousValues.Reserve(current.params.GetSize());
+  
+  for (auto p = 0; p < current.params.GetSize(); p++)
+  {
+    previousValues.Insert(current.params.Get(p)->GetNameForHost(), current.params.Get(p)->Value());
+  }
+  
+  mBuildBindings = pBindings;
+  Bindings& bindings = GetBuildBindings();
+  bindings.zones.Empty(); // remove existing pointers to zones
+
+//    AddMidiHandler();
+//    pDSP->buildUserInterface(mMidiUI);
+  pDSP->buildUserInterface(this);
+  
+  // Restore parameters that still exist in the updated code
+  for (auto p = 0; p < bindings.params.GetSize() && p < bindings.zones.GetSize(); p++)
+  {
+    IParam* pParam = bindings.params.Get(p);
+    
+    const double* pPreviousValue = previousValues.GetPtr(pParam->GetNameForHost());
+
+    if (pPreviousValue)
+    {
+      pParam->Set(*pPreviousValue);
+      *(bindings.zones.Get(p)) = pParam->Value();
+    }
+  }
+  
   BuildParameterMap(); // build a new map based on updated code
+  mBuildBindings = nullptr;
   mInitialized = true;
   
+  // New bindings are linked to the plug-in once the audio thread has swapped them in, see ReclaimRetiredDSP()
+  if(!pBindings)
+    OnParamsRebound();
+}
+
+void FaustGen::OnParamsRebound()
+{
   if(mPlug)
     mPlug->OnParamReset(EParamSource::kRecompile);
   
@@ -500,6 +763,22 @@ void FaustGen::Init()
     mOnCompileFunc();
 }
 
+void FaustGen::ReclaimRetiredDSP()
+{
+  if(mSwappedIn.load())
+  {
+    if(mIPlugParamStartIdx > -1 && mPlug != nullptr)
+      CreateIPlugParameters(mPlug, mIPlugParamStartIdx, -1, false); // keep the current values when re-linking after a recompile
+    
+    OnParamsRebound();
+    
+    // The audio thread doesn't swap in another DSP until the plug-in has been linked to this one
+    mSwappedIn.store(false, std::memory_order_release);
+  }
+  
+  delete mRetiredDSP.exchange(nullptr);
+}
+
 void FaustGen::GetDrawPath(WDL_String& path)
 {
   assert(!CStringHasContents(mFactory->mDrawPath.Get()));
@@ -582,9 +861,22 @@ void FaustGen::OnTimer(Timer& timer)
 {
   WDL_String* pInputFile;
   bool recompile = false;
+  
+  const bool checkFiles = (++sTimerTicks * FAUST_SWAP_POLL_INTERVAL) >= FAUST_RECOMPILE_INTERVAL;
+  
+  if(checkFiles)
+    sTimerTicks = 0;
 
   for (auto f : Factory::sFactoryMap)
   {
+    if(f.second->IsCompileFinished())
+      recompile |= f.second->CommitCompile();
+    
+    f.second->ReclaimRetired();
+    
+    if(!checkFiles || f.second->IsCompiling())
+      continue;
+    
     pInputFile = &f.second->mInputDSPFile;
     StatType buf;
     GetStat(pInputFile->Get(), &buf);
@@ -593,14 +885,11 @@ void FaustGen::OnTimer(Timer& timer)
 
     if(!Equal(newTime, oldTime))
     {
-      WDL_MutexLock lock(&mMutex);
-
-      recompile = true;
-      f.second->FreeDSPFactory();
       DBGMSG("FaustGen-%s: File change detected ----------------------------------\n", mName.Get());
       DBGMSG("FaustGen-%s: JIT compiling %s\n", mName.Get(), pInputFile->Get());
-      f.second->LoadFile(pInputFile->Get());
-      Init();
+      
+      if(f.second->ReadFile(pInputFile->Get()))
+        f.second->CompileInBackground();
     }
       
     f.second->mPreviousTime = newTime;
@@ -608,7 +897,6 @@ void FaustGen::OnTimer(Timer& timer)
 
   if(recompile)
   {
-    // TODO: should check for successfull JIT
     DBGMSG("FaustGen-%s: Statically compiling all FAUST blocks\n", mName.Get());
     CompileCPP();
     //WDL_String objFile;
@@ -631,7 +919,7 @@ void FaustGen::SetAutoRecompile(bool enable)
   if(enable)
   {
     if(sTimer == nullptr)
-      sTimer = Timer::Create(std::bind(&FaustGen::OnTimer, this, std::placeholders::_1), FAUST_RECOMPILE_INTERVAL);
+      sTimer = Timer::CreateScheduled(std::bind(&FaustGen::OnTimer, this, std::placeholders::_1), FAUST_SWAP_POLL_INTERVAL, Timer::kLowPriority);
   }
   else
   {
@@ -647,12 +935,131 @@ void FaustGen::SetAutoRecompile(bool enable)
 
 void FaustGen::ProcessBlock(sample** inputs, sample** outputs, int nFrames)
 {
-  WDL_MutexLock lock(&mMutex);
+  // Pick up a newly compiled DSP, unless the previous one is still fading out or hasn't been reclaimed and linked yet, or a parameter is being set
+  if(!mFading && !mSwappedIn.load() && mPendingDSP.load() && !mRetiredDSP.load() && TryBeginBindingsSwap())
+  {
+    mFading = true; // set before taking the pending DSP, so IsSwapping() never sees a gap
+    SwapDSP* pSwap = mPendingDSP.exchange(nullptr);
+    Bindings* pPrevious = mBindings.load(std::memory_order_relaxed);
+    Bindings* pBindings = pSwap->bindings.release();
+    
+    // Parameters may have changed since the new bindings were built
+    for (auto p = 0; p < pBindings->params.GetSize(); p++)
+    {
+      IParam* pParam = pBindings->params.Get(p);
+      const int previousIdx = pPrevious->indices.Get(pParam->GetNameForHost(), -1);
+      
+      if (previousIdx > -1)
+        pParam->Set(pPrevious->params.Get(previousIdx)->Value());
+      
+      if (p < pBindings->zones.GetSize())
+        *(pBindings->zones.Get(p)) = pParam->Value();
+    }
+    
+    // Swap the DSP and its bindings in together, pSwap keeps the previous ones
+    mBindings.store(pBindings);
+    pSwap->bindings.reset(pPrevious);
+    std::swap(mDSP, pSwap->dsp);
+    EndBindingsSwap();
+    mSwappedIn = true;
+    
+    mXFadePos = 0;
+    
+    if(pSwap->dsp)
+    {
+      mFadingDSP = pSwap;
+    }
+    else
+    {
+      mRetiredDSP = pSwap;
+      mFading = false;
+    }
+  }
+  
   if(!mErrored)
     IPlugFaust::ProcessBlock(inputs, outputs, nFrames);
   else
     memset(outputs[0], 0, nFrames * mMaxNOutputs * sizeof(sample));
 }
 
+void FaustGen::Compute(int nFrames, sample** inputs, sample** outputs)
+{
+  if(!mFadingDSP)
+  {
+    mDSP->compute(nFrames, inputs, outputs);
+    return;
+  }
+  
+  ::dsp* pOldDSP = mFadingDSP->dsp.get();
+  const int nOldInputs = pOldDSP->getNumInputs();
+  const int nNewInputs = mDSP->getNumInputs();
+  const int nNewOutputs = mDSP->getNumOutputs();
+  const int nChans = std::min(pOldDSP->getNumOutputs(), nNewOutputs);
+  int frame = 0;
+  
+  // Chunk by chunk, the old DSP runs first, since the new one overwrites the inputs if the host processes in place
+  while(frame < nFrames && mXFadePos < FAUST_XFADE_LENGTH)
+  {
+    const int n = std::min({FAUST_XFADE_CHUNK, nFrames - frame, FAUST_XFADE_LENGTH - mXFadePos});
+    
+    for (auto c = 0; c < nOldInputs; c++)
+    {
+      mXFadeInputs[c] = inputs[c] + frame;
+    }
+    
+    pOldDSP->compute(n, mXFadeInputs.data(), mXFadeOutputs.data());
+    
+    for (auto c = 0; c < nNewInputs; c++)
+    {
+      mChunkInputs[c] = inputs[c] + frame;
+    }
+    
+    for (auto c = 0; c < nNewOutputs; c++)
+    {
+      mChunkOutputs[c] = outputs[c] + frame;
+    }
+    
+    mDSP->compute(n, mChunkInputs.data(), mChunkOutputs.data());
+    
+    for (auto c = 0; c < nChans; c++)
+    {
+      sample* pOut = outputs[c] + frame;
+      const sample* pOld = mXFadeOutputs[c];
+      
+      for (auto s = 0; s < n; s++)
+      {
+        const sample gain = (sample) (mXFadePos + s) / (sample) FAUST_XFADE_LENGTH;
+        pOut[s] = pOut[s] * gain + pOld[s] * (1. - gain);
+      }
+    }
+    
+    frame += n;
+    mXFadePos += n;
+  }
+  
+  if(mXFadePos >= FAUST_XFADE_LENGTH)
+  {
+    mRetiredDSP = mFadingDSP; // hand back to the main thread to delete
+    mFadingDSP = nullptr;
+    mFading = false;
+  }
+  
+  // The rest of the block after the crossfade
+  if(frame < nFrames)
+  {
+    for (auto c = 0; c < nNewInputs; c++)
+    {
+      mChunkInputs[c] = inputs[c] + frame;
+    }
+    
+    for (auto c = 0; c < nNewOutputs; c++)
+    {
+      mChunkOutputs[c] = outputs[c] + frame;
+    }
+    
+    mDSP->compute(nFrames - frame, mChunkInputs.data(), mChunkOutputs.data());
+  }
+}
+
 #endif // #ifndef FAUST_COMPILED
 
@@ -26,6 +26,9 @@ using FaustGen = iplug::IPlugFaust; // not used, except for CompileCPP();
 #include <set>
 #include <vector>
 #include <map>
+#include <algorithm>
+#include <atomic>
+#include <thread>
 
 #include "IPlugPlatform.h"
 #include "IPlugConstants.h"
@@ -84,6 +87,9 @@ static inline StatTime TimeZero() { return (StatTime) 0; }
 
 #define FAUST_CLASS_PREFIX "F"
 #define FAUST_RECOMPILE_INTERVAL 5000 //ms
+#define FAUST_SWAP_POLL_INTERVAL 50 //ms, how often the timer checks for finished compiles and DSP instances to reclaim
+#define FAUST_XFADE_LENGTH 1024 //samples, crossfade between the old and the new DSP when hot-swapping
+#define FAUST_XFADE_CHUNK 64 //samples, the old DSP is rendered in chunks of this size during a crossfade
 
 #ifndef FAUST_EXE
   #if defined OS_MAC || defined OS_LINUX
@@ -155,12 +161,33 @@ class FaustGen : public IPlugFaust
 
     void UpdateSourceCode(const char* str);
 
-    ::dsp* CreateDSPInstance(int nVoices = 0);
+    ::dsp* CreateDSPInstance(llvm_dsp_factory* pFactory, int nVoices = 0);
     void AddInstance(FaustGen* pDSP) { mInstances.insert(pDSP); }
     void RemoveInstance(FaustGen* pDSP);
 
     bool LoadFile(const char* file);
+    
+    /** Reads the source code from a file without re-initializing the instances. Use CompileInBackground() to hot-swap them
+     * @return \c true on success */
+    bool ReadFile(const char* file);
     bool WriteToFile(const char* file);
+    
+    /** JIT compiles the current source code on a background thread, and prepares a new DSP for every instance. Instances keep processing with their existing DSP in the meantime.
+     * Call CommitCompile() on the main thread once IsCompileFinished() returns true */
+    void CompileInBackground();
+    bool IsCompiling() const { return mCompileThread.joinable(); }
+    bool IsCompileFinished() const { return mCompileFinished; }
+    void JoinCompileThread();
+    
+    /** Waits for a background compile to finish and throws its result away, e.g. because the source code it compiled is out of date */
+    void CancelCompile();
+    
+    /** Swaps the newly compiled factory in and hands the prepared DSP instances to the audio thread
+     * @return \c true if the compile succeeded */
+    bool CommitCompile();
+    
+    /** Deletes DSP instances and factories that are no longer in use on the audio thread */
+    void ReclaimRetired();
     void SetCompileOptions(std::initializer_list<const char*> options);
 
   private:
@@ -200,6 +227,10 @@ class FaustGen : public IPlugFaust
     std::set<FaustGen*> mInstances;
 
     llvm_dsp_factory* mLLVMFactory = nullptr;
+    llvm_dsp_factory* mCompiledFactory = nullptr; // result of the background compile, until committed
+    std::vector<llvm_dsp_factory*> mRetiredFactories; // kept alive until no instance processes a DSP created from them
+    std::thread mCompileThread;
+    std::atomic<bool> mCompileFinished {false};
     //  midi_handler mMidiHandler;
     WDL_FastString mSourceCodeStr;
     WDL_FastString mBitCodeStr;
@@ -231,12 +262,13 @@ public:
   /** Call this method after constructing the class to inform FaustGen what the maximum I/O count is
    * @param maxNInputs Specify a number here to tell FaustGen the maximum number of inputs the hosting code can accommodate
    * @param maxNOutputs Specify a number here to tell FaustGen the maximum number of outputs the hosting code can accommodate */
-  void SetMaxChannelCount(int maxNInputs, int maxNOutputs) override { mMaxNInputs = maxNInputs; mMaxNOutputs = maxNOutputs; }
+  void SetMaxChannelCount(int maxNInputs, int maxNOutputs) override;
   
   /** Call this method after constructing the class to JIT compile */
   void Init() override;
 
-  void LoadFile(const char* path) { mFactory->FreeDSPFactory(); mFactory->LoadFile(path); }
+  /** Loads a new .dsp file and hot-swaps it in once it has been compiled on a background thread */
+  void LoadFile(const char* path);
   
   /** This method allows SVG files generated by a specific instance of FaustGen can be located. The path to the SVG file for process.svg will be returned, if drawPath has been specified in the constructor.
    * This method will trigger an assertion if drawPath has not been specified
@@ -259,17 +291,64 @@ public:
   
   void SetErrored(bool errored) { mErrored = errored; }
   
+  /** Frees the current DSP, as well as any DSP that is waiting to be swapped in or reclaimed. Not safe to call while processing */
+  void FreeDSP();
+  
+private:
+  /** @return The sample rate the DSP runs at, taking oversampling into account */
+  double GetDSPSampleRate() const;
+  
+  /** Called on the compile thread, creates and initializes a DSP instance at the current sample rate, ready to be swapped in */
+  void PrepareDSP(llvm_dsp_factory* pFactory, double sampleRate);
+  
+  /** Called on the main thread, builds new parameters bound to the zones of the prepared DSP, restoring the current parameter values, and publishes both to the audio thread, which swaps them in together */
+  void CommitPreparedDSP();
+  
+  /** Connects the parameters to the zones of pDSP, restoring the values of parameters that existed before
+   * @param pBindings Where to put the zones, or nullptr for the bindings in use, which is only safe when not processing */
+  void BindDSP(::dsp* pDSP, Bindings* pBindings = nullptr);
+  
+  /** Links the plug-in's parameters to a DSP that the audio thread has swapped in, and deletes the DSP and bindings handed back by the audio thread, if there are any */
+  void ReclaimRetiredDSP();
+  
+  /** Lets the plug-in know that the parameters are bound to a new DSP */
+  void OnParamsRebound();
+  
+  /** @return \c true if a DSP instance is waiting to be swapped in, is being crossfaded out or is waiting to be reclaimed */
+  bool IsSwapping() const { return mPendingDSP.load() || mFading.load() || mRetiredDSP.load(); }
+  
+  void Compute(int nFrames, sample** inputs, sample** outputs) override;
+  
 private:
   Factory* mFactory = nullptr;
   static Timer* sTimer;
   static int sFaustGenCounter;
+  static int sTimerTicks;
   static bool sAutoRecompile;
   int mMaxNInputs = -1;
   int mMaxNOutputs = -1;
-  bool mErrored = false;
+  std::atomic<bool> mErrored {false};
   std::function<void()> mOnCompileFunc = nullptr;
   
-  WDL_Mutex mMutex;
+  /** A DSP instance and the zones of its parameters, which are handed between the threads as one */
+  struct SwapDSP
+  {
+    std::unique_ptr<::dsp> dsp;
+    std::unique_ptr<Bindings> bindings;
+  };
+  
+  std::unique_ptr<::dsp> mPreparedDSP; // written on the compile thread, read on the main thread after joining
+  std::atomic<SwapDSP*> mPendingDSP {nullptr}; // main thread -> audio thread
+  std::atomic<SwapDSP*> mRetiredDSP {nullptr}; // audio thread -> main thread
+  std::atomic<bool> mFading {false};
+  std::atomic<bool> mSwappedIn {false}; // audio thread -> main thread, the plug-in hasn't been linked to the new parameters yet
+  SwapDSP* mFadingDSP = nullptr; // audio thread only, the previous DSP and its bindings
+  int mXFadePos = 0;
+  std::vector<sample> mXFadeBuffer;
+  std::vector<sample*> mXFadeInputs;
+  std::vector<sample*> mXFadeOutputs;
+  std::vector<sample*> mChunkInputs;
+  std::vector<sample*> mChunkOutputs;
 };
 
 END_IPLUG_NAMESPACE
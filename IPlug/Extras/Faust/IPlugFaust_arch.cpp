@@ -18,13 +18,14 @@ class Faust_mydsp : public IPlugFaust
 public:
 	Faust_mydsp(const char* name, const char* inputDSPFile = 0, int nVoices = 1, int rate = 1,
 						const char* outputCPPFile = 0, const char* drawPath = 0, const char* libraryPath = DEFAULT_FAUST_LIBRARY_PATH)
-	: IPlugFaust(name, nVoices)
+	: IPlugFaust(name, nVoices, rate)
 	{
 	}
 
 	void Init() override
 	{
 		mDSP = std::make_unique<FAUSTCLASS>();
+		ResizeOverSampler(std::max(mDSP->getNumInputs(), mDSP->getNumOutputs()));
 		mDSP->buildUserInterface(this);
 		BuildParameterMap();
 		mInitialized = true;
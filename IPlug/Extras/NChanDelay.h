@@ -1,71 +1,123 @@
 /*
  ==============================================================================
- 
- This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers. 
- 
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
  See LICENSE.txt for  more info.
- 
+
  ==============================================================================
 */
 
 #pragma once
+
+#include <algorithm>
+#include <cstring>
+
 #include "IPlugPlatform.h"
 
 BEGIN_IPLUG_NAMESPACE
 
-// A static delayline used to delay bypassed signals to match mLatency in AAX/VST3/AU
+/** A static delayline used to delay bypassed signals to match mLatency in AAX/VST3/AU
+ * Each channel has its own ring buffer, which is read and written with block copies: a block no longer than the delay takes at most two copies per channel.
+ * Memory is only allocated when the delay time exceeds the maximum delay time, so SetMaxDelayTime() allows the delay to change on the audio thread */
 template<typename T>
 class NChanDelayLine
 {
 public:
-  NChanDelayLine(int nInputChans = 2, int nOutputChans = 2)
+  NChanDelayLine(int nInputChans = 2, int nOutputChans = 2, int maxDelayTimeSamples = 0)
   : mNInChans(nInputChans)
   , mNOutChans(nOutputChans)
-  {}
+  {
+    SetMaxDelayTime(maxDelayTimeSamples);
+  }
 
+  /** Allocate enough memory for delay times up to maxDelayTimeSamples. Only ever grows the buffer
+   * @param maxDelayTimeSamples The maximum delay time in samples */
+  void SetMaxDelayTime(int maxDelayTimeSamples)
+  {
+    if (maxDelayTimeSamples <= mMaxDTSamples)
+      return;
+
+    mMaxDTSamples = maxDelayTimeSamples;
+    mBuffer.Resize(mNInChans * mMaxDTSamples);
+    ClearBuffer();
+  }
+
+  /** Set the delay time, which clears the delay line. This does not allocate if delayTimeSamples is within the maximum delay time
+   * @param delayTimeSamples The delay time in samples */
   void SetDelayTime(int delayTimeSamples)
   {
-    mDTSamples = delayTimeSamples;
-    mBuffer.Resize(mNInChans * delayTimeSamples);
-    mWriteAddress = 0;
+    SetMaxDelayTime(delayTimeSamples);
+    mDTSamples = std::max(delayTimeSamples, 0);
     ClearBuffer();
   }
 
+  /** @return The delay time in samples */
+  int GetDelayTime() const { return mDTSamples; }
+
   void ClearBuffer()
   {
-    memset(mBuffer.Get(), 0, mNInChans * mDTSamples * sizeof(T));
+    for (auto c = 0; c < mNInChans; c++)
+      memset(GetChannelBuffer(c), 0, mDTSamples * sizeof(T));
+
+    mWriteAddress = 0;
   }
 
   void ProcessBlock(T** inputs, T** outputs, int nFrames)
   {
-    T* buffer = mBuffer.Get();
+    const int nChans = std::min(mNInChans, mNOutChans);
+
+    if (!mDTSamples)
+    {
+      for (auto c = 0; c < nChans; c++)
+      {
+        if (inputs[c] != outputs[c])
+          memcpy(outputs[c], inputs[c], nFrames * sizeof(T));
+      }
+
+      return;
+    }
 
-    for (auto s = 0 ; s < nFrames; ++s)
+    // the ring buffer of each channel holds the last mDTSamples inputs, the oldest one at mWriteAddress
+    for (auto c = 0; c < nChans; c++)
     {
-      int32_t readAddress = mWriteAddress - mDTSamples;
-      readAddress %= mDTSamples;
+      T* buffer = GetChannelBuffer(c);
+      const T* in = inputs[c];
+      T* out = outputs[c];
+      const bool inPlace = in == out;
+      int address = mWriteAddress;
 
-      for (auto c = 0; c < mNInChans; c++)
+      for (auto s = 0; s < nFrames;)
       {
-        if (c < mNOutChans)
+        const int n = std::min(nFrames - s, mDTSamples - address);
+
+        if (inPlace)
+          std::swap_ranges(out + s, out + s + n, buffer + address);
+        else
         {
-          T input = inputs[c][s];
-          const int offset = c * mDTSamples;
-          outputs[c][s] = buffer[offset + readAddress];
-          buffer[offset + mWriteAddress] = input;
+          memcpy(out + s, buffer + address, n * sizeof(T));
+          memcpy(buffer + address, in + s, n * sizeof(T));
         }
-      }
 
-      mWriteAddress++;
-      mWriteAddress %= mDTSamples;
+        s += n;
+        address += n;
+
+        if (address == mDTSamples)
+          address = 0;
+      }
     }
+
+    mWriteAddress = (int) ((mWriteAddress + (int64_t) nFrames) % mDTSamples);
   }
 
 private:
+  T* GetChannelBuffer(int chan) { return mBuffer.Get() + chan * mMaxDTSamples; }
+
   WDL_TypedBuf<T> mBuffer;
-  uint32_t mNInChans, mNOutChans;
-  uint32_t mWriteAddress = 0;
-  uint32_t mDTSamples = 0;
+  int mNInChans, mNOutChans;
+  int mWriteAddress = 0;
+  int mDTSamples = 0;
+  int mMaxDTSamples = 0;
 } WDL_FIXALIGN;
 
 END_IPLUG_NAMESPACE
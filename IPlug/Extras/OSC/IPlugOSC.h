@@ -22,17 +22,84 @@
 #include <unistd.h>
 #include <functional>
 #include <memory>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <chrono>
+#include <algorithm>
 
 #include "jnetlib/jnetlib.h"
 
+#ifdef _WIN32
+  #define OSC_POLLFD WSAPOLLFD
+  #define OSC_POLL WSAPoll
+#else
+  #include <poll.h>
+  #define OSC_POLLFD struct pollfd
+  #define OSC_POLL poll
+#endif
+
+#include "heapbuf.h"
+#include "ptrlist.h"
+#include "mutex.h"
+
 #include "IPlugPlatform.h"
 #include "IPlugOSC_msg.h"
+#include "IPlugQueue.h"
 #include "IPlugTimer.h"
 
 extern void Sleep(int ms);
 
+#define OSC_TIMETAG_IMMEDIATE 1ULL // the special OSC time tag meaning "process immediately"
+#define OSC_INCOMING_QUEUE_SIZE 256 // number of messages that can be waiting to be handled, per OSCInterface
+#define OSC_SCHEDULED_QUEUE_SIZE 64 // number of messages with a time tag in a later block that can be held back, per OSCInterface
+#define OSC_MAX_POLL_TIME_MS 100 // the longest time the network thread waits on the sockets
+
 BEGIN_IPLUG_NAMESPACE
 
+/** @return The current time as a 64 bit OSC (NTP) time tag, seconds since 1900 in the upper 32 bits, fraction in the lower 32 */
+static inline uint64_t OSCTimeTagNow()
+{
+  using namespace std::chrono;
+  const uint64_t nanos = (uint64_t) duration_cast<nanoseconds>(system_clock::now().time_since_epoch()).count();
+  const uint64_t secs = (nanos / 1000000000ULL) + 2208988800ULL; // seconds between 1900 and 1970
+  const uint64_t frac = ((nanos % 1000000000ULL) << 32) / 1000000000ULL;
+  return (secs << 32) | frac;
+}
+
+/** Calls func(const char* msg, int len, uint64_t timeTag) for each message in an OSC packet, descending into (nested) bundles.
+ * Nothing is copied, msg points into buf */
+template <typename Func>
+static void ForEachOSCMessage(const char* buf, int len, uint64_t timeTag, Func&& func)
+{
+  if (len >= 16 && !memcmp(buf, "#bundle", 8))
+  {
+    int tt[2];
+    memcpy(tt, buf + 8, sizeof(tt));
+    OSC_MAKEINTMEM4BE(&tt[0]);
+    OSC_MAKEINTMEM4BE(&tt[1]);
+    const uint64_t bundleTimeTag = ((uint64_t) (unsigned int) tt[0] << 32) | (unsigned int) tt[1];
+    
+    int pos = 16;
+    while (pos + (int) sizeof(int) <= len)
+    {
+      int sz;
+      memcpy(&sz, buf + pos, sizeof(int));
+      OSC_MAKEINTMEM4BE(&sz);
+      pos += sizeof(int);
+      
+      if (sz < 1 || pos + sz > len) break;
+      
+      ForEachOSCMessage(buf + pos, sz, bundleTimeTag, func);
+      pos += sz;
+    }
+  }
+  else if (len > 0)
+  {
+    func(buf, len, timeTag);
+  }
+}
+
 class IODevice
 {
 protected:
@@ -48,7 +115,7 @@ protected:
     
   struct rec
   {
-    void (*callback)(void *d1, int dev_idx, char type, int msglen, void *msg); // type=0 for MIDI, 1=osc
+    void (*callback)(void *d1, int dev_idx, char type, int msglen, void *msg, uint64_t timetag); // type=0 for MIDI, 1=osc
     void *data1;
     int dev_idx;
   };
@@ -63,22 +130,32 @@ public:
   virtual void run_input(WDL_FastString& textOut)=0;
   virtual void run_output(WDL_FastString& textOut)=0;
   virtual const char *get_type()=0;
+  virtual SOCKET get_socket() { return INVALID_SOCKET; } // socket to wait on for input, if any
   
   virtual void oscSend(const char *src, int len) {}
+  virtual bool take_output() { return false; } // move queued output aside for run_output(), returns true if there is any
   //  virtual void midiSend(const unsigned char *buf, int len) {}
   
-  virtual void addinst(void (*callback)(void *d1, int dev_idx, char type, int msglen, void *msg), void *d1, int dev_idx)
+  virtual void addinst(void (*callback)(void *d1, int dev_idx, char type, int msglen, void *msg, uint64_t timetag), void *d1, int dev_idx)
   {
     const rec r = {callback, d1, dev_idx};
     m_instances.Add(r);
   }
   
-  virtual void onMessage(char type, const unsigned char *msg, int len)
+  virtual void removeinst(void *d1)
+  {
+    for (int x=m_instances.GetSize()-1; x>=0; x--)
+      if (m_instances.Get()[x].data1 == d1) m_instances.Delete(x);
+  }
+  
+  int numinst() const { return m_instances.GetSize(); }
+  
+  virtual void onMessage(char type, const unsigned char *msg, int len, uint64_t timetag = OSC_TIMETAG_IMMEDIATE)
   {
     const int n=m_instances.GetSize();
     const rec *r = m_instances.Get();
     for (int x=0;x<n; x++)
-      if (r[x].callback) r[x].callback(r[x].data1,r[x].dev_idx, type, len, (void*)msg);
+      if (r[x].callback) r[x].callback(r[x].data1,r[x].dev_idx, type, len, (void*)msg, timetag);
   }
 };
 
@@ -87,10 +164,9 @@ class OSCDevice : public IODevice
 public:
   OSCDevice(const char* dest, int maxpacket, int sendsleep, struct sockaddr_in* listen_addr)
   {
-    m_has_input = true;
-    m_has_output = false;
+    m_has_input = listen_addr != nullptr;
+    m_has_output = listen_addr == nullptr;
     
-    // m_has_output = m_has_input = true;
     memset(&m_sendaddr, 0, sizeof(m_sendaddr));
     m_maxpacketsz = maxpacket > 0 ? maxpacket : 1024;
     m_sendsleep = sendsleep >= 0 ? sendsleep : 10;
@@ -161,7 +237,10 @@ public:
       const int len = (int)recvfrom(m_sendsock, buf, sizeof(buf), 0, p, p?&plen:nullptr);
       if (len<1) break;
       
-      onMessage(1,(const unsigned char *)buf,len);
+      // split bundles here, so that each message reaches the instances with its own time tag
+      ForEachOSCMessage(buf, len, OSC_TIMETAG_IMMEDIATE, [this](const char* msg, int msgLen, uint64_t timeTag) {
+        onMessage(1, (const unsigned char *)msg, msgLen, timeTag);
+      });
     }
   }
   
@@ -169,27 +248,27 @@ public:
   {
     static char hdr[16] = { '#', 'b', 'u', 'n', 'd', 'l', 'e', 0, 0, 0, 0, 0, 1, 0, 0, 0 };
     
-    // send m_sendq as UDP blocks
-    if (m_sendq.Available() <= 16)
+    // send m_sendingq as UDP blocks, see take_output()
+    if (m_sendingq.Available() <= 16)
     {
-      if (m_sendq.Available() > 0) m_sendq.Clear();
+      if (m_sendingq.Available() > 0) m_sendingq.Clear();
       return;
     }
-    // m_sendq should begin with a 16 byte pad, then messages in OSC
+    // m_sendingq should begin with a 16 byte pad, then messages in OSC
     
-    char* packetstart = (char*) m_sendq.Get();
+    char* packetstart = (char*) m_sendingq.Get();
     int packetlen = 16;
     bool hasbundle = false;
-    m_sendq.Advance(16); // skip bundle for now, but keep it around
+    m_sendingq.Advance(16); // skip bundle for now, but keep it around
     
     SET_SOCK_BLOCK(m_sendsock, true);
     
-    while (m_sendq.Available() >= sizeof(int))
+    while (m_sendingq.Available() >= sizeof(int))
     {
-      int len = *(int*) m_sendq.Get(); // not advancing
+      int len = *(int*) m_sendingq.Get(); // not advancing
       OSC_MAKEINTMEM4BE((char*)&len);
       
-      if (len < 1 || len > MAX_OSC_MSG_LEN || len > m_sendq.Available()) break;
+      if (len < 1 || len > MAX_OSC_MSG_LEN || len > m_sendingq.Available()) break;
       
       if (packetlen > 16 && packetlen+sizeof(int)+len > m_maxpacketsz)
       {
@@ -207,13 +286,13 @@ public:
         sendto(m_sendsock, packetstart, packetlen, 0, (struct sockaddr*)&m_sendaddr, sizeof(m_sendaddr));
         if (m_sendsleep>0) Sleep(m_sendsleep);
         
-        packetstart = (char*) m_sendq.Get()-16; // safe since we padded the queue start
+        packetstart = (char*) m_sendingq.Get()-16; // safe since we padded the queue start
         packetlen = 16;
         hasbundle = false;
       }
       
       if (packetlen > 16) hasbundle = true;
-      m_sendq.Advance(sizeof(int)+len);
+      m_sendingq.Advance(sizeof(int)+len);
       packetlen += sizeof(int)+len;
     }
     
@@ -233,7 +312,17 @@ public:
     }
     SET_SOCK_BLOCK(m_sendsock, false);
     
+    m_sendingq.Clear();
+  }
+  
+  virtual bool take_output()
+  {
+    // called with the devices locked, run_output() then sends without the lock, since it blocks and sleeps between packets
+    if (m_sendq.Available() > 16)
+      m_sendingq.Add(m_sendq.Get(), m_sendq.Available());
+    
     m_sendq.Clear();
+    return m_sendingq.Available() > 0;
   }
   
   virtual void oscSend(const char* src, int len)
@@ -247,44 +336,95 @@ public:
   }
   
   virtual const char* get_type() { return "OSC"; }
+  virtual SOCKET get_socket() { return m_has_input ? m_sendsock : INVALID_SOCKET; }
   
   SOCKET m_sendsock;
   int m_maxpacketsz, m_sendsleep;
   struct sockaddr_in m_sendaddr;
   WDL_Queue m_sendq;
+  WDL_Queue m_sendingq; // only used by the network thread
   WDL_String m_dest;
   
   struct sockaddr_in m_recvaddr;
   WDL_Queue m_recvq;
 };
 
-WDL_PtrList<IODevice> g_devices;
-
 class OSCReciever;
 
+/** A message received on the network thread, waiting in an OSCInterface's queue to be handled */
+struct OSCQueuedMessage
+{
+  uint64_t timeTag = OSC_TIMETAG_IMMEDIATE;
+  int size = 0;
+  char data[MAX_OSC_MSG_LEN];
+};
+
+/** Base class for OSC senders and receivers. All sockets are serviced by a single network thread shared by all instances, which
+ * waits on the sockets with poll(), so incoming messages are picked up as soon as they arrive rather than on a timer.
+ * Incoming messages are pushed into a lock-free queue per instance, and by default a timer calls OnOSCMessage() for each of them on the main thread.
+ * Call SetSampleAccurateOSC() to handle them in ProcessOSCMessages() instead */
 class OSCInterface
 {
 public:
+  /** @param updateRateMs How often OnOSCMessage() is called on the main thread for the messages that have arrived, unless SetSampleAccurateOSC() is called */
   OSCInterface(int updateRateMs = 100)
+  : mIncoming(OSC_INCOMING_QUEUE_SIZE)
+  , mScheduled(OSC_SCHEDULED_QUEUE_SIZE)
   {
+    // allocated up front, so that ProcessOSCMessages() never allocates on the audio thread
+    mScheduledOrder.reserve(OSC_SCHEDULED_QUEUE_SIZE);
+    mFreeSlots.reserve(OSC_SCHEDULED_QUEUE_SIZE);
+    
+    for (auto i = OSC_SCHEDULED_QUEUE_SIZE - 1; i >= 0; i--)
+      mFreeSlots.push_back(i);
+    
     JNL::open_socketlib();
     
-    if(!mTimer)
-      mTimer = std::unique_ptr<Timer>(Timer::Create(std::bind(&OSCInterface::OnTimer, this, std::placeholders::_1), updateRateMs));
+    NetworkState& state = GetNetworkState();
+    
+    {
+      std::lock_guard<std::mutex> lock(state.instancesMutex);
       
-    sInstances++;
+      if (state.nInstances++ == 0)
+        StartNetworkThread();
+    }
+    
+    mTimer = std::unique_ptr<Timer>(Timer::Create(std::bind(&OSCInterface::OnTimer, this, std::placeholders::_1), updateRateMs));
   }
   
   virtual ~OSCInterface()
   {
-    if (--sInstances == 0)
-      mTimer = nullptr;
+    mTimer = nullptr;
+    
+    NetworkState& state = GetNetworkState();
+    
+    {
+      WDL_MutexLock lock(&state.devicesMutex);
+      
+      // devices that no other instance uses are closed by the network thread, which may be sending on them
+      for (auto x = 0; x < m_devs.GetSize(); x++)
+      {
+        IODevice* pDev = m_devs.Get(x);
+        pDev->removeinst(this);
+        
+        if (!pDev->numinst() && state.devices.Find(pDev) >= 0)
+        {
+          state.devices.DeletePtr(pDev);
+          state.retiredDevices.Add(pDev);
+        }
+      }
+    }
+    
+    std::lock_guard<std::mutex> lock(state.instancesMutex);
+    
+    if (--state.nInstances == 0)
+      StopNetworkThread();
   }
   
   OSCInterface(const OSCInterface&) = delete;
   OSCInterface& operator=(const OSCInterface&) = delete;
     
-  static void MessageCallback(void *d1, int dev_idx, char type, int msglen, void *msg);
+  static void MessageCallback(void *d1, int dev_idx, char type, int msglen, void *msg, uint64_t timetag);
   
   void CreateReciever(WDL_String& results, int port = 8000)
   {
@@ -297,12 +437,15 @@ public:
     if (addr.sin_addr.s_addr == INADDR_NONE) addr.sin_addr.s_addr = INADDR_ANY;
     addr.sin_port = htons(port);
     
+    NetworkState& state = GetNetworkState();
+    WDL_MutexLock lock(&state.devicesMutex);
+    
     int x;
     bool is_reuse = false;
     OSCDevice *r = nullptr;
-    for (x = 0; x < g_devices.GetSize(); x++)
+    for (x = 0; x < state.devices.GetSize(); x++)
     {
-      IODevice  *dev = g_devices.Get(x);
+      IODevice  *dev = state.devices.Get(x);
       if (dev && !strcmp(dev->get_type(),"OSC") && dev->m_has_input)
       {
         OSCDevice *od = (OSCDevice *)dev;
@@ -339,19 +482,25 @@ public:
       m_devs.Add(r);
       
       if (!is_reuse)
-        g_devices.Add(r);
+        state.devices.Add(r);
     }
+    
+    WakeNetworkThread(); // start polling the new socket
   }
   
   void CreateSender(WDL_String& results, const char* ip = "127.0.0.1", int port = 8000)
   {
     WDL_String dp;
     dp.SetFormatted(256, "%s:%i", ip, port);
+    
+    NetworkState& state = GetNetworkState();
+    WDL_MutexLock lock(&state.devicesMutex);
+    
     OSCDevice *r = nullptr;
     bool is_reuse = false;
-    for (auto x=0; x<g_devices.GetSize(); x++)
+    for (auto x=0; x<state.devices.GetSize(); x++)
     {
-      IODevice *d = g_devices.Get(x);
+      IODevice *d = state.devices.Get(x);
       if (d && !strcmp(d->get_type(),"OSC") && d->m_has_output)
       {
         OSCDevice *p = (OSCDevice *)d;
@@ -384,101 +533,302 @@ public:
       m_devs.Add(r);
       
       if (!is_reuse)
-        g_devices.Add(r);
+        state.devices.Add(r);
     }
   }
   
 public:
+  /** Queue a message to be sent to this instance's destinations on the network thread. This takes a lock, so don't call it on the audio thread */
   void SendMsg(const char* msg, int len)
   {
-    g_devices.Get(0)->oscSend(msg, len); // TODO: device 0?
+    {
+      WDL_MutexLock lock(&GetNetworkState().devicesMutex);
+      
+      for (auto x = 0; x < m_devs.GetSize(); x++)
+      {
+        if (m_devs.Get(x)->m_has_output)
+          m_devs.Get(x)->oscSend(msg, len);
+      }
+    }
+    
+    WakeNetworkThread();
   }
   
-  struct incomingEvent
+  /** Call this in the constructor to handle the messages in ProcessOSCMessages(), so that messages from bundles can be handled at the sample given by their time tag.
+   * Otherwise OnOSCMessage() is called on the main thread as messages arrive, ignoring their time tags */
+  void SetSampleAccurateOSC() { mTimer = nullptr; }
+  
+  /** Handle the messages that have arrived since the last call, by calling OnOSCMessage() for each one, after SetSampleAccurateOSC() has been called. Parsing happens in place, over the queued data.
+   * Call this from ProcessBlock() with the block size and sample rate, and messages from bundles with a time tag in the future are held back until the block they are due in.
+   * Held back messages are kept apart, sorted by time tag, so they never delay the messages that arrive after them.
+   * GetOSCMessageOffset() then returns the sample offset of the message within the block. It can also be called on the main thread (e.g. from OnIdle()) with nFrames = 0,
+   * in which case all messages that are due now are handled.
+   * @param nFrames The number of frames in the current block, or 0
+   * @param sampleRate The current sample rate, only needed if nFrames > 0 */
+  void ProcessOSCMessages(int nFrames = 0, double sampleRate = 0.)
   {
-    IODevice* dev_ptr;
-    int sz; // size of msg[], 1..3 for midi, anything for OSC
-    char type; // 0=midi, 1=OSC
-    unsigned char msg[3];
-  };
+    assert(!mTimer && "call SetSampleAccurateOSC() first, messages are already handled on the main thread");
+    
+    const uint64_t now = OSCTimeTagNow();
+    const double ticksPerSample = (sampleRate > 0.) ? 4294967296. / sampleRate : 0.;
+    const uint64_t blockEnd = now + (uint64_t) (ticksPerSample * nFrames);
+    
+    // messages that were held back, and are due now
+    while (mScheduledOrder.size() && mScheduled[mScheduledOrder.back()].timeTag <= blockEnd)
+    {
+      const int slot = mScheduledOrder.back();
+      mScheduledOrder.pop_back();
+      mFreeSlots.push_back(slot);
+      HandleMessage(mScheduled[slot], nFrames, now, ticksPerSample);
+    }
+    
+    while (!mIncoming.WasEmpty())
+    {
+      mIncoming.Pop(mCurrentMessage);
+      
+      if (mCurrentMessage.timeTag <= blockEnd)
+        HandleMessage(mCurrentMessage, nFrames, now, ticksPerSample);
+      else
+        Schedule(mCurrentMessage);
+    }
+    
+    mCurrentOffset = 0;
+  }
+  
+  /** @return The sample offset within the current block of the message being handled in OnOSCMessage(), when called via ProcessOSCMessages() on the audio thread */
+  int GetOSCMessageOffset() const { return mCurrentOffset; }
+  
+  /** @return The number of messages that were dropped because the queue was full */
+  int GetNumDroppedOSCMessages() const { return mNumDropped; }
   
   virtual void OnOSCMessage(OscMessageRead& msg) {};
   
 private:
+  /** Shared by all instances. A function-local static, so that this header can be included in more than one file */
+  struct NetworkState
+  {
+    std::mutex instancesMutex; // held while instances are counted, and the network thread is started and stopped
+    int nInstances = 0;
+    std::thread thread;
+    std::atomic<bool> running {false};
+    SOCKET wakeSock = INVALID_SOCKET;
+    struct sockaddr_in wakeAddr;
+    WDL_Mutex devicesMutex; // protects the devices, their instances and queues, between the network thread and the others
+    WDL_PtrList<IODevice> devices;
+    WDL_PtrList<IODevice> retiredDevices; // no longer used by any instance, deleted by the network thread
+  };
+  
+  static NetworkState& GetNetworkState()
+  {
+    static NetworkState sState;
+    return sState;
+  }
+  
   void OnTimer(Timer& timer)
   {
-    if(mInputProc)
-      mInputProc();
+    while (!mIncoming.WasEmpty())
+    {
+      mIncoming.Pop(mCurrentMessage);
+      HandleMessage(mCurrentMessage, 0, 0, 0.);
+    }
+  }
+  
+  void HandleMessage(OSCQueuedMessage& item, int nFrames, uint64_t now, double ticksPerSample)
+  {
+    mCurrentOffset = 0;
     
-    if (m_incoming_events.GetSize())
+    if (nFrames > 0 && item.timeTag > now)
+      mCurrentOffset = std::min(nFrames - 1, (int) ((item.timeTag - now) / ticksPerSample));
+    
+    OscMessageRead msg(item.data, item.size);
+    
+    const char *mstr = msg.GetMessage();
+    if (mstr && *mstr)
+    {
+      OnOSCMessage(msg);
+    }
+  }
+  
+  /** Holds a message back until the block it is due in, keeping mScheduledOrder sorted with the earliest time tag last */
+  void Schedule(const OSCQueuedMessage& item)
+  {
+    if (mFreeSlots.empty())
+    {
+      mNumDropped++;
+      return;
+    }
+    
+    const int slot = mFreeSlots.back();
+    mFreeSlots.pop_back();
+    
+    OSCQueuedMessage& dest = mScheduled[slot];
+    dest.timeTag = item.timeTag;
+    dest.size = item.size;
+    memcpy(dest.data, item.data, item.size);
+    
+    // messages with the same time tag keep the order they arrived in
+    auto pos = std::upper_bound(mScheduledOrder.begin(), mScheduledOrder.end(), item.timeTag, [this](uint64_t timeTag, int other) {
+      return timeTag >= mScheduled[other].timeTag;
+    });
+    
+    mScheduledOrder.insert(pos, slot);
+  }
+  
+  static void StartNetworkThread()
+  {
+    NetworkState& state = GetNetworkState();
+    state.wakeSock = socket(AF_INET, SOCK_DGRAM, 0);
+    
+    if (state.wakeSock != INVALID_SOCKET)
     {
-      static WDL_HeapBuf tmp;
+      // a socket bound to a loopback port, that other threads send a byte to in order to interrupt poll()
+      memset(&state.wakeAddr, 0, sizeof(state.wakeAddr));
+      state.wakeAddr.sin_family = AF_INET;
+      state.wakeAddr.sin_addr.s_addr = inet_addr("127.0.0.1");
+      state.wakeAddr.sin_port = 0;
+      socklen_t addrLen = (socklen_t) sizeof(state.wakeAddr);
       
-      m_incoming_events_mutex.Enter();
-      tmp.CopyFrom(&m_incoming_events,false);
-      m_incoming_events.Resize(0,false);
-      m_incoming_events_mutex.Leave();
+      if (!bind(state.wakeSock, (struct sockaddr*) &state.wakeAddr, sizeof(state.wakeAddr)) && !getsockname(state.wakeSock, (struct sockaddr*) &state.wakeAddr, &addrLen))
+      {
+        SET_SOCK_BLOCK(state.wakeSock, false);
+      }
+      else
+      {
+        closesocket(state.wakeSock);
+        state.wakeSock = INVALID_SOCKET;
+      }
+    }
+    
+    state.running = true;
+    state.thread = std::thread(NetworkThreadProc);
+  }
+  
+  static void StopNetworkThread()
+  {
+    NetworkState& state = GetNetworkState();
+    state.running = false;
+    WakeNetworkThread();
+    
+    if (state.thread.joinable())
+      state.thread.join();
+    
+    if (state.wakeSock != INVALID_SOCKET)
+    {
+      closesocket(state.wakeSock);
+      state.wakeSock = INVALID_SOCKET;
+    }
+    
+    // all the instances have removed themselves, so this only leaves devices that were never attached
+    WDL_MutexLock lock(&state.devicesMutex);
+    state.retiredDevices.Empty(true);
+    state.devices.Empty(true);
+  }
+  
+  static void WakeNetworkThread()
+  {
+    NetworkState& state = GetNetworkState();
+    
+    if (state.wakeSock != INVALID_SOCKET)
+    {
+      const char c = 0;
+      sendto(state.wakeSock, &c, 1, 0, (struct sockaddr*) &state.wakeAddr, sizeof(state.wakeAddr));
+    }
+  }
+  
+  static void NetworkThreadProc()
+  {
+    NetworkState& state = GetNetworkState();
+    std::vector<OSC_POLLFD> fds;
+    std::vector<IODevice*> inputDevices;
+    std::vector<IODevice*> outputDevices;
+    WDL_FastString results;
+    
+    while (state.running)
+    {
+      fds.clear();
+      inputDevices.clear();
+      outputDevices.clear();
+      
+      OSC_POLLFD wakeFd = {};
+      wakeFd.fd = state.wakeSock;
+      wakeFd.events = POLLIN;
+      fds.push_back(wakeFd);
       
-      int pos=0;
-      const int endpos = tmp.GetSize();
-      while (pos < endpos+1 - sizeof(incomingEvent))
       {
-        incomingEvent *evt = (incomingEvent*) ((char *)tmp.Get()+pos);
+        WDL_MutexLock lock(&state.devicesMutex);
         
-        const int this_sz = ((sizeof(incomingEvent) + (evt->sz-3)) + 7) & ~7;
+        // only this thread uses devices without the lock, so they can be deleted here
+        state.retiredDevices.Empty(true);
         
-        if (pos+this_sz > endpos) break;
-        pos += this_sz;
+        for (auto x = 0; x < state.devices.GetSize(); x++)
+        {
+          IODevice* pDev = state.devices.Get(x);
+          
+          if (pDev && pDev->m_has_input && pDev->get_socket() != INVALID_SOCKET)
+          {
+            OSC_POLLFD fd = {};
+            fd.fd = pDev->get_socket();
+            fd.events = POLLIN;
+            fds.push_back(fd);
+            inputDevices.push_back(pDev);
+          }
+        }
+      }
+      
+      // without a wake socket, fall back to waking up regularly
+      const int timeout = (state.wakeSock != INVALID_SOCKET) ? OSC_MAX_POLL_TIME_MS : 10;
+      
+      if (OSC_POLL(fds.data() + (state.wakeSock == INVALID_SOCKET), (int) fds.size() - (state.wakeSock == INVALID_SOCKET), timeout) < 0)
+        continue;
+      
+      if (fds[0].revents & POLLIN)
+      {
+        char buf[64];
+        while (recv(state.wakeSock, buf, sizeof(buf), 0) > 0) {}
+      }
+      
+      {
+        WDL_MutexLock lock(&state.devicesMutex);
         
-        int rd_pos = 0;
-        int rd_sz = evt->sz;
-        if (evt->sz > 20 && !strcmp((char*)evt->msg, "#bundle"))
+        // the input sockets don't block, and the instances can't go away while their callbacks are called
+        for (auto i = 0; i < inputDevices.size(); i++)
         {
-          rd_sz = *(int *)(evt->msg+16);
-          OSC_MAKEINTMEM4BE(&rd_sz);
-          rd_pos += 20;
+          if (fds[i + 1].revents & POLLIN)
+            inputDevices[i]->run_input(results);
         }
-        //        if (m_var_msgs[3]) m_var_msgs[3][0] = evt->dev_ptr ? *evt->dev_ptr : -1.0;
         
-        while (rd_pos + rd_sz <= evt->sz && rd_sz>=0)
+        for (auto x = 0; x < state.devices.GetSize(); x++)
         {
-          OscMessageRead rmsg((char*)evt->msg + rd_pos, rd_sz);
-          
-          const char *mstr = rmsg.GetMessage();
-          if (mstr && *mstr)
-          {
-            OnOSCMessage(rmsg);
-          }
-          
-          rd_pos += rd_sz+4;
-          if (rd_pos >= evt->sz) break;
-          
-          rd_sz = *(int *)(evt->msg+rd_pos-4);
-          OSC_MAKEINTMEM4BE(&rd_sz);
+          if (state.devices.Get(x)->take_output())
+            outputDevices.push_back(state.devices.Get(x));
         }
       }
+      
+      // sending blocks, and pauses between packets, so it happens without holding up the other threads
+      for (auto pDev : outputDevices)
+      {
+        pDev->run_output(results);
+      }
+      
+      results.Set("");
     }
-    
-    if(mOutputProc)
-      mOutputProc();
   }
   
   // these are non-owned refs
   WDL_PtrList<IODevice> m_devs;
 protected:
-  static std::unique_ptr<Timer> mTimer;
-  static int sInstances;
-  WDL_FastString results;
-  std::function<void()> mInputProc = nullptr;
-  std::function<void()> mOutputProc = nullptr;
-  WDL_HeapBuf m_incoming_events;  // incomingEvent list, each is 8-byte aligned
-  WDL_Mutex m_incoming_events_mutex;
+  std::unique_ptr<Timer> mTimer; // calls OnOSCMessage() on the main thread, unless SetSampleAccurateOSC() was called
+  IPlugQueue<OSCQueuedMessage> mIncoming; // network thread -> OnTimer() or ProcessOSCMessages()
+  OSCQueuedMessage mReceivedMessage; // only used by the network thread
+  OSCQueuedMessage mCurrentMessage;
+  std::vector<OSCQueuedMessage> mScheduled; // messages that are due in a later block, only touched by ProcessOSCMessages()
+  std::vector<int> mScheduledOrder; // slots in mScheduled that are in use, latest time tag first
+  std::vector<int> mFreeSlots; // slots in mScheduled that are free
+  std::atomic<int> mNumDropped {0};
+  int mCurrentOffset = 0;
   static const int DEVICE_INDEX_BASE = 0x400000;
 };
 
-std::unique_ptr<Timer> OSCInterface::mTimer;
-int OSCInterface::sInstances = 0;
-
 class OSCSender : public OSCInterface
 {
 public:
@@ -487,11 +837,6 @@ public:
     WDL_String str;
     CreateSender(str, destIP, port);
     DBGMSG("%s\n", str.Get());
-    mOutputProc = [&]()
-    {
-      for (auto x = 0; x < g_devices.GetSize(); x++)
-        g_devices.Get(x)->run_output(results);  // send queued messages
-    };
   }
   
   void SendOSCMessage(OscMessageWrite& msg)
@@ -510,53 +855,31 @@ public:
     WDL_String str;
     CreateReciever(str, port);
     DBGMSG("%s\n", str.Get());
-    
-    mInputProc = [&]()
-    {
-      const int sizeOfData = results.GetLength();
-      
-      for (auto x = 0; x < g_devices.GetSize(); x++)
-        g_devices.Get(x)->run_input(results);
-      
-      if (results.GetLength() != sizeOfData) // if some input device added results
-      {
-        OscMessageRead msg{mReadBuf, sizeOfData};
-        OnOSCMessage(msg);
-      }
-    };
   }
   
   virtual void OnOSCMessage(OscMessageRead& msg) = 0;
-  
-private:
-  char mReadBuf[MAX_OSC_MSG_LEN] = {};
 };
 
 //static
-void OSCInterface::MessageCallback(void *d1, int dev_idx, char type, int len, void *msg)
+void OSCInterface::MessageCallback(void *d1, int dev_idx, char type, int len, void *msg, uint64_t timetag)
 {
   OSCInterface* _this  = (OSCInterface *) d1;
   
-  if (_this && msg)
+  if (_this && msg && len > 0)
   {
-    if (_this->m_incoming_events.GetSize() < 65536*8)
+    // called on the network thread, which is the only producer for mIncoming
+    OSCQueuedMessage& item = _this->mReceivedMessage;
+    
+    if (len > MAX_OSC_MSG_LEN || _this->mIncoming.WasFull())
     {
-      const int this_sz = ((sizeof(incomingEvent) + (len-3)) + 7) & ~7;
-      
-      _this->m_incoming_events_mutex.Enter();
-      const int oldsz = _this->m_incoming_events.GetSize();
-      _this->m_incoming_events.Resize(oldsz + this_sz,false);
-      
-      if (_this->m_incoming_events.GetSize() == oldsz+this_sz)
-      {
-        incomingEvent *item=(incomingEvent *) ((char *)_this->m_incoming_events.Get() + oldsz);
-        item->dev_ptr = _this->m_devs.Get(dev_idx);
-        item->sz = len;
-        item->type = type;
-        memcpy(item->msg,msg,len);
-      }
-      _this->m_incoming_events_mutex.Leave();
+      _this->mNumDropped++;
+      return;
     }
+    
+    item.timeTag = timetag;
+    item.size = len;
+    memcpy(item.data, msg, len);
+    _this->mIncoming.Push(item);
   }
 }
 
@@ -13,6 +13,7 @@
 #define OVERSAMPLING_FACTORS_VA_LIST "None", "2x", "4x", "8x", "16x"
 
 #include <functional>
+#include <utility>
 #include <cmath>
 
 #include "HIIR/FPUUpsampler2x.h"
@@ -169,17 +170,10 @@ public:
     mDown4BufferPtrs.Empty();
     mDown2BufferPtrs.Empty();
     
+    ClearFilters();
+    
     for (auto c = 0; c < mNChannels; c++)
     {
-      mUpsampler2x.Get(c)->clear_buffers();
-      mUpsampler4x.Get(c)->clear_buffers();
-      mUpsampler8x.Get(c)->clear_buffers();
-      mUpsampler16x.Get(c)->clear_buffers();
-      mDownsampler2x.Get(c)->clear_buffers();
-      mDownsampler4x.Get(c)->clear_buffers();
-      mDownsampler8x.Get(c)->clear_buffers();
-      mDownsampler16x.Get(c)->clear_buffers();
-      
       mUp2BufferPtrs.Add(mUp2x.Get() + c * 2 * blockSize);
       mUp4BufferPtrs.Add(mUp4x.Get() + (c * 4 * blockSize));
       mUp8BufferPtrs.Add(mUp8x.Get() + (c * 8 * blockSize));
@@ -196,10 +190,24 @@ public:
    * @param outputs Two-dimensional array for audio output (non-interleaved).
    * @param nFrames The block size for this block: number of samples per channel.
    * @param nChans The number of channels to process. Must be less or equal to the number of channels passed to the constructor
-   * @param func The function that processes the audio sample at the higher sampling rate. NOTE: std::function can call malloc if you pass in captures */
-  void ProcessBlock(T** inputs, T** outputs, int nFrames, int nChans, BlockProcessFunc func)
+   * @param func The function that processes the audio sample at the higher sampling rate. Any callable with the signature of BlockProcessFunc. It is not wrapped in a std::function, so lambda captures don't allocate */
+  template <typename ProcessFunc>
+  void ProcessBlock(T** inputs, T** outputs, int nFrames, int nChans, ProcessFunc&& func)
+  {
+    ProcessBlock(inputs, outputs, nFrames, nChans, nChans, std::forward<ProcessFunc>(func));
+  }
+  
+  /** Over sample an input block with a per-block function, where the number of input and output channels differ
+   * @param inputs Two-dimensional array containing the non-interleaved input buffers of audio samples for all channels
+   * @param outputs Two-dimensional array for audio output (non-interleaved).
+   * @param nFrames The block size for this block: number of samples per channel.
+   * @param nInChans The number of input channels to up sample. Must be less or equal to the number of channels passed to the constructor
+   * @param nOutChans The number of output channels to down sample. Must be less or equal to the number of channels passed to the constructor
+   * @param func The function that processes the audio sample at the higher sampling rate. Any callable with the signature of BlockProcessFunc */
+  template <typename ProcessFunc>
+  void ProcessBlock(T** inputs, T** outputs, int nFrames, int nInChans, int nOutChans, ProcessFunc&& func)
   {
-    assert(nChans <= mNChannels);
+    assert(nInChans <= mNChannels && nOutChans <= mNChannels);
     
     if(mRate != mPrevRate)
     {
@@ -228,25 +236,25 @@ public:
     }
 
     if (mRate >= 2) {
-      for(auto c = 0; c < nChans; c++) {
+      for(auto c = 0; c < nInChans; c++) {
         mUpsampler2x.Get(c)->process_block(mUp2BufferPtrs.Get(c), inputs[c], nFrames);
       }
     }
     
     if (mRate >= 4) {
-      for(auto c = 0; c < nChans; c++) {
+      for(auto c = 0; c < nInChans; c++) {
         mUpsampler4x.Get(c)->process_block(mUp4BufferPtrs.Get(c), mUp2BufferPtrs.Get(c), nFrames * 2);
       }
     }
     
     if (mRate >= 8) {
-      for(auto c = 0; c < nChans; c++) {
+      for(auto c = 0; c < nInChans; c++) {
         mUpsampler8x.Get(c)->process_block(mUp8BufferPtrs.Get(c), mUp4BufferPtrs.Get(c), nFrames * 4);
       }
     }
     
     if (mRate == 16) {
-      for(auto c = 0; c < nChans; c++) {
+      for(auto c = 0; c < nInChans; c++) {
         mUpsampler16x.Get(c)->process_block(mUp16BufferPtrs.Get(c), mUp8BufferPtrs.Get(c), nFrames * 8);
       }
     }
@@ -256,7 +264,7 @@ public:
     }
     else {
       for (auto i = 0; i < mRate; i++) {
-        for(auto c = 0; c < nChans; c++) {
+        for(auto c = 0; c < mNChannels; c++) {
           mNextInputPtrs.Set(c, mInPtrLoopSrc->Get(c) + (i * nFrames));
           mNextOutputPtrs.Set(c, mOutPtrLoopSrc->Get(c) + (i * nFrames));
         }
@@ -265,25 +273,25 @@ public:
     }
     
     if (mRate == 16) {
-      for(auto c = 0; c < nChans; c++) {
+      for(auto c = 0; c < nOutChans; c++) {
         mDownsampler16x.Get(c)->process_block(mDown8BufferPtrs.Get(c), mDown16BufferPtrs.Get(c), nFrames * 8);
       }
     }
     
     if (mRate >= 8) {
-      for(auto c = 0; c < nChans; c++) {
+      for(auto c = 0; c < nOutChans; c++) {
         mDownsampler8x.Get(c)->process_block(mDown4BufferPtrs.Get(c), mDown8BufferPtrs.Get(c), nFrames * 4);
       }
     }
     
     if (mRate >= 4) {
-      for(auto c = 0; c < nChans; c++) {
+      for(auto c = 0; c < nOutChans; c++) {
         mDownsampler4x.Get(c)->process_block(mDown2BufferPtrs.Get(c), mDown4BufferPtrs.Get(c), nFrames * 2);
       }
     }
     
     if (mRate >= 2) {
-      for(auto c = 0; c < nChans; c++) {
+      for(auto c = 0; c < nOutChans; c++) {
         mDownsampler2x.Get(c)->process_block(outputs[c], mDown2BufferPtrs.Get(c), nFrames);
       }
     }
@@ -442,6 +450,8 @@ public:
     return output;
   }
 
+  /** Change the over sampling factor. The buffers are sized for every factor in Reset(), so this doesn't allocate and is safe to call on the audio thread
+   * @param factor The new over sampling factor */
   void SetOverSampling(EFactor factor)
   {
     if(factor != mFactor)
@@ -449,7 +459,23 @@ public:
       mFactor = factor;
       mRate = std::pow(2, (int) factor);
       
-      Reset();
+      ClearFilters();
+    }
+  }
+  
+  /** Clear the state of the up and down sampling filters for all channels */
+  void ClearFilters()
+  {
+    for (auto c = 0; c < mNChannels; c++)
+    {
+      mUpsampler2x.Get(c)->clear_buffers();
+      mUpsampler4x.Get(c)->clear_buffers();
+      mUpsampler8x.Get(c)->clear_buffers();
+      mUpsampler16x.Get(c)->clear_buffers();
+      mDownsampler2x.Get(c)->clear_buffers();
+      mDownsampler4x.Get(c)->clear_buffers();
+      mDownsampler8x.Get(c)->clear_buffers();
+      mDownsampler16x.Get(c)->clear_buffers();
     }
   }
   
@@ -470,6 +496,11 @@ public:
   {
     return mRate;
   }
+  
+  int GetNChannels() const
+  {
+    return mNChannels;
+  }
 
 private:
   EFactor mFactor = kNone;
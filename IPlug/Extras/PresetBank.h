@@ -0,0 +1,478 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+#pragma once
+
+/**
+ * @file
+ * @copydoc IPresetBank
+ */
+
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <string>
+
+#include "fileread.h"
+#include "filewrite.h"
+#include "mutex.h"
+#include "ptrlist.h"
+#include "wdlstring.h"
+
+#include "IPlugStructs.h"
+
+BEGIN_IPLUG_NAMESPACE
+
+/** The on-disk layout of a preset bank file, shared by IPresetBank and IPresetBankWriter.
+ * A header is followed by an index entry per preset, a hash table of name hashes to preset indices, the names and tags as null terminated strings, and the preset chunks.
+ * All offsets are from the start of the file and values are stored in native byte order */
+struct IPresetBankFormat
+{
+  static constexpr int kMagic = ('I' << 24) | ('P' << 16) | ('p' << 8) | 'b';
+  static constexpr int kVersion = 1;
+  static constexpr int kEmptySlot = -1;
+
+  struct Header
+  {
+    int magic;
+    int version;
+    int numPresets;
+    int hashTableSize; // a power of two, at least twice numPresets
+  };
+
+  struct Entry
+  {
+    int nameOffset;
+    int nameLength;
+    int tagsOffset; // tags are a comma separated list
+    int tagsLength;
+    int dataOffset;
+    int dataSize;
+    uint32_t nameHash;
+    int reserved;
+  };
+
+  static uint32_t Hash(const char* str, int len)
+  {
+    uint32_t hash = 2166136261u;
+
+    for (auto i = 0; i < len; i++)
+      hash = (hash ^ (uint8_t) str[i]) * 16777619u;
+
+    return hash;
+  }
+
+  static int HashTableSizeFor(int numPresets)
+  {
+    int size = 16;
+
+    while (size < numPresets * 2)
+      size *= 2;
+
+    return size;
+  }
+};
+
+/** A read-only bank of presets in a memory-mapped file, with an index for finding presets by name or tag.
+ * Preset chunks are only paged in from disk when they are used, and every instance in the process that opens the same file shares one mapping,
+ * so large factory libraries don't need to be held in each instance's mPresets. Create bank files with IPresetBankWriter.
+ * Opening a bank and the accessors are thread safe, since the mapping is never written to */
+class IPresetBank final
+{
+public:
+  /** Open a preset bank, or get the bank that is already open for path
+   * @param path The path of the bank file
+   * @return The bank, or nullptr if the file doesn't exist or is not a valid bank. The mapping is released when the last reference goes away */
+  static std::shared_ptr<const IPresetBank> Open(const char* path)
+  {
+    WDL_MutexLock lock(&GetRegistryMutex());
+    auto it = GetRegistry().find(path);
+
+    if (it != GetRegistry().end())
+    {
+      std::shared_ptr<const IPresetBank> bank = it->second.lock();
+
+      if (bank)
+        return bank;
+    }
+
+    std::shared_ptr<const IPresetBank> bank(new IPresetBank(path));
+
+    if (!bank->mData)
+      return nullptr;
+
+    GetRegistry()[path] = bank;
+
+    return bank;
+  }
+
+  ~IPresetBank()
+  {
+    WDL_MutexLock lock(&GetRegistryMutex());
+    auto it = GetRegistry().find(mPath.Get());
+
+    // Open() may already have registered a new bank for the same path, once the references to this one were gone
+    if (it != GetRegistry().end() && it->second.expired())
+      GetRegistry().erase(it);
+  }
+
+  IPresetBank(const IPresetBank&) = delete;
+  IPresetBank& operator=(const IPresetBank&) = delete;
+
+  /** @return The number of presets in the bank */
+  int NPresets() const { return mHeader ? mHeader->numPresets : 0; }
+
+  /** @param idx The index of the preset
+   * @return The name of the preset, or an empty string if idx is out of range */
+  const char* GetPresetName(int idx) const
+  {
+    const IPresetBankFormat::Entry* pEntry = GetEntry(idx);
+    return pEntry ? GetString(pEntry->nameOffset) : "";
+  }
+
+  /** @param idx The index of the preset
+   * @return The comma separated tags of the preset, or an empty string if idx is out of range */
+  const char* GetPresetTags(int idx) const
+  {
+    const IPresetBankFormat::Entry* pEntry = GetEntry(idx);
+    return pEntry ? GetString(pEntry->tagsOffset) : "";
+  }
+
+  /** Find a preset by name, without searching the whole bank
+   * @param name The name of the preset
+   * @return The index of the preset, or -1 if there is no preset with that name */
+  int FindPreset(const char* name) const
+  {
+    if (!mHeader || !name)
+      return -1;
+
+    const int len = (int) strlen(name);
+    const uint32_t hash = IPresetBankFormat::Hash(name, len);
+    const int mask = mHeader->hashTableSize - 1;
+
+    for (int slot = hash & mask, probes = 0; probes < mHeader->hashTableSize; slot = (slot + 1) & mask, probes++)
+    {
+      const int idx = mHashTable[slot];
+
+      if (idx == IPresetBankFormat::kEmptySlot)
+        break;
+
+      const IPresetBankFormat::Entry& entry = mEntries[idx];
+
+      if (entry.nameHash == hash && entry.nameLength == len && !memcmp(GetString(entry.nameOffset), name, len))
+        return idx;
+    }
+
+    return -1;
+  }
+
+  /** Find the presets that have a tag
+   * @param tag The tag to look for
+   * @param indices Receives the indices of the presets, in bank order
+   * @return The number of presets found */
+  int FindPresetsWithTag(const char* tag, WDL_TypedBuf<int>& indices) const
+  {
+    indices.Resize(0);
+
+    const int tagLen = tag ? (int) strlen(tag) : 0;
+
+    if (!tagLen)
+      return 0;
+
+    for (auto i = 0; i < NPresets(); i++)
+    {
+      const char* pTags = GetString(mEntries[i].tagsOffset);
+
+      for (const char* pFound = strstr(pTags, tag); pFound; pFound = strstr(pFound + 1, tag))
+      {
+        const bool startsTag = pFound == pTags || pFound[-1] == ',';
+        const bool endsTag = pFound[tagLen] == '\0' || pFound[tagLen] == ',';
+
+        if (startsTag && endsTag)
+        {
+          indices.Add(i);
+          break;
+        }
+      }
+    }
+
+    return indices.GetSize();
+  }
+
+  /** Get the state chunk of a preset, without copying it
+   * @param idx The index of the preset
+   * @param size Receives the size of the chunk in bytes
+   * @return Pointer to the chunk in the mapping, or nullptr if idx is out of range. Valid for as long as the bank is referenced */
+  const uint8_t* GetPresetData(int idx, int& size) const
+  {
+    const IPresetBankFormat::Entry* pEntry = GetEntry(idx);
+    size = pEntry ? pEntry->dataSize : 0;
+    return pEntry ? mData + pEntry->dataOffset : nullptr;
+  }
+
+  /** Copy the state chunk of a preset into an IByteChunk
+   * @param idx The index of the preset
+   * @param chunk The chunk to copy to, it is cleared first
+   * @return \c true on success */
+  bool GetPresetChunk(int idx, IByteChunk& chunk) const
+  {
+    int size = 0;
+    const uint8_t* pData = GetPresetData(idx, size);
+
+    chunk.Clear();
+
+    if (!pData)
+      return false;
+
+    chunk.PutBytes(pData, size);
+    return chunk.Size() == size;
+  }
+
+  /** Restore a preset from the bank into a plug-in, in the same way as IPluginBase::RestorePreset()
+   * @param plugin The plug-in, an IPluginBase or derived class
+   * @param idx The index of the preset
+   * @return \c true on success */
+  template <class T>
+  bool RestorePreset(T& plugin, int idx) const
+  {
+    IByteChunk chunk;
+
+    if (!GetPresetChunk(idx, chunk) || plugin.UnserializeState(chunk, 0) <= 0)
+      return false;
+
+    plugin.OnRestoreState();
+    return true;
+  }
+
+private:
+  IPresetBank(const char* path)
+  : mPath(path)
+  , mFile(path, 0, 8192, 1, 0, 0x7fffffff)
+  {
+    if (!mFile.IsOpen())
+      return;
+
+    int size = (int) mFile.GetSize();
+    const uint8_t* pData = (const uint8_t*) mFile.GetMappedView(0, &size);
+
+    if (pData && Validate(pData, size))
+    {
+      mData = pData;
+      mHeader = reinterpret_cast<const IPresetBankFormat::Header*>(pData);
+      mEntries = reinterpret_cast<const IPresetBankFormat::Entry*>(pData + sizeof(IPresetBankFormat::Header));
+      mHashTable = reinterpret_cast<const int*>(mEntries + mHeader->numPresets);
+    }
+  }
+
+  /** Check everything the accessors rely on once, so that a corrupt file can't make them read outside the mapping */
+  static bool Validate(const uint8_t* pData, int size)
+  {
+    using Format = IPresetBankFormat;
+
+    if (size < (int) sizeof(Format::Header))
+      return false;
+
+    const Format::Header* pHeader = reinterpret_cast<const Format::Header*>(pData);
+    const int64_t n = pHeader->numPresets;
+    const int64_t hashTableSize = pHeader->hashTableSize;
+
+    if (pHeader->magic != Format::kMagic || pHeader->version != Format::kVersion || n < 0
+        || hashTableSize < n * 2 || hashTableSize <= 0 || (hashTableSize & (hashTableSize - 1))
+        || (int64_t) sizeof(Format::Header) + n * (int64_t) sizeof(Format::Entry) + hashTableSize * (int64_t) sizeof(int) > size)
+      return false;
+
+    const Format::Entry* pEntries = reinterpret_cast<const Format::Entry*>(pData + sizeof(Format::Header));
+    const int* pHashTable = reinterpret_cast<const int*>(pEntries + n);
+
+    auto validString = [pData, size](int offset, int length) {
+      return offset >= 0 && length >= 0 && (int64_t) offset + length < size && pData[offset + length] == '\0';
+    };
+
+    for (auto i = 0; i < n; i++)
+    {
+      const Format::Entry& entry = pEntries[i];
+
+      if (!validString(entry.nameOffset, entry.nameLength) || !validString(entry.tagsOffset, entry.tagsLength)
+          || entry.dataOffset < 0 || entry.dataSize < 0 || (int64_t) entry.dataOffset + entry.dataSize > size)
+        return false;
+    }
+
+    for (auto i = 0; i < hashTableSize; i++)
+    {
+      if (pHashTable[i] < Format::kEmptySlot || pHashTable[i] >= n)
+        return false;
+    }
+
+    return true;
+  }
+
+  const IPresetBankFormat::Entry* GetEntry(int idx) const
+  {
+    return (idx >= 0 && idx < NPresets()) ? &mEntries[idx] : nullptr;
+  }
+
+  const char* GetString(int offset) const { return reinterpret_cast<const char*>(mData + offset); }
+
+  static WDL_Mutex& GetRegistryMutex()
+  {
+    static WDL_Mutex sMutex;
+    return sMutex;
+  }
+
+  static std::map<std::string, std::weak_ptr<const IPresetBank>>& GetRegistry()
+  {
+    static std::map<std::string, std::weak_ptr<const IPresetBank>> sRegistry;
+    return sRegistry;
+  }
+
+  WDL_String mPath;
+  WDL_FileRead mFile;
+  const uint8_t* mData = nullptr;
+  const IPresetBankFormat::Header* mHeader = nullptr;
+  const IPresetBankFormat::Entry* mEntries = nullptr;
+  const int* mHashTable = nullptr;
+};
+
+/** Builds a preset bank file for IPresetBank, e.g. from a plug-in's factory presets at development time */
+class IPresetBankWriter final
+{
+public:
+  IPresetBankWriter() {}
+  ~IPresetBankWriter() { mPresets.Empty(true); }
+
+  IPresetBankWriter(const IPresetBankWriter&) = delete;
+  IPresetBankWriter& operator=(const IPresetBankWriter&) = delete;
+
+  /** Add a preset to the bank
+   * @param name The name of the preset, must be unique within the bank
+   * @param tags A comma separated list of tags, or nullptr
+   * @param chunk The state of the preset, as produced by SerializeState()
+   * @return \c false if a preset with the same name was already added */
+  bool AddPreset(const char* name, const char* tags, const IByteChunk& chunk)
+  {
+    for (auto i = 0; i < mPresets.GetSize(); i++)
+    {
+      if (!strcmp(mPresets.Get(i)->mName.Get(), name))
+        return false;
+    }
+
+    Preset* pPreset = new Preset;
+    pPreset->mName.Set(name);
+    pPreset->mTags.Set(tags ? tags : "");
+    pPreset->mChunk.PutChunk(&chunk);
+    mPresets.Add(pPreset);
+    return true;
+  }
+
+  /** @return The number of presets added */
+  int NPresets() const { return mPresets.GetSize(); }
+
+  /** Write the bank to a file
+   * @param path The path of the file to write, it is overwritten
+   * @return \c true on success */
+  bool Write(const char* path) const
+  {
+    using Format = IPresetBankFormat;
+
+    const int n = mPresets.GetSize();
+    const int hashTableSize = Format::HashTableSizeFor(n);
+
+    WDL_TypedBuf<Format::Entry> entries;
+    WDL_TypedBuf<int> hashTable;
+    entries.Resize(n);
+    hashTable.Resize(hashTableSize);
+
+    for (auto i = 0; i < hashTableSize; i++)
+      hashTable.Get()[i] = Format::kEmptySlot;
+
+    int64_t offset = sizeof(Format::Header) + (int64_t) n * sizeof(Format::Entry) + (int64_t) hashTableSize * sizeof(int);
+
+    // strings first, then the chunks aligned to 8 bytes
+    for (auto i = 0; i < n; i++)
+    {
+      const Preset* pPreset = mPresets.Get(i);
+      Format::Entry& entry = entries.Get()[i];
+      memset(&entry, 0, sizeof(Format::Entry));
+      entry.nameOffset = (int) offset;
+      entry.nameLength = pPreset->mName.GetLength();
+      offset += entry.nameLength + 1;
+      entry.tagsOffset = (int) offset;
+      entry.tagsLength = pPreset->mTags.GetLength();
+      offset += entry.tagsLength + 1;
+      entry.nameHash = Format::Hash(pPreset->mName.Get(), entry.nameLength);
+
+      const int mask = hashTableSize - 1;
+      int slot = entry.nameHash & mask;
+
+      while (hashTable.Get()[slot] != Format::kEmptySlot)
+        slot = (slot + 1) & mask;
+
+      hashTable.Get()[slot] = i;
+    }
+
+    const int64_t stringsEnd = offset;
+    offset = (offset + 7) & ~((int64_t) 7);
+
+    for (auto i = 0; i < n; i++)
+    {
+      Format::Entry& entry = entries.Get()[i];
+      entry.dataOffset = (int) offset;
+      entry.dataSize = mPresets.Get(i)->mChunk.Size();
+      offset = (offset + entry.dataSize + 7) & ~((int64_t) 7);
+    }
+
+    if (offset > 0x7fffffff)
+      return false;
+
+    WDL_FileWrite file(path, 0);
+
+    if (!file.IsOpen())
+      return false;
+
+    const Format::Header header { Format::kMagic, Format::kVersion, n, hashTableSize };
+    const char zeros[8] = {};
+    bool writtenOK = file.Write(&header, sizeof(header)) == (int) sizeof(header);
+    writtenOK &= file.Write(entries.Get(), n * (int) sizeof(Format::Entry)) == n * (int) sizeof(Format::Entry);
+    writtenOK &= file.Write(hashTable.Get(), hashTableSize * (int) sizeof(int)) == hashTableSize * (int) sizeof(int);
+
+    for (auto i = 0; i < n; i++)
+    {
+      const Preset* pPreset = mPresets.Get(i);
+      writtenOK &= file.Write(pPreset->mName.Get(), pPreset->mName.GetLength() + 1) == pPreset->mName.GetLength() + 1;
+      writtenOK &= file.Write(pPreset->mTags.Get(), pPreset->mTags.GetLength() + 1) == pPreset->mTags.GetLength() + 1;
+    }
+
+    int64_t written = stringsEnd;
+
+    for (auto i = 0; i < n; i++)
+    {
+      const Format::Entry& entry = entries.Get()[i];
+      const int padding = (int) (entry.dataOffset - written);
+      writtenOK &= file.Write(zeros, padding) == padding;
+      writtenOK &= file.Write(mPresets.Get(i)->mChunk.GetData(), entry.dataSize) == entry.dataSize;
+      written = entry.dataOffset + entry.dataSize;
+    }
+
+    return writtenOK;
+  }
+
+private:
+  struct Preset
+  {
+    WDL_String mName;
+    WDL_String mTags;
+    IByteChunk mChunk;
+  };
+
+  WDL_PtrList<Preset> mPresets;
+};
+
+END_IPLUG_NAMESPACE
@@ -0,0 +1,673 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+#pragma once
+
+/**
+ * @file
+ * @brief Classes for running the DSP of a plug-in in a separate helper process, so that a crash or a hang in the DSP does not take down the host.
+ *
+ * The plug-in owns an IPlugSandboxHost and forwards its ProcessBlock(), OnReset(), OnParamChange() and ProcessMidiMsg() to it.
+ * The helper is a small executable whose main() creates the DSP, an ISandboxDSP, and calls RunSandboxServer().
+ *
+ * The two processes share one memory segment, which holds the audio buffers and single-producer single-consumer rings for parameter changes and MIDI.
+ * Each block is one request from the host and one reply from the helper, signalled on Linux with futexes on two counters in the segment.
+ * The waiting side spins briefly before it sleeps, which keeps the round trip short when the helper is idle and waiting for the next block.
+ *
+ * WDL_SHM_Connection is not used for the audio path: on POSIX it is a socket that is polled with Run(), and its message queues allocate.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <thread>
+#include <vector>
+
+#include "IPlugPlatform.h"
+
+#if defined OS_WIN
+  #error NOT IMPLEMENTED
+#endif
+
+#include <fcntl.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#if defined OS_LINUX
+  #include <linux/futex.h>
+  #include <sys/syscall.h>
+#endif
+
+#include "wdlstring.h"
+
+#include "IPlugConstants.h"
+#include "IPlugMidi.h"
+
+extern char** environ;
+
+BEGIN_IPLUG_NAMESPACE
+
+static_assert(ATOMIC_INT_LOCK_FREE == 2, "the sandbox needs lock-free atomics in shared memory");
+
+/** The argument before the name of the shared memory on the command line of the helper */
+static constexpr const char* kSandboxArg = "--iplug-sandbox";
+
+/** A single-producer single-consumer ring of trivially copyable items, which lives in the shared memory of the sandbox. The host also uses it to hold the MIDI messages of a block
+ * @tparam N The capacity, a power of 2 */
+template <typename T, int N>
+struct SandboxRing
+{
+  static_assert((N & (N - 1)) == 0, "the capacity must be a power of 2");
+
+  /** @return \c false if the ring is full */
+  bool Push(const T& item)
+  {
+    const uint32_t writePos = mWritePos.load(std::memory_order_relaxed);
+
+    if (writePos - mReadPos.load(std::memory_order_acquire) == N)
+      return false;
+
+    mItems[writePos % N] = item;
+    mWritePos.store(writePos + 1, std::memory_order_release);
+    return true;
+  }
+
+  /** Get the next item without removing it, on the consumer's side
+   * @return \c false if the ring is empty */
+  bool Peek(T& item) const
+  {
+    const uint32_t readPos = mReadPos.load(std::memory_order_relaxed);
+
+    if (readPos == mWritePos.load(std::memory_order_acquire))
+      return false;
+
+    item = mItems[readPos % N];
+    return true;
+  }
+
+  /** @return \c false if the ring is empty */
+  bool Pop(T& item)
+  {
+    const uint32_t readPos = mReadPos.load(std::memory_order_relaxed);
+
+    if (readPos == mWritePos.load(std::memory_order_acquire))
+      return false;
+
+    item = mItems[readPos % N];
+    mReadPos.store(readPos + 1, std::memory_order_release);
+    return true;
+  }
+
+  std::atomic<uint32_t> mWritePos {0};
+  std::atomic<uint32_t> mReadPos {0};
+  T mItems[N];
+};
+
+/** A parameter change, sent from the host to the helper before the next block */
+struct SandboxParamChange
+{
+  int paramIdx;
+  double value;
+};
+
+/** The start of the shared memory segment. The audio buffers follow it, one buffer of maxFrames samples per input and then per output */
+struct SandboxShared
+{
+  static constexpr uint32_t kMagic = 0x49505342;
+  static constexpr uint32_t kVersion = 1;
+  static constexpr int kRingSize = 1024;
+
+  enum ECommand
+  {
+    kProcess,
+    kReset
+  };
+
+  SandboxShared(int nIns, int nOuts, int maxBlockFrames)
+  : nInputs(nIns)
+  , nOutputs(nOuts)
+  , maxFrames(maxBlockFrames)
+  {
+  }
+
+  /** @return The size of a segment with this many channels and frames */
+  static size_t GetSize(int nIns, int nOuts, int maxBlockFrames)
+  {
+    return sizeof(SandboxShared) + static_cast<size_t>(nIns + nOuts) * maxBlockFrames * sizeof(sample);
+  }
+
+  sample* GetInput(int chan) { return reinterpret_cast<sample*>(this + 1) + chan * maxFrames; }
+  sample* GetOutput(int chan) { return GetInput(nInputs + chan); }
+
+  const uint32_t magic = kMagic;
+  const uint32_t version = kVersion;
+  const uint32_t sampleSize = sizeof(sample); // catches a helper built with a different sample type
+  const int nInputs;
+  const int nOutputs;
+  const int maxFrames;
+  std::atomic<uint32_t> request {0}; // incremented by the host for each request
+  std::atomic<uint32_t> reply {0}; // set to the request by the helper when it has handled it
+  std::atomic<uint32_t> quit {0};
+  int command = kProcess;
+  int nFrames = 0;
+  int blockSize = 0;
+  double sampleRate = 44100.;
+  SandboxRing<SandboxParamChange, kRingSize> paramChanges;
+  SandboxRing<IMidiMsg, kRingSize> midiIn;
+  SandboxRing<IMidiMsg, kRingSize> midiOut;
+};
+
+/** Wake the process waiting for a counter in the shared memory to change */
+static inline void SandboxWake(std::atomic<uint32_t>& counter)
+{
+#if defined OS_LINUX
+  syscall(SYS_futex, reinterpret_cast<uint32_t*>(&counter), FUTEX_WAKE, 1, nullptr, nullptr, 0);
+#endif
+}
+
+/** Wait for a counter in the shared memory to change from a value. Spins first, and then sleeps on a futex, or polls where there are no futexes
+ * @param timeoutMs The time to wait, or a negative value to wait indefinitely
+ * @return \c false if the counter didn't change in time */
+static inline bool SandboxWait(std::atomic<uint32_t>& counter, uint32_t value, int spinCount, double timeoutMs)
+{
+  for (auto i = 0; i < spinCount; i++)
+  {
+    if (counter.load(std::memory_order_acquire) != value)
+      return true;
+  }
+
+  using Clock = std::chrono::steady_clock;
+  const Clock::time_point deadline = Clock::now() + std::chrono::microseconds(static_cast<int64_t>(timeoutMs * 1000.));
+
+  while (counter.load(std::memory_order_acquire) == value)
+  {
+    const int64_t remainingNs = timeoutMs < 0. ? 1000000000 : std::chrono::duration_cast<std::chrono::nanoseconds>(deadline - Clock::now()).count();
+
+    if (remainingNs <= 0)
+      return false;
+
+#if defined OS_LINUX
+    // returns early when woken, interrupted, or if the counter already changed
+    timespec timeout {static_cast<time_t>(remainingNs / 1000000000), static_cast<long>(remainingNs % 1000000000)};
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&counter), FUTEX_WAIT, value, &timeout, nullptr, 0);
+#else
+    std::this_thread::sleep_for(std::chrono::microseconds(std::min<int64_t>(50, remainingNs / 1000 + 1)));
+#endif
+  }
+
+  return true;
+}
+
+/** The plug-in side of the sandbox. It launches the helper process and sends it each block.
+ * ProcessBlock(), SetParameter(), SendMidiMsg() and PopMidiMsg() are called from the audio thread, since the queues have a single producer and consumer.
+ * Launch(), Stop(), IsRunning() and Reset() are called from a non-realtime thread. The audio thread holds on to the shared memory for the whole of each call, and Stop() waits for it to let go before it unmaps the memory.
+ * If the helper doesn't reply within the timeout, or has exited, the block is output as silence. After a missed block, blocks are not sent again until the helper has
+ * caught up, so the two processes never touch the audio buffers at the same time.
+ * A block that is longer than maxFrames is sent in parts, and the offsets of the MIDI messages in both directions are relative to the part that they belong to */
+class IPlugSandboxHost
+{
+public:
+  /** @param nInputs The number of input channels
+   * @param nOutputs The number of output channels
+   * @param maxFrames The largest block sent to the helper. Longer blocks are sent in several requests */
+  IPlugSandboxHost(int nInputs, int nOutputs, int maxFrames = 4096)
+  : mNInputs(nInputs)
+  , mNOutputs(nOutputs)
+  , mMaxFrames(maxFrames)
+  {
+  }
+
+  ~IPlugSandboxHost()
+  {
+    Stop();
+  }
+
+  IPlugSandboxHost(const IPlugSandboxHost&) = delete;
+  IPlugSandboxHost& operator=(const IPlugSandboxHost&) = delete;
+
+  /** Create the shared memory and start the helper process, stopping any previous one
+   * @param helperPath The path of the helper executable
+   * @return \c true on success */
+  bool Launch(const char* helperPath)
+  {
+    Stop();
+
+    static std::atomic<int> sCounter {0};
+    mShmName.SetFormatted(64, "/iplug-sandbox-%d-%d", static_cast<int>(getpid()), sCounter++);
+    mSize = SandboxShared::GetSize(mNInputs, mNOutputs, mMaxFrames);
+
+    const int fd = shm_open(mShmName.Get(), O_CREAT | O_EXCL | O_RDWR, 0600);
+
+    if (fd < 0)
+      return false;
+
+    void* pMem = ftruncate(fd, static_cast<off_t>(mSize)) == 0 ? mmap(nullptr, mSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+    close(fd);
+
+    if (pMem == MAP_FAILED)
+    {
+      shm_unlink(mShmName.Get());
+      return false;
+    }
+
+    SandboxShared* pShared = new (pMem) SandboxShared(mNInputs, mNOutputs, mMaxFrames);
+    mRequest = 0;
+    mPending = false;
+
+    const char* argv[] = {helperPath, kSandboxArg, mShmName.Get(), nullptr};
+
+    if (posix_spawn(&mPid, helperPath, nullptr, nullptr, const_cast<char**>(argv), environ) != 0)
+    {
+      mPid = 0;
+      ReleaseSharedMemory(pShared);
+      return false;
+    }
+
+    // the helper may need to be reset before the first block, which the audio thread can send as soon as the memory is published
+    if (mSampleRate > 0.)
+      SendReset(*pShared);
+
+    mRunning = true;
+    mShared.store(pShared);
+    return true;
+  }
+
+  /** Ask the helper to quit, and kill it if it doesn't quit within timeoutMs. Waits for the audio thread to finish with the shared memory first */
+  void Stop(int timeoutMs = 500)
+  {
+    mRunning = false;
+
+    // see ScopedSharedMemory
+    SandboxShared* pShared = mShared.exchange(nullptr);
+
+    while (mNumUsers.load())
+      std::this_thread::yield();
+
+    if (mPid > 0)
+    {
+      if (pShared)
+      {
+        pShared->quit.store(1, std::memory_order_release);
+        pShared->request.fetch_add(1, std::memory_order_release);
+        SandboxWake(pShared->request);
+      }
+
+      int status;
+      bool exited = false;
+
+      for (auto i = 0; i < timeoutMs && !exited; i++)
+      {
+        exited = waitpid(mPid, &status, WNOHANG) == mPid;
+
+        if (!exited)
+          std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+
+      if (!exited)
+      {
+        kill(mPid, SIGKILL);
+        waitpid(mPid, &status, 0);
+      }
+
+      mPid = 0;
+    }
+
+    ReleaseSharedMemory(pShared);
+  }
+
+  /** Check whether the helper is still running, and reap it if it has exited or crashed. Call this from a non-realtime thread, e.g. OnIdle()
+   * @return \c true if the helper is running */
+  bool IsRunning()
+  {
+    if (mPid > 0 && mRunning)
+    {
+      int status;
+
+      if (waitpid(mPid, &status, WNOHANG) == mPid)
+      {
+        mRunning = false;
+        mPid = 0;
+      }
+    }
+
+    return mRunning;
+  }
+
+  /** Set the time to wait for the helper to process a block, after which the block is output as silence. Set it below the duration of a block, so that the host doesn't miss its deadline */
+  void SetTimeout(double timeoutMs) { mTimeoutMs = timeoutMs; }
+
+  /** Set how many times to poll for the reply before sleeping. Spinning shortens the round trip, at the cost of CPU time on the audio thread */
+  void SetSpinCount(int spinCount) { mSpinCount = spinCount; }
+
+  /** @return The number of blocks that were output as silence because the helper didn't process them in time or wasn't running */
+  int64_t GetNumMissedBlocks() const { return mNumMissedBlocks.load(std::memory_order_relaxed); }
+
+  /** Send a reset to the helper, which calls ISandboxDSP::OnReset(). This waits up to a second for the helper, so call it from OnReset() rather than while processing */
+  void Reset(double sampleRate, int blockSize)
+  {
+    mSampleRate = sampleRate;
+    mBlockSize = blockSize;
+
+    ScopedSharedMemory shared(*this);
+
+    if (shared.Get() && mRunning)
+      SendReset(*shared.Get());
+  }
+
+  /** Queue a parameter change, which the helper receives before the next block
+   * @return \c false if the queue is full or there is no helper */
+  bool SetParameter(int paramIdx, double value)
+  {
+    ScopedSharedMemory shared(*this);
+
+    return shared.Get() && shared.Get()->paramChanges.Push({paramIdx, value});
+  }
+
+  /** Queue a MIDI message for the next block, which the helper receives before the part of the block that contains its offset
+   * @return \c false if the queue is full or there is no helper */
+  bool SendMidiMsg(const IMidiMsg& msg)
+  {
+    return mShared.load(std::memory_order_relaxed) && mMidiIn.Push(msg);
+  }
+
+  /** Get the next MIDI message that the helper sent, e.g. after ProcessBlock(), to pass it on with IPlugProcessor::SendMidiMsg(). Its offset is in the whole block
+   * @return \c false if there are no more messages */
+  bool PopMidiMsg(IMidiMsg& msg)
+  {
+    return mMidiOut.Pop(msg);
+  }
+
+  /** Process a block in the helper
+   * @return \c true if the helper processed the block, \c false if the outputs were silenced */
+  bool ProcessBlock(sample** inputs, sample** outputs, int nFrames)
+  {
+    ScopedSharedMemory shared(*this);
+    SandboxShared* pShared = shared.Get();
+    IMidiMsg msg;
+    int pos = 0;
+    bool processed = false;
+
+    if (pShared && mRunning && CatchUp(*pShared))
+    {
+      processed = true;
+
+      for (; pos < nFrames; pos += mMaxFrames)
+      {
+        const int n = std::min(nFrames - pos, mMaxFrames);
+
+        for (auto c = 0; c < mNInputs; c++)
+          memcpy(pShared->GetInput(c), inputs[c] + pos, n * sizeof(sample));
+
+        // the messages in this part of the block, and in the last part any that are beyond its end
+        while (mMidiIn.Peek(msg) && (msg.mOffset < pos + n || pos + n == nFrames))
+        {
+          msg.mOffset = std::max(msg.mOffset - pos, 0);
+
+          if (!pShared->midiIn.Push(msg))
+            break;
+
+          mMidiIn.Pop(msg);
+        }
+
+        pShared->command = SandboxShared::kProcess;
+        pShared->nFrames = n;
+
+        if (!Transact(*pShared, mTimeoutMs))
+        {
+          processed = false;
+          break;
+        }
+
+        for (auto c = 0; c < mNOutputs; c++)
+          memcpy(outputs[c] + pos, pShared->GetOutput(c), n * sizeof(sample));
+
+        while (pShared->midiOut.Pop(msg))
+        {
+          msg.mOffset += pos;
+          mMidiOut.Push(msg);
+        }
+      }
+    }
+
+    // the messages of the parts that weren't processed are dropped
+    while (mMidiIn.Pop(msg)) {}
+
+    if (processed)
+      return true;
+
+    for (auto c = 0; c < mNOutputs; c++)
+      memset(outputs[c] + pos, 0, (nFrames - pos) * sizeof(sample));
+
+    mNumMissedBlocks.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+
+private:
+  /** Keeps the shared memory mapped while it is in use. Stop() unpublishes the memory and then waits until it has no users, so a user either gets nullptr or is waited for */
+  class ScopedSharedMemory
+  {
+  public:
+    ScopedSharedMemory(IPlugSandboxHost& host)
+    : mHost(host)
+    {
+      mHost.mNumUsers.fetch_add(1);
+      mShared = mHost.mShared.load();
+    }
+
+    ~ScopedSharedMemory()
+    {
+      mHost.mNumUsers.fetch_sub(1, std::memory_order_release);
+    }
+
+    ScopedSharedMemory(const ScopedSharedMemory&) = delete;
+    ScopedSharedMemory& operator=(const ScopedSharedMemory&) = delete;
+
+    SandboxShared* Get() const { return mShared; }
+
+  private:
+    IPlugSandboxHost& mHost;
+    SandboxShared* mShared;
+  };
+
+  /** @return \c true if the helper has replied to the last request */
+  bool CatchUp(SandboxShared& shared)
+  {
+    if (mPending && shared.reply.load(std::memory_order_acquire) == mRequest)
+      mPending = false;
+
+    return !mPending;
+  }
+
+  /** Send the request that has been written to the shared memory and wait for the reply
+   * @return \c false if the helper didn't reply in time */
+  bool Transact(SandboxShared& shared, double timeoutMs)
+  {
+    const uint32_t lastReply = mRequest++;
+    shared.request.store(mRequest, std::memory_order_release);
+    SandboxWake(shared.request);
+
+    if (!SandboxWait(shared.reply, lastReply, mSpinCount, timeoutMs))
+    {
+      mPending = true;
+      return false;
+    }
+
+    return true;
+  }
+
+  void SendReset(SandboxShared& shared)
+  {
+    if (!CatchUp(shared))
+      return;
+
+    shared.command = SandboxShared::kReset;
+    shared.sampleRate = mSampleRate;
+    shared.blockSize = mBlockSize;
+    Transact(shared, 1000.);
+  }
+
+  void ReleaseSharedMemory(SandboxShared* pShared)
+  {
+    if (pShared)
+    {
+      munmap(pShared, mSize);
+      shm_unlink(mShmName.Get());
+    }
+  }
+
+  const int mNInputs;
+  const int mNOutputs;
+  const int mMaxFrames;
+  WDL_String mShmName;
+  size_t mSize = 0;
+  std::atomic<SandboxShared*> mShared {nullptr};
+  std::atomic<int> mNumUsers {0};
+  pid_t mPid = 0;
+  std::atomic<bool> mRunning {false};
+  std::atomic<int64_t> mNumMissedBlocks {0};
+  uint32_t mRequest = 0;
+  bool mPending = false; // a request timed out, and the helper may still be working on it
+  double mTimeoutMs = 10.;
+  int mSpinCount = 2000;
+  double mSampleRate = 0.;
+  int mBlockSize = 0;
+  SandboxRing<IMidiMsg, SandboxShared::kRingSize> mMidiIn; // held until the part of the block that they belong to is sent
+  SandboxRing<IMidiMsg, SandboxShared::kRingSize> mMidiOut;
+};
+
+/** The DSP that runs in the helper process. Its methods are called on the helper's main thread, in the order in which the host sent them */
+class ISandboxDSP
+{
+public:
+  virtual ~ISandboxDSP() {}
+
+  /** Called when the host calls IPlugSandboxHost::Reset() */
+  virtual void OnReset(double sampleRate, int blockSize) {}
+
+  /** Called for each parameter change, before the block that follows it */
+  virtual void OnParamChange(int paramIdx, double value) {}
+
+  /** Called for each MIDI message, before the block that it belongs to */
+  virtual void ProcessMidiMsg(const IMidiMsg& msg) {}
+
+  virtual void ProcessBlock(sample** inputs, sample** outputs, int nFrames) = 0;
+
+  /** Send a MIDI message to the host, from ProcessBlock()
+   * @return \c false if the queue is full */
+  bool SendMidiMsg(const IMidiMsg& msg)
+  {
+    return mShared && mShared->midiOut.Push(msg);
+  }
+
+private:
+  SandboxShared* mShared = nullptr;
+
+  friend int RunSandboxServer(int argc, const char** argv, ISandboxDSP& dsp, int spinCount);
+};
+
+/** Serve the blocks of the host, calling the DSP for each of them. Call this from main() of the helper process.
+ * This returns when the host stops the helper or exits
+ * @param spinCount How many times to poll for the next request before sleeping
+ * @return The exit code of the helper */
+inline int RunSandboxServer(int argc, const char** argv, ISandboxDSP& dsp, int spinCount = 2000)
+{
+  const char* shmName = nullptr;
+
+  for (auto i = 1; i < argc - 1; i++)
+  {
+    if (!strcmp(argv[i], kSandboxArg))
+      shmName = argv[i + 1];
+  }
+
+  const int fd = shmName ? shm_open(shmName, O_RDWR, 0) : -1;
+
+  if (fd < 0)
+    return 1;
+
+  struct stat info;
+  void* pMem = fstat(fd, &info) == 0 && info.st_size >= static_cast<off_t>(sizeof(SandboxShared)) ? mmap(nullptr, info.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+  close(fd);
+
+  if (pMem == MAP_FAILED)
+    return 1;
+
+  SandboxShared* pShared = static_cast<SandboxShared*>(pMem);
+
+  if (pShared->magic != SandboxShared::kMagic || pShared->version != SandboxShared::kVersion || pShared->sampleSize != sizeof(sample)
+      || info.st_size < static_cast<off_t>(SandboxShared::GetSize(pShared->nInputs, pShared->nOutputs, pShared->maxFrames)))
+  {
+    munmap(pMem, info.st_size);
+    return 1;
+  }
+
+  std::vector<sample*> inputs(pShared->nInputs + 1);
+  std::vector<sample*> outputs(pShared->nOutputs + 1);
+
+  for (auto c = 0; c < pShared->nInputs; c++)
+    inputs[c] = pShared->GetInput(c);
+
+  for (auto c = 0; c < pShared->nOutputs; c++)
+    outputs[c] = pShared->GetOutput(c);
+
+  dsp.mShared = pShared;
+
+  const pid_t parent = getppid();
+  uint32_t handled = pShared->reply.load(std::memory_order_acquire);
+
+  while (!pShared->quit.load(std::memory_order_acquire))
+  {
+    // wake up now and then to check that the host is still there
+    if (!SandboxWait(pShared->request, handled, spinCount, 1000.))
+    {
+      if (getppid() != parent)
+        break;
+
+      continue;
+    }
+
+    const uint32_t request = pShared->request.load(std::memory_order_acquire);
+
+    if (pShared->quit.load(std::memory_order_acquire))
+      break;
+
+    SandboxParamChange change;
+    IMidiMsg msg;
+
+    while (pShared->paramChanges.Pop(change))
+      dsp.OnParamChange(change.paramIdx, change.value);
+
+    while (pShared->midiIn.Pop(msg))
+      dsp.ProcessMidiMsg(msg);
+
+    if (pShared->command == SandboxShared::kReset)
+      dsp.OnReset(pShared->sampleRate, pShared->blockSize);
+    else
+      dsp.ProcessBlock(inputs.data(), outputs.data(), std::min(pShared->nFrames, pShared->maxFrames));
+
+    handled = request;
+    pShared->reply.store(request, std::memory_order_release);
+    SandboxWake(pShared->reply);
+  }
+
+  dsp.mShared = nullptr;
+  munmap(pMem, info.st_size);
+  return 0;
+}
+
+END_IPLUG_NAMESPACE
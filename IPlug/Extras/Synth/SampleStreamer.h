@@ -0,0 +1,616 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+ */
+
+#pragma once
+
+/**
+ * @file
+ * @copydoc SampleStreamer
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+  #include <unistd.h> // for the POSIX reads in fileread.h
+#endif
+
+#include "fileread.h"
+#include "heapbuf.h"
+#include "mutex.h"
+#include "pcmfmtcvt.h"
+#include "ptrlist.h"
+#include "wdlcstring.h"
+#include "wdlstring.h"
+
+#include "IPlugPlatform.h"
+
+BEGIN_IPLUG_NAMESPACE
+
+/** A sample in a RIFF WAVE file, of which only the first frames (the head) are kept in memory. The rest is read from disk by a SampleStreamer while the sample plays.
+ * Supports 16, 24 and 32 bit integer and 32 bit float files */
+class StreamingSample
+{
+public:
+  /** The format of the frames of a sample in its file. A SampleStreamer keeps a copy of it while it streams the sample */
+  struct Format
+  {
+    int nChans = 0;
+    int bitsPerSample = 0;
+    int frameBytes = 0;
+    bool isFloat = false;
+    double sampleRate = 0.;
+    int64_t nFrames = 0;
+    int64_t dataOffset = 0;
+    /** Unique to each successful Load() of any sample, so that a reloaded sample is never mistaken for the file that was loaded before */
+    int loadId = 0;
+
+    /** Convert interleaved frames read from the file to a float buffer per channel
+     * @param pSrc The frames in the format of the file
+     * @param nFrames The number of frames
+     * @param pDest A buffer for each channel, which is written from its start
+     * @param nDestChans The number of channels to convert, starting from the first */
+    void ConvertFrames(const void* pSrc, int nFrames, float* const* pDest, int nDestChans) const
+    {
+      const int bytesPerSample = bitsPerSample / 8;
+
+      for (auto c = 0; c < nDestChans; c++)
+      {
+        const char* pChanSrc = static_cast<const char*>(pSrc) + c * bytesPerSample;
+
+        if (isFloat)
+        {
+          for (auto s = 0; s < nFrames; s++)
+            memcpy(pDest[c] + s, pChanSrc + s * frameBytes, sizeof(float));
+        }
+        else
+          pcmToFloats(const_cast<char*>(pChanSrc), nFrames, bitsPerSample, nChans, pDest[c], 1);
+      }
+    }
+  };
+
+  /** Read the format of a WAVE file and load its head. This reads from disk, so don't call it on the audio thread
+   * @param path The path of the file
+   * @param headFrames The number of frames to keep in memory. They are played while the rest of the sample starts streaming, so they should cover the worst case disk latency at the highest playback rate
+   * @return \c true on success */
+  bool Load(const char* path, int headFrames)
+  {
+    WDL_FileRead file(path, 0);
+    unsigned char header[12];
+    Format format;
+
+    mFormat = Format();
+
+    if (!file.IsOpen() || file.Read(header, 12) != 12 || memcmp(header, "RIFF", 4) || memcmp(header + 8, "WAVE", 4))
+      return false;
+
+    int formatTag = 0;
+    int64_t dataSize = 0;
+
+    while (true)
+    {
+      unsigned char chunk[8];
+
+      if (file.Read(chunk, 8) != 8)
+        return false;
+
+      const int64_t chunkSize = ReadLE32(chunk + 4);
+      const int64_t chunkStart = file.GetPosition();
+
+      if (!memcmp(chunk, "fmt ", 4))
+      {
+        unsigned char fmt[26] = {};
+
+        if (chunkSize < 16 || file.Read(fmt, (int) std::min<int64_t>(chunkSize, sizeof(fmt))) < 16)
+          return false;
+
+        formatTag = ReadLE16(fmt);
+        format.nChans = ReadLE16(fmt + 2);
+        format.sampleRate = ReadLE32(fmt + 4);
+        format.bitsPerSample = ReadLE16(fmt + 14);
+
+        if (formatTag == 0xFFFE && chunkSize >= 26) // WAVE_FORMAT_EXTENSIBLE, the format is at the start of the sub-format GUID
+          formatTag = ReadLE16(fmt + 24);
+      }
+      else if (!memcmp(chunk, "data", 4))
+      {
+        format.dataOffset = chunkStart;
+        dataSize = std::min<int64_t>(chunkSize, file.GetSize() - chunkStart);
+        break;
+      }
+
+      if (file.SetPosition(chunkStart + chunkSize + (chunkSize & 1)))
+        return false;
+    }
+
+    format.isFloat = formatTag == 3;
+
+    if (format.nChans <= 0 || format.sampleRate <= 0. || (formatTag != 1 && formatTag != 3) || (format.isFloat && format.bitsPerSample != 32) || (!format.isFloat && format.bitsPerSample != 16 && format.bitsPerSample != 24 && format.bitsPerSample != 32))
+      return false;
+
+    format.frameBytes = format.nChans * format.bitsPerSample / 8;
+    mHeadFrames = (int) std::min<int64_t>(std::max(headFrames, 0), dataSize / format.frameBytes);
+    mHead.Resize(format.nChans * mHeadFrames);
+
+    WDL_HeapBuf buf;
+    buf.Resize(mHeadFrames * format.frameBytes);
+
+    if (file.SetPosition(format.dataOffset) || file.Read(buf.Get(), buf.GetSize()) != buf.GetSize())
+      return false;
+
+    std::vector<float*> dest(format.nChans);
+
+    for (auto c = 0; c < format.nChans; c++)
+      dest[c] = mHead.Get() + c * mHeadFrames;
+
+    format.ConvertFrames(buf.Get(), mHeadFrames, dest.data(), format.nChans);
+    format.nFrames = dataSize / format.frameBytes;
+    format.loadId = NewLoadId();
+
+    mPath.Set(path);
+    mFormat = format;
+    return true;
+  }
+
+  /** @return \c true if a file was loaded */
+  bool IsLoaded() const { return mFormat.nFrames > 0; }
+
+  int NChans() const { return mFormat.nChans; }
+  int64_t NFrames() const { return mFormat.nFrames; }
+  int GetHeadFrames() const { return mHeadFrames; }
+  double GetSampleRate() const { return mFormat.sampleRate; }
+  const char* GetPath() const { return mPath.Get(); }
+  const Format& GetFormat() const { return mFormat; }
+
+  /** @param chan The channel
+   * @return The frames of the head of a channel */
+  const float* GetHead(int chan) const { return mHead.Get() + chan * mHeadFrames; }
+
+private:
+  static int ReadLE16(const unsigned char* p) { return p[0] | (p[1] << 8); }
+  static int64_t ReadLE32(const unsigned char* p) { return (int64_t) p[0] | ((int64_t) p[1] << 8) | ((int64_t) p[2] << 16) | ((int64_t) p[3] << 24); }
+
+  static int NewLoadId()
+  {
+    static std::atomic<int> sLastLoadId {0};
+    return ++sLastLoadId;
+  }
+
+  WDL_String mPath;
+  WDL_TypedBuf<float> mHead;
+  int mHeadFrames = 0;
+  Format mFormat;
+};
+
+class SampleStreamer;
+
+/** The ring buffer through which a SampleStreamer passes frames of a StreamingSample to one voice.
+ * The audio thread calls Start(), Stop() and Read(). A thread of the streamer fills the ring buffer.
+ * Each Start() begins a new generation, and the audio thread ignores the ring buffer until the streamer has reset it for that generation, so a voice can be retriggered at any time without locking or waiting */
+class SampleStream
+{
+public:
+  static constexpr int kMaxChans = 32;
+  static constexpr int kMaxPathLen = 4096;
+
+  /** Audio thread: start streaming a sample. The streamer only gets a copy of its format and path, so the sample is never used by another thread
+   * @param pSample The sample. Its path is truncated to kMaxPathLen
+   * @param startFrame The first frame to stream, usually the frame after the head of the sample */
+  void Start(const StreamingSample* pSample, int64_t startFrame)
+  {
+    PostRequest(pSample, startFrame);
+    WakeStreamer();
+  }
+
+  /** Audio thread: stop streaming, so that the streamer no longer reads for this stream */
+  void Stop()
+  {
+    PostRequest(nullptr, 0);
+  }
+
+  /** Audio thread: take the next frames of the sample from the ring buffer
+   * @param pDest A buffer for each channel of the sample up to the maximum number of channels of the stream, which is written from its start
+   * @param nFrames The number of frames wanted
+   * @return The number of frames read, which is less than nFrames if the streamer hasn't caught up */
+  int Read(float* const* pDest, int nFrames)
+  {
+    const int generation = mGeneration.load(std::memory_order_relaxed);
+
+    if (mRingGeneration.load(std::memory_order_acquire) != generation)
+      return 0;
+
+    const int64_t readPos = mReadPos.load(std::memory_order_relaxed);
+    const int n = (int) std::min<int64_t>(nFrames, mWritePos.load(std::memory_order_acquire) - readPos);
+    const int idx = (int) (readPos & (mCapacity - 1));
+    const int n1 = std::min(n, mCapacity - idx);
+
+    for (auto c = 0; c < mNChans; c++)
+    {
+      const float* pRing = mRing.Get() + c * mCapacity;
+      memcpy(pDest[c], pRing + idx, n1 * sizeof(float));
+      memcpy(pDest[c] + n1, pRing, (n - n1) * sizeof(float));
+    }
+
+    mReadPos.store(readPos + n, std::memory_order_release);
+
+    // wake the streamer each time a chunk of the ring buffer has been freed
+    if ((readPos + n) / mChunkFrames != readPos / mChunkFrames)
+      WakeStreamer();
+
+    return n;
+  }
+
+  /** Audio thread: count a block in which Read() didn't return all the frames needed */
+  void AddUnderrun() { mNumUnderruns.store(mNumUnderruns.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed); }
+
+  /** @return The number of blocks in which the streamer didn't keep up with this stream */
+  int64_t GetNumUnderruns() const { return mNumUnderruns.load(std::memory_order_relaxed); }
+
+  /** @return The size of the ring buffer in frames */
+  int GetCapacity() const { return mCapacity; }
+
+private:
+  friend class SampleStreamer;
+
+  SampleStream(SampleStreamer& streamer, int maxChans, int ringFrames, int chunkFrames)
+  : mStreamer(streamer)
+  , mMaxChans(std::min(std::max(maxChans, 1), static_cast<int>(kMaxChans)))
+  , mChunkFrames(chunkFrames)
+  {
+    while (mCapacity < ringFrames)
+      mCapacity *= 2;
+
+    mRing.Resize(mMaxChans * mCapacity);
+    memset(mRing.Get(), 0, mRing.GetSize() * sizeof(float));
+  }
+
+  /** What the audio thread asks of the streamer, see PostRequest() */
+  struct Request
+  {
+    int generation = 0;
+    bool active = false;
+    int64_t startFrame = 0;
+    StreamingSample::Format format;
+    char path[kMaxPathLen] = {};
+  };
+
+  static constexpr int kNewRequest = 4; // flags mMiddleRequest when it holds a request the streamer hasn't taken
+  static constexpr int kRequestIdxMask = 3;
+
+  /** Audio thread: begin a new generation. The request is written to a slot that the streamer doesn't use, and swapped with the middle slot of a triple buffer, from which the streamer takes the latest request, so neither side ever waits for the other
+   * @param pSample The sample to stream, or nullptr to stop */
+  void PostRequest(const StreamingSample* pSample, int64_t startFrame)
+  {
+    const int generation = mGeneration.load(std::memory_order_relaxed) + 1;
+    Request& request = mRequests[mBackRequest];
+    request.generation = generation;
+    request.active = pSample != nullptr;
+    request.startFrame = startFrame;
+
+    if (pSample)
+    {
+      request.format = pSample->GetFormat();
+      lstrcpyn_safe(request.path, pSample->GetPath(), kMaxPathLen);
+    }
+
+    mBackRequest = mMiddleRequest.exchange(mBackRequest | kNewRequest, std::memory_order_acq_rel) & kRequestIdxMask;
+    mActive.store(request.active, std::memory_order_relaxed);
+    mGeneration.store(generation, std::memory_order_release);
+  }
+
+  /** Streamer: take the latest request, if the audio thread has posted one since the last call
+   * @return The request, which stays valid until the next call */
+  const Request& TakeRequest()
+  {
+    if (mMiddleRequest.load(std::memory_order_relaxed) & kNewRequest)
+      mFrontRequest = mMiddleRequest.exchange(mFrontRequest, std::memory_order_acq_rel) & kRequestIdxMask;
+
+    return mRequests[mFrontRequest];
+  }
+
+  inline void WakeStreamer();
+
+  SampleStreamer& mStreamer;
+
+  // state shared with the audio thread
+  Request mRequests[3];
+  int mBackRequest = 0; // audio thread only
+  std::atomic<int> mMiddleRequest {1};
+  int mFrontRequest = 2; // only used by the thread that has claimed the stream
+  std::atomic<bool> mActive {false};
+  std::atomic<int> mGeneration {0};
+  std::atomic<int> mRingGeneration {0};
+  std::atomic<int64_t> mReadPos {0};
+  std::atomic<int64_t> mWritePos {0};
+  std::atomic<int64_t> mNumUnderruns {0};
+  WDL_TypedBuf<float> mRing;
+  int mCapacity = 1;
+  const int mMaxChans;
+  const int mChunkFrames;
+  int mNChans = 0; // written by the streamer before it publishes a generation
+
+  // state of the streamer, only used by the thread that has claimed the stream
+  std::atomic<bool> mClaimed {false};
+  std::atomic<int64_t> mFramesLeft {0};
+  StreamingSample::Format mFormat;
+  std::unique_ptr<WDL_FileRead> mFile;
+  WDL_String mOpenPath;
+  int mOpenLoadId = 0;
+  int64_t mFilePos = 0;
+  WDL_HeapBuf mReadBuf;
+};
+
+/** Streams samples from disk for any number of voices, with a pool of background I/O threads.
+ * The threads sleep until the audio thread starts a stream or frees a chunk of its ring buffer, and serve the most urgent stream first: a stream that was just started, then the stream with the fewest frames buffered.
+ * Reads are synchronous on the I/O threads (pread() or mmap on Linux and macOS, ReadFile() on Windows), so the audio thread never waits for the disk, on any platform */
+class SampleStreamer
+{
+public:
+  /** Totals of all streams */
+  struct Stats
+  {
+    int64_t numReads = 0;
+    int64_t bytesRead = 0;
+    int64_t numUnderruns = 0;
+  };
+
+  /** @param numThreads The number of I/O threads
+   * @param chunkFrames The number of frames read at once. Streams are only served once this many frames are free in their ring buffer, or the end of the sample is closer
+   * @param maxWaitMs The longest an idle I/O thread sleeps. The audio thread wakes the I/O threads without locking, so a wakeup that races with a thread going to sleep can be missed, and this bounds the delay */
+  SampleStreamer(int numThreads = 2, int chunkFrames = 4096, int maxWaitMs = 20)
+  : mChunkFrames(chunkFrames)
+  , mMaxWait(maxWaitMs)
+  {
+    for (auto i = 0; i < numThreads; i++)
+      mThreads.emplace_back([this]() { ThreadLoop(); });
+  }
+
+  SampleStreamer(const SampleStreamer&) = delete;
+  SampleStreamer& operator=(const SampleStreamer&) = delete;
+
+  /** Stops the I/O threads and deletes the streams, so destroy the voices that use them first */
+  ~SampleStreamer()
+  {
+    {
+      std::lock_guard<std::mutex> lock(mWakeMutex);
+      mQuit = true;
+    }
+
+    mWakeCondition.notify_all();
+
+    for (auto& thread : mThreads)
+      thread.join();
+
+    mStreams.Empty(true);
+  }
+
+  /** Create a stream for a voice. Allocates, so don't call it on the audio thread
+   * @param maxChans The number of channels to stream, up to 32. Channels of a sample beyond this are ignored
+   * @param ringFrames The size of the ring buffer, rounded up to a power of two. It should be several times chunkFrames
+   * @return The stream, which is owned by the streamer until it is removed */
+  SampleStream* AddStream(int maxChans, int ringFrames)
+  {
+    SampleStream* pStream = new SampleStream(*this, maxChans, std::max(ringFrames, mChunkFrames), mChunkFrames);
+    WDL_MutexLock lock(&mStreamsMutex);
+    return mStreams.Add(pStream);
+  }
+
+  /** Delete a stream, after waiting for an I/O thread that is serving it. Don't call it on the audio thread, or while the audio thread uses the stream
+   * @param pStream A stream created by AddStream() */
+  void RemoveStream(SampleStream* pStream)
+  {
+    {
+      // the I/O threads only claim streams that are in the list
+      WDL_MutexLock lock(&mStreamsMutex);
+      mStreams.DeletePtr(pStream);
+    }
+
+    while (pStream->mClaimed.load(std::memory_order_acquire))
+      std::this_thread::yield();
+
+    mRemovedUnderruns.fetch_add(pStream->GetNumUnderruns(), std::memory_order_relaxed);
+    delete pStream;
+  }
+
+  /** @return Totals of all streams, including removed ones. Can be called from any thread */
+  Stats GetStats() const
+  {
+    Stats stats;
+    stats.numReads = mNumReads.load(std::memory_order_relaxed);
+    stats.bytesRead = mBytesRead.load(std::memory_order_relaxed);
+    stats.numUnderruns = mRemovedUnderruns.load(std::memory_order_relaxed);
+
+    WDL_MutexLock lock(&mStreamsMutex);
+
+    for (auto i = 0; i < mStreams.GetSize(); i++)
+      stats.numUnderruns += mStreams.Get(i)->GetNumUnderruns();
+
+    return stats;
+  }
+
+private:
+  friend class SampleStream;
+
+  /** Audio thread: wake an I/O thread. This doesn't lock, notify_one() only makes a system call if a thread is waiting */
+  void Wake()
+  {
+    mWakeCount.fetch_add(1, std::memory_order_release);
+    mWakeCondition.notify_one();
+  }
+
+  void ThreadLoop()
+  {
+    while (true)
+    {
+      // taken before looking for work, so that a wakeup during the search isn't missed
+      const int wakeCount = mWakeCount.load(std::memory_order_acquire);
+      SampleStream* pStream = ClaimMostUrgentStream();
+
+      if (pStream)
+      {
+        Serve(*pStream);
+        pStream->mClaimed.store(false, std::memory_order_release);
+        continue;
+      }
+
+      std::unique_lock<std::mutex> lock(mWakeMutex);
+
+      mWakeCondition.wait_for(lock, mMaxWait, [this, wakeCount]() { return mQuit || mWakeCount.load(std::memory_order_acquire) != wakeCount; });
+
+      if (mQuit)
+        return;
+    }
+  }
+
+  SampleStream* ClaimMostUrgentStream()
+  {
+    WDL_MutexLock lock(&mStreamsMutex);
+
+    while (true)
+    {
+      SampleStream* pBest = nullptr;
+      int64_t bestBuffered = 0;
+
+      for (auto i = 0; i < mStreams.GetSize(); i++)
+      {
+        SampleStream* pStream = mStreams.Get(i);
+
+        if (!pStream->mActive.load(std::memory_order_relaxed) || pStream->mClaimed.load(std::memory_order_relaxed))
+          continue;
+
+        int64_t buffered = 0;
+
+        // a stream that was just started has nothing buffered
+        if (pStream->mRingGeneration.load(std::memory_order_relaxed) == pStream->mGeneration.load(std::memory_order_acquire))
+        {
+          buffered = pStream->mWritePos.load(std::memory_order_relaxed) - pStream->mReadPos.load(std::memory_order_acquire);
+          const int64_t framesLeft = pStream->mFramesLeft.load(std::memory_order_relaxed);
+
+          if (!framesLeft || pStream->mCapacity - buffered < std::min<int64_t>(mChunkFrames, framesLeft))
+            continue;
+        }
+
+        if (!pBest || buffered < bestBuffered)
+        {
+          pBest = pStream;
+          bestBuffered = buffered;
+        }
+      }
+
+      if (!pBest)
+        return nullptr;
+
+      bool expected = false;
+
+      if (pBest->mClaimed.compare_exchange_strong(expected, true, std::memory_order_acquire))
+        return pBest;
+    }
+  }
+
+  void Serve(SampleStream& stream)
+  {
+    // a request that has been superseded by the time the audio thread sees its generation is simply discarded
+    const SampleStream::Request& request = stream.TakeRequest();
+
+    if (!request.active)
+      return;
+
+    const StreamingSample::Format& format = stream.mFormat;
+
+    if (stream.mRingGeneration.load(std::memory_order_relaxed) != request.generation)
+    {
+      stream.mFormat = request.format;
+
+      // reopen the file if a different sample, or the same sample reloaded, is started
+      if (format.loadId != stream.mOpenLoadId || strcmp(request.path, stream.mOpenPath.Get()))
+      {
+        stream.mOpenPath.Set(request.path);
+        stream.mFile = std::make_unique<WDL_FileRead>(request.path, 0);
+        stream.mOpenLoadId = format.loadId;
+      }
+
+      // the audio thread doesn't touch the ring buffer until it sees the new generation
+      stream.mFilePos = request.startFrame;
+      stream.mNChans = std::min(format.nChans, stream.mMaxChans);
+      stream.mReadPos.store(0, std::memory_order_relaxed);
+      stream.mWritePos.store(0, std::memory_order_relaxed);
+      stream.mFramesLeft.store(std::max<int64_t>(format.nFrames - stream.mFilePos, 0), std::memory_order_relaxed);
+      stream.mRingGeneration.store(request.generation, std::memory_order_release);
+    }
+
+    const int64_t writePos = stream.mWritePos.load(std::memory_order_relaxed);
+    const int64_t space = stream.mCapacity - (writePos - stream.mReadPos.load(std::memory_order_acquire));
+    const int nFrames = (int) std::min<int64_t>({ space, mChunkFrames, stream.mFramesLeft.load(std::memory_order_relaxed) });
+
+    if (nFrames <= 0 || !stream.mFile || !stream.mFile->IsOpen())
+      return;
+
+    stream.mReadBuf.Resize(nFrames * format.frameBytes, false);
+
+    if (stream.mFile->SetPosition(format.dataOffset + stream.mFilePos * format.frameBytes))
+      return;
+
+    const int framesRead = stream.mFile->Read(stream.mReadBuf.Get(), nFrames * format.frameBytes) / format.frameBytes;
+
+    if (framesRead <= 0)
+      return;
+
+    // convert straight into the ring buffer, in two parts if the frames wrap around
+    const int idx = (int) (writePos & (stream.mCapacity - 1));
+    const int n1 = std::min(framesRead, stream.mCapacity - idx);
+    float* pDest[2][SampleStream::kMaxChans];
+
+    for (auto c = 0; c < stream.mNChans; c++)
+    {
+      pDest[0][c] = stream.mRing.Get() + c * stream.mCapacity + idx;
+      pDest[1][c] = stream.mRing.Get() + c * stream.mCapacity;
+    }
+
+    format.ConvertFrames(stream.mReadBuf.Get(), n1, pDest[0], stream.mNChans);
+    format.ConvertFrames(static_cast<const char*>(stream.mReadBuf.Get()) + n1 * format.frameBytes, framesRead - n1, pDest[1], stream.mNChans);
+
+    stream.mFilePos += framesRead;
+    stream.mFramesLeft.store(stream.mFramesLeft.load(std::memory_order_relaxed) - framesRead, std::memory_order_relaxed);
+    stream.mWritePos.store(writePos + framesRead, std::memory_order_release);
+
+    mNumReads.fetch_add(1, std::memory_order_relaxed);
+    mBytesRead.fetch_add(framesRead * format.frameBytes, std::memory_order_relaxed);
+  }
+
+  int mChunkFrames;
+  std::chrono::milliseconds mMaxWait;
+  std::vector<std::thread> mThreads;
+  std::mutex mWakeMutex;
+  std::condition_variable mWakeCondition;
+  std::atomic<int> mWakeCount {0};
+  bool mQuit = false;
+
+  mutable WDL_Mutex mStreamsMutex;
+  WDL_PtrList<SampleStream> mStreams;
+
+  std::atomic<int64_t> mNumReads {0};
+  std::atomic<int64_t> mBytesRead {0};
+  std::atomic<int64_t> mRemovedUnderruns {0};
+};
+
+void SampleStream::WakeStreamer()
+{
+  mStreamer.Wake();
+}
+
+END_IPLUG_NAMESPACE
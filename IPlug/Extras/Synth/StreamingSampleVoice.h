@@ -0,0 +1,274 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+ */
+
+#pragma once
+
+/**
+ * @file
+ * @copydoc StreamingSampleVoice
+ */
+
+#include <cmath>
+
+#include "heapbuf.h"
+
+#include "ADSREnvelope.h"
+#include "SampleStreamer.h"
+#include "SynthVoice.h"
+
+BEGIN_IPLUG_NAMESPACE
+
+/** A SynthVoice that plays a StreamingSample. The head of the sample is played from memory while a SampleStreamer starts streaming the rest into this voice's SampleStream.
+ * The sample is resampled with linear interpolation, following the pitch and pitch bend inputs relative to the root key of the sample.
+ * If the streamer falls behind, the voice outputs silence and holds its position until the frames arrive, and counts an underrun */
+class StreamingSampleVoice : public SynthVoice
+{
+public:
+  /** @param streamer The streamer, which must outlive the voice
+   * @param maxChans The number of channels of the samples to play, up to 32. Output channels beyond this repeat the sample's channels
+   * @param ringFrames The size of the ring buffer of the voice's stream */
+  StreamingSampleVoice(SampleStreamer& streamer, int maxChans = 2, int ringFrames = 32768)
+  : mStreamer(streamer)
+  , mStream(streamer.AddStream(maxChans, ringFrames))
+  , mMaxChans(std::min(std::max(maxChans, 1), static_cast<int>(SampleStream::kMaxChans)))
+  {
+    mWindow.Resize(mMaxChans * kWindowFrames);
+    mEnvBuffer.Resize(kSubBlockFrames);
+  }
+
+  ~StreamingSampleVoice()
+  {
+    mStreamer.RemoveStream(mStream);
+  }
+
+  /** Set the sample to play from the next time the voice is triggered. Call this on the audio thread, e.g. from an override of Trigger() that picks a sample for mKey
+   * @param pSample The sample, which must stay loaded while the voice plays it
+   * @param rootKey The MIDI note at which the sample plays at its original pitch */
+  void SetSample(const StreamingSample* pSample, int rootKey = 60)
+  {
+    mNextSample = pSample;
+    mNextRootKey = rootKey;
+  }
+
+  /** @return The amplitude envelope, e.g. to set its stage times */
+  ADSREnvelope<sample>& GetEnvelope() { return mEnv; }
+
+  /** @return The number of blocks in which this voice was starved of frames */
+  int64_t GetNumUnderruns() const { return mStream->GetNumUnderruns(); }
+
+  bool GetBusy() const override { return mPlaying; }
+
+  void Trigger(double level, bool isRetrigger) override
+  {
+    if (isRetrigger && mPlaying)
+    {
+      // the envelope fades out quickly, and the sample restarts when it starts the attack again
+      mRestartPending = true;
+      mEnv.Retrigger(level);
+    }
+    else
+    {
+      StartSample();
+      mEnv.Start(level);
+    }
+  }
+
+  void Release() override
+  {
+    mEnv.Release();
+  }
+
+  void ProcessSamplesAccumulating(sample** inputs, sample** outputs, int nInputs, int nOutputs, int startIdx, int nFrames) override
+  {
+    const double pitch = mInputs[kVoiceControlPitch].endValue + mInputs[kVoiceControlPitchBend].endValue;
+
+    for (auto pos = 0; pos < nFrames && mPlaying;)
+    {
+      const int n = std::min(nFrames - pos, mEnvBuffer.GetSize());
+      sample* pEnv = mEnvBuffer.Get();
+      ADSREnvelope<sample>::StageChange changes[4];
+      const int nChanges = mEnv.ProcessBlock(pEnv, n, 1., changes, 4);
+      int restartOffset = n;
+
+      for (auto i = 0; i < nChanges && mRestartPending; i++)
+      {
+        if (changes[i].stage == ADSREnvelope<sample>::kAttack)
+          restartOffset = changes[i].offset;
+      }
+
+      Render(outputs, nOutputs, startIdx + pos, restartOffset, pEnv, pitch);
+
+      if (restartOffset < n)
+      {
+        mRestartPending = false;
+        StartSample();
+        Render(outputs, nOutputs, startIdx + pos + restartOffset, n - restartOffset, pEnv + restartOffset, pitch);
+      }
+
+      if (!mEnv.GetBusy())
+        StopSample();
+
+      pos += n;
+    }
+  }
+
+  void SetSampleRateAndBlockSize(double sampleRate, int blockSize) override
+  {
+    mSampleRate = sampleRate;
+    mEnv.SetSampleRate(sampleRate);
+    mEnvBuffer.Resize(std::max(blockSize, 1));
+  }
+
+private:
+  static constexpr int kSubBlockFrames = 64;
+  static constexpr double kMaxRate = 16.; // four octaves above the sample's original pitch and rate
+  static constexpr int kWindowFrames = kSubBlockFrames * 16 + 2;
+
+  void StartSample()
+  {
+    mSample = mNextSample;
+    mRootKey = mNextRootKey;
+    mPlaying = mSample && mSample->IsLoaded();
+    mNChans = mPlaying ? std::min(mSample->NChans(), mMaxChans) : 0;
+    mSourcePos = 0;
+    mWindowFrames = 0;
+    mPlayedFrames = 0;
+    mFrac = 0.;
+
+    if (mPlaying && mSample->NFrames() > mSample->GetHeadFrames())
+      mStream->Start(mSample, mSample->GetHeadFrames());
+    else
+      mStream->Stop();
+  }
+
+  void StopSample()
+  {
+    mPlaying = false;
+    mRestartPending = false;
+    mStream->Stop();
+  }
+
+  /** Fill the window up to nFrames, from the head and then from the stream. Past the end of the sample the window is padded with silence
+   * @return \c false if the stream didn't have enough frames */
+  bool FillWindow(int nFrames)
+  {
+    float* pDest[SampleStream::kMaxChans];
+
+    while (mWindowFrames < nFrames && mSourcePos < mSample->NFrames())
+    {
+      const int wanted = nFrames - mWindowFrames;
+      int n;
+
+      for (auto c = 0; c < mNChans; c++)
+        pDest[c] = mWindow.Get() + c * kWindowFrames + mWindowFrames;
+
+      if (mSourcePos < mSample->GetHeadFrames())
+      {
+        n = (int) std::min<int64_t>(wanted, mSample->GetHeadFrames() - mSourcePos);
+
+        for (auto c = 0; c < mNChans; c++)
+          memcpy(pDest[c], mSample->GetHead(c) + mSourcePos, n * sizeof(float));
+      }
+      else if (!(n = mStream->Read(pDest, wanted)))
+        return false;
+
+      mWindowFrames += n;
+      mSourcePos += n;
+    }
+
+    if (mWindowFrames < nFrames)
+    {
+      for (auto c = 0; c < mNChans; c++)
+        memset(mWindow.Get() + c * kWindowFrames + mWindowFrames, 0, (nFrames - mWindowFrames) * sizeof(float));
+
+      mWindowFrames = nFrames;
+    }
+
+    return true;
+  }
+
+  void Render(sample** outputs, int nOutputs, int startIdx, int nFrames, const sample* pEnv, double pitch)
+  {
+    const double rate = std::min(std::pow(2., pitch - (mRootKey - 69) / 12.) * mSample->GetSampleRate() / mSampleRate, static_cast<double>(kMaxRate));
+    bool underrun = false;
+
+    for (auto pos = 0; pos < nFrames && mPlaying;)
+    {
+      const int n = std::min(nFrames - pos, static_cast<int>(kSubBlockFrames));
+      const int needed = static_cast<int>(mFrac + (n - 1) * rate) + 2;
+      int nOut = n;
+
+      if (!FillWindow(needed))
+      {
+        // only render the frames that the window covers, and hold the position for the rest
+        underrun = true;
+        nOut = 0;
+
+        while (nOut < n && static_cast<int>(mFrac + nOut * rate) + 1 < mWindowFrames)
+          nOut++;
+      }
+
+      for (auto c = 0; c < nOutputs; c++)
+      {
+        const float* pSrc = mWindow.Get() + (c % mNChans) * kWindowFrames;
+        sample* pOut = outputs[c] + startIdx + pos;
+
+        for (auto i = 0; i < nOut; i++)
+        {
+          const double x = mFrac + i * rate;
+          const int idx = static_cast<int>(x);
+          const float t = static_cast<float>(x - idx);
+          pOut[i] += (pSrc[idx] + t * (pSrc[idx + 1] - pSrc[idx])) * pEnv[pos + i] * mGain;
+        }
+      }
+
+      const double end = mFrac + nOut * rate;
+      const int consumed = std::min(static_cast<int>(end), mWindowFrames);
+      mFrac = end - static_cast<int>(end);
+      mPlayedFrames += consumed;
+      mWindowFrames -= consumed;
+
+      for (auto c = 0; c < mNChans; c++)
+      {
+        float* pChan = mWindow.Get() + c * kWindowFrames;
+        memmove(pChan, pChan + consumed, mWindowFrames * sizeof(float));
+      }
+
+      if (mPlayedFrames >= mSample->NFrames())
+        StopSample();
+
+      pos += n;
+    }
+
+    if (underrun)
+      mStream->AddUnderrun();
+  }
+
+  SampleStreamer& mStreamer;
+  SampleStream* mStream;
+  const int mMaxChans;
+  ADSREnvelope<sample> mEnv {"sample"};
+  WDL_TypedBuf<sample> mEnvBuffer;
+  WDL_TypedBuf<float> mWindow; // the frames from the integer part of the playback position onwards, per channel
+  const StreamingSample* mNextSample = nullptr;
+  const StreamingSample* mSample = nullptr;
+  int mNextRootKey = 60;
+  int mRootKey = 60;
+  int mNChans = 0;
+  int mWindowFrames = 0;
+  int64_t mSourcePos = 0; // the frame of the sample after the last one in the window
+  int64_t mPlayedFrames = 0;
+  double mFrac = 0.;
+  double mSampleRate = 44100.;
+  bool mPlaying = false;
+  bool mRestartPending = false;
+};
+
+END_IPLUG_NAMESPACE
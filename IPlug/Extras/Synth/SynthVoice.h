@@ -69,6 +69,12 @@ public:
   /** As with Trigger, called to do optional tasks when a voice is released. */
   virtual void Release() {};
 
+  /** Called for every busy voice before any of them process the block. Voices that are rendered together by a shared renderer, e.g. a WavetableVoiceBank,
+   * set up their part of the block here, so that the renderer can render all of them when the first voice is processed
+   @param startIdx The start index of the block of samples to process
+   @param nFrames The number of samples the process in this block */
+  virtual void PrepareBlock(int startIdx, int nFrames) {};
+
   /** Process a block of audio data for the voice
    @param inputs Pointer to input channel arrays. Sometimes synthesisers have audio inputs. Alternatively you can pass in modulation from global LFOs etc here.
    @param outputs Pointer to output channel arrays. You should add to the existing data in these arrays (so that all the voices get summed)
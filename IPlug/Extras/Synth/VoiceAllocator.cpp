@@ -529,6 +529,14 @@ void VoiceAllocator::NoteOff(VoiceInputEvent e, int64_t sampleTime)
 
 void VoiceAllocator::ProcessVoices(sample** inputs, sample** outputs, int nInputs, int nOutputs, int startIndex, int blockSize)
 {
+  for(auto pVoice : mVoicePtrs)
+  {
+    if(pVoice->GetBusy())
+    {
+      pVoice->PrepareBlock(startIndex, blockSize);
+    }
+  }
+
   for(auto pVoice : mVoicePtrs)
   {
     // TODO distribute voices across cores
@@ -0,0 +1,302 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+ */
+
+#pragma once
+
+/**
+ * @file
+ * @copydoc WavetableVoice
+ */
+
+#include <cmath>
+#include <vector>
+
+#include "heapbuf.h"
+
+#include "ADSREnvelope.h"
+#include "SynthVoice.h"
+#include "WavetableOscillator.h"
+
+BEGIN_IPLUG_NAMESPACE
+
+/** Renders the wavetable oscillators of all the voices of a synth together, kNumLanes oscillators at a time. Each voice claims a run of lanes when it is created, e.g. for a unison stack.
+ * In SynthVoice::PrepareBlock() each busy voice sets the frequencies of its lanes, and optionally their FM input. The first voice that asks for its output then renders every group of lanes
+ * that has an active lane, and the other voices read what was rendered. */
+class WavetableVoiceBank
+{
+public:
+  using Bank = WavetableOscillatorBank<8>;
+  static constexpr int kNumLanes = Bank::kNumLanes;
+
+  /** @param pWavetable The wavetable of all lanes, which must outlive the bank */
+  WavetableVoiceBank(const Wavetable* pWavetable)
+  : mWavetable(pWavetable)
+  {
+  }
+
+  /** Claim lanes, e.g. from the constructor of a voice. A run of lanes doesn't straddle two groups, so that a voice is rendered in one pass
+   * @param nLanes The number of lanes, up to kNumLanes
+   * @return The first of the lanes */
+  int AddLanes(int nLanes)
+  {
+    nLanes = Clip(nLanes, 1, static_cast<int>(kNumLanes));
+
+    if (mNumLanes % kNumLanes + nLanes > kNumLanes)
+      mNumLanes += kNumLanes - mNumLanes % kNumLanes;
+
+    const int firstLane = mNumLanes;
+    mNumLanes += nLanes;
+
+    while (static_cast<int>(mGroups.size()) * kNumLanes < mNumLanes)
+    {
+      mGroups.emplace_back();
+      Group& group = mGroups.back();
+      group.bank.SetWavetable(mWavetable);
+      group.bank.SetSampleRate(mSampleRate);
+      group.output.Resize(mMaxFrames * kNumLanes);
+      group.fm.Resize(mMaxFrames * kNumLanes);
+    }
+
+    return firstLane;
+  }
+
+  /** Set the wavetable of all lanes. Not while the voices are processing */
+  void SetWavetable(const Wavetable* pWavetable)
+  {
+    mWavetable = pWavetable;
+
+    for (auto& group : mGroups)
+      group.bank.SetWavetable(pWavetable);
+  }
+
+  /** Voices can call this from their SetSampleRateAndBlockSize()
+   * @param blockSize The largest block that the voices will process */
+  void SetSampleRateAndBlockSize(double sampleRate, int blockSize)
+  {
+    mSampleRate = sampleRate;
+    mMaxFrames = std::max(blockSize, 1);
+
+    for (auto& group : mGroups)
+    {
+      group.bank.SetSampleRate(sampleRate);
+      group.output.Resize(mMaxFrames * kNumLanes);
+      group.fm.Resize(mMaxFrames * kNumLanes);
+    }
+  }
+
+  /** Include a lane in the renders or leave it out. A group of lanes is only rendered if one of its lanes is active */
+  void SetLaneActive(int lane, bool active)
+  {
+    Group& group = mGroups[lane / kNumLanes];
+    const uint32_t bit = 1u << (lane % kNumLanes);
+    group.activeLanes = active ? (group.activeLanes | bit) : (group.activeLanes & ~bit);
+  }
+
+  /** Set the frequency of a lane for the next render, from SynthVoice::PrepareBlock() */
+  void SetFreqCPS(int lane, double freqCPS)
+  {
+    mGroups[lane / kNumLanes].bank.SetFreqCPS(lane % kNumLanes, freqCPS);
+    mDirty = true;
+  }
+
+  /** @param phase The phase of the lane, in cycles */
+  void SetPhase(int lane, double phase)
+  {
+    mGroups[lane / kNumLanes].bank.SetPhase(lane % kNumLanes, phase);
+  }
+
+  /** Set the frequency modulation of a lane for the next render, from SynthVoice::PrepareBlock(). The frequency is multiplied by (1 + fm). Lanes without FM for a render are not modulated
+   * @param pFM nFrames values, up to the block size */
+  void SetFM(int lane, const sample* pFM, int nFrames)
+  {
+    Group& group = mGroups[lane / kNumLanes];
+    const int l = lane % kNumLanes;
+    float* pDest = group.fm.Get();
+
+    for (auto i = 0; i < std::min(nFrames, mMaxFrames); i++)
+      pDest[i * kNumLanes + l] = static_cast<float>(pFM[i]);
+
+    group.fmLanes |= 1u << l;
+    mDirty = true;
+  }
+
+  /** Get the output of a lane, rendering all the active lanes first if they haven't been rendered since they were last set up
+   * @param nFrames The number of frames, up to the block size
+   * @return The output of the lane. The lanes of a group are interleaved, so the output at frame i is at [i * kNumLanes] */
+  const float* GetOutput(int lane, int nFrames)
+  {
+    if (mDirty || nFrames != mRenderedFrames)
+      Render(std::min(nFrames, mMaxFrames));
+
+    return mGroups[lane / kNumLanes].output.Get() + lane % kNumLanes;
+  }
+
+private:
+  struct Group
+  {
+    Bank bank;
+    WDL_TypedBuf<float> output;
+    WDL_TypedBuf<float> fm;
+    uint32_t activeLanes = 0;
+    uint32_t fmLanes = 0; // the lanes that have FM for the next render
+  };
+
+  void Render(int nFrames)
+  {
+    for (auto& group : mGroups)
+    {
+      if (!group.activeLanes)
+        continue;
+
+      if (group.fmLanes)
+      {
+        float* pFM = group.fm.Get();
+
+        for (auto l = 0; l < kNumLanes; l++)
+        {
+          if (!(group.fmLanes & (1u << l)))
+          {
+            for (auto i = 0; i < nFrames; i++)
+              pFM[i * kNumLanes + l] = 0.f;
+          }
+        }
+
+        group.bank.ProcessBlock(group.output.Get(), nFrames, pFM);
+        group.fmLanes = 0;
+      }
+      else
+        group.bank.ProcessBlock(group.output.Get(), nFrames);
+    }
+
+    mRenderedFrames = nFrames;
+    mDirty = false;
+  }
+
+  const Wavetable* mWavetable;
+  std::vector<Group> mGroups;
+  int mNumLanes = 0;
+  int mMaxFrames = 64;
+  int mRenderedFrames = 0;
+  double mSampleRate = 44100.;
+  bool mDirty = true;
+};
+
+/** A SynthVoice that plays a stack of detuned wavetable oscillators through an ADSR envelope. The oscillators of all voices that share a WavetableVoiceBank are rendered together.
+ * The oscillators follow the pitch and pitch bend inputs. Subclasses can add FM from an override of PrepareBlock(), with WavetableVoiceBank::SetFM() for the lanes from GetFirstLane() */
+class WavetableVoice : public SynthVoice
+{
+public:
+  /** @param bank The bank, which must outlive the voice
+   * @param nUnison The number of oscillators, up to WavetableVoiceBank::kNumLanes */
+  WavetableVoice(WavetableVoiceBank& bank, int nUnison = 1)
+  : mBank(bank)
+  , mNUnison(Clip(nUnison, 1, static_cast<int>(WavetableVoiceBank::kNumLanes)))
+  , mFirstLane(bank.AddLanes(mNUnison))
+  {
+    mEnvBuffer.Resize(64);
+  }
+
+  /** Set the detuning of the unison stack. The oscillators are spread evenly between -cents and +cents */
+  void SetDetune(double cents) { mDetuneCents = cents; }
+
+  /** @return The amplitude envelope, e.g. to set its stage times */
+  ADSREnvelope<sample>& GetEnvelope() { return mEnv; }
+
+  /** Set the sustain level of the envelope */
+  void SetSustain(sample level) { mSustain = level; }
+
+  /** @return The first of the voice's lanes in the bank */
+  int GetFirstLane() const { return mFirstLane; }
+
+  bool GetBusy() const override { return mEnv.GetBusy(); }
+
+  void Trigger(double level, bool isRetrigger) override
+  {
+    if (isRetrigger && mEnv.GetBusy())
+    {
+      mEnv.Retrigger(level);
+      return;
+    }
+
+    // spread the start phases, so that the unison stack doesn't start with all the oscillators in phase
+    for (auto l = 0; l < mNUnison; l++)
+    {
+      mBank.SetPhase(mFirstLane + l, static_cast<double>(l) / mNUnison);
+      mBank.SetLaneActive(mFirstLane + l, true);
+    }
+
+    mEnv.Start(level);
+  }
+
+  void Release() override
+  {
+    mEnv.Release();
+  }
+
+  void PrepareBlock(int startIdx, int nFrames) override
+  {
+    const double pitch = mInputs[kVoiceControlPitch].endValue + mInputs[kVoiceControlPitchBend].endValue;
+    const double freqCPS = 440. * std::pow(2., pitch);
+
+    for (auto l = 0; l < mNUnison; l++)
+    {
+      const double cents = mNUnison > 1 ? mDetuneCents * (2. * l / (mNUnison - 1) - 1.) : 0.;
+      mBank.SetFreqCPS(mFirstLane + l, freqCPS * std::pow(2., cents / 1200.));
+    }
+  }
+
+  void ProcessSamplesAccumulating(sample** inputs, sample** outputs, int nInputs, int nOutputs, int startIdx, int nFrames) override
+  {
+    nFrames = std::min(nFrames, mEnvBuffer.GetSize());
+    sample* pEnv = mEnvBuffer.Get();
+    mEnv.ProcessBlock(pEnv, nFrames, mSustain);
+
+    const float* pOsc = mBank.GetOutput(mFirstLane, nFrames);
+    const sample gain = 1. / std::sqrt(static_cast<double>(mNUnison));
+
+    for (auto i = 0; i < nFrames; i++)
+    {
+      const float* pFrame = pOsc + i * WavetableVoiceBank::kNumLanes;
+      float sum = 0.f;
+
+      for (auto l = 0; l < mNUnison; l++)
+        sum += pFrame[l];
+
+      const sample out = sum * gain * pEnv[i];
+
+      for (auto c = 0; c < nOutputs; c++)
+        outputs[c][startIdx + i] += out;
+    }
+
+    if (!mEnv.GetBusy())
+    {
+      for (auto l = 0; l < mNUnison; l++)
+        mBank.SetLaneActive(mFirstLane + l, false);
+    }
+  }
+
+  void SetSampleRateAndBlockSize(double sampleRate, int blockSize) override
+  {
+    mEnv.SetSampleRate(sampleRate);
+    mEnvBuffer.Resize(std::max(blockSize, 1));
+    mBank.SetSampleRateAndBlockSize(sampleRate, blockSize);
+  }
+
+private:
+  WavetableVoiceBank& mBank;
+  const int mNUnison;
+  const int mFirstLane;
+  ADSREnvelope<sample> mEnv {"wavetable"};
+  WDL_TypedBuf<sample> mEnvBuffer;
+  sample mSustain = 1.;
+  double mDetuneCents = 10.;
+};
+
+END_IPLUG_NAMESPACE
@@ -0,0 +1,396 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+#pragma once
+
+/**
+ * @file
+ * @brief A bandlimited, mip-mapped wavetable and a bank of oscillators that render it several at a time
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+#include "heapbuf.h"
+
+#include "IPlugPlatform.h"
+
+#if defined __SSE2__ || defined _M_X64 || (defined _M_IX86_FP && _M_IX86_FP >= 2)
+  #include <emmintrin.h>
+  #define IPLUG_WAVETABLE_SSE2
+#endif
+
+BEGIN_IPLUG_NAMESPACE
+
+/** One cycle of a waveform, stored as a set of bandlimited tables with one table per octave. Each table only holds the harmonics that
+ * stay below Nyquist at the highest frequency it is used for, so an oscillator that picks the table for its frequency doesn't alias.
+ * A wavetable is read-only once built, so many oscillators can share it */
+class Wavetable
+{
+public:
+  static constexpr int kTableBits = 11;
+  static constexpr int kTableSize = 1 << kTableBits;
+  static constexpr int kNumLevels = 10; // level n holds harmonics up to kMaxHarmonics >> n, i.e. down to only the fundamental
+  static constexpr int kMaxHarmonics = 1 << (kNumLevels - 1); // a quarter of the table size, so that linear interpolation is accurate
+
+  enum EShape
+  {
+    kSine,
+    kTriangle,
+    kSaw,
+    kSquare
+  };
+
+  Wavetable(EShape shape = kSine)
+  {
+    SetShape(shape);
+  }
+
+  /** Build the tables for a basic waveform */
+  void SetShape(EShape shape)
+  {
+    WDL_TypedBuf<float> amps;
+    float* pAmps = amps.Resize(kMaxHarmonics);
+
+    for (auto h = 1; h <= kMaxHarmonics; h++)
+    {
+      switch (shape)
+      {
+        case kSine: pAmps[h - 1] = h == 1 ? 1.f : 0.f; break;
+        case kTriangle: pAmps[h - 1] = (h & 1) ? static_cast<float>(((h / 2) & 1 ? -8. : 8.) / (PI * PI * h * h)) : 0.f; break;
+        case kSaw: pAmps[h - 1] = static_cast<float>((h & 1 ? 2. : -2.) / (PI * h)); break;
+        case kSquare: pAmps[h - 1] = (h & 1) ? static_cast<float>(4. / (PI * h)) : 0.f; break;
+      }
+    }
+
+    SetHarmonics(pAmps, nullptr, kMaxHarmonics);
+  }
+
+  /** Build the tables from the amplitudes of the harmonics of the waveform
+   * @param pSinAmps The amplitudes of the sine components of harmonics 1 to nHarmonics
+   * @param pCosAmps The amplitudes of the cosine components, or nullptr
+   * @param nHarmonics The number of harmonics. Harmonics above kMaxHarmonics are ignored */
+  void SetHarmonics(const float* pSinAmps, const float* pCosAmps, int nHarmonics)
+  {
+    nHarmonics = std::min(nHarmonics, static_cast<int>(kMaxHarmonics));
+    mTables.Resize(kNumLevels * kLevelSize);
+
+    // build the levels from the top one, with only the fundamental, down: each level adds the harmonics above those of the level before.
+    // The harmonics are summed with a rotating phasor per harmonic rather than with std::sin per sample
+    WDL_TypedBuf<double> sum;
+    double* pSum = sum.Resize(kTableSize);
+    std::fill(pSum, pSum + kTableSize, 0.);
+    int lastHarmonic = 0;
+
+    for (auto level = kNumLevels - 1; level >= 0; level--)
+    {
+      const int maxHarmonic = std::min(kMaxHarmonics >> level, nHarmonics);
+
+      for (auto h = lastHarmonic + 1; h <= maxHarmonic; h++)
+      {
+        const double sinAmp = pSinAmps[h - 1];
+        const double cosAmp = pCosAmps ? pCosAmps[h - 1] : 0.;
+
+        if (sinAmp == 0. && cosAmp == 0.)
+          continue;
+
+        const double step = 2. * PI * h / kTableSize;
+        const double stepRe = std::cos(step), stepIm = std::sin(step);
+        double re = 1., im = 0.;
+
+        for (auto i = 0; i < kTableSize; i++)
+        {
+          pSum[i] += sinAmp * im + cosAmp * re;
+          const double nextRe = re * stepRe - im * stepIm;
+          im = re * stepIm + im * stepRe;
+          re = nextRe;
+        }
+      }
+
+      lastHarmonic = std::max(lastHarmonic, maxHarmonic);
+
+      float* pTable = mTables.Get() + level * kLevelSize;
+
+      for (auto i = 0; i < kTableSize; i++)
+        pTable[i] = static_cast<float>(pSum[i]);
+
+      pTable[kTableSize] = pTable[0]; // the guard point for interpolation
+    }
+  }
+
+  /** Build the tables from one cycle of a waveform, which is analysed into its harmonics
+   * @param pCycle The samples of one cycle
+   * @param length The number of samples */
+  void SetWaveform(const float* pCycle, int length)
+  {
+    const int nHarmonics = std::min(length / 2, static_cast<int>(kMaxHarmonics));
+    WDL_TypedBuf<float> amps;
+    float* pSinAmps = amps.Resize(nHarmonics * 2);
+    float* pCosAmps = pSinAmps + nHarmonics;
+
+    for (auto h = 1; h <= nHarmonics; h++)
+    {
+      const double step = 2. * PI * h / length;
+      const double stepRe = std::cos(step), stepIm = std::sin(step);
+      double re = 1., im = 0., sinSum = 0., cosSum = 0.;
+
+      for (auto i = 0; i < length; i++)
+      {
+        sinSum += pCycle[i] * im;
+        cosSum += pCycle[i] * re;
+        const double nextRe = re * stepRe - im * stepIm;
+        im = re * stepIm + im * stepRe;
+        re = nextRe;
+      }
+
+      pSinAmps[h - 1] = static_cast<float>(2. * sinSum / length);
+      pCosAmps[h - 1] = static_cast<float>(2. * cosSum / length);
+    }
+
+    SetHarmonics(pSinAmps, pCosAmps, nHarmonics);
+  }
+
+  /** @return The table of a level, with kTableSize + 1 samples */
+  const float* GetLevel(int level) const { return mTables.Get() + level * kLevelSize; }
+
+  /** @param cyclesPerSample The frequency divided by the sample rate
+   * @return The level with the most harmonics that all stay below Nyquist at this frequency */
+  static int GetLevelForFrequency(double cyclesPerSample)
+  {
+    int level = 0;
+
+    while (level < kNumLevels - 1 && (kMaxHarmonics >> level) * cyclesPerSample > 0.5)
+      level++;
+
+    return level;
+  }
+
+private:
+  static constexpr int kLevelSize = kTableSize + 1;
+
+  WDL_TypedBuf<float> mTables;
+};
+
+/** A bank of NLanes wavetable oscillators, rendered together with SIMD, e.g. the voices of a unison stack or several synth voices at once.
+ * With SSE2, four lanes at a time share the phase accumulation, the interpolation and the FM, and only the table reads are per lane.
+ * Elsewhere, or if NLanes isn't a multiple of 4, each step of the render loop advances every lane, so that the compiler can vectorize it.
+ * The phase of each lane is a 32-bit fixed-point number that wraps by itself, and each lane picks the table of its wavetable for its frequency when the frequency is set.
+ * The output is interleaved: the sample of lane l at frame i is at pOutput[i * NLanes + l] */
+template <int NLanes = 8>
+class WavetableOscillatorBank
+{
+public:
+  static constexpr int kNumLanes = NLanes;
+
+  WavetableOscillatorBank()
+  {
+    for (auto l = 0; l < NLanes; l++)
+    {
+      mPhase[l] = 0;
+      mIncr[l] = 0.f;
+      mIntIncr[l] = 0;
+      mFreqCPS[l] = 0.;
+      mTables[l] = nullptr;
+    }
+  }
+
+  /** Set the wavetable of all lanes, which must outlive the bank or be replaced before it is destroyed */
+  void SetWavetable(const Wavetable* pWavetable)
+  {
+    for (auto l = 0; l < NLanes; l++)
+      SetWavetable(l, pWavetable);
+  }
+
+  /** Set the wavetable of one lane, which must outlive the bank or be replaced before it is destroyed */
+  void SetWavetable(int lane, const Wavetable* pWavetable)
+  {
+    mWavetables[lane] = pWavetable;
+    UpdateTable(lane);
+  }
+
+  void SetSampleRate(double sampleRate)
+  {
+    mSampleRate = sampleRate;
+
+    for (auto l = 0; l < NLanes; l++)
+      SetFreqCPS(l, mFreqCPS[l]);
+  }
+
+  /** Set the frequency of a lane. This also picks the table that the lane reads, so call it at most once per block
+   * @param freqCPS The frequency in Hz, up to half the sample rate */
+  void SetFreqCPS(int lane, double freqCPS)
+  {
+    mFreqCPS[lane] = freqCPS;
+    mIncr[lane] = static_cast<float>(std::copysign(GetCyclesPerSample(lane), freqCPS) * kPhaseScale);
+    mIntIncr[lane] = ToIncrement(mIncr[lane]);
+    UpdateTable(lane);
+  }
+
+  /** @param phase The phase of the lane, in cycles */
+  void SetPhase(int lane, double phase)
+  {
+    mPhase[lane] = static_cast<uint32_t>(static_cast<int64_t>((phase - std::floor(phase)) * kPhaseScale));
+  }
+
+  /** @return The phase of the lane, in cycles from 0 to 1 */
+  double GetPhase(int lane) const { return mPhase[lane] / kPhaseScale; }
+
+  /** Render all lanes
+   * @param pOutput The interleaved output, nFrames * NLanes samples
+   * @param nFrames The number of frames
+   * @param pFM Optional interleaved frequency modulation, in the same layout as the output. The frequency of each lane is multiplied by (1 + fm), which may go through zero.
+   * The table of the lane stays the one picked for its unmodulated frequency */
+  void ProcessBlock(float* pOutput, int nFrames, const float* pFM = nullptr)
+  {
+    for (auto l = 0; l < NLanes; l++)
+    {
+      if (!mTables[l])
+      {
+        // a lane without a wavetable reads silence, rather than being checked for in the render loop
+        mTables[l] = sSilence;
+      }
+    }
+
+    if (pFM)
+      Render<true>(pOutput, nFrames, pFM);
+    else
+      Render<false>(pOutput, nFrames, nullptr);
+  }
+
+private:
+  static constexpr double kPhaseScale = 4294967296.; // 2^32, one cycle
+  static constexpr int kFracBits = 32 - Wavetable::kTableBits;
+  static constexpr uint32_t kFracMask = (1u << kFracBits) - 1;
+  static constexpr float kMaxIncr = 2147483520.f; // the largest float below 2^31
+
+  static int32_t ToIncrement(float incr)
+  {
+    const float maxIncr = kMaxIncr;
+    return static_cast<int32_t>(std::min(std::max(incr, -maxIncr), maxIncr));
+  }
+
+  double GetCyclesPerSample(int lane) const
+  {
+    return std::min(std::abs(mFreqCPS[lane]) / mSampleRate, 0.5);
+  }
+
+  void UpdateTable(int lane)
+  {
+    const Wavetable* pWavetable = mWavetables[lane];
+    mTables[lane] = pWavetable ? pWavetable->GetLevel(Wavetable::GetLevelForFrequency(GetCyclesPerSample(lane))) : nullptr;
+  }
+
+  template <bool withFM>
+  void Render(float* pOutput, int nFrames, const float* pFM)
+  {
+#ifdef IPLUG_WAVETABLE_SSE2
+    if (NLanes % 4 == 0)
+    {
+      for (auto l = 0; l < NLanes; l += 4)
+        RenderSSE2<withFM>(pOutput + l, nFrames, pFM ? pFM + l : nullptr, l);
+
+      return;
+    }
+#endif
+
+    // local copies, so that the compiler knows that the output doesn't alias the state
+    uint32_t phase[NLanes];
+    float incr[NLanes];
+    int32_t intIncr[NLanes];
+    const float* tables[NLanes];
+    const float fracScale = 1.f / static_cast<float>(1u << kFracBits);
+
+    for (auto l = 0; l < NLanes; l++)
+    {
+      phase[l] = mPhase[l];
+      incr[l] = mIncr[l];
+      intIncr[l] = mIntIncr[l];
+      tables[l] = mTables[l];
+    }
+
+    for (auto i = 0; i < nFrames; i++)
+    {
+      float* pOut = pOutput + i * NLanes;
+
+      for (auto l = 0; l < NLanes; l++)
+      {
+        const uint32_t idx = phase[l] >> kFracBits;
+        const float frac = static_cast<float>(static_cast<int32_t>(phase[l] & kFracMask)) * fracScale;
+        const float a = tables[l][idx];
+        const float b = tables[l][idx + 1];
+        pOut[l] = a + frac * (b - a);
+
+        if (withFM)
+          phase[l] += static_cast<uint32_t>(ToIncrement(incr[l] * (1.f + pFM[i * NLanes + l])));
+        else
+          phase[l] += static_cast<uint32_t>(intIncr[l]);
+      }
+    }
+
+    for (auto l = 0; l < NLanes; l++)
+      mPhase[l] = phase[l];
+  }
+
+#ifdef IPLUG_WAVETABLE_SSE2
+  /** Render four lanes from firstLane, with the phases kept in a register for the whole block */
+  template <bool withFM>
+  void RenderSSE2(float* pOutput, int nFrames, const float* pFM, int firstLane)
+  {
+    const float* t0 = mTables[firstLane];
+    const float* t1 = mTables[firstLane + 1];
+    const float* t2 = mTables[firstLane + 2];
+    const float* t3 = mTables[firstLane + 3];
+    const __m128i fracMask = _mm_set1_epi32(kFracMask);
+    const __m128 fracScale = _mm_set1_ps(1.f / static_cast<float>(1u << kFracBits));
+    const __m128 one = _mm_set1_ps(1.f);
+    const __m128 maxIncr = _mm_set1_ps(kMaxIncr);
+    const __m128 minIncr = _mm_set1_ps(-kMaxIncr);
+    const __m128 incr = _mm_loadu_ps(mIncr + firstLane);
+    const __m128i intIncr = _mm_loadu_si128(reinterpret_cast<const __m128i*>(mIntIncr + firstLane));
+    __m128i phase = _mm_loadu_si128(reinterpret_cast<const __m128i*>(mPhase + firstLane));
+    alignas(16) int32_t idx[4];
+
+    for (auto i = 0; i < nFrames; i++)
+    {
+      _mm_store_si128(reinterpret_cast<__m128i*>(idx), _mm_srli_epi32(phase, kFracBits));
+      const __m128 frac = _mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(phase, fracMask)), fracScale);
+      const __m128 a = _mm_set_ps(t3[idx[3]], t2[idx[2]], t1[idx[1]], t0[idx[0]]);
+      const __m128 b = _mm_set_ps(t3[idx[3] + 1], t2[idx[2] + 1], t1[idx[1] + 1], t0[idx[0] + 1]);
+      _mm_storeu_ps(pOutput + i * NLanes, _mm_add_ps(a, _mm_mul_ps(frac, _mm_sub_ps(b, a))));
+
+      if (withFM)
+      {
+        const __m128 modulated = _mm_mul_ps(incr, _mm_add_ps(one, _mm_loadu_ps(pFM + i * NLanes)));
+        phase = _mm_add_epi32(phase, _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(modulated, minIncr), maxIncr)));
+      }
+      else
+        phase = _mm_add_epi32(phase, intIncr);
+    }
+
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(mPhase + firstLane), phase);
+  }
+#endif
+
+  static constexpr float sSilence[Wavetable::kTableSize + 1] = {};
+
+  uint32_t mPhase[NLanes];
+  float mIncr[NLanes]; // the phase increment per sample, in 2^-32 cycles
+  int32_t mIntIncr[NLanes];
+  double mFreqCPS[NLanes];
+  const float* mTables[NLanes];
+  const Wavetable* mWavetables[NLanes] = {};
+  double mSampleRate = 44100.;
+};
+
+template <int NLanes>
+constexpr float WavetableOscillatorBank<NLanes>::sSilence[Wavetable::kTableSize + 1];
+
+END_IPLUG_NAMESPACE
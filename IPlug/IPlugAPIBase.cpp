@@ -41,6 +41,8 @@ IPlugAPIBase::IPlugAPIBase(Config c, EAPI plugAPI)
   Trace(TRACELOC, "%s:%s", c.pluginName, CurrentTime());
   
   mParamDisplayStr.Set("", MAX_PARAM_DISPLAY_LEN);
+  
+  mStartupProfile.Mark("IPlugAPIBase");
 }
 
 IPlugAPIBase::~IPlugAPIBase()
@@ -64,7 +66,7 @@ void IPlugAPIBase::OnHostRequestingImportantParameters(int count, WDL_TypedBuf<i
 
 void IPlugAPIBase::CreateTimer()
 {
-  mTimer = std::unique_ptr<Timer>(Timer::Create(std::bind(&IPlugAPIBase::OnTimer, this, std::placeholders::_1), IDLE_TIMER_RATE));
+  mTimer = std::unique_ptr<Timer>(Timer::CreateScheduled(std::bind(&IPlugAPIBase::OnTimer, this, std::placeholders::_1), IDLE_TIMER_RATE, Timer::kHighPriority, IDLE_TIMER_MAX_INTERVAL));
 }
 
 bool IPlugAPIBase::CompareState(const uint8_t* pIncomingState, int startPos) const
@@ -147,14 +149,17 @@ void IPlugAPIBase::SendParameterValueFromAPI(int paramIdx, double value, bool no
   mParamChangeFromProcessor.Push(ParamTuple { paramIdx, value } );
 }
 
-void IPlugAPIBase::OnTimer(Timer& t)
+bool IPlugAPIBase::TransferToUI()
 {
+  bool transferred = false;
+
   if(HasUI())
   {
     // in distributed VST 3, parameter changes are managed by the host
   #if !defined VST3C_API && !defined VST3P_API
     while(mParamChangeFromProcessor.ElementsAvailable())
     {
+      transferred = true;
       ParamTuple p;
       mParamChangeFromProcessor.Pop(p);
       SendParameterValueFromDelegate(p.idx, p.value, false); // TODO:  if the parameter hasn't changed maybe we shouldn't do anything?
@@ -162,6 +167,7 @@ void IPlugAPIBase::OnTimer(Timer& t)
     
     while (mMidiMsgsFromProcessor.ElementsAvailable())
     {
+      transferred = true;
       IMidiMsg msg;
       mMidiMsgsFromProcessor.Pop(msg);
       SendMidiMsgFromDelegate(msg);
@@ -169,6 +175,7 @@ void IPlugAPIBase::OnTimer(Timer& t)
     
     while (mSysExDataFromProcessor.ElementsAvailable())
     {
+      transferred = true;
       SysExData msg;
       mSysExDataFromProcessor.Pop(msg);
       SendSysexMsgFromDelegate({msg.mOffset, msg.mData, msg.mSize});
@@ -179,6 +186,7 @@ void IPlugAPIBase::OnTimer(Timer& t)
   #if defined VST3P_API
     while (mMidiMsgsFromProcessor.ElementsAvailable())
     {
+      transferred = true;
       IMidiMsg msg;
       mMidiMsgsFromProcessor.Pop(msg);
       TransmitMidiMsgFromProcessor(msg);
@@ -186,14 +194,47 @@ void IPlugAPIBase::OnTimer(Timer& t)
     
     while (mSysExDataFromProcessor.ElementsAvailable())
     {
+      transferred = true;
       SysExData data;
       mSysExDataFromProcessor.Pop(data);
       TransmitSysExDataFromProcessor(data);
     }
   #endif
+
+    transferred |= mControlMsgsFromProcessor.Drain([this](int controlTag, int messageTag, int dataSize, const void* pData) {
+      SendControlMsgFromDelegate(controlTag, messageTag, dataSize, pData);
+    }) > 0;
   }
-  
+
+  return transferred;
+}
+
+void IPlugAPIBase::OnTimer(Timer& t)
+{
+  // while the UI is drawing, OnUIFrame() does this instead, so the timer backs off until the UI stops
+  if (mUIFrameSinceLastTimer)
+  {
+    mUIFrameSinceLastTimer = false;
+    t.SetIdle();
+    return;
+  }
+
+  const bool transferred = TransferToUI();
+
+  mIdleReported = false;
+  OnIdle();
+
+  if (!transferred && mIdleReported)
+    t.SetIdle();
+}
+
+void IPlugAPIBase::OnUIFrame()
+{
+  mUIFrameSinceLastTimer = true;
+
+  // OnIdle() first, so that data it sends to the UI is drawn in this frame
   OnIdle();
+  TransferToUI();
 }
 
 void IPlugAPIBase::SendMidiMsgFromUI(const IMidiMsg& msg)
@@ -24,6 +24,7 @@
 #include "IPlugUtilities.h"
 #include "IPlugParameter.h"
 #include "IPlugQueue.h"
+#include "IPlugMessageArena.h"
 #include "IPlugTimer.h"
 
 /**
@@ -113,8 +114,15 @@ public:
 #endif
   }
 
-  /** Override this method to get an "idle"" call on the main thread */
-  virtual void OnIdle() {}
+  /** Override this method to get an "idle"" call on the main thread. It is called before each frame while an IGraphics UI is drawing,
+   * otherwise every IDLE_TIMER_RATE ms. While there is no data to send to the UI the timer slows down to IDLE_TIMER_MAX_INTERVAL ms,
+   * but only if OnIdle() reports that it had nothing to do either, see ReportIdle(), so an override that sends data to the UI keeps its rate */
+  virtual void OnIdle() { ReportIdle(); }
+
+  /** Call this from your OnIdle() override when it had nothing to do, e.g. no new data for the UI, to let the idle timer slow down until there is */
+  void ReportIdle() { mIdleReported = true; }
+
+  void OnUIFrame() override;
     
 #pragma mark - Methods you can call - some of which have custom implementations in the API classes, some implemented in IPlugAPIBase.cpp
   /** Helper method, used to print some info to the console in debug builds. Can be overridden in other IPlugAPIBases, for specific functionality, such as printing UI details. */
@@ -145,6 +153,29 @@ public:
    * @param normalizedValue The new (normalised) value */
   void SetParameterValue(int paramIdx, double normalizedValue);
   
+  /** Reserve space for a control message, to be sent to the editor on the main thread via SendControlMsgFromDelegate().
+   * This is realtime safe and can be called on the audio thread. Write the message data into the returned pointer, then call CommitControlMsgFromProcessor().
+   * Only one thread may send control messages this way.
+   * @param controlTag A unique tag to identify the control that is the destination of the message
+   * @param messageTag A unique tag to identify the message
+   * @param dataSize The size in bytes of the message data
+   * @return Pointer to dataSize bytes to write the message into, or nullptr if the message arena is full */
+  void* ReserveControlMsgFromProcessor(int controlTag, int messageTag, int dataSize) { return mControlMsgsFromProcessor.Reserve(controlTag, messageTag, dataSize); }
+
+  /** Typed version of ReserveControlMsgFromProcessor(), default constructs a T in place
+   * @param controlTag A unique tag to identify the control that is the destination of the message
+   * @param messageTag A unique tag to identify the message
+   * @return Pointer to the T to fill in, or nullptr if the message arena is full */
+  template <typename T>
+  T* ReserveControlMsgFromProcessor(int controlTag, int messageTag) { return mControlMsgsFromProcessor.Reserve<T>(controlTag, messageTag); }
+
+  /** Send the control message written into the last reservation made with ReserveControlMsgFromProcessor() */
+  void CommitControlMsgFromProcessor() { mControlMsgsFromProcessor.Commit(); }
+
+  /** @param controlTag The tag of the destination control
+   * @return Statistics for the control messages sent to controlTag via ReserveControlMsgFromProcessor(), useful for sizing CONTROL_MSG_ARENA_SIZE. nullptr if none were sent */
+  const IPlugMessageArena::Stats* GetControlMsgStats(int controlTag) const { return mControlMsgsFromProcessor.GetStats(controlTag); }
+
   /** Get the color of the track that the plug-in is inserted on */
   virtual void GetTrackColor(int& r, int& g, int& b) {};
 
@@ -202,7 +233,7 @@ public:
     mSysExDataFromEditor.Push(data);
   }
 
-  /** /todo */
+  /** Start the timer that sends data from the processor to the UI and calls OnIdle(). It is scheduled by the TimerScheduler, so instances share one platform timer */
   void CreateTimer();
   
 private:
@@ -218,8 +249,15 @@ private:
   /** /todo */
   virtual void TransmitSysExDataFromProcessor(const SysExData& data) {};
 
+  /** Send data queued by the processor to the UI
+   * @return \c true if there was anything to send */
+  bool TransferToUI();
+
   void OnTimer(Timer& t);
 
+  bool mUIFrameSinceLastTimer = false;
+  bool mIdleReported = false;
+
 protected:
   WDL_String mParamDisplayStr;
   std::unique_ptr<Timer> mTimer;
@@ -229,6 +267,7 @@ protected:
   IPlugQueue<IMidiMsg> mMidiMsgsFromProcessor {MIDI_TRANSFER_SIZE}; // a queue of MIDI messages received (potentially on the high priority thread), by the processor to send to the editor
   IPlugQueue<SysExData> mSysExDataFromEditor {SYSEX_TRANSFER_SIZE}; // a queue of SYSEX data to send to the processor
   IPlugQueue<SysExData> mSysExDataFromProcessor {SYSEX_TRANSFER_SIZE}; // a queue of SYSEX data to send to the editor
+  IPlugMessageArena mControlMsgsFromProcessor {CONTROL_MSG_ARENA_SIZE}; // control messages written in place by the processor, to send to the editor
   SysExData mSysexBuf;
 };
 
@@ -111,6 +111,10 @@ static const int MAX_PARAM_DISPLAY_PRECISION = 6;
 #define IDLE_TIMER_RATE 20 // this controls the frequency of data going from processor to editor (and OnIdle calls)
 #endif
 
+#ifndef IDLE_TIMER_MAX_INTERVAL
+#define IDLE_TIMER_MAX_INTERVAL 100 // ms, the idle timer slows down to this when there is nothing to send to the editor. Set to IDLE_TIMER_RATE for a fixed rate
+#endif
+
 #ifndef MAX_SYSEX_SIZE
 #define MAX_SYSEX_SIZE 512
 #endif
@@ -118,6 +122,7 @@ static const int MAX_PARAM_DISPLAY_PRECISION = 6;
 #define PARAM_TRANSFER_SIZE 512
 #define MIDI_TRANSFER_SIZE 32
 #define SYSEX_TRANSFER_SIZE 4
+#define CONTROL_MSG_ARENA_SIZE 65536 // bytes
 
 // All version ints are stored as 0xVVVVRRMM: V = version, R = revision, M = minor revision.
 #define IPLUG_VERSION 0x010000
@@ -97,6 +97,9 @@ public:
   
   /** Override this method to do something before the UI is closed. */
   virtual void OnUIClose() {};
+
+  /** Called by the UI on the main thread at the start of each frame, before it checks which controls need redrawing. IGraphics calls this, other UIs may not */
+  virtual void OnUIFrame() {}
   
   /** Override this method to do something to your DSP when a parameter changes.
    * WARNING: this method can in some cases be called on the realtime audio thread
@@ -0,0 +1,244 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+#pragma once
+
+/**
+ * @file
+ * @copydoc IPlugMessageArena
+ */
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+#include "heapbuf.h"
+
+#include "IPlugPlatform.h"
+#include "IPlugConstants.h"
+
+BEGIN_IPLUG_NAMESPACE
+
+/** A lock-free SPSC channel for variable sized control messages, used to transfer data from the realtime audio thread to the main thread without copying.
+ * The producer reserves a slot in a preallocated buffer, writes the message in place and commits it. The consumer drains committed messages,
+ * receiving a pointer into the buffer that stays valid for the duration of the callback.
+ * Statistics are kept per control tag, so that the arena can be sized according to the real high-water mark. */
+class IPlugMessageArena final
+{
+public:
+  static constexpr int kMaxStatsTags = 32;
+  static constexpr int kUnusedStats = INT32_MIN; // marks a free entry in the stats table
+
+  /** Statistics for the messages sent to one control tag. All members are updated atomically and can be read from any thread */
+  struct Stats
+  {
+    std::atomic<int> controlTag {kUnusedStats};
+    std::atomic<int> numCommitted {0}; // number of messages that were committed
+    std::atomic<int> numDropped {0}; // number of reservations that failed, because the arena was full
+    std::atomic<int> pendingBytes {0}; // bytes that have been committed but not drained yet
+    std::atomic<int> highWaterBytes {0}; // the maximum value of pendingBytes so far
+  };
+
+  /** @param size The capacity of the arena in bytes */
+  IPlugMessageArena(int size)
+  {
+    mData.Resize(Align(size));
+    memset(mData.Get(), 0, mData.GetSize());
+  }
+
+  IPlugMessageArena(const IPlugMessageArena&) = delete;
+  IPlugMessageArena& operator=(const IPlugMessageArena&) = delete;
+
+  /** Producer side: reserve space for a message. Only one reservation can be outstanding at a time. Calling Reserve() again before Commit() abandons the previous reservation
+   * @param controlTag The tag of the control the message is for
+   * @param messageTag A tag identifying the message
+   * @param dataSize The size of the message in bytes
+   * @return Pointer to dataSize bytes to write the message into, or nullptr if the arena is full */
+  void* Reserve(int controlTag, int messageTag, int dataSize)
+  {
+    const size_t capacity = mData.GetSize();
+    const size_t needed = Align(sizeof(Header) + dataSize);
+    const size_t writeCount = mWriteCount.load(std::memory_order_relaxed);
+    const size_t available = capacity - (writeCount - mReadCount.load(std::memory_order_acquire));
+    const size_t pos = writeCount % capacity;
+    const size_t untilEnd = capacity - pos;
+
+    // messages are contiguous, if it doesn't fit before the end of the buffer, skip to the start
+    const size_t skip = (untilEnd < needed) ? untilEnd : 0;
+
+    if (needed + skip > available || needed > capacity)
+    {
+      Stats* pStats = GetStats(controlTag, true);
+
+      if (pStats)
+        pStats->numDropped++;
+
+      mReservedBytes = 0;
+      return nullptr;
+    }
+
+    if (skip && skip >= sizeof(Header))
+      new (mData.Get() + pos) Header {kNoTag, kNoTag, kWrapMarker, (int) skip};
+
+    Header* pHeader = new (mData.Get() + ((pos + skip) % capacity)) Header {controlTag, messageTag, dataSize, (int) needed};
+    mReservedBytes = needed + skip;
+    mReservedMessageBytes = needed;
+    mReservedControlTag = controlTag;
+
+    return pHeader + 1;
+  }
+
+  /** Producer side: typed version of Reserve(), default constructs a T in place
+   * @param controlTag The tag of the control the message is for
+   * @param messageTag A tag identifying the message
+   * @return Pointer to the T to fill in, or nullptr if the arena is full */
+  template <typename T>
+  T* Reserve(int controlTag, int messageTag)
+  {
+    void* pSlot = Reserve(controlTag, messageTag, sizeof(T));
+    return pSlot ? new (pSlot) T() : nullptr;
+  }
+
+  /** Producer side: publish the message written into the last reservation */
+  void Commit()
+  {
+    if (mReservedBytes == 0)
+      return;
+
+    mWriteCount.store(mWriteCount.load(std::memory_order_relaxed) + mReservedBytes, std::memory_order_release);
+
+    Stats* pStats = GetStats(mReservedControlTag, true);
+
+    if (pStats)
+    {
+      pStats->numCommitted++;
+      const int pending = pStats->pendingBytes += (int) mReservedMessageBytes;
+
+      if (pending > pStats->highWaterBytes)
+        pStats->highWaterBytes = pending;
+    }
+
+    mReservedBytes = 0;
+  }
+
+  /** Producer side: abandon the last reservation */
+  void Cancel()
+  {
+    mReservedBytes = 0;
+  }
+
+  /** Consumer side: call func(int controlTag, int messageTag, int dataSize, const void* pData) for each committed message, in order. pData points into the arena and is only valid during the call
+   * @return The number of messages drained */
+  template <typename Func>
+  int Drain(Func&& func)
+  {
+    const size_t capacity = mData.GetSize();
+    const size_t writeCount = mWriteCount.load(std::memory_order_acquire);
+    size_t readCount = mReadCount.load(std::memory_order_relaxed);
+    int numMessages = 0;
+
+    while (readCount != writeCount)
+    {
+      const size_t pos = readCount % capacity;
+      const size_t untilEnd = capacity - pos;
+
+      if (untilEnd < sizeof(Header))
+      {
+        readCount += untilEnd;
+        continue;
+      }
+
+      const Header* pHeader = reinterpret_cast<const Header*>(mData.Get() + pos);
+
+      if (pHeader->dataSize != kWrapMarker)
+      {
+        func(pHeader->controlTag, pHeader->messageTag, pHeader->dataSize, (const void*) (pHeader + 1));
+        numMessages++;
+
+        Stats* pStats = GetStats(pHeader->controlTag, false);
+
+        if (pStats)
+          pStats->pendingBytes -= pHeader->totalSize;
+      }
+
+      readCount += pHeader->totalSize;
+    }
+
+    mReadCount.store(readCount, std::memory_order_release);
+
+    return numMessages;
+  }
+
+  /** @return The statistics for controlTag, or nullptr if no messages have been sent to it, or too many tags are in use */
+  const Stats* GetStats(int controlTag) const
+  {
+    for (auto i = 0; i < kMaxStatsTags; i++)
+    {
+      if (mStats[i].controlTag == controlTag)
+        return &mStats[i];
+    }
+
+    return nullptr;
+  }
+
+  /** @param dataSize The size of a message in bytes
+   * @return The number of bytes the message occupies in the arena, use this to size an arena for a number of messages */
+  static constexpr int GetMessageSize(int dataSize) { return (int) Align(sizeof(Header) + dataSize); }
+
+  /** @return The capacity of the arena in bytes */
+  int GetCapacity() const { return mData.GetSize(); }
+
+private:
+  static constexpr int kWrapMarker = -1;
+
+  struct Header
+  {
+    int controlTag;
+    int messageTag;
+    int dataSize; // kWrapMarker means skip to the start of the buffer
+    int totalSize; // header + data + alignment padding
+  };
+
+  static constexpr size_t Align(size_t size) { return (size + 7) & ~((size_t) 7); }
+
+  /** The stats table is fixed size, so that it never allocates. Entries are only ever claimed by the producer */
+  Stats* GetStats(int controlTag, bool create)
+  {
+    for (auto i = 0; i < kMaxStatsTags; i++)
+    {
+      const int tag = mStats[i].controlTag;
+
+      if (tag == controlTag)
+        return &mStats[i];
+
+      if (tag == kUnusedStats)
+      {
+        if (!create)
+          return nullptr;
+
+        mStats[i].controlTag = controlTag;
+        return &mStats[i];
+      }
+    }
+
+    return nullptr;
+  }
+
+  WDL_TypedBuf<char> mData;
+  std::atomic<size_t> mWriteCount {0};
+  std::atomic<size_t> mReadCount {0};
+  size_t mReservedBytes = 0; // producer only, including any bytes skipped at the end of the buffer
+  size_t mReservedMessageBytes = 0; // producer only
+  int mReservedControlTag = kNoTag; // producer only
+  Stats mStats[kMaxStatsTags];
+};
+
+END_IPLUG_NAMESPACE
@@ -22,10 +22,15 @@ using namespace iplug;
 IPluginBase::IPluginBase(int nParams, int nPresets)
 : EDITOR_DELEGATE_CLASS(nParams)
 {  
+  mStartupProfile.Start();
+  ISharedResourceRegistry::RetainInstance();
+
 #ifndef NO_PRESETS
   for (int i = 0; i < nPresets; ++i)
     mPresets.Add(new IPreset());
 #endif
+
+  mStartupProfile.Mark("IPluginBase");
 }
 
 IPluginBase::~IPluginBase()
@@ -33,6 +38,8 @@ IPluginBase::~IPluginBase()
 #ifndef NO_PRESETS
   mPresets.Empty(true);
 #endif
+
+  ISharedResourceRegistry::ReleaseInstance();
 }
 
 int IPluginBase::GetPluginVersion(bool decimal) const
@@ -105,18 +112,34 @@ void IPluginBase::GetBuildInfoStr(WDL_String& str) const
 #pragma mark -
 
 bool IPluginBase::SerializeParams(IByteChunk& chunk) const
+{
+  return SerializeParamValues(chunk, false);
+}
+
+bool IPluginBase::SerializeParamValues(IByteChunk& chunk, bool defaults) const
 {
   TRACE
-  bool savedOK = true;
-  int i, n = mParams.GetSize();
-  for (i = 0; i < n && savedOK; ++i)
+  const int n = mParams.GetSize();
+  const int startPos = chunk.Size();
+  
+  // Resize once and copy the values in, rather than growing the chunk per parameter
+  chunk.Resize(startPos + n * (int) sizeof(double));
+  
+  if (chunk.Size() != startPos + n * (int) sizeof(double))
+    return false;
+  
+  uint8_t* pData = chunk.GetData() + startPos;
+  
+  for (int i = 0; i < n; ++i)
   {
-    IParam* pParam = mParams.Get(i);
-    Trace(TRACELOC, "%d %s %f", i, pParam->GetNameForHost(), pParam->Value());
-    double v = pParam->Value();
-    savedOK &= (chunk.Put(&v) > 0);
+    const double v = defaults ? mParams.Get(i)->GetDefault() : mParams.Get(i)->Value();
+    memcpy(pData + i * sizeof(double), &v, sizeof(double));
+#ifdef TRACER_BUILD
+    Trace(TRACELOC, "%d %s %f", i, mParams.Get(i)->GetNameForHost(), v);
+#endif
   }
-  return savedOK;
+  
+  return true;
 }
 
 int IPluginBase::UnserializeParams(const IByteChunk& chunk, int startPos)
@@ -124,13 +147,34 @@ int IPluginBase::UnserializeParams(const IByteChunk& chunk, int startPos)
   TRACE
   int i, n = mParams.GetSize(), pos = startPos;
   ENTER_PARAMS_MUTEX
-  for (i = 0; i < n && pos >= 0; ++i)
+  if (startPos >= 0 && startPos + n * (int) sizeof(double) <= chunk.Size())
   {
-    IParam* pParam = mParams.Get(i);
-    double v = 0.0;
-    pos = chunk.Get(&v, pos);
-    pParam->Set(v);
-    Trace(TRACELOC, "%d %s %f", i, pParam->GetNameForHost(), pParam->Value());
+    // All values are present, so read them straight out of the chunk
+    const uint8_t* pData = chunk.GetData() + startPos;
+    
+    for (i = 0; i < n; ++i)
+    {
+      IParam* pParam = mParams.Get(i);
+      double v;
+      memcpy(&v, pData + i * sizeof(double), sizeof(double));
+      pParam->Set(v);
+#ifdef TRACER_BUILD
+      Trace(TRACELOC, "%d %s %f", i, pParam->GetNameForHost(), pParam->Value());
+#endif
+    }
+    
+    pos = startPos + n * (int) sizeof(double);
+  }
+  else
+  {
+    for (i = 0; i < n && pos >= 0; ++i)
+    {
+      IParam* pParam = mParams.Get(i);
+      double v = 0.0;
+      pos = chunk.Get(&v, pos);
+      pParam->Set(v);
+      Trace(TRACELOC, "%d %s %f", i, pParam->GetNameForHost(), pParam->Value());
+    }
   }
 
   OnParamReset(kPresetRecall);
@@ -293,7 +337,12 @@ void IPluginBase::MakeDefaultPreset(const char* name, int nPresets)
     {
       pPreset->mInitialized = true;
       strcpy(pPreset->mName, (name ? name : "Empty"));
-      SerializeState(pPreset->mChunk);
+      
+      // The parameters may have changed by the time deferred presets are made
+      if (mMakingDeferredPresets)
+        SerializeParamValues(pPreset->mChunk, true);
+      else
+        SerializeState(pPreset->mChunk);
     }
   }
 }
@@ -355,7 +404,8 @@ void IPluginBase::MakePresetFromNamedParams(const char* name, int nParamsNamed,
     {
       if (*pV == PARAM_UNINIT)        // Any that weren't explicitly set, use the defaults.
       {
-        *pV = GetParam(i)->Value();
+        // Deferred presets are made after the parameters may have changed, so they don't use the current values
+        *pV = mMakingDeferredPresets ? GetParam(i)->GetDefault() : GetParam(i)->Value();
       }
       pPreset->mChunk.Put(pV);
     }
@@ -401,12 +451,26 @@ static void MakeDefaultUserPresetName(WDL_PtrList<IPreset>* pPresets, char* str)
 void IPluginBase::EnsureDefaultPreset()
 {
   TRACE
+  MakeDeferredPresets();
+
   MakeDefaultPreset("Empty", mPresets.GetSize());
 }
 
 void IPluginBase::PruneUninitializedPresets()
 {
   TRACE
+  // Pruning needs to know which presets are made, so wait until they are
+  if (mMakePresetsFunc && !mDeferredPresetsMade)
+  {
+    mPrunePresetsDeferred = true;
+    return;
+  }
+
+  DeleteUninitializedPresets();
+}
+
+void IPluginBase::DeleteUninitializedPresets() const
+{
   int i = 0;
   while (i < mPresets.GetSize())
   {
@@ -422,9 +486,38 @@ void IPluginBase::PruneUninitializedPresets()
   }
 }
 
+void IPluginBase::MakeDeferredPresets() const
+{
+  if (!mMakePresetsFunc || mDeferredPresetsMade)
+    return;
+
+  // A host may ask for presets on more than one thread, the first caller makes them and the others wait
+  WDL_MutexLock lock(&mDeferredPresetsMutex);
+
+  if (mDeferredPresetsMade || mMakingDeferredPresets)
+    return;
+
+  const auto startTime = std::chrono::steady_clock::now();
+
+  mMakingDeferredPresets = true;
+  mMakePresetsFunc();
+
+  if (mPrunePresetsDeferred)
+  {
+    mPrunePresetsDeferred = false;
+    DeleteUninitializedPresets();
+  }
+
+  mStartupProfile.AddPhase("Deferred presets", std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count());
+  mMakingDeferredPresets = false;
+  mDeferredPresetsMade = true;
+}
+
 bool IPluginBase::RestorePreset(int idx)
 {
   TRACE
+  MakeDeferredPresets();
+
   bool restoredOK = false;
   if (idx >= 0 && idx < mPresets.GetSize())
   {
@@ -453,6 +546,8 @@ bool IPluginBase::RestorePreset(int idx)
 
 bool IPluginBase::RestorePreset(const char* name)
 {
+  MakeDeferredPresets();
+
   if (CStringHasContents(name))
   {
     int n = mPresets.GetSize();
@@ -470,6 +565,8 @@ bool IPluginBase::RestorePreset(const char* name)
 
 const char* IPluginBase::GetPresetName(int idx) const
 {
+  MakeDeferredPresets();
+
   if (idx >= 0 && idx < mPresets.GetSize())
   {
     return mPresets.Get(idx)->mName;
@@ -479,6 +576,8 @@ const char* IPluginBase::GetPresetName(int idx) const
 
 void IPluginBase::ModifyCurrentPreset(const char* name)
 {
+  MakeDeferredPresets();
+
   if (mCurrentPresetIdx >= 0 && mCurrentPresetIdx < mPresets.GetSize())
   {
     IPreset* pPreset = mPresets.Get(mCurrentPresetIdx);
@@ -498,8 +597,20 @@ void IPluginBase::ModifyCurrentPreset(const char* name)
 bool IPluginBase::SerializePresets(IByteChunk& chunk) const
 {
   TRACE
+  MakeDeferredPresets();
+
   bool savedOK = true;
   int n = mPresets.GetSize();
+  int bankSize = 0;
+  
+  for (int i = 0; i < n; ++i)
+  {
+    const IPreset* pPreset = mPresets.Get(i);
+    bankSize += (int) (sizeof(int) + strlen(pPreset->mName) + sizeof(bool)) + (pPreset->mInitialized ? pPreset->mChunk.Size() : 0);
+  }
+  
+  chunk.Reserve(bankSize);
+  
   for (int i = 0; i < n && savedOK; ++i)
   {
     IPreset* pPreset = mPresets.Get(i);
@@ -519,6 +630,8 @@ bool IPluginBase::SerializePresets(IByteChunk& chunk) const
 int IPluginBase::UnserializePresets(IByteChunk& chunk, int startPos)
 {
   TRACE
+  MakeDeferredPresets();
+
   WDL_String name;
   int n = mPresets.GetSize(), pos = startPos;
   for (int i = 0; i < n && pos >= 0; ++i)
@@ -584,6 +697,8 @@ void IPluginBase::DumpPresetSrcCode(const char* filename, const char* paramEnumN
 
 void IPluginBase::DumpAllPresetsBlob(const char* filename) const
 {
+  MakeDeferredPresets();
+
   FILE* fp = fopen(filename, "w");
   
   char buf[MAX_BLOB_LENGTH] = "";
@@ -606,6 +721,8 @@ void IPluginBase::DumpAllPresetsBlob(const char* filename) const
 
 void IPluginBase::DumpPresetBlob(const char* filename) const
 {
+  MakeDeferredPresets();
+
   FILE* fp = fopen(filename, "w");
   fprintf(fp, "MakePresetFromBlob(\"name\", \"");
   
@@ -622,6 +739,8 @@ void IPluginBase::DumpPresetBlob(const char* filename) const
 
 void IPluginBase::DumpBankBlob(const char* filename) const
 {
+  MakeDeferredPresets();
+
   FILE* fp = fopen(filename, "w");
   
   if (!fp)
@@ -722,6 +841,8 @@ bool IPluginBase::SaveProgramAsFXP(const char* file) const
 
 bool IPluginBase::SaveBankAsFXB(const char* file) const
 {
+  MakeDeferredPresets();
+
   if (CStringHasContents(file))
   {
     FILE* fp = fopen(file, "wb");
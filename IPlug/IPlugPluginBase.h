@@ -15,10 +15,16 @@
  * @copydoc IPluginBase
  */
 
+#include <atomic>
+
+#include "mutex.h"
+
 #include "IPlugDelegate_select.h"
 #include "IPlugParameter.h"
 #include "IPlugStructs.h"
 #include "IPlugLogger.h"
+#include "IPlugSharedResources.h"
+#include "IPlugStartupProfile.h"
 
 BEGIN_IPLUG_NAMESPACE
 
@@ -57,6 +63,13 @@ public:
   /** @return The plug-in's unique four character ID as an integer */
   int GetUniqueID() const { return mUniqueID; }
   
+  /** Mark the end of a phase of creating this instance, e.g. call this in your constructor after initializing the parameters, to see what it costs
+   * @param name The name of the phase that just ended. Must be a string literal */
+  void MarkStartupPhase(const char* name) { mStartupProfile.Mark(name); }
+  
+  /** @return Timing for each phase of creating this instance, and deferred initialization such as mMakePresetsFunc */
+  const IPlugStartupProfile& GetStartupProfile() const { return mStartupProfile; }
+  
   /** @return The plug-in manufacturer's unique four character ID as an integer */
   int GetMfrID() const { return mMfrID; }
   
@@ -191,7 +204,7 @@ public:
 
   /** Gets the number of factory presets. NOTE: some hosts don't like 0 presets, so even if you don't support factory presets, this method should return 1
    * @return The number of factory presets */
-  int NPresets() const { return mPresets.GetSize(); }
+  int NPresets() const { if (mPrunePresetsDeferred) MakeDeferredPresets(); return mPresets.GetSize(); }
 
   /** Restore a preset by index. This should also update mCurrentPresetIdx
    * @param idx The index of the preset to restore
@@ -213,6 +226,7 @@ public:
   * @param dest_idx index of internal dest preset */
   void CopyPreset(IPreset* pPresetSrc, int dest_idx, bool copyname = false)
   {
+    MakeDeferredPresets();
     IPreset* pPresetTgt = mPresets.Get(dest_idx);
 
     pPresetTgt->mChunk.Clear();
@@ -489,8 +503,35 @@ protected:
   /** A list of unique cstrings found specified as "parameter groups" when defining IParams. These are used in various APIs to group parameters together in automation dialogues. */
   WDL_PtrList<const char> mParamGroups;
   
+  /** Timing for each phase of creating this instance, see MarkStartupPhase(). Mutable, since the const preset getters can make the deferred presets */
+  mutable IPlugStartupProfile mStartupProfile;
+  
+private:
+  /** Serialize the current values, or the default values, of all parameters, see SerializeParams() */
+  bool SerializeParamValues(IByteChunk& chunk, bool defaults) const;
+
+protected:
 #ifndef NO_PRESETS
-  WDL_PtrList<IPreset> mPresets;
+  /** Mutable, since the presets are made by the const getters if mMakePresetsFunc is set. Making the presets doesn't change the plug-in's logical state */
+  mutable WDL_PtrList<IPreset> mPresets;
+  
+  /** If set, this is called to make the factory presets the first time they are needed, rather than in the constructor.
+   * Hosts create many instances when scanning that never use presets, so this makes creating an instance cheaper. All MakePreset() calls should go in here.
+   * By then the parameters may have changed, so parameters that MakePresetFromNamedParams() doesn't name get their default values, and MakeDefaultPreset() stores the default values of the parameters only.
+   * A plug-in with state beyond its parameters should make its default presets with MakePresetFromChunk() */
+  std::function<void()> mMakePresetsFunc = nullptr;
+
+private:
+  /** Call mMakePresetsFunc, if it hasn't been called yet. Thread safe, a thread that calls this while another one is making the presets waits for it */
+  void MakeDeferredPresets() const;
+  
+  /** Delete the presets that MakePreset() etc. haven't filled in */
+  void DeleteUninitializedPresets() const;
+  
+  mutable WDL_Mutex mDeferredPresetsMutex;
+  mutable std::atomic<bool> mDeferredPresetsMade {false};
+  mutable bool mMakingDeferredPresets = false; // set while mMakePresetsFunc runs, in case it ends up calling MakeDeferredPresets() again
+  mutable bool mPrunePresetsDeferred = false;
 #endif
 
 #ifdef PARAMS_MUTEX
@@ -0,0 +1,159 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+#pragma once
+
+/**
+ * @file
+ * @copydoc IProcessTiming
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#include "IPlugPlatform.h"
+
+BEGIN_IPLUG_NAMESPACE
+
+/** Measures how long each processing block takes, compared to the time available for it (nFrames / sample rate).
+ * The audio thread is the only writer. The results are published with atomics, so they can be read from the UI thread at any time without locking.
+ * When disabled, the only cost on the audio thread is checking a flag */
+class IProcessTiming
+{
+public:
+  /** Load is the time taken by a block divided by its duration. The histogram has a bin per 10% of load, the last bin counts blocks that missed the deadline */
+  static constexpr int kNumHistogramBins = 11;
+
+  using Clock = std::chrono::steady_clock;
+
+  /** A copy of the results at one point in time */
+  struct Snapshot
+  {
+    int64_t numBlocks = 0;
+    int64_t numOverruns = 0; // blocks that took longer than their duration
+    int64_t numXruns = 0; // dropouts reported by the host or driver, see AddXrun()
+    double lastLoad = 0.; // load of the most recent block
+    double averageLoad = 0.; // smoothed load
+    double worstLoad = 0.; // highest load so far
+    double worstBlockTime = 0.; // longest block so far, in seconds
+    int64_t histogram[kNumHistogramBins] = {};
+  };
+
+  IProcessTiming() { Clear(); }
+  IProcessTiming(const IProcessTiming&) = delete;
+  IProcessTiming& operator=(const IProcessTiming&) = delete;
+
+  /** Turn timing on or off. Can be called from any thread */
+  void SetEnabled(bool enabled) { mEnabled.store(enabled, std::memory_order_relaxed); }
+
+  /** @return \c true if timing is on */
+  bool GetEnabled() const { return mEnabled.load(std::memory_order_relaxed); }
+
+  /** Ask the audio thread to clear the results before the next block. Can be called from any thread */
+  void Reset() { mResetRequested.store(true, std::memory_order_relaxed); }
+
+  /** Audio thread: call before processing a block
+   * @return The start time to pass to EndBlock() */
+  Clock::time_point BeginBlock() const
+  {
+    return GetEnabled() ? Clock::now() : Clock::time_point();
+  }
+
+  /** Audio thread: call after processing a block
+   * @param startTime The value returned by BeginBlock()
+   * @param nFrames The number of frames in the block
+   * @param sampleRate The sample rate */
+  void EndBlock(Clock::time_point startTime, int nFrames, double sampleRate)
+  {
+    if (startTime == Clock::time_point() || nFrames <= 0 || sampleRate <= 0.)
+      return;
+
+    const double blockTime = std::chrono::duration<double>(Clock::now() - startTime).count();
+    AddBlock(blockTime, nFrames / sampleRate);
+  }
+
+  /** Audio thread: add a block that was timed elsewhere
+   * @param blockTime The time taken to process the block in seconds
+   * @param budget The duration of the block in seconds */
+  void AddBlock(double blockTime, double budget)
+  {
+    if (mResetRequested.exchange(false, std::memory_order_relaxed))
+      Clear();
+
+    const double load = blockTime / budget;
+    const int bin = load >= 1. ? kNumHistogramBins - 1 : static_cast<int>(load * (kNumHistogramBins - 1));
+    const double averageLoad = mNumBlocks.load(std::memory_order_relaxed) ? mAverageLoad.load(std::memory_order_relaxed) : load;
+
+    mHistogram[bin].store(mHistogram[bin].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    mLastLoad.store(load, std::memory_order_relaxed);
+    mAverageLoad.store(averageLoad + (load - averageLoad) * kAverageCoeff, std::memory_order_relaxed);
+
+    if (load > mWorstLoad.load(std::memory_order_relaxed))
+      mWorstLoad.store(load, std::memory_order_relaxed);
+
+    if (blockTime > mWorstBlockTime.load(std::memory_order_relaxed))
+      mWorstBlockTime.store(blockTime, std::memory_order_relaxed);
+
+    if (load >= 1.)
+      mNumOverruns.store(mNumOverruns.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+    mNumBlocks.store(mNumBlocks.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+  }
+
+  /** Record a dropout reported by the host or audio driver. Can be called from any thread */
+  void AddXrun() { mNumXruns++; }
+
+  /** Copy the current results. Can be called from any thread. The values are read individually, so they may be one block apart
+   * @param snapshot The snapshot to fill in */
+  void GetSnapshot(Snapshot& snapshot) const
+  {
+    snapshot.numBlocks = mNumBlocks.load(std::memory_order_acquire);
+    snapshot.numOverruns = mNumOverruns.load(std::memory_order_relaxed);
+    snapshot.numXruns = mNumXruns.load(std::memory_order_relaxed);
+    snapshot.lastLoad = mLastLoad.load(std::memory_order_relaxed);
+    snapshot.averageLoad = mAverageLoad.load(std::memory_order_relaxed);
+    snapshot.worstLoad = mWorstLoad.load(std::memory_order_relaxed);
+    snapshot.worstBlockTime = mWorstBlockTime.load(std::memory_order_relaxed);
+
+    for (auto i = 0; i < kNumHistogramBins; i++)
+      snapshot.histogram[i] = mHistogram[i].load(std::memory_order_relaxed);
+  }
+
+private:
+  static constexpr double kAverageCoeff = 0.05;
+
+  void Clear()
+  {
+    mNumBlocks.store(0, std::memory_order_relaxed);
+    mNumOverruns.store(0, std::memory_order_relaxed);
+    mNumXruns.store(0, std::memory_order_relaxed);
+    mLastLoad.store(0., std::memory_order_relaxed);
+    mAverageLoad.store(0., std::memory_order_relaxed);
+    mWorstLoad.store(0., std::memory_order_relaxed);
+    mWorstBlockTime.store(0., std::memory_order_relaxed);
+
+    for (auto i = 0; i < kNumHistogramBins; i++)
+      mHistogram[i].store(0, std::memory_order_relaxed);
+  }
+
+  std::atomic<bool> mEnabled {false};
+  std::atomic<bool> mResetRequested {false};
+  std::atomic<int64_t> mNumBlocks {0};
+  std::atomic<int64_t> mNumOverruns {0};
+  std::atomic<int64_t> mNumXruns {0};
+  std::atomic<double> mLastLoad {0.};
+  std::atomic<double> mAverageLoad {0.};
+  std::atomic<double> mWorstLoad {0.};
+  std::atomic<double> mWorstBlockTime {0.};
+  std::atomic<int64_t> mHistogram[kNumHistogramBins];
+};
+
+END_IPLUG_NAMESPACE
@@ -21,6 +21,24 @@
 
 using namespace iplug;
 
+/** Copies each input to the corresponding output and zeros outputs that have no input, used for the default pass through processing */
+template <typename T>
+static void CopyInputsToOutputs(T** inputs, T** outputs, int nIn, int nOut, int nFrames)
+{
+  int i = 0;
+
+  for (; i < nOut && i < nIn; ++i)
+  {
+    memcpy(outputs[i], inputs[i], nFrames * sizeof(T));
+  }
+
+  // zero remaining outs
+  for (; i < nOut; ++i)
+  {
+    memset(outputs[i], 0, nFrames * sizeof(T));
+  }
+}
+
 IPlugProcessor::IPlugProcessor(const Config& config, EAPI plugAPI)
 : mLatency(config.latency)
 , mPlugType((EIPlugPluginType) config.plugType)
@@ -35,24 +53,30 @@ IPlugProcessor::IPlugProcessor(const Config& config, EAPI plugAPI)
 
   mScratchData[ERoute::kInput].Resize(totalNInChans);
   mScratchData[ERoute::kOutput].Resize(totalNOutChans);
+  mNativeData[ERoute::kInput].Resize(totalNInChans);
+  mNativeData[ERoute::kOutput].Resize(totalNOutChans);
 
   sample** ppInData = mScratchData[ERoute::kInput].Get();
+  PLUG_SAMPLE_SRC** ppNativeInData = mNativeData[ERoute::kInput].Get();
 
-  for (auto i = 0; i < totalNInChans; ++i, ++ppInData)
+  for (auto i = 0; i < totalNInChans; ++i, ++ppInData, ++ppNativeInData)
   {
     IChannelData<>* pInChannel = new IChannelData<>;
     pInChannel->mConnected = false;
     pInChannel->mData = ppInData;
+    pInChannel->mNativeData = ppNativeInData;
     mChannelData[ERoute::kInput].Add(pInChannel);
   }
 
   sample** ppOutData = mScratchData[ERoute::kOutput].Get();
+  PLUG_SAMPLE_SRC** ppNativeOutData = mNativeData[ERoute::kOutput].Get();
 
-  for (auto i = 0; i < totalNOutChans; ++i, ++ppOutData)
+  for (auto i = 0; i < totalNOutChans; ++i, ++ppOutData, ++ppNativeOutData)
   {
     IChannelData<>* pOutChannel = new IChannelData<>;
     pOutChannel->mConnected = false;
     pOutChannel->mData = ppOutData;
+    pOutChannel->mNativeData = ppNativeOutData;
     pOutChannel->mIncomingData = nullptr;
     mChannelData[ERoute::kOutput].Add(pOutChannel);
   }
@@ -69,21 +93,12 @@ IPlugProcessor::~IPlugProcessor()
 
 void IPlugProcessor::ProcessBlock(sample** inputs, sample** outputs, int nFrames)
 {
-  int i, nIn = mChannelData[ERoute::kInput].GetSize(), nOut = mChannelData[ERoute::kOutput].GetSize();
-  int j = 0;
-  for (i = 0; i < nOut; ++i)
-  {
-    if (i < nIn)
-    {
-      memcpy(outputs[i], inputs[i], nFrames * sizeof(sample));
-      j++;
-    }
-  }
-  // zero remaining outs
-  for (/* same j */; j < nOut; ++j)
-  {
-    memset(outputs[j], 0, nFrames * sizeof(sample));
-  }
+  CopyInputsToOutputs(inputs, outputs, mChannelData[ERoute::kInput].GetSize(), mChannelData[ERoute::kOutput].GetSize(), nFrames);
+}
+
+void IPlugProcessor::ProcessBlockNative(PLUG_SAMPLE_SRC** inputs, PLUG_SAMPLE_SRC** outputs, int nFrames)
+{
+  CopyInputsToOutputs(inputs, outputs, mChannelData[ERoute::kInput].GetSize(), mChannelData[ERoute::kOutput].GetSize(), nFrames);
 }
 
 void IPlugProcessor::ProcessMidiMsg(const IMidiMsg& msg)
@@ -197,6 +212,14 @@ void IPlugProcessor::SetLatency(int samples)
     mLatencyDelay->SetDelayTime(mLatency);
 }
 
+void IPlugProcessor::SetMaxLatency(int maxLatency)
+{
+  mMaxLatency = std::max(mMaxLatency, maxLatency);
+
+  if (mLatencyDelay)
+    mLatencyDelay->SetMaxDelayTime(maxLatency);
+}
+
 //static
 int IPlugProcessor::ParseChannelIOStr(const char* IOStr, WDL_PtrList<IOConfig>& channelIOList, int& totalNInChans, int& totalNOutChans, int& totalNInBuses, int& totalNOutBuses)
 {
@@ -334,7 +357,10 @@ void IPlugProcessor::SetChannelConnections(ERoute direction, int idx, int n, boo
     pChannel->mConnected = connected;
 
     if (!connected)
+    {
       *(pChannel->mData) = pChannel->mScratchBuf.Get();
+      *(pChannel->mNativeData) = pChannel->mNativeScratchBuf.Get();
+    }
   }
 }
 
@@ -365,7 +391,11 @@ void IPlugProcessor::AttachBuffers(ERoute direction, int idx, int n, PLUG_SAMPLE
 
     if (pChannel->mConnected)
     {
-      if (direction == ERoute::kInput)
+      if (mProcessNativePrecision)
+      {
+        *(pChannel->mNativeData) = *(ppData++);
+      }
+      else if (direction == ERoute::kInput)
       {
         PLUG_SAMPLE_DST* pScratch = pChannel->mScratchBuf.Get();
         CastCopy(pScratch, *(ppData++), nFrames);
@@ -390,6 +420,46 @@ void IPlugProcessor::PassThroughBuffers(PLUG_SAMPLE_DST type, int nFrames)
 
 void IPlugProcessor::PassThroughBuffers(PLUG_SAMPLE_SRC type, int nFrames)
 {
+  if (mProcessNativePrecision)
+  {
+    if (mLatency && mLatencyDelay)
+    {
+      // the latency delay line runs in sample precision, so only in this case convert the connected channels
+      for (auto i = 0; i < MaxNChannels(ERoute::kInput); ++i)
+      {
+        IChannelData<>* pInChannel = mChannelData[ERoute::kInput].Get(i);
+
+        if (pInChannel->mConnected)
+        {
+          CastCopy(pInChannel->mScratchBuf.Get(), *(pInChannel->mNativeData), nFrames);
+          *(pInChannel->mData) = pInChannel->mScratchBuf.Get();
+        }
+      }
+
+      for (auto i = 0; i < MaxNChannels(ERoute::kOutput); ++i)
+      {
+        IChannelData<>* pOutChannel = mChannelData[ERoute::kOutput].Get(i);
+
+        if (pOutChannel->mConnected)
+          *(pOutChannel->mData) = pOutChannel->mScratchBuf.Get();
+      }
+
+      PassThroughBuffers(PLUG_SAMPLE_DST(0.), nFrames);
+
+      for (auto i = 0; i < MaxNChannels(ERoute::kOutput); ++i)
+      {
+        IChannelData<>* pOutChannel = mChannelData[ERoute::kOutput].Get(i);
+
+        if (pOutChannel->mConnected)
+          CastCopy(*(pOutChannel->mNativeData), *(pOutChannel->mData), nFrames);
+      }
+    }
+    else
+      CopyInputsToOutputs(mNativeData[ERoute::kInput].Get(), mNativeData[ERoute::kOutput].Get(), MaxNChannels(ERoute::kInput), MaxNChannels(ERoute::kOutput), nFrames);
+
+    return;
+  }
+
   // for PLUG_SAMPLE_SRC bit buffers, first run the delay (if mLatency) on the PLUG_SAMPLE_DST IPlug buffers
   PassThroughBuffers(PLUG_SAMPLE_DST(0.), nFrames);
 
@@ -408,11 +478,21 @@ void IPlugProcessor::PassThroughBuffers(PLUG_SAMPLE_SRC type, int nFrames)
 
 void IPlugProcessor::ProcessBuffers(PLUG_SAMPLE_DST type, int nFrames)
 {
+  const auto startTime = mProcessTiming.BeginBlock();
   ProcessBlock(mScratchData[ERoute::kInput].Get(), mScratchData[ERoute::kOutput].Get(), nFrames);
+  mProcessTiming.EndBlock(startTime, nFrames, GetSampleRate());
 }
 
 void IPlugProcessor::ProcessBuffers(PLUG_SAMPLE_SRC type, int nFrames)
 {
+  if (mProcessNativePrecision)
+  {
+    const auto startTime = mProcessTiming.BeginBlock();
+    ProcessBlockNative(mNativeData[ERoute::kInput].Get(), mNativeData[ERoute::kOutput].Get(), nFrames);
+    mProcessTiming.EndBlock(startTime, nFrames, GetSampleRate());
+    return;
+  }
+
   ProcessBuffers((PLUG_SAMPLE_DST) 0, nFrames);
   int i, n = MaxNChannels(ERoute::kOutput);
   IChannelData<>** ppOutChannel = mChannelData[ERoute::kOutput].GetList();
@@ -430,6 +510,48 @@ void IPlugProcessor::ProcessBuffers(PLUG_SAMPLE_SRC type, int nFrames)
 
 void IPlugProcessor::ProcessBuffersAccumulating(int nFrames)
 {
+  if (mProcessNativePrecision)
+  {
+    int i, n = MaxNChannels(ERoute::kOutput);
+    IChannelData<>** ppOutChannel = mChannelData[ERoute::kOutput].GetList();
+
+    // render into the scratch buffers, then accumulate into the host's buffers
+    for (i = 0; i < n; ++i)
+    {
+      IChannelData<>* pOutChannel = ppOutChannel[i];
+
+      if (pOutChannel->mConnected)
+      {
+        pOutChannel->mIncomingData = *(pOutChannel->mNativeData);
+        *(pOutChannel->mNativeData) = pOutChannel->mNativeScratchBuf.Get();
+      }
+    }
+
+    const auto startTime = mProcessTiming.BeginBlock();
+    ProcessBlockNative(mNativeData[ERoute::kInput].Get(), mNativeData[ERoute::kOutput].Get(), nFrames);
+    mProcessTiming.EndBlock(startTime, nFrames, GetSampleRate());
+
+    for (i = 0; i < n; ++i)
+    {
+      IChannelData<>* pOutChannel = ppOutChannel[i];
+
+      if (pOutChannel->mConnected)
+      {
+        PLUG_SAMPLE_SRC* pDest = pOutChannel->mIncomingData;
+        const PLUG_SAMPLE_SRC* pSrc = pOutChannel->mNativeScratchBuf.Get();
+
+        for (int j = 0; j < nFrames; ++j)
+        {
+          pDest[j] += pSrc[j];
+        }
+
+        *(pOutChannel->mNativeData) = pDest;
+      }
+    }
+
+    return;
+  }
+
   ProcessBuffers((PLUG_SAMPLE_DST) 0, nFrames);
   int i, n = MaxNChannels(ERoute::kOutput);
   IChannelData<>** ppOutChannel = mChannelData[ERoute::kOutput].GetList();
@@ -464,6 +586,9 @@ void IPlugProcessor::ZeroScratchBuffers()
     IChannelData<>* pOutChannel = mChannelData[ERoute::kOutput].Get(i);
     memset(pOutChannel->mScratchBuf.Get(), 0, mBlockSize * sizeof(PLUG_SAMPLE_DST));
   }
+
+  if (mProcessNativePrecision)
+    ResizeNativeScratchBuffers(mBlockSize);
 }
 
 void IPlugProcessor::SetBlockSize(int blockSize)
@@ -486,6 +611,31 @@ void IPlugProcessor::SetBlockSize(int blockSize)
       memset(pOutChannel->mScratchBuf.Get(), 0, blockSize * sizeof(PLUG_SAMPLE_DST));
     }
 
+    if (mProcessNativePrecision)
+      ResizeNativeScratchBuffers(blockSize);
+
     mBlockSize = blockSize;
   }
 }
+
+void IPlugProcessor::ResizeNativeScratchBuffers(int blockSize)
+{
+  for (auto d = 0; d < 2; ++d)
+  {
+    for (auto i = 0; i < mChannelData[d].GetSize(); ++i)
+    {
+      IChannelData<>* pChannel = mChannelData[d].Get(i);
+      pChannel->mNativeScratchBuf.Resize(blockSize);
+      memset(pChannel->mNativeScratchBuf.Get(), 0, blockSize * sizeof(PLUG_SAMPLE_SRC));
+
+      if (!pChannel->mConnected)
+        *(pChannel->mNativeData) = pChannel->mNativeScratchBuf.Get();
+    }
+  }
+}
+
+void IPlugProcessor::SetProcessNativePrecision(bool enable)
+{
+  mProcessNativePrecision = enable;
+  ResizeNativeScratchBuffers(enable ? mBlockSize : 0);
+}
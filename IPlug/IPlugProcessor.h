@@ -25,6 +25,7 @@
 #include "IPlugStructs.h"
 #include "IPlugUtilities.h"
 #include "NChanDelay.h"
+#include "IPlugProcessTiming.h"
 
 /**
  * @file
@@ -60,6 +61,15 @@ public:
    * @param nFrames The block size for this block: number of samples per channel.*/
   virtual void ProcessBlock(sample** inputs, sample** outputs, int nFrames);
 
+  /** Override this method, as well as ProcessBlock(), to process audio in the precision of the host's buffers when it differs from iPlug's sample type.
+   * This avoids converting every channel to and from sample, e.g. when a float-native DSP runs in a 32-bit host. It is only called if you opt in by calling SetProcessNativePrecision(true) in your plug-in's constructor.
+   * Typically both overrides forward to a single template, e.g. template <typename T> void ProcessBlockT(T** inputs, T** outputs, int nFrames)
+   * THIS METHOD IS CALLED BY THE HIGH PRIORITY AUDIO THREAD - You should be careful not to do any unbounded, blocking operations such as file I/O which could cause audio dropouts
+   * @param inputs Two-dimensional array containing the non-interleaved input buffers of audio samples for all channels
+   * @param outputs Two-dimensional array for audio output (non-interleaved).
+   * @param nFrames The block size for this block: number of samples per channel.*/
+  virtual void ProcessBlockNative(PLUG_SAMPLE_SRC** inputs, PLUG_SAMPLE_SRC** outputs, int nFrames);
+
   /** Override this method to handle incoming MIDI messages. The method is called prior to ProcessBlock().
    * You can use IMidiQueue in combination with this method in order to queue the message and process at the appropriate time in ProcessBlock()
    * THIS METHOD IS CALLED BY THE HIGH PRIORITY AUDIO THREAD - You should be careful not to do any unbounded, blocking operations such as file I/O which could cause audio dropouts
@@ -233,11 +243,36 @@ public:
    * @param zeroBased If \c true the index in the format string will be zero based */
   void SetChannelLabel(ERoute direction, int idx, const char* formatStr, bool zeroBased = false);
 
+  /** Call this in your plug-in's constructor to have buffers of PLUG_SAMPLE_SRC precision passed to ProcessBlockNative() without conversion, instead of being converted to sample and passed to ProcessBlock().
+   * Buffers that are already of sample precision are still passed to ProcessBlock(), so you need to override both
+   * @param enable \c true to process in the host's native precision */
+  void SetProcessNativePrecision(bool enable);
+
+  /** @return \c true if buffers of PLUG_SAMPLE_SRC precision are passed to ProcessBlockNative() without conversion */
+  bool GetProcessNativePrecision() const { return mProcessNativePrecision; }
+
+  /** Timing of ProcessBlock() calls, relative to the duration of each block. Off by default, turn it on with GetProcessTiming().SetEnabled(true)
+   * The results can be read from any thread, e.g. by an IProcessLoadDisplayControl
+   * @return The timing of this instance */
+  IProcessTiming& GetProcessTiming() { return mProcessTiming; }
+
+  /** @return The timing of this instance */
+  const IProcessTiming& GetProcessTiming() const { return mProcessTiming; }
+
   /** Call this if the latency of your plug-in changes after initialization (perhaps from OnReset() )
    * This may not be supported by the host. The method is virtual because it's overridden in API classes.
    @param latency Latency in samples */
   virtual void SetLatency(int latency);
 
+  /** Call this in your plug-in's constructor if the latency can change at runtime, so that the delay line used to compensate for latency when bypassed
+   * can be allocated up front, and SetLatency() doesn't need to allocate memory for latencies up to this value.
+   * Only the APIs that delay the bypassed signal themselves have that delay line (AAX and VST3), with the others the host compensates, and the value is just kept
+   * @param maxLatency The largest latency in samples that will be passed to SetLatency() */
+  void SetMaxLatency(int maxLatency);
+
+  /** @return The largest latency passed to SetMaxLatency(), or 0 */
+  int GetMaxLatency() const { return mMaxLatency; }
+
   /** Call this method if you need to update the tail size at runtime, for example if the decay time of your reverb effect changes
    * Some apis have special interpretations of certain numbers. For VST3 set to 0xffffffff for infinite tail, or 0 for none (default)
    * For VST2 setting to 1 means no tail
@@ -271,6 +306,7 @@ protected:
   void ProcessBuffers(PLUG_SAMPLE_DST type, int nFrames);
   void ProcessBuffersAccumulating(int nFrames); // only for VST2 deprecated method single precision
   void ZeroScratchBuffers();
+  void ResizeNativeScratchBuffers(int blockSize);
   void SetSampleRate(double sampleRate) { mSampleRate = sampleRate; }
   void SetBlockSize(int blockSize);
   void SetBypassed(bool bypassed) { mBypassed = bypassed; }
@@ -289,6 +325,8 @@ private:
   bool mDoesMPE;
   /** Plug-in latency (in samples) */
   int mLatency;
+  /** The largest latency the plug-in will set, so that the latency delay line can be allocated up front (in samples) */
+  int mMaxLatency = 0;
   /** Current sample rate (in Hz) */
   double mSampleRate = DEFAULT_SAMPLE_RATE;
   /** Current block size (in samples) */
@@ -299,10 +337,16 @@ private:
   bool mBypassed = false;
   /** \c true if the plug-in is rendering off-line*/
   bool mRenderingOffline = false;
+  /** \c true if PLUG_SAMPLE_SRC buffers are processed without conversion, see SetProcessNativePrecision() */
+  bool mProcessNativePrecision = false;
+  /** Times ProcessBlock() calls, see GetProcessTiming() */
+  IProcessTiming mProcessTiming;
   /** A list of IOConfig structures populated by ParseChannelIOStr in the IPlugProcessor constructor */
   WDL_PtrList<IOConfig> mIOConfigs;
   /* Manages pointers to the actual data for each channel */
   WDL_TypedBuf<sample*> mScratchData[2];
+  /* Manages pointers to the actual data for each channel, when processing in the host's native precision */
+  WDL_TypedBuf<PLUG_SAMPLE_SRC*> mNativeData[2];
   /* A list of IChannelData structures corresponding to every input/output channel */
   WDL_PtrList<IChannelData<>> mChannelData[2];
 protected: // these members are protected because they need to be access by the API classes, and don't want a setter/getter
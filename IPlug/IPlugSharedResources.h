@@ -0,0 +1,243 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+#pragma once
+
+/**
+ * @file
+ * @copydoc ISharedResourceRegistry
+ */
+
+#include <cstring>
+#include <memory>
+#include <typeinfo>
+#include <utility>
+
+#include "mutex.h"
+#include "ptrlist.h"
+#include "wdlstring.h"
+
+#include "IPlugPlatform.h"
+
+BEGIN_IPLUG_NAMESPACE
+
+/** A handle to an immutable resource from ISharedResourceRegistry, with copy-on-write semantics.
+ * Reading goes straight to the shared data. The first call to GetMutable() gives this handle its own copy, so other instances never see the modification */
+template <class T>
+class ISharedResource
+{
+public:
+  ISharedResource() {}
+  ISharedResource(std::shared_ptr<const T> pData) : mData(std::move(pData)) {}
+
+  const T* Get() const { return mData.get(); }
+  const T& operator*() const { return *mData; }
+  const T* operator->() const { return mData.get(); }
+  explicit operator bool() const { return mData != nullptr; }
+
+  /** @return A reference to data that only this handle uses, copying the shared data the first time it is called */
+  T& GetMutable()
+  {
+    if (!mMutableData)
+    {
+      mMutableData = mData ? std::make_shared<T>(*mData) : std::make_shared<T>();
+      mData = mMutableData;
+    }
+
+    return *mMutableData;
+  }
+
+  /** @return \c true if the data has not been copied by GetMutable() */
+  bool IsShared() const { return !mMutableData; }
+
+  /** @return The shared data, e.g. to publish a modified copy with ISharedResourceRegistry::Set() */
+  std::shared_ptr<const T> GetPtr() const { return mData; }
+
+private:
+  std::shared_ptr<const T> mData;
+  std::shared_ptr<T> mMutableData;
+};
+
+/** A process-wide registry of immutable data that can be shared by all plug-in instances, such as lookup tables, impulse responses or decoded samples.
+ * Resources are created once, by the first instance that asks for them, and are identified by a key and their type.
+ * While any plug-in instance exists the registry keeps every resource alive, so that instances created later don't rebuild them.
+ * When the last instance is destroyed the registry lets go of them, and each one is freed as soon as nothing else refers to it.
+ * All methods are thread safe. The create functions run with the registry locked, and they may use the registry themselves */
+class ISharedResourceRegistry final
+{
+public:
+  /** Get a resource, creating it if it doesn't exist yet
+   * @param key Identifies the resource, together with T
+   * @param createFunc Called to create the resource if needed, must return a T* allocated with new, a std::unique_ptr<T> or a std::shared_ptr<T>
+   * @return The resource, or nullptr if createFunc returned nullptr */
+  template <class T, class CreateFunc>
+  static std::shared_ptr<const T> Get(const char* key, CreateFunc&& createFunc)
+  {
+    Storage& storage = GetStorage();
+    WDL_MutexLock lock(&storage.mMutex);
+
+    std::shared_ptr<const T> pData = Find<T>(storage, key);
+
+    if (!pData)
+    {
+      pData = std::shared_ptr<const T>(createFunc());
+
+      if (pData)
+        Set<T>(storage, key, pData);
+    }
+
+    return pData;
+  }
+
+  /** Get a resource, default constructing it if it doesn't exist yet
+   * @param key Identifies the resource, together with T
+   * @return The resource */
+  template <class T>
+  static std::shared_ptr<const T> Get(const char* key)
+  {
+    return Get<T>(key, []() { return new T(); });
+  }
+
+  /** Find a resource
+   * @param key Identifies the resource, together with T
+   * @return The resource, or nullptr if it doesn't exist */
+  template <class T>
+  static std::shared_ptr<const T> Find(const char* key)
+  {
+    Storage& storage = GetStorage();
+    WDL_MutexLock lock(&storage.mMutex);
+    return Find<T>(storage, key);
+  }
+
+  /** Publish a new version of a resource. Holders of the previous version keep using it until they get the resource again
+   * @param key Identifies the resource, together with T
+   * @param pData The new version */
+  template <class T>
+  static void Set(const char* key, std::shared_ptr<const T> pData)
+  {
+    Storage& storage = GetStorage();
+    WDL_MutexLock lock(&storage.mMutex);
+    Set<T>(storage, key, std::move(pData));
+  }
+
+  /** Remove a resource from the registry. It is freed once nothing else refers to it
+   * @param key Identifies the resource, together with T */
+  template <class T>
+  static void Remove(const char* key)
+  {
+    Storage& storage = GetStorage();
+    WDL_MutexLock lock(&storage.mMutex);
+    const int idx = FindEntry(storage, key, typeid(T));
+
+    if (idx >= 0)
+      storage.mEntries.Delete(idx, true);
+  }
+
+  /** Called by each plug-in instance when it is created */
+  static void RetainInstance()
+  {
+    Storage& storage = GetStorage();
+    WDL_MutexLock lock(&storage.mMutex);
+    storage.mNumInstances++;
+  }
+
+  /** Called by each plug-in instance when it is destroyed. When there are no instances left the registry stops keeping resources alive */
+  static void ReleaseInstance()
+  {
+    Storage& storage = GetStorage();
+    WDL_MutexLock lock(&storage.mMutex);
+
+    if (--storage.mNumInstances == 0)
+    {
+      for (auto i = storage.mEntries.GetSize() - 1; i >= 0; i--)
+      {
+        Entry* pEntry = storage.mEntries.Get(i);
+        pEntry->mStrong.reset();
+
+        if (pEntry->mWeak.expired())
+          storage.mEntries.Delete(i, true);
+      }
+    }
+  }
+
+  /** @return The number of plug-in instances that currently exist */
+  static int GetNumInstances()
+  {
+    Storage& storage = GetStorage();
+    WDL_MutexLock lock(&storage.mMutex);
+    return storage.mNumInstances;
+  }
+
+  /** @return The number of resources in the registry, including ones that are only kept alive by their users */
+  static int GetNumResources()
+  {
+    Storage& storage = GetStorage();
+    WDL_MutexLock lock(&storage.mMutex);
+    return storage.mEntries.GetSize();
+  }
+
+private:
+  struct Entry
+  {
+    WDL_String mKey;
+    const std::type_info* mType;
+    std::shared_ptr<const void> mStrong; // only set while there are instances
+    std::weak_ptr<const void> mWeak;
+  };
+
+  struct Storage
+  {
+    WDL_Mutex mMutex;
+    WDL_PtrList<Entry> mEntries;
+    int mNumInstances = 0;
+
+    ~Storage() { mEntries.Empty(true); }
+  };
+
+  static Storage& GetStorage()
+  {
+    static Storage sStorage;
+    return sStorage;
+  }
+
+  static int FindEntry(Storage& storage, const char* key, const std::type_info& type)
+  {
+    for (auto i = 0; i < storage.mEntries.GetSize(); i++)
+    {
+      const Entry* pEntry = storage.mEntries.Get(i);
+
+      if (*pEntry->mType == type && !strcmp(pEntry->mKey.Get(), key))
+        return i;
+    }
+
+    return -1;
+  }
+
+  template <class T>
+  static std::shared_ptr<const T> Find(Storage& storage, const char* key)
+  {
+    const int idx = FindEntry(storage, key, typeid(T));
+    return idx >= 0 ? std::static_pointer_cast<const T>(storage.mEntries.Get(idx)->mWeak.lock()) : nullptr;
+  }
+
+  template <class T>
+  static void Set(Storage& storage, const char* key, std::shared_ptr<const T> pData)
+  {
+    const int idx = FindEntry(storage, key, typeid(T));
+    Entry* pEntry = idx >= 0 ? storage.mEntries.Get(idx) : storage.mEntries.Add(new Entry);
+
+    pEntry->mKey.Set(key);
+    pEntry->mType = &typeid(T);
+    pEntry->mWeak = pData;
+    pEntry->mStrong = storage.mNumInstances > 0 ? std::shared_ptr<const void>(std::move(pData)) : nullptr;
+  }
+};
+
+END_IPLUG_NAMESPACE
@@ -0,0 +1,106 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+#pragma once
+
+/**
+ * @file
+ * @copydoc IPlugStartupProfile
+ */
+
+#include <chrono>
+
+#include "wdlstring.h"
+
+#include "IPlugPlatform.h"
+
+BEGIN_IPLUG_NAMESPACE
+
+/** Records how long each phase of creating a plug-in instance takes. Hosts create instances many times when scanning, so this shows where the time goes.
+ * IPluginBase, IPlugAPIBase and MakePlug() mark their own phases. A plug-in can split its constructor up further with IPluginBase::MarkStartupPhase() */
+class IPlugStartupProfile
+{
+public:
+  static constexpr int kMaxPhases = 32;
+
+  /** Reset the profile and start timing the first phase */
+  void Start()
+  {
+    mNumPhases = 0;
+    mLastMarkTime = Clock::now();
+  }
+
+  /** End the current phase and start the next one
+   * @param name The name of the phase that just ended. Must be a string literal or otherwise outlive the profile */
+  void Mark(const char* name)
+  {
+    const Clock::time_point now = Clock::now();
+    AddPhase(name, std::chrono::duration<double, std::milli>(now - mLastMarkTime).count());
+    mLastMarkTime = now;
+  }
+
+  /** Add a phase that happened later on, such as deferred initialization, without affecting the current phase
+   * @param name The name of the phase. Must be a string literal or otherwise outlive the profile
+   * @param durationMs The duration of the phase in milliseconds */
+  void AddPhase(const char* name, double durationMs)
+  {
+    if (mNumPhases < kMaxPhases)
+      mPhases[mNumPhases++] = { name, durationMs };
+  }
+
+  /** @return The number of phases recorded */
+  int NPhases() const { return mNumPhases; }
+
+  /** @param idx The index of the phase
+   * @return The name of the phase */
+  const char* GetPhaseName(int idx) const { return mPhases[idx].name; }
+
+  /** @param idx The index of the phase
+   * @return The duration of the phase in milliseconds */
+  double GetPhaseDuration(int idx) const { return mPhases[idx].durationMs; }
+
+  /** @return The sum of the durations of all phases in milliseconds */
+  double GetTotalDuration() const
+  {
+    double total = 0.;
+
+    for (auto i = 0; i < mNumPhases; i++)
+      total += mPhases[i].durationMs;
+
+    return total;
+  }
+
+  /** Get a human readable report, one phase per line
+   * @param str The string to write the report to */
+  void GetReport(WDL_String& str) const
+  {
+    str.Set("");
+
+    for (auto i = 0; i < mNumPhases; i++)
+      str.AppendFormatted(256, "%-32s %8.3f ms\n", mPhases[i].name, mPhases[i].durationMs);
+
+    str.AppendFormatted(256, "%-32s %8.3f ms\n", "Total", GetTotalDuration());
+  }
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  struct Phase
+  {
+    const char* name;
+    double durationMs;
+  };
+
+  Phase mPhases[kMaxPhases];
+  int mNumPhases = 0;
+  Clock::time_point mLastMarkTime;
+};
+
+END_IPLUG_NAMESPACE
@@ -209,6 +209,15 @@ public:
     return PutBytes(pRHS->GetData(), pRHS->Size());
   }
   
+  /** Makes sure that size more bytes can be added to the chunk without reallocating, use this before a lot of small Put() calls
+   * @param size The number of bytes that will be added */
+  inline void Reserve(int size)
+  {
+    int n = mBytes.GetSize();
+    mBytes.Resize(n + size, false);
+    mBytes.Resize(n, false);
+  }
+  
   /** Clears the chunk */
   inline void Clear()
   {
@@ -401,6 +410,8 @@ struct IChannelData
   TOUT** mData = nullptr; // If this is for an input channel, points into IPlugProcessor::mInData, if it's for an output channel points into IPlugProcessor::mOutData
   TIN* mIncomingData = nullptr;
   WDL_TypedBuf<TOUT> mScratchBuf;
+  TIN** mNativeData = nullptr; // Points into IPlugProcessor::mNativeData, only used when processing in the host's native precision
+  WDL_TypedBuf<TIN> mNativeScratchBuf; // Only allocated when processing in the host's native precision
   WDL_String mLabel = WDL_String("");
 };
 
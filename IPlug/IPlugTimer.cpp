@@ -13,6 +13,8 @@
  * @brief Timer implementation
  */
 
+#include <algorithm>
+
 #include "IPlugTimer.h"
 
 using namespace iplug;
@@ -117,4 +119,199 @@ void CALLBACK Timer_impl::TimerProc(HWND hwnd, UINT uMsg, UINT_PTR idEvent, DWOR
   }
 }
 
+#elif defined OS_LINUX
+
+Timer* Timer::Create(ITimerFunction func, uint32_t intervalMs)
+{
+  return new Timer_impl(func, intervalMs);
+}
+
+#endif
+
+#if !defined OS_WEB
+
+class TimerScheduler::ScheduledTimer : public Timer
+{
+public:
+  ScheduledTimer(ITimerFunction func, uint32_t intervalMs, EPriority priority, uint32_t maxIntervalMs)
+  : mTimerFunc(func)
+  , mIntervalMs(std::max(intervalMs, 1u))
+  , mMaxIntervalMs(std::max(maxIntervalMs, mIntervalMs))
+  , mCurrentIntervalMs(mIntervalMs)
+  , mPriority(priority)
+  {
+    TimerScheduler::Get().Add(this);
+  }
+
+  ~ScheduledTimer()
+  {
+    Stop();
+  }
+
+  void Stop() override
+  {
+    if (mScheduled)
+      TimerScheduler::Get().Remove(this);
+  }
+
+  void SetIdle() override { mIdle = true; }
+
+  ITimerFunction mTimerFunc;
+  uint32_t mIntervalMs;
+  uint32_t mMaxIntervalMs;
+  uint32_t mCurrentIntervalMs;
+  EPriority mPriority;
+  Clock::time_point mNextTime;
+  bool mIdle = false;
+  bool mScheduled = false;
+};
+
+Timer* Timer::CreateScheduled(ITimerFunction func, uint32_t intervalMs, EPriority priority, uint32_t maxIntervalMs)
+{
+  return new TimerScheduler::ScheduledTimer(func, intervalMs, priority, maxIntervalMs);
+}
+
+TimerScheduler& TimerScheduler::Get()
+{
+  static TimerScheduler sInstance;
+  return sInstance;
+}
+
+void TimerScheduler::Add(ScheduledTimer* pTimer)
+{
+  {
+    WDL_MutexLock lock(&mMutex);
+    int idx = 0;
+
+    while (idx < mTimers.GetSize() && mTimers.Get(idx)->mPriority <= pTimer->mPriority)
+      idx++;
+
+    pTimer->mNextTime = Clock::now() + std::chrono::milliseconds(pTimer->mIntervalMs);
+    pTimer->mScheduled = true;
+    mTimers.Insert(idx, pTimer);
+  }
+
+  UpdateTickInterval();
+}
+
+void TimerScheduler::Remove(ScheduledTimer* pTimer)
+{
+  {
+    WDL_MutexLock lock(&mMutex);
+    pTimer->mScheduled = false;
+    mTimers.DeletePtr(pTimer);
+  }
+
+  UpdateTickInterval();
+}
+
+void TimerScheduler::UpdateTickInterval(bool onTick)
+{
+  // Creating and stopping the platform timer can take a lock that is held while it calls OnTick() (see Timer_impl on Windows), which then takes mMutex.
+  // So mMutex is never held while the platform timer is replaced, and OnTick() leaves the update to its next call rather than wait for another thread that is replacing it
+  {
+    WDL_MutexLock lock(&mMutex);
+
+    if (mTickDepth > 0) // called by a timer function, OnTick() updates the platform timer once they have all been called
+    {
+      mTickIntervalChanged = true;
+      return;
+    }
+  }
+
+  std::unique_lock<std::mutex> platformTimerLock(mPlatformTimerMutex, std::defer_lock);
+
+  if (onTick)
+  {
+    if (!platformTimerLock.try_lock())
+      return; // mTickIntervalChanged is still set
+  }
+  else
+    platformTimerLock.lock();
+
+  uint32_t tickIntervalMs = 0;
+
+  {
+    WDL_MutexLock lock(&mMutex);
+    mTickIntervalChanged = false;
+
+    for (auto i = 0; i < mTimers.GetSize(); i++)
+    {
+      const uint32_t intervalMs = mTimers.Get(i)->mCurrentIntervalMs;
+
+      if (!tickIntervalMs || intervalMs < tickIntervalMs)
+        tickIntervalMs = intervalMs;
+    }
+  }
+
+  if (tickIntervalMs == mTickIntervalMs)
+    return;
+
+  mTickIntervalMs = tickIntervalMs;
+
+  // this may be called from OnTick(), i.e. from mTimer's own callback, so it is stopped but only deleted the next time round
+  if (mTimer)
+    mTimer->Stop();
+
+  mRetiredTimer = std::move(mTimer);
+
+  if (mTickIntervalMs)
+    mTimer = std::unique_ptr<Timer>(Timer::Create(std::bind(&TimerScheduler::OnTick, this, std::placeholders::_1), mTickIntervalMs));
+}
+
+void TimerScheduler::OnTick(Timer& t)
+{
+  mMutex.Enter();
+  const Clock::time_point tickStart = Clock::now();
+  // call timers that will be due before the middle of the next tick, so that none of them is more than half a tick late
+  const Clock::time_point dueTime = tickStart + std::chrono::milliseconds(mTickIntervalMs / 2);
+  const Clock::duration tickBudget = std::chrono::milliseconds(mTickIntervalMs);
+
+  WDL_PtrList<ScheduledTimer> dueTimers;
+
+  for (auto i = 0; i < mTimers.GetSize(); i++)
+  {
+    if (mTimers.Get(i)->mNextTime <= dueTime)
+      dueTimers.Add(mTimers.Get(i));
+  }
+
+  mTickDepth++;
+
+  for (auto i = 0; i < dueTimers.GetSize(); i++)
+  {
+    ScheduledTimer* pTimer = dueTimers.Get(i);
+
+    if (mTimers.Find(pTimer) < 0) // stopped by an earlier timer
+      continue;
+
+    if (pTimer->mPriority != Timer::kHighPriority && Clock::now() - tickStart > tickBudget)
+      break; // running late, the remaining timers stay due until the next tick
+
+    pTimer->mIdle = false;
+    pTimer->mTimerFunc(*pTimer);
+
+    if (mTimers.Find(pTimer) < 0) // stopped itself
+      continue;
+
+    const uint32_t previousIntervalMs = pTimer->mCurrentIntervalMs;
+
+    if (pTimer->mIdle)
+      pTimer->mCurrentIntervalMs = std::min(pTimer->mCurrentIntervalMs * 2, pTimer->mMaxIntervalMs);
+    else
+      pTimer->mCurrentIntervalMs = pTimer->mIntervalMs;
+
+    // the platform timer follows the timers as they slow down and speed up again
+    if (pTimer->mCurrentIntervalMs != previousIntervalMs)
+      mTickIntervalChanged = true;
+
+    pTimer->mNextTime = tickStart + std::chrono::milliseconds(pTimer->mCurrentIntervalMs);
+  }
+
+  const bool tickIntervalChanged = --mTickDepth == 0 && mTickIntervalChanged;
+  mMutex.Leave();
+
+  if (tickIntervalChanged)
+    UpdateTickInterval(true);
+}
+
 #endif
@@ -22,6 +22,10 @@
 #include <cstring>
 #include <cmath>
 #include <functional>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <atomic>
 #include "ptrlist.h"
 #include "mutex.h"
 
@@ -43,14 +47,30 @@ struct Timer
   
   using ITimerFunction = std::function<void(Timer& t)>;
 
+  enum EPriority
+  {
+    kHighPriority,
+    kNormalPriority,
+    kLowPriority
+  };
+
   static Timer* Create(ITimerFunction func, uint32_t intervalMs)
   {
     return new Timer();
   }
+
+  static Timer* CreateScheduled(ITimerFunction func, uint32_t intervalMs, EPriority priority = kNormalPriority, uint32_t maxIntervalMs = 0)
+  {
+    return new Timer();
+  }
   
   void Stop()
   {
   }
+
+  void SetIdle()
+  {
+  }
 };
 #else
 /** Base class for timer */
@@ -62,9 +82,75 @@ struct Timer
   
   using ITimerFunction = std::function<void(Timer& t)>;
 
+  /** The order in which scheduled timers that are due on the same tick are called. When a tick runs late, lower priority timers wait for the next one */
+  enum EPriority
+  {
+    kHighPriority,
+    kNormalPriority,
+    kLowPriority
+  };
+
+  /** Create a timer with its own platform timer */
   static Timer* Create(ITimerFunction func, uint32_t intervalMs);
+
+  /** Create a timer that is called by the TimerScheduler, which shares one platform timer between all scheduled timers in the process.
+   * It is called on the first scheduler tick after it is due, so it runs on the main thread just like a timer from Create()
+   * @param func The function to call
+   * @param intervalMs The interval in milliseconds
+   * @param priority The order in which timers that are due on the same tick are called
+   * @param maxIntervalMs If larger than intervalMs the timer slows down, up to this interval, while func calls SetIdle() */
+  static Timer* CreateScheduled(ITimerFunction func, uint32_t intervalMs, EPriority priority = kNormalPriority, uint32_t maxIntervalMs = 0);
+
   virtual ~Timer() {};
   virtual void Stop() = 0;
+
+  /** Call this from the timer function when there was nothing to do. A scheduled timer with a maxIntervalMs doubles its interval each time, and goes back to intervalMs as soon as a call doesn't call SetIdle() */
+  virtual void SetIdle() {}
+};
+
+/** Calls all the timers made with Timer::CreateScheduled() from a single platform timer, which ticks at the shortest current interval of any of them.
+ * Many plug-in instances each with their own timers would otherwise wake the main thread separately, and while all of them have slowed down with SetIdle(), so does the platform timer.
+ * The platform timer calls the timers on the main thread, but plug-in instances, and so their timers, can be created and deleted on any thread.
+ * A timer is never called again once deleting or stopping it has returned */
+class TimerScheduler
+{
+public:
+  static TimerScheduler& Get();
+
+  /** @return The number of scheduled timers */
+  int NTimers() const
+  {
+    WDL_MutexLock lock(&mMutex);
+    return mTimers.GetSize();
+  }
+
+  /** @return The interval of the platform timer in milliseconds, or 0 if there are no scheduled timers. This is the shortest current interval of the timers, so it grows while they are idle */
+  uint32_t GetTickInterval() const { return mTickIntervalMs; }
+
+private:
+  class ScheduledTimer;
+  using Clock = std::chrono::steady_clock;
+
+  TimerScheduler() = default;
+  TimerScheduler(const TimerScheduler&) = delete;
+  TimerScheduler& operator=(const TimerScheduler&) = delete;
+
+  void Add(ScheduledTimer* pTimer);
+  void Remove(ScheduledTimer* pTimer);
+  void UpdateTickInterval(bool onTick = false);
+  void OnTick(Timer& t);
+
+  mutable WDL_Mutex mMutex; // held while the timers are called, and by Add() and Remove()
+  WDL_PtrList<ScheduledTimer> mTimers; // in order of priority
+  int mTickDepth = 0; // > 0 while timer functions are being called
+  bool mTickIntervalChanged = false; // the platform timer can't be replaced while it is calling OnTick()
+
+  std::mutex mPlatformTimerMutex; // held while the platform timer is replaced, never together with mMutex
+  std::unique_ptr<Timer> mTimer;
+  std::unique_ptr<Timer> mRetiredTimer;
+  std::atomic<uint32_t> mTickIntervalMs {0};
+
+  friend struct Timer;
 };
 #endif
 
@@ -101,8 +187,16 @@ private:
   ITimerFunction mTimerFunc;
   uint32_t mIntervalMs;
 };
+#elif defined OS_LINUX
+/** There is no event loop on Linux yet, only the headless APP_OFFLINE renderer, so this timer never fires */
+class Timer_impl : public Timer
+{
+public:
+  Timer_impl(ITimerFunction func, uint32_t intervalMs) {}
+  void Stop() override {}
+};
 #elif defined OS_WEB
-#elif
+#else
   #error NOT IMPLEMENTED
 #endif
 
@@ -254,6 +254,18 @@
 
 BEGIN_IPLUG_NAMESPACE
 
+/** Called once the plug-in class has been constructed. Define IPLUG_PROFILE_STARTUP to print the time taken by each phase */
+static void OnPlugConstructed(IPluginBase* pPlug)
+{
+  pPlug->MarkStartupPhase("Plug-in constructor");
+  
+#ifdef IPLUG_PROFILE_STARTUP
+  WDL_String report;
+  pPlug->GetStartupProfile().GetReport(report);
+  DBGMSG("%s startup:\n%s", pPlug->GetPluginName(), report.Get());
+#endif
+}
+
 #pragma mark -
 #pragma mark VST2, VST3, AAX, AUv3, APP, WAM, WEB
 
@@ -265,7 +277,9 @@ Plugin* MakePlug(const InstanceInfo& info)
   static WDL_Mutex sMutex;
   WDL_MutexLock lock(&sMutex);
   
-  return new PLUG_CLASS_NAME(info);
+  PLUG_CLASS_NAME* pPlug = new PLUG_CLASS_NAME(info);
+  OnPlugConstructed(pPlug);
+  return pPlug;
 }
 
 #pragma mark - AUv2
@@ -276,10 +290,9 @@ Plugin* MakePlug(void* pMemory)
   InstanceInfo info;
   info.mCocoaViewFactoryClassName.Set(AUV2_VIEW_CLASS_STR);
     
-  if (pMemory)
-    return new(pMemory) PLUG_CLASS_NAME(info);
-  else
-    return new PLUG_CLASS_NAME(info);
+  PLUG_CLASS_NAME* pPlug = pMemory ? new(pMemory) PLUG_CLASS_NAME(info) : new PLUG_CLASS_NAME(info);
+  OnPlugConstructed(pPlug);
+  return pPlug;
 }
 
 #pragma mark - VST3 Controller
@@ -293,7 +306,9 @@ Steinberg::FUnknown* MakeController()
   info.mOtherGUID = Steinberg::FUID(PROC_GUID1, PROC_GUID2, VST3_GUID3, VST3_GUID4);
   //If you are trying to build a distributed VST3 plug-in and you hit an error here "no matching constructor...",
   //you need to replace all instances of PLUG_CLASS_NAME in your plug-in class, with the macro PLUG_CLASS_NAME
-  return static_cast<Steinberg::Vst::IEditController*>(new PLUG_CLASS_NAME(info));
+  PLUG_CLASS_NAME* pPlug = new PLUG_CLASS_NAME(info);
+  OnPlugConstructed(pPlug);
+  return static_cast<Steinberg::Vst::IEditController*>(pPlug);
 }
 
 #pragma mark - VST3 Processor
@@ -305,7 +320,9 @@ Steinberg::FUnknown* MakeProcessor()
   WDL_MutexLock lock(&sMutex);
   IPlugVST3Processor::InstanceInfo info;
   info.mOtherGUID = FUID(CTRL_GUID1, CTRL_GUID2, VST3_GUID3, VST3_GUID4);
-  return static_cast<Steinberg::Vst::IAudioProcessor*>(new PLUG_CLASS_NAME(info));
+  PLUG_CLASS_NAME* pPlug = new PLUG_CLASS_NAME(info);
+  OnPlugConstructed(pPlug);
+  return static_cast<Steinberg::Vst::IAudioProcessor*>(pPlug);
 }
 
 #else
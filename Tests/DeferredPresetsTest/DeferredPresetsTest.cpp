@@ -0,0 +1,133 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+/*
+  Checks that factory presets made with mMakePresetsFunc, the first time they are needed, are the same as presets made in the constructor,
+  even when the parameters have changed in between. Parameters that MakePresetFromNamedParams() doesn't name, and the presets made by
+  MakeDefaultPreset(), must get the default values rather than the current ones.
+
+  From this folder:
+  c++ -std=c++14 -O2 -DNO_IGRAPHICS -include cmath -I../../IPlug -I../../WDL DeferredPresetsTest.cpp ../../IPlug/IPlugPluginBase.cpp ../../IPlug/IPlugParameter.cpp -lpthread -o DeferredPresetsTest
+*/
+
+#include <cstdio>
+#include <cstring>
+
+#include "IPlugPluginBase.h"
+
+using namespace iplug;
+
+enum EParams
+{
+  kGain = 0,
+  kMix,
+  kMode,
+  kNumParams
+};
+
+enum EPresets
+{
+  kNamedPreset = 0,
+  kFullPreset,
+  kDefaultPreset,
+  kNumPresets
+};
+
+class TestPlugin : public IPluginBase
+{
+public:
+  TestPlugin(bool deferPresets)
+  : IPluginBase(kNumParams, kNumPresets)
+  {
+    GetParam(kGain)->InitDouble("Gain", 0.25, 0., 1., 0.01);
+    GetParam(kMix)->InitDouble("Mix", 0.5, 0., 1., 0.01);
+    GetParam(kMode)->InitInt("Mode", 1, 0, 3);
+
+    auto makePresets = [this]() {
+      MakePresetFromNamedParams("Named", 1, kMix, 0.9);
+      MakePreset("Full", 0.75, 0.125, 3);
+      MakeDefaultPreset("Default", 1);
+    };
+
+    if (deferPresets)
+      mMakePresetsFunc = makePresets;
+    else
+      makePresets();
+  }
+
+  void BeginInformHostOfParamChangeFromUI(int paramIdx) override {}
+  void EndInformHostOfParamChangeFromUI(int paramIdx) override {}
+
+  void SetValues(double gain, double mix, int mode)
+  {
+    GetParam(kGain)->Set(gain);
+    GetParam(kMix)->Set(mix);
+    GetParam(kMode)->Set(mode);
+  }
+};
+
+static int Compare(TestPlugin& deferred, TestPlugin& eager, int presetIdx)
+{
+  int errors = 0;
+
+  // move both away from the preset first, so that a preset that doesn't restore a parameter shows up
+  deferred.SetValues(1., 1., 2);
+  eager.SetValues(1., 1., 2);
+
+  if (!deferred.RestorePreset(presetIdx) || !eager.RestorePreset(presetIdx))
+  {
+    printf("preset %d: can't restore\n", presetIdx);
+    return 1;
+  }
+
+  for (auto p = 0; p < kNumParams; p++)
+  {
+    const double deferredValue = deferred.GetParam(p)->Value();
+    const double eagerValue = eager.GetParam(p)->Value();
+
+    if (deferredValue != eagerValue)
+    {
+      printf("preset %d (%s), %s: deferred %f, made in the constructor %f\n", presetIdx, eager.GetPresetName(presetIdx), eager.GetParam(p)->GetNameForHost(), deferredValue, eagerValue);
+      errors++;
+    }
+  }
+
+  return errors;
+}
+
+int main()
+{
+  TestPlugin eager(false);
+  TestPlugin deferred(true);
+  int errors = 0;
+
+  // the user or the host changes the parameters before anything asks for the presets
+  deferred.SetValues(0.5, 0.25, 2);
+
+  if (deferred.NPresets() != kNumPresets)
+  {
+    printf("deferred presets: %d presets, expected %d\n", deferred.NPresets(), kNumPresets);
+    errors++;
+  }
+
+  for (auto i = 0; i < kNumPresets; i++)
+  {
+    errors += Compare(deferred, eager, i);
+  }
+
+  if (strcmp(deferred.GetPresetName(kDefaultPreset), "Default"))
+  {
+    printf("deferred presets: preset %d is called %s\n", kDefaultPreset, deferred.GetPresetName(kDefaultPreset));
+    errors++;
+  }
+
+  printf("%s\n", errors ? "FAILED" : "OK");
+  return errors ? 1 : 0;
+}
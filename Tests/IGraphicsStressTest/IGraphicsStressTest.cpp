@@ -74,6 +74,18 @@ void IGraphicsStressTest::LayoutUI(IGraphics* pGraphics)
   pGraphics->AttachControl(new ILambdaControl(bounds, [&](ILambdaControl* pCaller, IGraphics& g, IRECT& r) {
     static IBitmap smiley = g.LoadBitmap(SMILEY_FN);
     static ISVG tiger = g.LoadSVG(TIGER_FN);
+    static constexpr int kNumDataPoints = 4096;
+    static float data[kNumDataPoints];
+    static bool dataInitialized = false;
+
+    if(!dataInitialized)
+    {
+      // a spectrum-like curve with noise, for the DrawData/FillData benchmarks
+      for (int i=0; i<kNumDataPoints; i++)
+        data[i] = 0.8f * std::pow(1.f - (float) i / kNumDataPoints, 3.f) + 0.2f * ((float) rand() / RAND_MAX);
+
+      dataInitialized = true;
+    }
     
     if(mKindOfThing == 0)
       g.DrawText(IText(40), "Press tab to go to next test, up/down to change the # of things", r);
@@ -107,6 +119,18 @@ void IGraphicsStressTest::LayoutUI(IGraphics* pGraphics)
           case 10: g.DrawDottedLine(rc, dir == 0 ? rr.L : rr.R, rr.B, dir == 0 ? rr.R : rr.L, rr.T, &rb, thickness); break;
           case 11: g.DrawFittedBitmap(smiley, rr, &rb); break;
           case 12: g.DrawSVG(tiger, rr); break;
+          case 13: g.DrawData(rc, rr, data, kNumDataPoints, nullptr, &rb, thickness); break;
+          case 14: g.FillData(rc, rr, data, kNumDataPoints, nullptr, &rb); break;
+          case 15:
+          {
+            // the same as test 13 without decimation, for comparison
+            g.PathClear();
+            g.PathMoveTo(rr.L, rr.B - rr.H() * data[0]);
+            for (int p=1; p<kNumDataPoints; p++)
+              g.PathLineTo(rr.L + rr.W() * (float) p / (kNumDataPoints - 1), rr.B - rr.H() * data[p]);
+            g.PathStroke(rc, thickness, IStrokeOptions(), &rb);
+            break;
+          }
           default:
             break;
         }
@@ -132,7 +156,7 @@ void IGraphicsStressTest::LayoutUI(IGraphics* pGraphics)
       switch (button) {
         case 0:
         {
-          static IPopupMenu menu {"Test", {"DrawRect", "FillRect", "DrawRoundRect", "FillRoundRect", "DrawEllipse", "FillEllipse", "DrawArc", "FillArc", "DrawLine", "DrawDottedLine", "DrawFittedBitmap", "DrawSVG"},
+          static IPopupMenu menu {"Test", {"DrawRect", "FillRect", "DrawRoundRect", "FillRoundRect", "DrawEllipse", "FillEllipse", "DrawArc", "FillArc", "DrawLine", "DrawDottedLine", "DrawFittedBitmap", "DrawSVG", "DrawData", "FillData", "DrawData (PathLineTo)"},
             [DoFunc](int indexInMenu, IPopupMenu::Item* itemChosen) {
               DoFunc(EFunc::Set, indexInMenu);
             }};
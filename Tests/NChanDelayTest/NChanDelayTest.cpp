@@ -0,0 +1,112 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+/*
+  Checks that NChanDelayLine delays every channel by exactly the delay time: output[n] == input[n - delay], and silence until the delay line has filled.
+  A ramp is fed through it in odd block sizes, shorter and longer than the delay, out of place and in place, while the delay time changes,
+  including to 0 and to times that are longer than the maximum, so that the buffer grows.
+
+  From this folder:
+  c++ -std=c++14 -O2 -I../../IPlug -I../../IPlug/Extras -I../../WDL NChanDelayTest.cpp -o NChanDelayTest
+*/
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "heapbuf.h"
+#include "NChanDelay.h"
+
+using namespace iplug;
+
+static const int kNumChans = 3;
+static const int kBlockSizes[] = {1, 7, 64, 3, 511, 13, 1024, 2, 97};
+static const int kDelayTimes[] = {5, 0, 64, 1, 300, 2000, 77};
+static const int kFramesPerDelayTime = 6000;
+
+/** The input of channel c at frame n, exactly representable in a float */
+static float Input(int c, int n)
+{
+  return (float) (n + 1 + c * 1000000);
+}
+
+static int Run(bool inPlace)
+{
+  NChanDelayLine<float> delay(kNumChans, kNumChans, 100);
+
+  std::vector<float> in[kNumChans], out[kNumChans];
+  float* inputs[kNumChans];
+  float* outputs[kNumChans];
+  int errors = 0;
+  int frame = 0;
+  int block = 0;
+
+  for (auto c = 0; c < kNumChans; c++)
+  {
+    in[c].resize(1024);
+    out[c].resize(1024);
+    inputs[c] = in[c].data();
+    outputs[c] = inPlace ? in[c].data() : out[c].data();
+  }
+
+  for (auto delayTime : kDelayTimes)
+  {
+    delay.SetDelayTime(delayTime);
+
+    if (delay.GetDelayTime() != delayTime)
+      errors++;
+
+    // the delay line is cleared when the delay time changes
+    const int startFrame = frame;
+
+    while (frame < startFrame + kFramesPerDelayTime)
+    {
+      const int nFrames = kBlockSizes[block++ % (sizeof(kBlockSizes) / sizeof(kBlockSizes[0]))];
+
+      for (auto c = 0; c < kNumChans; c++)
+      {
+        for (auto s = 0; s < nFrames; s++)
+          in[c][s] = Input(c, frame + s);
+      }
+
+      delay.ProcessBlock(inputs, outputs, nFrames);
+
+      for (auto c = 0; c < kNumChans; c++)
+      {
+        for (auto s = 0; s < nFrames; s++)
+        {
+          const int n = frame + s;
+          const float expected = (n - startFrame >= delayTime) ? Input(c, n - delayTime) : 0.f;
+
+          if (outputs[c][s] != expected)
+          {
+            if (errors < 10)
+              printf("%s, delay %d, channel %d, frame %d: %g, expected %g\n", inPlace ? "in place" : "out of place", delayTime, c, n, outputs[c][s], expected);
+
+            errors++;
+          }
+        }
+      }
+
+      frame += nFrames;
+    }
+  }
+
+  return errors;
+}
+
+int main()
+{
+  const int errors = Run(false) + Run(true);
+
+  printf("%s\n", errors ? "FAILED" : "OK");
+
+  return errors ? 1 : 0;
+}
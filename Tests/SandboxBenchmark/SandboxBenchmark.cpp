@@ -0,0 +1,260 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+/*
+  Measures the round trip time of a block through an IPlugSandboxHost and its helper process, and the audio throughput, at a few block sizes.
+  Also checks that the helper processes the audio and parameter changes, that MIDI offsets are relative to each part of a block that is longer than maxFrames,
+  and that the helper can be stopped and relaunched while the audio thread is processing.
+  The program is its own helper: it launches itself with the sandbox argument. Linux only.
+
+  From this folder:
+  c++ -std=c++14 -O2 -I../../IPlug -I../../IPlug/Extras/Sandbox -I../../WDL SandboxBenchmark.cpp -o SandboxBenchmark -lpthread -lrt
+*/
+
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "IPlugSandbox.h"
+
+using namespace iplug;
+using Clock = std::chrono::steady_clock;
+
+static const int kNumChans = 2;
+static const int kMaxFrames = 4096;
+static const int kNumBlocks = 20000;
+
+/** A gain, which sends back each MIDI message from the part of the block that it arrived in. The velocity is 99, or 0 if the offset was outside the part */
+class GainDSP : public ISandboxDSP
+{
+public:
+  void OnParamChange(int paramIdx, double value) override
+  {
+    if (paramIdx == 0)
+      mGain = value;
+  }
+
+  void ProcessMidiMsg(const IMidiMsg& msg) override
+  {
+    mMidi.push_back(msg);
+  }
+
+  void ProcessBlock(sample** inputs, sample** outputs, int nFrames) override
+  {
+    for (auto c = 0; c < kNumChans; c++)
+    {
+      for (auto s = 0; s < nFrames; s++)
+        outputs[c][s] = inputs[c][s] * mGain;
+    }
+
+    for (auto msg : mMidi)
+    {
+      msg.mData2 = msg.mOffset >= 0 && msg.mOffset < nFrames ? 99 : 0;
+      SendMidiMsg(msg);
+    }
+
+    mMidi.clear();
+  }
+
+private:
+  double mGain = 1.;
+  std::vector<IMidiMsg> mMidi;
+};
+
+static int CheckProcessing(IPlugSandboxHost& host)
+{
+  int errors = 0;
+  const int nFrames = 10000;
+  std::vector<sample> in[kNumChans], out[kNumChans];
+  sample* inputs[kNumChans];
+  sample* outputs[kNumChans];
+
+  for (auto c = 0; c < kNumChans; c++)
+  {
+    in[c].resize(nFrames);
+    out[c].resize(nFrames);
+    inputs[c] = in[c].data();
+    outputs[c] = out[c].data();
+
+    for (auto s = 0; s < nFrames; s++)
+      in[c][s] = s + c;
+  }
+
+  host.SetParameter(0, 0.5);
+
+  const int offsets[] = {5, 4095, 4096, 9000, 9999};
+
+  for (auto offset : offsets)
+  {
+    IMidiMsg msg;
+    msg.MakeNoteOnMsg(60, 100, offset);
+    host.SendMidiMsg(msg);
+  }
+
+  if (!host.ProcessBlock(inputs, outputs, nFrames))
+    errors++;
+
+  for (auto c = 0; c < kNumChans; c++)
+  {
+    for (auto s = 0; s < nFrames; s++)
+    {
+      if (out[c][s] != (s + c) * 0.5)
+        errors++;
+    }
+  }
+
+  IMidiMsg msg;
+  int nMsgs = 0;
+
+  while (host.PopMidiMsg(msg))
+  {
+    if (nMsgs >= static_cast<int>(sizeof(offsets) / sizeof(offsets[0])) || msg.mOffset != offsets[nMsgs] || msg.mData2 != 99)
+    {
+      printf("MIDI message %d: offset %d velocity %d\n", nMsgs, msg.mOffset, msg.mData2);
+      errors++;
+    }
+
+    nMsgs++;
+  }
+
+  if (nMsgs != static_cast<int>(sizeof(offsets) / sizeof(offsets[0])))
+    errors++;
+
+  host.SetParameter(0, 1.);
+  return errors;
+}
+
+static void Benchmark(IPlugSandboxHost& host, int nFrames)
+{
+  std::vector<sample> buffers[kNumChans];
+  sample* channels[kNumChans];
+
+  for (auto c = 0; c < kNumChans; c++)
+  {
+    buffers[c].resize(nFrames);
+    channels[c] = buffers[c].data();
+  }
+
+  std::vector<double> times(kNumBlocks);
+  const int64_t missedBefore = host.GetNumMissedBlocks();
+
+  for (auto i = 0; i < kNumBlocks; i++)
+  {
+    const Clock::time_point start = Clock::now();
+    host.ProcessBlock(channels, channels, nFrames);
+    times[i] = std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+  }
+
+  double total = 0.;
+
+  for (auto t : times)
+    total += t;
+
+  std::sort(times.begin(), times.end());
+
+  // the audio goes both ways
+  const double megabytes = static_cast<double>(kNumBlocks) * nFrames * kNumChans * 2 * sizeof(sample) / 1e6;
+
+  printf("%5d frames: median %.1f us, 99th percentile %.1f us, %.0f blocks/s, %.0f MB/s, %lld missed\n", nFrames, times[kNumBlocks / 2], times[kNumBlocks * 99 / 100],
+         kNumBlocks / (total * 1e-6), megabytes / (total * 1e-6), static_cast<long long>(host.GetNumMissedBlocks() - missedBefore));
+}
+
+/** Process on one thread while another stops and relaunches the helper, which must not unmap the shared memory under the audio thread */
+static int CheckRelaunch(IPlugSandboxHost& host, const char* helperPath)
+{
+  std::atomic<bool> done {false};
+  int errors = 0;
+
+  std::thread audioThread([&]() {
+    std::vector<sample> buffers[kNumChans];
+    sample* channels[kNumChans];
+
+    for (auto c = 0; c < kNumChans; c++)
+    {
+      buffers[c].resize(256);
+      channels[c] = buffers[c].data();
+    }
+
+    IMidiMsg msg;
+    msg.MakeNoteOnMsg(60, 100, 10);
+
+    while (!done)
+    {
+      host.SetParameter(0, 1.);
+      host.SendMidiMsg(msg);
+      host.ProcessBlock(channels, channels, 256);
+
+      while (host.PopMidiMsg(msg)) {}
+    }
+  });
+
+  for (auto i = 0; i < 20; i++)
+  {
+    if (!host.Launch(helperPath))
+      errors++;
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+
+  done = true;
+  audioThread.join();
+  return errors;
+}
+
+int main(int argc, const char** argv)
+{
+  GainDSP dsp;
+
+  for (auto i = 1; i < argc; i++)
+  {
+    if (!strcmp(argv[i], kSandboxArg))
+      return RunSandboxServer(argc, argv, dsp);
+  }
+
+  const char* helperPath = "/proc/self/exe";
+  char path[4096];
+  const ssize_t pathLength = readlink(helperPath, path, sizeof(path) - 1);
+
+  if (pathLength > 0)
+  {
+    path[pathLength] = 0;
+    helperPath = path;
+  }
+
+  IPlugSandboxHost host(kNumChans, kNumChans, kMaxFrames);
+  host.SetTimeout(100.);
+  host.Reset(48000., 512);
+
+  if (!host.Launch(helperPath))
+  {
+    printf("couldn't launch %s\n", helperPath);
+    return 1;
+  }
+
+  int errors = CheckProcessing(host);
+
+  for (auto nFrames : {64, 256, 1024, 4096})
+    Benchmark(host, nFrames);
+
+  errors += CheckRelaunch(host, helperPath);
+  errors += CheckProcessing(host);
+
+  host.Stop();
+
+  if (host.IsRunning())
+    errors++;
+
+  printf("%s\n", errors ? "FAILED" : "OK");
+
+  return errors ? 1 : 0;
+}
@@ -0,0 +1,120 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+/*
+  Measures the size of a typical plug-in state stored with ICompressedChunk, and the time it takes to save and restore it, at a few zlib levels.
+  Also checks that the state round trips, and that corrupted or truncated chunks are rejected.
+  The state is 3000 parameter values, as SerializeParams() writes them, plus 200 KB of custom data.
+
+  From this folder:
+  cc -O2 -c ../../WDL/zlib/{adler32,compress,crc32,deflate,inffast,inflate,inftrees,trees,uncompr,zutil}.c
+  c++ -std=c++14 -O2 -I../../IPlug -I../../IPlug/Extras -I../../WDL StateChunkBenchmark.cpp *.o -o StateChunkBenchmark
+*/
+
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <climits>
+#include <memory>
+#include <functional>
+#include <chrono>
+#include <vector>
+
+#include "IPlugStructs.h"
+#include "CompressedChunk.h"
+
+using namespace iplug;
+using Clock = std::chrono::steady_clock;
+
+static const int kNumParams = 3000;
+static const int kCustomSize = 200000;
+static const int kRepeats = 20;
+
+static double MicrosecondsSince(Clock::time_point start, int repeats)
+{
+  return std::chrono::duration<double, std::micro>(Clock::now() - start).count() / repeats;
+}
+
+int main()
+{
+  int errors = 0;
+
+  IByteChunk state;
+
+  for (auto i = 0; i < kNumParams; i++)
+  {
+    double value = (i % 17) * 0.25;
+    state.Put(&value);
+  }
+
+  std::vector<char> custom(kCustomSize);
+
+  for (size_t i = 0; i < custom.size(); i++)
+    custom[i] = (char) ((i * 7) % 61);
+
+  state.PutBytes(custom.data(), (int) custom.size());
+
+  printf("state: %d bytes\n", state.Size());
+
+  for (auto level : {1, 6, 9})
+  {
+    IByteChunk chunk;
+
+    Clock::time_point start = Clock::now();
+
+    for (auto r = 0; r < kRepeats; r++)
+    {
+      chunk.Clear();
+
+      if (!ICompressedChunk::Put(chunk, state, 3, level))
+        errors++;
+    }
+
+    const double saveTime = MicrosecondsSince(start, kRepeats);
+
+    IByteChunk restored;
+    int stateVersion = 0;
+    int endPos = 0;
+
+    start = Clock::now();
+
+    for (auto r = 0; r < kRepeats; r++)
+      endPos = ICompressedChunk::Get(chunk, 0, restored, &stateVersion);
+
+    const double restoreTime = MicrosecondsSince(start, kRepeats);
+
+    if (endPos != chunk.Size() || stateVersion != 3 || !restored.IsEqual(state) || !ICompressedChunk::IsCompressed(chunk, 0))
+      errors++;
+
+    printf("level %d: %d bytes, save %.1f us, restore %.1f us\n", level, chunk.Size(), saveTime, restoreTime);
+
+    chunk.GetData()[chunk.Size() - 3] ^= 0x55;
+
+    if (ICompressedChunk::Get(chunk, 0, restored) != -1)
+      errors++;
+
+    chunk.Resize(chunk.Size() - 5);
+
+    if (ICompressedChunk::Get(chunk, 0, restored) != -1)
+      errors++;
+  }
+
+  if (ICompressedChunk::IsCompressed(state, 0))
+    errors++;
+
+  IByteChunk empty, chunk, restored;
+
+  if (!ICompressedChunk::Put(chunk, empty) || ICompressedChunk::Get(chunk, 0, restored) != chunk.Size() || restored.Size() != 0)
+    errors++;
+
+  printf("%s\n", errors ? "FAILED" : "OK");
+
+  return errors ? 1 : 0;
+}
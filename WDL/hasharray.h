@@ -0,0 +1,385 @@
+#ifndef _WDL_HASHARRAY_H_
+#define _WDL_HASHARRAY_H_
+
+#include "heapbuf.h"
+
+
+// WDL_HashArrayImpl has the same interface shape as WDL_AssocArrayImpl (GetPtr/Exists/Insert/Delete/Enumerate),
+// but is an open-addressing hash table (linear probing, backward-shift deletion), so lookups, inserts and
+// deletes are O(1) on average rather than a binary search plus a memmove.
+//
+// differences from WDL_AssocArrayImpl:
+//   - entries are enumerated in insertion order, not sorted. Delete() moves the last entry into the hole,
+//     so indices from Insert()/GetIdx() are only valid until the next Delete()
+//   - it takes a hash function as well as the compare function, which only needs to return 0 for equal keys.
+//     keys that compare equal must hash equal
+//
+// if valdispose is set, the array will dispose of values as needed.
+// if keydup/keydispose are set, copies of (any) key data will be made/destroyed as necessary
+
+template <class KEY, class VAL> class WDL_HashArrayImpl
+{
+  WDL_HashArrayImpl(const WDL_HashArrayImpl &cp);
+  WDL_HashArrayImpl &operator=(const WDL_HashArrayImpl &cp);
+
+public:
+
+  explicit WDL_HashArrayImpl(unsigned int (*keyhash)(KEY k), int (*keycmp)(KEY *k1, KEY *k2), KEY (*keydup)(KEY)=0, void (*keydispose)(KEY)=0, void (*valdispose)(VAL)=0)
+  {
+    m_keyhash = keyhash;
+    m_keycmp = keycmp;
+    m_keydup = keydup;
+    m_keydispose = keydispose;
+    m_valdispose = valdispose;
+  }
+
+  ~WDL_HashArrayImpl()
+  {
+    DeleteAll();
+  }
+
+  VAL* GetPtr(KEY key, KEY *keyPtrOut=NULL) const
+  {
+    const int i = GetIdx(key);
+    if (i >= 0)
+    {
+      KeyVal* kv = m_data.Get()+i;
+      if (keyPtrOut) *keyPtrOut = kv->key;
+      return &(kv->val);
+    }
+    return 0;
+  }
+
+  bool Exists(KEY key) const
+  {
+    return GetIdx(key) >= 0;
+  }
+
+  int Insert(KEY key, VAL val)
+  {
+    const unsigned int hash = m_keyhash(key);
+    bool ismatch = false;
+    int s = FindSlot(key, hash, &ismatch);
+    if (ismatch)
+    {
+      const int i = m_slots.Get()[s].idx;
+      KeyVal* kv = m_data.Get()+i;
+      if (m_valdispose) m_valdispose(kv->val);
+      kv->val = val;
+      return i;
+    }
+
+    // keep the table at most 3/4 full, so that probe sequences stay short
+    if ((m_data.GetSize()+1)*4 > m_slots.GetSize()*3)
+    {
+      Rehash(m_slots.GetSize() ? m_slots.GetSize()*2 : 16);
+      s = FindSlot(key, hash, &ismatch);
+    }
+
+    const int i = m_data.GetSize();
+    KeyVal* kv = m_data.Resize(i+1)+i;
+    if (m_keydup) key = m_keydup(key);
+    kv->key = key;
+    kv->val = val;
+    kv->hash = hash;
+
+    Slot* slot = m_slots.Get()+s;
+    slot->hash = hash;
+    slot->idx = i;
+    return i;
+  }
+
+  void Delete(KEY key)
+  {
+    DeleteByIndex(GetIdx(key));
+  }
+
+  void DeleteByIndex(int idx)
+  {
+    if (idx >= 0 && idx < m_data.GetSize())
+    {
+      KeyVal* kv = m_data.Get()+idx;
+      if (m_keydispose) m_keydispose(kv->key);
+      if (m_valdispose) m_valdispose(kv->val);
+      RemoveSlot(FindSlotByIndex(idx));
+
+      // move the last entry into the hole
+      const int last = m_data.GetSize()-1;
+      if (idx != last)
+      {
+        m_slots.Get()[FindSlotByIndex(last)].idx = idx;
+        *kv = m_data.Get()[last];
+      }
+      m_data.Resize(last, false);
+    }
+  }
+
+  void DeleteAll(bool resizedown=false)
+  {
+    if (m_keydispose || m_valdispose)
+    {
+      int i;
+      for (i = 0; i < m_data.GetSize(); ++i)
+      {
+        KeyVal* kv = m_data.Get()+i;
+        if (m_keydispose) m_keydispose(kv->key);
+        if (m_valdispose) m_valdispose(kv->val);
+      }
+    }
+    m_data.Resize(0, resizedown);
+    if (resizedown) m_slots.Resize(0, true);
+    else ClearSlots();
+  }
+
+  int GetSize() const
+  {
+    return m_data.GetSize();
+  }
+
+  VAL* EnumeratePtr(int i, KEY* key=0) const
+  {
+    if (i >= 0 && i < m_data.GetSize())
+    {
+      KeyVal* kv = m_data.Get()+i;
+      if (key) *key = kv->key;
+      return &(kv->val);
+    }
+    return 0;
+  }
+
+  KEY* ReverseLookupPtr(VAL val) const
+  {
+    int i;
+    for (i = 0; i < m_data.GetSize(); ++i)
+    {
+      KeyVal* kv = m_data.Get()+i;
+      if (kv->val == val) return &kv->key;
+    }
+    return 0;
+  }
+
+  void ChangeKey(KEY oldkey, KEY newkey)
+  {
+    int i = GetIdx(oldkey);
+    if (i >= 0)
+    {
+      // an entry that already has newkey is replaced
+      const int existing = GetIdx(newkey);
+      if (existing >= 0 && existing != i)
+      {
+        DeleteByIndex(existing);
+        i = GetIdx(oldkey);
+      }
+
+      KeyVal* kv = m_data.Get()+i;
+      RemoveSlot(FindSlotByIndex(i));
+      if (m_keydispose) m_keydispose(kv->key);
+      if (m_keydup) newkey = m_keydup(newkey);
+      kv->key = newkey;
+      kv->hash = m_keyhash(newkey);
+
+      bool ismatch = false;
+      Slot* slot = m_slots.Get()+FindSlot(newkey, kv->hash, &ismatch);
+      slot->hash = kv->hash;
+      slot->idx = i;
+    }
+  }
+
+  int GetIdx(KEY key) const
+  {
+    bool ismatch = false;
+    const int s = FindSlot(key, m_keyhash(key), &ismatch);
+    if (ismatch) return m_slots.Get()[s].idx;
+    return -1;
+  }
+
+  // allocate for n entries, to avoid rehashing while adding them
+  void Reserve(int n)
+  {
+    int sz = 16;
+    while (sz*3 < n*4) sz *= 2;
+    if (sz > m_slots.GetSize()) Rehash(sz);
+    const int cnt = m_data.GetSize();
+    if (n > cnt)
+    {
+      m_data.Resize(n, false);
+      m_data.Resize(cnt, false);
+    }
+  }
+
+  void SetGranul(int gran)
+  {
+    m_data.SetGranul(gran);
+  }
+
+protected:
+
+  struct KeyVal
+  {
+    KEY key;
+    VAL val;
+    unsigned int hash;
+  };
+
+  // the hash is kept in the slot too, so that probing rarely touches the entries
+  struct Slot
+  {
+    unsigned int hash;
+    int idx; // index in m_data, or -1 if the slot is empty
+  };
+
+  // returns the slot of key, or the empty slot where it would go. the table must not be full
+  int FindSlot(KEY key, unsigned int hash, bool* ismatch) const
+  {
+    *ismatch = false;
+    if (!m_slots.GetSize()) return -1;
+
+    const int mask = m_slots.GetSize()-1;
+    const Slot* slots = m_slots.Get();
+    int s = (int) (hash & mask);
+    while (slots[s].idx >= 0)
+    {
+      if (slots[s].hash == hash && !m_keycmp(&key, &m_data.Get()[slots[s].idx].key))
+      {
+        *ismatch = true;
+        break;
+      }
+      s = (s+1) & mask;
+    }
+    return s;
+  }
+
+  int FindSlotByIndex(int idx) const
+  {
+    const int mask = m_slots.GetSize()-1;
+    const Slot* slots = m_slots.Get();
+    int s = (int) (m_data.Get()[idx].hash & mask);
+    while (slots[s].idx != idx) s = (s+1) & mask;
+    return s;
+  }
+
+  // empties a slot, moving back the entries after it that would otherwise no longer be found
+  void RemoveSlot(int s)
+  {
+    const int mask = m_slots.GetSize()-1;
+    Slot* slots = m_slots.Get();
+    int j = s;
+    for (;;)
+    {
+      j = (j+1) & mask;
+      if (slots[j].idx < 0) break;
+
+      // an entry can move back to s unless its home slot is cyclically in (s, j]
+      const int home = (int) (slots[j].hash & mask);
+      if (s <= j ? (s < home && home <= j) : (s < home || home <= j)) continue;
+
+      slots[s] = slots[j];
+      s = j;
+    }
+    slots[s].idx = -1;
+  }
+
+  void ClearSlots()
+  {
+    Slot* slots = m_slots.Get();
+    int s;
+    for (s = 0; s < m_slots.GetSize(); ++s) slots[s].idx = -1;
+  }
+
+  void Rehash(int newsize)
+  {
+    m_slots.Resize(newsize, false);
+    ClearSlots();
+
+    const int mask = newsize-1;
+    Slot* slots = m_slots.Get();
+    int i;
+    for (i = 0; i < m_data.GetSize(); ++i)
+    {
+      const unsigned int hash = m_data.Get()[i].hash;
+      int s = (int) (hash & mask);
+      while (slots[s].idx >= 0) s = (s+1) & mask;
+      slots[s].hash = hash;
+      slots[s].idx = i;
+    }
+  }
+
+  WDL_TypedBuf<KeyVal> m_data;
+  WDL_TypedBuf<Slot> m_slots; // size is 0 or a power of 2
+
+  unsigned int (*m_keyhash)(KEY k);
+  int (*m_keycmp)(KEY *k1, KEY *k2);
+  KEY (*m_keydup)(KEY);
+  void (*m_keydispose)(KEY);
+  void (*m_valdispose)(VAL);
+
+};
+
+
+// WDL_HashArray adds useful functions but cannot contain structs for keys or values
+template <class KEY, class VAL> class WDL_HashArray : public WDL_HashArrayImpl<KEY, VAL>
+{
+public:
+
+  explicit WDL_HashArray(unsigned int (*keyhash)(KEY k), int (*keycmp)(KEY *k1, KEY *k2), KEY (*keydup)(KEY)=0, void (*keydispose)(KEY)=0, void (*valdispose)(VAL)=0)
+  : WDL_HashArrayImpl<KEY, VAL>(keyhash, keycmp, keydup, keydispose, valdispose)
+  {
+  }
+
+  VAL Get(KEY key, VAL notfound=0) const
+  {
+    VAL* p = this->GetPtr(key);
+    if (p) return *p;
+    return notfound;
+  }
+
+  VAL Enumerate(int i, KEY* key=0, VAL notfound=0) const
+  {
+    VAL* p = this->EnumeratePtr(i, key);
+    if (p) return *p;
+    return notfound;
+  }
+
+  KEY ReverseLookup(VAL val, KEY notfound=0) const
+  {
+    KEY* p=this->ReverseLookupPtr(val);
+    if (p) return *p;
+    return notfound;
+  }
+};
+
+
+template <class VAL> class WDL_IntKeyedHashArray : public WDL_HashArray<int, VAL>
+{
+public:
+
+  explicit WDL_IntKeyedHashArray(void (*valdispose)(VAL)=0) : WDL_HashArray<int, VAL>(hashint, cmpint, NULL, NULL, valdispose) {}
+  ~WDL_IntKeyedHashArray() {}
+
+private:
+
+  // the table uses the low bits, so mix the high bits down
+  static unsigned int hashint(int i) { unsigned int h = (unsigned int) i * 0x9E3779B9u; return h ^ (h >> 16); }
+  static int cmpint(int *i1, int *i2) { return *i1-*i2; }
+};
+
+
+template <class VAL> class WDL_StringKeyedHashArray : public WDL_HashArray<const char *, VAL>
+{
+public:
+
+  explicit WDL_StringKeyedHashArray(bool caseSensitive=true, void (*valdispose)(VAL)=0) : WDL_HashArray<const char*, VAL>(caseSensitive?hashstr:hashistr, caseSensitive?cmpstr:cmpistr, dupstr, freestr, valdispose) {}
+
+  ~WDL_StringKeyedHashArray() { }
+
+  // FNV-1a. the case insensitive version folds ASCII letters, as stricmp does
+  static unsigned int hashstr(const char *s) { unsigned int h = 2166136261u; while (*s) { h ^= (unsigned char) *s++; h *= 16777619u; } return h ^ (h >> 15); }
+  static unsigned int hashistr(const char *s) { unsigned int h = 2166136261u; while (*s) { unsigned char c = (unsigned char) *s++; if (c >= 'a' && c <= 'z') c += 'A'-'a'; h ^= c; h *= 16777619u; } return h ^ (h >> 15); }
+  static const char *dupstr(const char *s) { return strdup(s);  }
+  static int cmpstr(const char **s1, const char **s2) { return strcmp(*s1, *s2); }
+  static int cmpistr(const char **a, const char **b) { return stricmp(*a,*b); }
+  static void freestr(const char* s) { free((void*)s); }
+};
+
+
+#endif
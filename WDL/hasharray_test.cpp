@@ -0,0 +1,129 @@
+// benchmark of WDL_HashArray against WDL_AssocArray, with string and int keys: insert, lookup (hits and misses), delete.
+// also checks that both give the same results.
+//
+// c++ -O2 hasharray_test.cpp -o hasharray_test
+// ./hasharray_test [maxsize]
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <chrono>
+
+#include "wdltypes.h"
+#include "assocarray.h"
+#include "hasharray.h"
+
+static double now_us()
+{
+  return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static int g_bad;
+
+template <class ARR> static void run_str(const char *name, ARR &arr, int n, char **keys, char **misses, int reps)
+{
+  double t0=now_us();
+  int x;
+  for (x=0;x<n;x++) arr.Insert(keys[x],x);
+  double t1=now_us();
+
+  int found=0;
+  for (int r=0;r<reps;r++)
+    for (x=0;x<n;x++)
+    {
+      int *p=arr.GetPtr(keys[x]);
+      if (p && *p==x) found++;
+    }
+  double t2=now_us();
+
+  for (int r=0;r<reps;r++)
+    for (x=0;x<n;x++) if (arr.GetPtr(misses[x])) g_bad++;
+  double t3=now_us();
+
+  for (x=0;x<n;x+=2) arr.Delete(keys[x]);
+  double t4=now_us();
+
+  if (found != n*reps || arr.GetSize() != n/2) g_bad++;
+  for (x=0;x<n;x++) if ((arr.GetPtr(keys[x])!=NULL) != (x&1)) g_bad++;
+
+  printf("%-26s %7d: insert %7.1f ns  hit %6.1f ns  miss %6.1f ns  delete %7.1f ns\n",name,n,
+    (t1-t0)*1000.0/n,(t2-t1)*1000.0/(n*reps),(t3-t2)*1000.0/(n*reps),(t4-t3)*1000.0/((n+1)/2));
+}
+
+template <class ARR> static void run_int(const char *name, ARR &arr, int n, int reps)
+{
+  // spread out keys, so that they don't arrive in sorted order
+  #define KEY(x) ((int) (((unsigned int) (x) * 2654435761u) >> 1))
+  double t0=now_us();
+  int x;
+  for (x=0;x<n;x++) arr.Insert(KEY(x),x);
+  double t1=now_us();
+
+  int found=0;
+  for (int r=0;r<reps;r++)
+    for (x=0;x<n;x++)
+    {
+      int *p=arr.GetPtr(KEY(x));
+      if (p && *p==x) found++;
+    }
+  double t2=now_us();
+
+  for (int r=0;r<reps;r++)
+    for (x=0;x<n;x++) if (arr.GetPtr(KEY(x+n))) g_bad++;
+  double t3=now_us();
+
+  for (x=0;x<n;x+=2) arr.Delete(KEY(x));
+  double t4=now_us();
+
+  if (found != n*reps || arr.GetSize() != n/2) g_bad++;
+  for (x=0;x<n;x++) if ((arr.GetPtr(KEY(x))!=NULL) != (x&1)) g_bad++;
+  #undef KEY
+
+  printf("%-26s %7d: insert %7.1f ns  hit %6.1f ns  miss %6.1f ns  delete %7.1f ns\n",name,n,
+    (t1-t0)*1000.0/n,(t2-t1)*1000.0/(n*reps),(t3-t2)*1000.0/(n*reps),(t4-t3)*1000.0/((n+1)/2));
+}
+
+int main(int argc, char **argv)
+{
+  const int maxn = argc>1 ? atoi(argv[1]) : 100000;
+  char **keys=(char **)malloc(maxn*sizeof(char*));
+  char **misses=(char **)malloc(maxn*sizeof(char*));
+  int x;
+  for (x=0;x<maxn;x++)
+  {
+    char buf[64];
+    snprintf(buf,sizeof(buf),"/param/%d/value",(int) (((unsigned int) x * 2654435761u) % 1000000007u));
+    keys[x]=strdup(buf);
+    buf[1]='P';
+    misses[x]=strdup(buf);
+  }
+
+  for (int n=10;n<=maxn;n*=10)
+  {
+    const int reps = n < 1000 ? 1000 : n < 100000 ? 10 : 1;
+    {
+      WDL_StringKeyedArray<int> a;
+      run_str("WDL_StringKeyedArray",a,n,keys,misses,reps);
+    }
+    {
+      WDL_StringKeyedHashArray<int> a;
+      run_str("WDL_StringKeyedHashArray",a,n,keys,misses,reps);
+    }
+    {
+      WDL_IntKeyedArray<int> a;
+      run_int("WDL_IntKeyedArray",a,n,reps);
+    }
+    {
+      WDL_IntKeyedHashArray<int> a;
+      run_int("WDL_IntKeyedHashArray",a,n,reps);
+    }
+    printf("\n");
+  }
+
+  for (x=0;x<maxn;x++) { free(keys[x]); free(misses[x]); }
+  free(keys);
+  free(misses);
+
+  printf("%s\n",g_bad ? "FAILED" : "OK");
+  return g_bad ? 1 : 0;
+}
@@ -24,7 +24,8 @@
 
   This file provides some simple functions for dealing with PCM audio.
   Specifically: 
-    + convert between 16/24/32 bit integer samples and flaots (only really tested on little-endian (i.e. x86) systems)
+    + convert between 16/24/32 bit integer samples and flaots (only really tested on little-endian (i.e. x86) systems),
+      per sample or in blocks (vectorized, optionally dithered, optionally (de)interleaving)
     + mix (and optionally resample, using low quality linear interpolation) a block of floats to another.
  
 */
@@ -33,6 +34,7 @@
 #define _PCMFMTCVT_H_
 
 
+#include <string.h>
 #include "wdltypes.h"
 
 #ifndef PCMFMTCVT_DBL_TYPE
@@ -209,144 +211,509 @@ static inline void double_to_i24(PCMFMTCVT_DBL_TYPE *vv, unsigned char *i24)
   }
 }
 
-static void pcmToFloats(void *src, int items, int bps, int src_spacing, float *dest, int dest_spacing)
+/*
+  Block conversions.
+
+  pcmToFloats(), floatsToPcm(), pcmToDoubles() and doublesToPcm() convert 4 samples at a time with SSE2 (x86) or
+  NEON (arm64), or with plain C++ elsewhere (or if PCMFMTCVT_NO_SIMD is defined). the results are the same as those
+  of the per-sample functions above, except for NaNs.
+
+  the conversions to 16 and 24 bit can add TPDF dither, see pcmfmtcvt_dither. pcmToFloatsNI() and friends convert
+  between interleaved PCM and a buffer per channel in one pass.
+*/
+
+#ifndef PCMFMTCVT_NO_SIMD
+  #if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define PCMFMTCVT_SSE2
+  #elif defined(__aarch64__) || defined(_M_ARM64)
+    #include <arm_neon.h>
+    #define PCMFMTCVT_NEON
+  #endif
+#endif
+
+// TPDF dither for the conversions to 16 and 24 bit: the sum of two uniform random values, of +/-amount LSB peak
+// (amount=1.0 is the usual triangular dither). keep one per stream, and init it with pcmfmtcvt_dither_init()
+struct pcmfmtcvt_dither
 {
-  if (bps == 32)
+  unsigned int state[4]; // xorshift32, one per lane
+  float amount;
+};
+
+static void pcmfmtcvt_dither_init(pcmfmtcvt_dither *d, float amount=1.0f, unsigned int seed=1)
+{
+  int x;
+  for (x = 0; x < 4; x ++)
   {
-    int *i1=(int *)src;
-    while (items--)
-    {          
-      i32_to_float(*i1,dest);
-      i1+=src_spacing;
-      dest+=dest_spacing;      
-    }
+    unsigned int s = seed*2654435761u + x*0x9E3779B9u;
+    d->state[x] = s ? s : 1;
   }
-  else if (bps == 24)
+  d->amount = amount;
+}
+
+// 4 lanes of floats (f4), doubles (d4) and ints (i4). masks are 0 or -1 per lane
+#if defined(PCMFMTCVT_SSE2)
+
+typedef __m128 pcmfmtcvt_f4;
+typedef __m128i pcmfmtcvt_i4;
+struct pcmfmtcvt_d4 { __m128d lo, hi; };
+
+static inline pcmfmtcvt_f4 pcmfmtcvt_f4_load(const float *p) { return _mm_loadu_ps(p); }
+static inline void pcmfmtcvt_f4_store(float *p, pcmfmtcvt_f4 a) { _mm_storeu_ps(p,a); }
+static inline pcmfmtcvt_f4 pcmfmtcvt_f4_set(float a, float b, float c, float d) { return _mm_setr_ps(a,b,c,d); }
+static inline pcmfmtcvt_f4 pcmfmtcvt_f4_set1(float a) { return _mm_set1_ps(a); }
+static inline pcmfmtcvt_f4 pcmfmtcvt_f4_add(pcmfmtcvt_f4 a, pcmfmtcvt_f4 b) { return _mm_add_ps(a,b); }
+static inline pcmfmtcvt_f4 pcmfmtcvt_f4_mul(pcmfmtcvt_f4 a, pcmfmtcvt_f4 b) { return _mm_mul_ps(a,b); }
+static inline pcmfmtcvt_f4 pcmfmtcvt_f4_clamp(pcmfmtcvt_f4 a, pcmfmtcvt_f4 lo, pcmfmtcvt_f4 hi) { return _mm_min_ps(_mm_max_ps(a,lo),hi); }
+static inline pcmfmtcvt_f4 pcmfmtcvt_f4_from_i4(pcmfmtcvt_i4 a) { return _mm_cvtepi32_ps(a); }
+static inline pcmfmtcvt_i4 pcmfmtcvt_f4_round(pcmfmtcvt_f4 a) // to nearest, halves away from zero
+{
+  const __m128i t = _mm_cvttps_epi32(a);
+  const __m128 frac = _mm_sub_ps(a,_mm_cvtepi32_ps(t));
+  const __m128i up = _mm_castps_si128(_mm_cmpge_ps(frac,_mm_set1_ps(0.5f)));
+  const __m128i down = _mm_castps_si128(_mm_cmple_ps(frac,_mm_set1_ps(-0.5f)));
+  return _mm_add_epi32(_mm_sub_epi32(t,up),down);
+}
+
+static inline pcmfmtcvt_d4 pcmfmtcvt_d4_load(const double *p) { pcmfmtcvt_d4 r = { _mm_loadu_pd(p), _mm_loadu_pd(p+2) }; return r; }
+static inline void pcmfmtcvt_d4_store(double *p, pcmfmtcvt_d4 a) { _mm_storeu_pd(p,a.lo); _mm_storeu_pd(p+2,a.hi); }
+static inline pcmfmtcvt_d4 pcmfmtcvt_d4_set(double a, double b, double c, double d) { pcmfmtcvt_d4 r = { _mm_setr_pd(a,b), _mm_setr_pd(c,d) }; return r; }
+static inline pcmfmtcvt_d4 pcmfmtcvt_d4_set1(double a) { pcmfmtcvt_d4 r = { _mm_set1_pd(a), _mm_set1_pd(a) }; return r; }
+static inline pcmfmtcvt_d4 pcmfmtcvt_d4_add(pcmfmtcvt_d4 a, pcmfmtcvt_d4 b) { pcmfmtcvt_d4 r = { _mm_add_pd(a.lo,b.lo), _mm_add_pd(a.hi,b.hi) }; return r; }
+static inline pcmfmtcvt_d4 pcmfmtcvt_d4_mul(pcmfmtcvt_d4 a, pcmfmtcvt_d4 b) { pcmfmtcvt_d4 r = { _mm_mul_pd(a.lo,b.lo), _mm_mul_pd(a.hi,b.hi) }; return r; }
+static inline pcmfmtcvt_d4 pcmfmtcvt_d4_clamp(pcmfmtcvt_d4 a, pcmfmtcvt_d4 lo, pcmfmtcvt_d4 hi)
+{
+  pcmfmtcvt_d4 r = { _mm_min_pd(_mm_max_pd(a.lo,lo.lo),hi.lo), _mm_min_pd(_mm_max_pd(a.hi,lo.hi),hi.hi) };
+  return r;
+}
+static inline pcmfmtcvt_d4 pcmfmtcvt_d4_from_i4(pcmfmtcvt_i4 a) { pcmfmtcvt_d4 r = { _mm_cvtepi32_pd(a), _mm_cvtepi32_pd(_mm_shuffle_epi32(a,_MM_SHUFFLE(1,0,3,2))) }; return r; }
+static inline pcmfmtcvt_d4 pcmfmtcvt_d4_from_f4(pcmfmtcvt_f4 a) { pcmfmtcvt_d4 r = { _mm_cvtps_pd(a), _mm_cvtps_pd(_mm_movehl_ps(a,a)) }; return r; }
+static inline pcmfmtcvt_i4 pcmfmtcvt_d4_round(pcmfmtcvt_d4 a) // (int)(a +/- 0.5), like the per-sample functions
+{
+  const __m128d sign = _mm_set1_pd(-0.0), half = _mm_set1_pd(0.5);
+  const __m128i lo = _mm_cvttpd_epi32(_mm_add_pd(a.lo,_mm_or_pd(_mm_and_pd(_mm_cmplt_pd(a.lo,_mm_setzero_pd()),sign),half)));
+  const __m128i hi = _mm_cvttpd_epi32(_mm_add_pd(a.hi,_mm_or_pd(_mm_and_pd(_mm_cmplt_pd(a.hi,_mm_setzero_pd()),sign),half)));
+  return _mm_unpacklo_epi64(lo,hi);
+}
+
+static inline pcmfmtcvt_i4 pcmfmtcvt_i4_load(const int *p) { return _mm_loadu_si128((const __m128i *)p); }
+static inline pcmfmtcvt_i4 pcmfmtcvt_i4_set(int a, int b, int c, int d) { return _mm_setr_epi32(a,b,c,d); }
+static inline void pcmfmtcvt_i4_store(int *p, pcmfmtcvt_i4 a) { _mm_storeu_si128((__m128i *)p,a); }
+static inline pcmfmtcvt_i4 pcmfmtcvt_i4_load16(const short *p) { const __m128i a = _mm_loadl_epi64((const __m128i *)p); return _mm_srai_epi32(_mm_unpacklo_epi16(a,a),16); }
+static inline void pcmfmtcvt_i4_store16(short *p, pcmfmtcvt_i4 a) { _mm_storel_epi64((__m128i *)p,_mm_packs_epi32(a,a)); }
+
+static inline pcmfmtcvt_f4 pcmfmtcvt_dither_f4(pcmfmtcvt_dither *d)
+{
+  __m128i s = _mm_loadu_si128((const __m128i *)d->state), u1;
+  s = _mm_xor_si128(s,_mm_slli_epi32(s,13));
+  s = _mm_xor_si128(s,_mm_srli_epi32(s,17));
+  u1 = s = _mm_xor_si128(s,_mm_slli_epi32(s,5));
+  s = _mm_xor_si128(s,_mm_slli_epi32(s,13));
+  s = _mm_xor_si128(s,_mm_srli_epi32(s,17));
+  s = _mm_xor_si128(s,_mm_slli_epi32(s,5));
+  _mm_storeu_si128((__m128i *)d->state,s);
+  return _mm_mul_ps(_mm_add_ps(_mm_cvtepi32_ps(u1),_mm_cvtepi32_ps(s)),_mm_set1_ps(d->amount * (1.0f/4294967296.0f)));
+}
+
+#elif defined(PCMFMTCVT_NEON)
+
+typedef float32x4_t pcmfmtcvt_f4;
+typedef int32x4_t pcmfmtcvt_i4;
+struct pcmfmtcvt_d4 { float64x2_t lo, hi; };
+
+static inline pcmfmtcvt_f4 pcmfmtcvt_f4_load(const float *p) { return vld1q_f32(p); }
+static inline void pcmfmtcvt_f4_store(float *p, pcmfmtcvt_f4 a) { vst1q_f32(p,a); }
+static inline pcmfmtcvt_f4 pcmfmtcvt_f4_set(float a, float b, float c, float d) { return vsetq_lane_f32(d,vsetq_lane_f32(c,vsetq_lane_f32(b,vdupq_n_f32(a),1),2),3); }
+static inline pcmfmtcvt_f4 pcmfmtcvt_f4_set1(float a) { return vdupq_n_f32(a); }
+static inline pcmfmtcvt_f4 pcmfmtcvt_f4_add(pcmfmtcvt_f4 a, pcmfmtcvt_f4 b) { return vaddq_f32(a,b); }
+static inline pcmfmtcvt_f4 pcmfmtcvt_f4_mul(pcmfmtcvt_f4 a, pcmfmtcvt_f4 b) { return vmulq_f32(a,b); }
+static inline pcmfmtcvt_f4 pcmfmtcvt_f4_clamp(pcmfmtcvt_f4 a, pcmfmtcvt_f4 lo, pcmfmtcvt_f4 hi) { return vminq_f32(vmaxq_f32(a,lo),hi); }
+static inline pcmfmtcvt_f4 pcmfmtcvt_f4_from_i4(pcmfmtcvt_i4 a) { return vcvtq_f32_s32(a); }
+static inline pcmfmtcvt_i4 pcmfmtcvt_f4_round(pcmfmtcvt_f4 a) // to nearest, halves away from zero
+{
+  return vcvtaq_s32_f32(a);
+}
+
+static inline pcmfmtcvt_d4 pcmfmtcvt_d4_load(const double *p) { pcmfmtcvt_d4 r = { vld1q_f64(p), vld1q_f64(p+2) }; return r; }
+static inline void pcmfmtcvt_d4_store(double *p, pcmfmtcvt_d4 a) { vst1q_f64(p,a.lo); vst1q_f64(p+2,a.hi); }
+static inline pcmfmtcvt_d4 pcmfmtcvt_d4_set(double a, double b, double c, double d)
+{
+  pcmfmtcvt_d4 r = { vsetq_lane_f64(b,vdupq_n_f64(a),1), vsetq_lane_f64(d,vdupq_n_f64(c),1) };
+  return r;
+}
+static inline pcmfmtcvt_d4 pcmfmtcvt_d4_set1(double a) { pcmfmtcvt_d4 r = { vdupq_n_f64(a), vdupq_n_f64(a) }; return r; }
+static inline pcmfmtcvt_d4 pcmfmtcvt_d4_add(pcmfmtcvt_d4 a, pcmfmtcvt_d4 b) { pcmfmtcvt_d4 r = { vaddq_f64(a.lo,b.lo), vaddq_f64(a.hi,b.hi) }; return r; }
+static inline pcmfmtcvt_d4 pcmfmtcvt_d4_mul(pcmfmtcvt_d4 a, pcmfmtcvt_d4 b) { pcmfmtcvt_d4 r = { vmulq_f64(a.lo,b.lo), vmulq_f64(a.hi,b.hi) }; return r; }
+static inline pcmfmtcvt_d4 pcmfmtcvt_d4_clamp(pcmfmtcvt_d4 a, pcmfmtcvt_d4 lo, pcmfmtcvt_d4 hi)
+{
+  pcmfmtcvt_d4 r = { vminq_f64(vmaxq_f64(a.lo,lo.lo),hi.lo), vminq_f64(vmaxq_f64(a.hi,lo.hi),hi.hi) };
+  return r;
+}
+static inline pcmfmtcvt_d4 pcmfmtcvt_d4_from_i4(pcmfmtcvt_i4 a)
+{
+  pcmfmtcvt_d4 r = { vcvtq_f64_s64(vmovl_s32(vget_low_s32(a))), vcvtq_f64_s64(vmovl_s32(vget_high_s32(a))) };
+  return r;
+}
+static inline pcmfmtcvt_d4 pcmfmtcvt_d4_from_f4(pcmfmtcvt_f4 a) { pcmfmtcvt_d4 r = { vcvt_f64_f32(vget_low_f32(a)), vcvt_high_f64_f32(a) }; return r; }
+static inline pcmfmtcvt_i4 pcmfmtcvt_d4_round(pcmfmtcvt_d4 a) // (int)(a +/- 0.5), like the per-sample functions
+{
+  const float64x2_t half = vdupq_n_f64(0.5), nhalf = vdupq_n_f64(-0.5), zero = vdupq_n_f64(0.0);
+  const float64x2_t lo = vaddq_f64(a.lo,vbslq_f64(vcltq_f64(a.lo,zero),nhalf,half));
+  const float64x2_t hi = vaddq_f64(a.hi,vbslq_f64(vcltq_f64(a.hi,zero),nhalf,half));
+  return vcombine_s32(vmovn_s64(vcvtq_s64_f64(lo)),vmovn_s64(vcvtq_s64_f64(hi)));
+}
+
+static inline pcmfmtcvt_i4 pcmfmtcvt_i4_load(const int *p) { return vld1q_s32(p); }
+static inline pcmfmtcvt_i4 pcmfmtcvt_i4_set(int a, int b, int c, int d) { return vsetq_lane_s32(d,vsetq_lane_s32(c,vsetq_lane_s32(b,vdupq_n_s32(a),1),2),3); }
+static inline void pcmfmtcvt_i4_store(int *p, pcmfmtcvt_i4 a) { vst1q_s32(p,a); }
+static inline pcmfmtcvt_i4 pcmfmtcvt_i4_load16(const short *p) { return vmovl_s16(vld1_s16(p)); }
+static inline void pcmfmtcvt_i4_store16(short *p, pcmfmtcvt_i4 a) { vst1_s16(p,vqmovn_s32(a)); }
+
+static inline pcmfmtcvt_f4 pcmfmtcvt_dither_f4(pcmfmtcvt_dither *d)
+{
+  uint32x4_t s = vld1q_u32(d->state), u1;
+  s = veorq_u32(s,vshlq_n_u32(s,13));
+  s = veorq_u32(s,vshrq_n_u32(s,17));
+  u1 = s = veorq_u32(s,vshlq_n_u32(s,5));
+  s = veorq_u32(s,vshlq_n_u32(s,13));
+  s = veorq_u32(s,vshrq_n_u32(s,17));
+  s = veorq_u32(s,vshlq_n_u32(s,5));
+  vst1q_u32(d->state,s);
+  return vmulq_n_f32(vaddq_f32(vcvtq_f32_s32(vreinterpretq_s32_u32(u1)),vcvtq_f32_s32(vreinterpretq_s32_u32(s))),d->amount * (1.0f/4294967296.0f));
+}
+
+#else
+
+struct pcmfmtcvt_f4 { float v[4]; };
+struct pcmfmtcvt_d4 { double v[4]; };
+struct pcmfmtcvt_i4 { int v[4]; };
+
+// the lanes are written out, rather than looped over, so that they stay in registers
+template<class T> static inline T pcmfmtcvt_clamp1(T a, T lo, T hi) { return a < lo ? lo : a > hi ? hi : a; }
+static inline int pcmfmtcvt_round1(float a) { const int t = (int)a; const float frac = a - (float)t; return t + (frac >= 0.5f) - (frac <= -0.5f); }
+static inline int pcmfmtcvt_round1(double a) { return float2int(a + (a < 0.0 ? -0.5 : 0.5)); }
+
+static inline pcmfmtcvt_f4 pcmfmtcvt_f4_set(float a, float b, float c, float d) { pcmfmtcvt_f4 r = {{a,b,c,d}}; return r; }
+static inline pcmfmtcvt_f4 pcmfmtcvt_f4_set1(float a) { return pcmfmtcvt_f4_set(a,a,a,a); }
+static inline pcmfmtcvt_f4 pcmfmtcvt_f4_load(const float *p) { return pcmfmtcvt_f4_set(p[0],p[1],p[2],p[3]); }
+static inline void pcmfmtcvt_f4_store(float *p, pcmfmtcvt_f4 a) { p[0]=a.v[0]; p[1]=a.v[1]; p[2]=a.v[2]; p[3]=a.v[3]; }
+static inline pcmfmtcvt_f4 pcmfmtcvt_f4_add(pcmfmtcvt_f4 a, pcmfmtcvt_f4 b) { return pcmfmtcvt_f4_set(a.v[0]+b.v[0],a.v[1]+b.v[1],a.v[2]+b.v[2],a.v[3]+b.v[3]); }
+static inline pcmfmtcvt_f4 pcmfmtcvt_f4_mul(pcmfmtcvt_f4 a, pcmfmtcvt_f4 b) { return pcmfmtcvt_f4_set(a.v[0]*b.v[0],a.v[1]*b.v[1],a.v[2]*b.v[2],a.v[3]*b.v[3]); }
+static inline pcmfmtcvt_f4 pcmfmtcvt_f4_clamp(pcmfmtcvt_f4 a, pcmfmtcvt_f4 lo, pcmfmtcvt_f4 hi)
+{
+  return pcmfmtcvt_f4_set(pcmfmtcvt_clamp1(a.v[0],lo.v[0],hi.v[0]),pcmfmtcvt_clamp1(a.v[1],lo.v[1],hi.v[1]),
+                          pcmfmtcvt_clamp1(a.v[2],lo.v[2],hi.v[2]),pcmfmtcvt_clamp1(a.v[3],lo.v[3],hi.v[3]));
+}
+static inline pcmfmtcvt_f4 pcmfmtcvt_f4_from_i4(pcmfmtcvt_i4 a) { return pcmfmtcvt_f4_set((float)a.v[0],(float)a.v[1],(float)a.v[2],(float)a.v[3]); }
+
+static inline pcmfmtcvt_d4 pcmfmtcvt_d4_set(double a, double b, double c, double d) { pcmfmtcvt_d4 r = {{a,b,c,d}}; return r; }
+static inline pcmfmtcvt_d4 pcmfmtcvt_d4_set1(double a) { return pcmfmtcvt_d4_set(a,a,a,a); }
+static inline pcmfmtcvt_d4 pcmfmtcvt_d4_load(const double *p) { return pcmfmtcvt_d4_set(p[0],p[1],p[2],p[3]); }
+static inline void pcmfmtcvt_d4_store(double *p, pcmfmtcvt_d4 a) { p[0]=a.v[0]; p[1]=a.v[1]; p[2]=a.v[2]; p[3]=a.v[3]; }
+static inline pcmfmtcvt_d4 pcmfmtcvt_d4_add(pcmfmtcvt_d4 a, pcmfmtcvt_d4 b) { return pcmfmtcvt_d4_set(a.v[0]+b.v[0],a.v[1]+b.v[1],a.v[2]+b.v[2],a.v[3]+b.v[3]); }
+static inline pcmfmtcvt_d4 pcmfmtcvt_d4_mul(pcmfmtcvt_d4 a, pcmfmtcvt_d4 b) { return pcmfmtcvt_d4_set(a.v[0]*b.v[0],a.v[1]*b.v[1],a.v[2]*b.v[2],a.v[3]*b.v[3]); }
+static inline pcmfmtcvt_d4 pcmfmtcvt_d4_clamp(pcmfmtcvt_d4 a, pcmfmtcvt_d4 lo, pcmfmtcvt_d4 hi)
+{
+  return pcmfmtcvt_d4_set(pcmfmtcvt_clamp1(a.v[0],lo.v[0],hi.v[0]),pcmfmtcvt_clamp1(a.v[1],lo.v[1],hi.v[1]),
+                          pcmfmtcvt_clamp1(a.v[2],lo.v[2],hi.v[2]),pcmfmtcvt_clamp1(a.v[3],lo.v[3],hi.v[3]));
+}
+static inline pcmfmtcvt_d4 pcmfmtcvt_d4_from_i4(pcmfmtcvt_i4 a) { return pcmfmtcvt_d4_set(a.v[0],a.v[1],a.v[2],a.v[3]); }
+static inline pcmfmtcvt_d4 pcmfmtcvt_d4_from_f4(pcmfmtcvt_f4 a) { return pcmfmtcvt_d4_set(a.v[0],a.v[1],a.v[2],a.v[3]); }
+
+static inline pcmfmtcvt_i4 pcmfmtcvt_i4_set(int a, int b, int c, int d) { pcmfmtcvt_i4 r = {{a,b,c,d}}; return r; }
+static inline pcmfmtcvt_i4 pcmfmtcvt_i4_load(const int *p) { return pcmfmtcvt_i4_set(p[0],p[1],p[2],p[3]); }
+static inline void pcmfmtcvt_i4_store(int *p, pcmfmtcvt_i4 a) { p[0]=a.v[0]; p[1]=a.v[1]; p[2]=a.v[2]; p[3]=a.v[3]; }
+static inline pcmfmtcvt_i4 pcmfmtcvt_i4_load16(const short *p) { return pcmfmtcvt_i4_set(p[0],p[1],p[2],p[3]); }
+static inline void pcmfmtcvt_i4_store16(short *p, pcmfmtcvt_i4 a) { p[0]=(short)a.v[0]; p[1]=(short)a.v[1]; p[2]=(short)a.v[2]; p[3]=(short)a.v[3]; }
+static inline pcmfmtcvt_i4 pcmfmtcvt_f4_round(pcmfmtcvt_f4 a) // to nearest, halves away from zero
+{
+  return pcmfmtcvt_i4_set(pcmfmtcvt_round1(a.v[0]),pcmfmtcvt_round1(a.v[1]),pcmfmtcvt_round1(a.v[2]),pcmfmtcvt_round1(a.v[3]));
+}
+static inline pcmfmtcvt_i4 pcmfmtcvt_d4_round(pcmfmtcvt_d4 a) // (int)(a +/- 0.5), like the per-sample functions
+{
+  return pcmfmtcvt_i4_set(pcmfmtcvt_round1(a.v[0]),pcmfmtcvt_round1(a.v[1]),pcmfmtcvt_round1(a.v[2]),pcmfmtcvt_round1(a.v[3]));
+}
+
+static inline pcmfmtcvt_f4 pcmfmtcvt_dither_f4(pcmfmtcvt_dither *d)
+{
+  pcmfmtcvt_f4 r;
+  int x;
+  for (x = 0; x < 4; x ++)
   {
-    unsigned char *i1=(unsigned char *)src;
-    int adv=3*src_spacing;
-    while (items--)
-    {          
-      i24_to_float(i1,dest);
-      dest+=dest_spacing;
-      i1+=adv;
-    }
+    unsigned int s = d->state[x], u1;
+    s ^= s<<13; s ^= s>>17; s ^= s<<5;
+    u1 = s;
+    s ^= s<<13; s ^= s>>17; s ^= s<<5;
+    d->state[x] = s;
+    r.v[x] = ((float)(int)u1 + (float)(int)s) * (d->amount * (1.0f/4294967296.0f));
+  }
+  return r;
+}
+
+#endif
+
+// loads and stores of 4 samples of PCM, spaced by spacing samples (and adv24 bytes per sample for 24 bit)
+static inline int pcmfmtcvt_i24(const unsigned char *p) { return (int)(((unsigned int)p[0]<<8) | ((unsigned int)p[1]<<16) | ((unsigned int)p[2]<<24)) >> 8; }
+
+static inline pcmfmtcvt_i4 pcmfmtcvt_i4_load_pcm(const void *src, int bps, int spacing, int adv24)
+{
+  if (bps == 32)
+  {
+    const int *p = (const int *)src;
+    if (spacing == 1) return pcmfmtcvt_i4_load(p);
+    return pcmfmtcvt_i4_set(p[0],p[spacing],p[2*spacing],p[3*spacing]);
   }
-  else if (bps == 16)
+  if (bps == 16)
   {
-    short *i1=(short *)src;
-    while (items--)
-    {          
-      INT16_TO_float(*dest,*i1);
-      i1+=src_spacing;
-      dest+=dest_spacing;
-    }
+    const short *p = (const short *)src;
+    if (spacing == 1) return pcmfmtcvt_i4_load16(p);
+    return pcmfmtcvt_i4_set(p[0],p[spacing],p[2*spacing],p[3*spacing]);
   }
+  const unsigned char *p = (const unsigned char *)src;
+  return pcmfmtcvt_i4_set(pcmfmtcvt_i24(p),pcmfmtcvt_i24(p+adv24),pcmfmtcvt_i24(p+2*adv24),pcmfmtcvt_i24(p+3*adv24));
 }
 
-static void floatsToPcm(float *src, int src_spacing, int items, void *dest, int bps, int dest_spacing)
+static inline void pcmfmtcvt_i4_store_pcm(void *dest, int bps, int spacing, int adv24, pcmfmtcvt_i4 a)
 {
-  if (bps==32)
+  int tmp[4], x;
+  if (bps == 16 && spacing == 1)
   {
-    int *o1=(int*)dest;
-    while (items--)
-    {
-      float_to_i32(src,o1);
-      src+=src_spacing;
-      o1+=dest_spacing;
-    }
+    pcmfmtcvt_i4_store16((short *)dest,a);
+    return;
   }
-  else if (bps == 24)
+  if (bps == 32 && spacing == 1)
   {
-    unsigned char *o1=(unsigned char*)dest;
-    int adv=dest_spacing*3;
-    while (items--)
-    {
-      float_to_i24(src,o1);
-      src+=src_spacing;
-      o1+=adv;
-    }
+    pcmfmtcvt_i4_store((int *)dest,a);
+    return;
   }
-  else if (bps==16)
+  pcmfmtcvt_i4_store(tmp,a);
+  if (bps == 32) for (x = 0; x < 4; x ++) ((int *)dest)[x*spacing] = tmp[x];
+  else if (bps == 16) for (x = 0; x < 4; x ++) ((short *)dest)[x*spacing] = (short)tmp[x];
+  else
   {
-    short *o1=(short*)dest;
-    while (items--)
+    unsigned char *p = (unsigned char *)dest;
+    for (x = 0; x < 4; x ++, p += adv24)
     {
-      float_TO_INT16(*o1,*src);
-      src+=src_spacing;
-      o1+=dest_spacing;
+      p[0] = tmp[x]&0xff;
+      p[1] = (tmp[x]>>8)&0xff;
+      p[2] = (tmp[x]>>16)&0xff;
     }
   }
 }
 
+static inline pcmfmtcvt_f4 pcmfmtcvt_f4_load_strided(const float *p, int spacing)
+{
+  if (spacing == 1) return pcmfmtcvt_f4_load(p);
+  return pcmfmtcvt_f4_set(p[0],p[spacing],p[2*spacing],p[3*spacing]);
+}
 
-static void pcmToDoubles(void *src, int items, int bps, int src_spacing, PCMFMTCVT_DBL_TYPE *dest, int dest_spacing, int byteadvancefor24=0)
+static inline void pcmfmtcvt_f4_store_strided(float *p, int spacing, pcmfmtcvt_f4 a)
 {
-  if (bps == 32)
+  float tmp[4];
+  int x;
+  if (spacing == 1) { pcmfmtcvt_f4_store(p,a); return; }
+  pcmfmtcvt_f4_store(tmp,a);
+  for (x = 0; x < 4; x ++) p[x*spacing] = tmp[x];
+}
+
+static inline pcmfmtcvt_d4 pcmfmtcvt_d4_load_strided(const double *p, int spacing)
+{
+  if (spacing == 1) return pcmfmtcvt_d4_load(p);
+  return pcmfmtcvt_d4_set(p[0],p[spacing],p[2*spacing],p[3*spacing]);
+}
+
+static inline void pcmfmtcvt_d4_store_strided(double *p, int spacing, pcmfmtcvt_d4 a)
+{
+  double tmp[4];
+  int x;
+  if (spacing == 1) { pcmfmtcvt_d4_store(p,a); return; }
+  pcmfmtcvt_d4_store(tmp,a);
+  for (x = 0; x < 4; x ++) p[x*spacing] = tmp[x];
+}
+
+// the full scale and clipping range of each integer format
+static inline double pcmfmtcvt_scale(int bps) { return bps == 32 ? 2147483648.0 : bps == 24 ? 8388608.0 : 32768.0; }
+
+// PCM to floats/doubles, 4 samples at a time, leaving items%4 samples for the caller. returns the number converted
+static int pcmfmtcvt_pcm_to_block(const void *src, int items, int bps, int src_spacing, int adv24, float *dest, int dest_spacing)
+{
+  const pcmfmtcvt_f4 sc = pcmfmtcvt_f4_set1((float)(1.0/pcmfmtcvt_scale(bps)));
+  const int srcadv = bps == 24 ? 4*adv24 : 4*src_spacing*(bps/8);
+  int n;
+  for (n = 0; n + 4 <= items; n += 4)
   {
-    int *i1=(int *)src;
-    while (items--)
-    {          
-      i32_to_double(*i1,dest);
-      i1+=src_spacing;
-      dest+=dest_spacing;      
-    }
+    pcmfmtcvt_f4_store_strided(dest,dest_spacing,pcmfmtcvt_f4_mul(pcmfmtcvt_f4_from_i4(pcmfmtcvt_i4_load_pcm(src,bps,src_spacing,adv24)),sc));
+    src = (const char *)src + srcadv;
+    dest += 4*dest_spacing;
   }
-  else if (bps == 24)
+  return n;
+}
+
+static int pcmfmtcvt_pcm_to_block(const void *src, int items, int bps, int src_spacing, int adv24, double *dest, int dest_spacing)
+{
+  const pcmfmtcvt_d4 sc = pcmfmtcvt_d4_set1(1.0/pcmfmtcvt_scale(bps));
+  const int srcadv = bps == 24 ? 4*adv24 : 4*src_spacing*(bps/8);
+  int n;
+  for (n = 0; n + 4 <= items; n += 4)
   {
-    unsigned char *i1=(unsigned char *)src;
-    int adv=3*src_spacing+byteadvancefor24;
-    while (items--)
-    {          
-      i24_to_double(i1,dest);
-      dest+=dest_spacing;
-      i1+=adv;
-    }
+    pcmfmtcvt_d4_store_strided(dest,dest_spacing,pcmfmtcvt_d4_mul(pcmfmtcvt_d4_from_i4(pcmfmtcvt_i4_load_pcm(src,bps,src_spacing,adv24)),sc));
+    src = (const char *)src + srcadv;
+    dest += 4*dest_spacing;
   }
-  else if (bps == 16)
+  return n;
+}
+
+// floats/doubles to PCM, 4 samples at a time, leaving items%4 samples for the caller. returns the number converted.
+// the samples are scaled, dithered, clipped and then rounded halves away from zero. floats are rounded as floats
+// (exactly, so 16 and 24 bit match the per-sample functions) except to 32 bit, which goes through doubles
+static int pcmfmtcvt_block_to_pcm(const double *src, int src_spacing, int items, void *dest, int bps, int dest_spacing, int adv24, pcmfmtcvt_dither *dither)
+{
+  const double scale = pcmfmtcvt_scale(bps);
+  const pcmfmtcvt_d4 sc = pcmfmtcvt_d4_set1(scale), lo = pcmfmtcvt_d4_set1(-scale), hi = pcmfmtcvt_d4_set1(scale-1.0);
+  const int destadv = bps == 24 ? 4*adv24 : 4*dest_spacing*(bps/8);
+  int n;
+  if (bps == 32) dither = NULL;
+  for (n = 0; n + 4 <= items; n += 4)
   {
-    short *i1=(short *)src;
-    while (items--)
-    {          
-      INT16_TO_double(*dest,*i1);
-      i1+=src_spacing;
-      dest+=dest_spacing;
-    }
+    pcmfmtcvt_d4 v = pcmfmtcvt_d4_mul(pcmfmtcvt_d4_load_strided(src,src_spacing),sc);
+    if (dither) v = pcmfmtcvt_d4_add(v,pcmfmtcvt_d4_from_f4(pcmfmtcvt_dither_f4(dither)));
+    pcmfmtcvt_i4_store_pcm(dest,bps,dest_spacing,adv24,pcmfmtcvt_d4_round(pcmfmtcvt_d4_clamp(v,lo,hi)));
+    src += 4*src_spacing;
+    dest = (char *)dest + destadv;
   }
+  return n;
 }
 
-static void doublesToPcm(PCMFMTCVT_DBL_TYPE *src, int src_spacing, int items, void *dest, int bps, int dest_spacing, int byteadvancefor24=0)
+static int pcmfmtcvt_block_to_pcm(const float *src, int src_spacing, int items, void *dest, int bps, int dest_spacing, int adv24, pcmfmtcvt_dither *dither)
 {
-  if (bps==32)
+  const float scale = (float)pcmfmtcvt_scale(bps);
+  const pcmfmtcvt_f4 sc = pcmfmtcvt_f4_set1(scale), lo = pcmfmtcvt_f4_set1(-scale), hi = pcmfmtcvt_f4_set1(scale-1.0f);
+  const pcmfmtcvt_d4 dsc = pcmfmtcvt_d4_set1(2147483648.0), dlo = pcmfmtcvt_d4_set1(-2147483648.0), dhi = pcmfmtcvt_d4_set1(2147483647.0);
+  const int destadv = bps == 24 ? 4*adv24 : 4*dest_spacing*(bps/8);
+  int n;
+  for (n = 0; n + 4 <= items; n += 4)
   {
-    int *o1=(int*)dest;
-    while (items--)
+    const pcmfmtcvt_f4 in = pcmfmtcvt_f4_load_strided(src,src_spacing);
+    pcmfmtcvt_i4 r;
+    if (bps == 32)
     {
-      double_to_i32(src,o1);
-      src+=src_spacing;
-      o1+=dest_spacing;
+      r = pcmfmtcvt_d4_round(pcmfmtcvt_d4_clamp(pcmfmtcvt_d4_mul(pcmfmtcvt_d4_from_f4(in),dsc),dlo,dhi));
     }
-  }
-  else if (bps == 24)
-  {
-    unsigned char *o1=(unsigned char*)dest;
-    int adv=dest_spacing*3+byteadvancefor24;
-    while (items--)
+    else
     {
-      double_to_i24(src,o1);
-      src+=src_spacing;
-      o1+=adv;
+      pcmfmtcvt_f4 v = pcmfmtcvt_f4_mul(in,sc);
+      if (dither) v = pcmfmtcvt_f4_add(v,pcmfmtcvt_dither_f4(dither));
+      r = pcmfmtcvt_f4_round(pcmfmtcvt_f4_clamp(v,lo,hi));
     }
+    pcmfmtcvt_i4_store_pcm(dest,bps,dest_spacing,adv24,r);
+    src += 4*src_spacing;
+    dest = (char *)dest + destadv;
   }
-  else if (bps==16)
+  return n;
+}
+
+// the block conversions above, plus the last items%4 samples through a padded copy
+template<class T> static void pcmfmtcvt_pcm_to(const void *src, int items, int bps, int src_spacing, int byteadvancefor24, T *dest, int dest_spacing)
+{
+  if (bps != 16 && bps != 24 && bps != 32) return;
+  const int adv24 = 3*src_spacing+byteadvancefor24;
+  const int srcadv = bps == 24 ? adv24 : src_spacing*(bps/8);
+  const int n = pcmfmtcvt_pcm_to_block(src,items,bps,src_spacing,adv24,dest,dest_spacing);
+  if (n < items)
   {
-    short *o1=(short*)dest;
-    while (items--)
-    {
-      double_TO_INT16(*o1,*src);
-      src+=src_spacing;
-      o1+=dest_spacing;
-    }
+    unsigned char tmp[4*4]={0,};
+    const unsigned char *p = (const unsigned char *)src + n*srcadv;
+    T out[4];
+    int x;
+    for (x = 0; x < items-n; x ++) memcpy(tmp+x*(bps/8),p+x*srcadv,bps/8);
+    pcmfmtcvt_pcm_to_block(tmp,4,bps,1,3,out,1);
+    for (x = 0; x < items-n; x ++) dest[(n+x)*dest_spacing] = out[x];
+  }
+}
+
+template<class T> static void pcmfmtcvt_to_pcm(const T *src, int src_spacing, int items, void *dest, int bps, int dest_spacing, int byteadvancefor24, pcmfmtcvt_dither *dither)
+{
+  if (bps != 16 && bps != 24 && bps != 32) return;
+  const int adv24 = 3*dest_spacing+byteadvancefor24;
+  const int destadv = bps == 24 ? adv24 : dest_spacing*(bps/8);
+  const int n = pcmfmtcvt_block_to_pcm(src,src_spacing,items,dest,bps,dest_spacing,adv24,dither);
+  if (n < items)
+  {
+    unsigned char tmp[4*4];
+    unsigned char *p = (unsigned char *)dest + n*destadv;
+    T in[4]={0,};
+    int x;
+    for (x = 0; x < items-n; x ++) in[x] = src[(n+x)*src_spacing];
+    pcmfmtcvt_block_to_pcm(in,1,4,tmp,bps,1,3,dither);
+    for (x = 0; x < items-n; x ++) memcpy(p+x*destadv,tmp+x*(bps/8),bps/8);
+  }
+}
+
+static void pcmToFloats(void *src, int items, int bps, int src_spacing, float *dest, int dest_spacing)
+{
+  pcmfmtcvt_pcm_to(src,items,bps,src_spacing,0,dest,dest_spacing);
+}
+
+static void floatsToPcm(float *src, int src_spacing, int items, void *dest, int bps, int dest_spacing, pcmfmtcvt_dither *dither=NULL)
+{
+  pcmfmtcvt_to_pcm(src,src_spacing,items,dest,bps,dest_spacing,0,dither);
+}
+
+static void pcmToDoubles(void *src, int items, int bps, int src_spacing, PCMFMTCVT_DBL_TYPE *dest, int dest_spacing, int byteadvancefor24=0)
+{
+  pcmfmtcvt_pcm_to(src,items,bps,src_spacing,byteadvancefor24,dest,dest_spacing);
+}
+
+static void doublesToPcm(PCMFMTCVT_DBL_TYPE *src, int src_spacing, int items, void *dest, int bps, int dest_spacing, int byteadvancefor24=0, pcmfmtcvt_dither *dither=NULL)
+{
+  pcmfmtcvt_to_pcm(src,src_spacing,items,dest,bps,dest_spacing,byteadvancefor24,dither);
+}
+
+// interleaved PCM of nch channels to/from a buffer per channel. the frames are converted in runs short enough that
+// the interleaved PCM stays in the cache while each channel is converted
+#define PCMFMTCVT_NI_FRAMES 1024
+
+static void pcmToFloatsNI(void *src, int nch, int frames, int bps, float **dest)
+{
+  int pos, c;
+  for (pos = 0; pos < frames; pos += PCMFMTCVT_NI_FRAMES)
+  {
+    const int n = frames-pos < PCMFMTCVT_NI_FRAMES ? frames-pos : PCMFMTCVT_NI_FRAMES;
+    for (c = 0; c < nch; c ++)
+      pcmfmtcvt_pcm_to((char *)src + (pos*nch+c)*(bps/8),n,bps,nch,0,dest[c]+pos,1);
+  }
+}
+
+static void floatsNIToPcm(float **src, int nch, int frames, void *dest, int bps, pcmfmtcvt_dither *dither=NULL)
+{
+  int pos, c;
+  for (pos = 0; pos < frames; pos += PCMFMTCVT_NI_FRAMES)
+  {
+    const int n = frames-pos < PCMFMTCVT_NI_FRAMES ? frames-pos : PCMFMTCVT_NI_FRAMES;
+    for (c = 0; c < nch; c ++)
+      pcmfmtcvt_to_pcm(src[c]+pos,1,n,(char *)dest + (pos*nch+c)*(bps/8),bps,nch,0,dither);
+  }
+}
+
+static void pcmToDoublesNI(void *src, int nch, int frames, int bps, PCMFMTCVT_DBL_TYPE **dest)
+{
+  int pos, c;
+  for (pos = 0; pos < frames; pos += PCMFMTCVT_NI_FRAMES)
+  {
+    const int n = frames-pos < PCMFMTCVT_NI_FRAMES ? frames-pos : PCMFMTCVT_NI_FRAMES;
+    for (c = 0; c < nch; c ++)
+      pcmfmtcvt_pcm_to((char *)src + (pos*nch+c)*(bps/8),n,bps,nch,0,dest[c]+pos,1);
+  }
+}
+
+static void doublesNIToPcm(PCMFMTCVT_DBL_TYPE **src, int nch, int frames, void *dest, int bps, pcmfmtcvt_dither *dither=NULL)
+{
+  int pos, c;
+  for (pos = 0; pos < frames; pos += PCMFMTCVT_NI_FRAMES)
+  {
+    const int n = frames-pos < PCMFMTCVT_NI_FRAMES ? frames-pos : PCMFMTCVT_NI_FRAMES;
+    for (c = 0; c < nch; c ++)
+      pcmfmtcvt_to_pcm(src[c]+pos,1,n,(char *)dest + (pos*nch+c)*(bps/8),bps,nch,0,dither);
   }
 }
 
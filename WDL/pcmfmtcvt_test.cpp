@@ -0,0 +1,180 @@
+// benchmark of the block conversions in pcmfmtcvt.h, in GB/s (bytes read plus bytes written), against a loop of the
+// per-sample conversions. also checks that the block conversions give exactly the same results as the per-sample ones,
+// with and without spacing, and reports the error of the dithered conversion to 16 bit.
+//
+// c++ -O2 pcmfmtcvt_test.cpp -o pcmfmtcvt_test
+// (add -DPCMFMTCVT_NO_SIMD to measure the plain C++ path)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <chrono>
+#include <vector>
+
+#include "pcmfmtcvt.h"
+
+static double now_s()
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static unsigned int g_rand = 1;
+static double rnd(double range)
+{
+  g_rand = g_rand*1664525 + 1013904223;
+  return ((g_rand >> 8) * (1.0/16777216.0) * 2.0 - 1.0) * range;
+}
+
+// values that round to either side of a step or clip, as well as random ones
+static double test_value(int i)
+{
+  static const double edges[] = { 1.0, -1.0, 0.0, -0.0, 1.5, -1.5, 32766.5/32768.0, -32767.5/32768.0, 8388606.5/8388608.0, 2147483646.5/2147483648.0, 0.5/32768.0, -0.5/8388608.0 };
+  const int ne = sizeof(edges)/sizeof(edges[0]);
+  return i % 7 ? rnd(1.2) : edges[(i/7) % ne];
+}
+
+// the per-sample conversions, one sample at a time
+static void ref_floatsToPcm(const float *src, int ss, int items, void *dest, int bps, int ds)
+{
+  int x;
+  for (x = 0; x < items; x ++)
+  {
+    float v = src[x*ss];
+    if (bps == 16) { float_TO_INT16(((short *)dest)[x*ds], v) }
+    else if (bps == 24) float_to_i24(&v, (unsigned char *)dest + x*ds*3);
+    else float_to_i32(&v, (int *)dest + x*ds);
+  }
+}
+
+static void ref_doublesToPcm(const double *src, int ss, int items, void *dest, int bps, int ds)
+{
+  int x;
+  for (x = 0; x < items; x ++)
+  {
+    double v = src[x*ss];
+    if (bps == 16) { double_TO_INT16(((short *)dest)[x*ds], v) }
+    else if (bps == 24) double_to_i24(&v, (unsigned char *)dest + x*ds*3);
+    else double_to_i32(&v, (int *)dest + x*ds);
+  }
+}
+
+static void ref_pcmToFloats(void *src, int items, int bps, int ss, float *dest, int ds)
+{
+  int x;
+  for (x = 0; x < items; x ++)
+  {
+    if (bps == 16) INT16_TO_float(dest[x*ds], ((short *)src)[x*ss])
+    else if (bps == 24) i24_to_float((unsigned char *)src + x*ss*3, dest + x*ds);
+    else i32_to_float(((int *)src)[x*ss], dest + x*ds);
+  }
+}
+
+static void ref_pcmToDoubles(void *src, int items, int bps, int ss, double *dest, int ds)
+{
+  int x;
+  for (x = 0; x < items; x ++)
+  {
+    if (bps == 16) INT16_TO_double(dest[x*ds], ((short *)src)[x*ss])
+    else if (bps == 24) i24_to_double((unsigned char *)src + x*ss*3, dest + x*ds);
+    else i32_to_double(((int *)src)[x*ss], dest + x*ds);
+  }
+}
+
+static int check(int bps, int ss, int ds, int items)
+{
+  int bad = 0, x;
+  std::vector<float> f(items*ss), fa(items*ds, 7.0f), fb(items*ds, 7.0f);
+  std::vector<double> d(items*ss), da(items*ds, 7.0), db(items*ds, 7.0);
+  std::vector<unsigned char> a(items*ds*4 + 16, 0xab), b(items*ds*4 + 16, 0xab);
+  for (x = 0; x < items*ss; x ++) { d[x] = test_value(x); f[x] = (float) d[x]; }
+
+  ref_floatsToPcm(f.data(), ss, items, a.data(), bps, ds);
+  floatsToPcm(f.data(), ss, items, b.data(), bps, ds);
+  if (a != b) { printf("floatsToPcm %d bit, spacing %d/%d differs\n", bps, ss, ds); bad ++; }
+
+  ref_doublesToPcm(d.data(), ss, items, a.data(), bps, ds);
+  doublesToPcm(d.data(), ss, items, b.data(), bps, ds);
+  if (a != b) { printf("doublesToPcm %d bit, spacing %d/%d differs\n", bps, ss, ds); bad ++; }
+
+  // from every bit pattern in a, read with the source spacing
+  for (x = 0; x < (int) a.size(); x ++) a[x] = (unsigned char) (g_rand = g_rand*1664525 + 1013904223) >> 24;
+  const int pcm_items = items*ds/ss;
+  ref_pcmToFloats(a.data(), pcm_items, bps, ss, fa.data(), 1);
+  pcmToFloats(a.data(), pcm_items, bps, ss, fb.data(), 1);
+  if (memcmp(fa.data(), fb.data(), pcm_items*sizeof(float))) { printf("pcmToFloats %d bit, spacing %d differs\n", bps, ss); bad ++; }
+
+  ref_pcmToDoubles(a.data(), pcm_items, bps, ss, da.data(), 1);
+  pcmToDoubles(a.data(), pcm_items, bps, ss, db.data(), 1);
+  if (memcmp(da.data(), db.data(), pcm_items*sizeof(double))) { printf("pcmToDoubles %d bit, spacing %d differs\n", bps, ss); bad ++; }
+
+  return bad;
+}
+
+template<class F> static void bench(const char *name, double bytes, F fn)
+{
+  fn();
+  const int reps = 10;
+  double t = now_s();
+  for (int r = 0; r < reps; r ++) fn();
+  t = (now_s() - t) / reps;
+  printf("  %-28s %6.2f GB/s\n", name, bytes / t * 1e-9);
+}
+
+int main()
+{
+  int bad = 0;
+  static const int bpss[] = { 16, 24, 32 };
+
+  for (int i = 0; i < 3; i ++)
+    for (int ss = 1; ss <= 3; ss ++)
+      for (int ds = 1; ds <= 3; ds ++)
+        for (int items = 0; items < 40; items += 13)
+          bad += check(bpss[i], ss, ds, items + 1000);
+
+  {
+    pcmfmtcvt_dither dither;
+    pcmfmtcvt_dither_init(&dither);
+    const int n = 1 << 20;
+    std::vector<float> f(n);
+    std::vector<short> o(n);
+    for (int x = 0; x < n; x ++) f[x] = (float) (0.0003 * sin(x * 0.001));
+    floatsToPcm(f.data(), 1, n, o.data(), 16, 1, &dither);
+    double sum = 0.0, sum2 = 0.0;
+    for (int x = 0; x < n; x ++) { const double e = o[x] - f[x] * 32768.0; sum += e; sum2 += e*e; }
+    printf("dithered 16 bit: mean error %.4f LSB, rms error %.4f LSB (expected %.4f)\n\n", sum / n, sqrt(sum2 / n), sqrt(1.0/6.0 + 1.0/12.0));
+  }
+
+  const int n = 1 << 22;
+  std::vector<float> f(n), f2(n);
+  std::vector<double> d(n), d2(n);
+  std::vector<unsigned char> pcm(n*4);
+  for (int x = 0; x < n; x ++) { d[x] = rnd(1.0); f[x] = (float) d[x]; }
+
+  for (int i = 0; i < 3; i ++)
+  {
+    const int bps = bpss[i], bytes = bps/8;
+    float *chans[2] = { f2.data(), f2.data() + n/2 };
+    float *src_chans[2] = { f.data(), f.data() + n/2 };
+    pcmfmtcvt_dither dither;
+    pcmfmtcvt_dither_init(&dither);
+
+    printf("%d bit:\n", bps);
+    bench("per-sample floatsToPcm", n * (4.0 + bytes), [&] { ref_floatsToPcm(f.data(), 1, n, pcm.data(), bps, 1); });
+    bench("floatsToPcm", n * (4.0 + bytes), [&] { floatsToPcm(f.data(), 1, n, pcm.data(), bps, 1); });
+    if (bps < 32) bench("floatsToPcm, dithered", n * (4.0 + bytes), [&] { floatsToPcm(f.data(), 1, n, pcm.data(), bps, 1, &dither); });
+    bench("per-sample doublesToPcm", n * (8.0 + bytes), [&] { ref_doublesToPcm(d.data(), 1, n, pcm.data(), bps, 1); });
+    bench("doublesToPcm", n * (8.0 + bytes), [&] { doublesToPcm(d.data(), 1, n, pcm.data(), bps, 1); });
+    bench("per-sample pcmToFloats", n * (4.0 + bytes), [&] { ref_pcmToFloats(pcm.data(), n, bps, 1, f2.data(), 1); });
+    bench("pcmToFloats", n * (4.0 + bytes), [&] { pcmToFloats(pcm.data(), n, bps, 1, f2.data(), 1); });
+    bench("per-sample pcmToDoubles", n * (8.0 + bytes), [&] { ref_pcmToDoubles(pcm.data(), n, bps, 1, d2.data(), 1); });
+    bench("pcmToDoubles", n * (8.0 + bytes), [&] { pcmToDoubles(pcm.data(), n, bps, 1, d2.data(), 1); });
+    bench("per-sample deinterleave 2ch", n * (4.0 + bytes), [&] { for (int c = 0; c < 2; c ++) ref_pcmToFloats(pcm.data() + c*bytes, n/2, bps, 2, chans[c], 1); });
+    bench("pcmToFloatsNI 2ch", n * (4.0 + bytes), [&] { pcmToFloatsNI(pcm.data(), 2, n/2, bps, chans); });
+    bench("per-sample interleave 2ch", n * (4.0 + bytes), [&] { for (int c = 0; c < 2; c ++) ref_floatsToPcm(src_chans[c], 1, n/2, pcm.data() + c*bytes, bps, 2); });
+    bench("floatsNIToPcm 2ch", n * (4.0 + bytes), [&] { floatsNIToPcm(src_chans, 2, n/2, pcm.data(), bps); });
+  }
+
+  printf("%s\n", bad ? "FAILED" : "OK");
+  return bad ? 1 : 0;
+}
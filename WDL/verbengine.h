@@ -297,4 +297,362 @@ private:
 };
 
 
+// WDL_ReverbEngineMC is the same reverb for any number of channels, in float or double, restructured for block processing:
+//
+//   - the samples are processed in chunks no longer than the shortest delay line, so within a chunk no delay line
+//     reads what it writes. the allpasses then run as straight loops over the chunk
+//   - the only recursion left, the dampening filter of each comb, runs across the 10 combs of a channel at once
+//     (padded to 12 lanes), each lane reading and writing its delay line through its own pointer. with SSE2 these
+//     are 6 vectors of doubles or 3 of floats, and the allpasses run 2 or 4 samples at a time
+//   - all delay lines live in one allocation
+//
+// channel c uses the tunings spread by c*wdl_verb__stereospread, so channels 0 and 1 are the left and right
+// channels of WDL_ReverbEngine. SetWidth() mixes the pairs of channels 0/1, 2/3 and so on; an odd last channel is
+// left as it is.
+//
+// the arithmetic is the same as WDL_ReverbEngine::ProcessSampleBlock(), in the same order, so with T=double and
+// 2 channels the output is bit-identical to WDL_ReverbEngine (as long as both are compiled with the same
+// floating point settings, e.g. no FMA contraction), which is useful for regression testing.
+// like WDL_ReverbEngine, room size and dampening take effect on Reset().
+
+#if defined(__SSE2__) || _M_IX86_FP >= 2 || defined(_WIN64)
+  #include <emmintrin.h>
+  #define WDL_VERBENGINE_SSE2
+#endif
+
+static double WDL_DENORMAL_INLINE wdl_verb_denormal_filter(double a) { return denormal_filter_double(a); }
+static float WDL_DENORMAL_INLINE wdl_verb_denormal_filter(float a) { return denormal_filter_float(a); }
+
+// the vector operations of WDL_ReverbEngineMC, W values of T at a time. denormal_filter() zeroes values smaller
+// than lim in magnitude, nlim being -lim. without SSE2 they are written out on pairs of values, and
+// denormal_filter() is denormal_filter_double()/denormal_filter_float()
+template<class T> struct wdl_verb_simd
+{
+  enum { W=2 };
+  struct V { T a, b; };
+  static V make(T a, T b) { V r={a,b}; return r; }
+  static V load(const T *p) { return make(p[0],p[1]); }
+  static void store(T *p, V v) { p[0]=v.a; p[1]=v.b; }
+  static V gather(T * const *p, int i) { return make(p[0][i],p[1][i]); }
+  static void scatter(T * const *p, int i, V v) { p[0][i]=v.a; p[1][i]=v.b; }
+  static V set1(T a) { return make(a,a); }
+  static V add(V x, V y) { return make(x.a+y.a,x.b+y.b); }
+  static V sub(V x, V y) { return make(x.a-y.a,x.b-y.b); }
+  static V mul(V x, V y) { return make(x.a*y.a,x.b*y.b); }
+  static V denormal_filter(V x, V lim, V nlim) { return make(wdl_verb_denormal_filter(x.a),wdl_verb_denormal_filter(x.b)); }
+};
+
+#ifdef WDL_VERBENGINE_SSE2
+template<> struct wdl_verb_simd<double>
+{
+  typedef __m128d V;
+  enum { W=2 };
+  static V load(const double *p) { return _mm_loadu_pd(p); }
+  static void store(double *p, V a) { _mm_storeu_pd(p,a); }
+  static V gather(double * const *p, int i) { return _mm_loadh_pd(_mm_load_sd(p[0]+i),p[1]+i); }
+  static void scatter(double * const *p, int i, V a) { _mm_storel_pd(p[0]+i,a); _mm_storeh_pd(p[1]+i,a); }
+  static V set1(double a) { return _mm_set1_pd(a); }
+  static V add(V a, V b) { return _mm_add_pd(a,b); }
+  static V sub(V a, V b) { return _mm_sub_pd(a,b); }
+  static V mul(V a, V b) { return _mm_mul_pd(a,b); }
+  static V denormal_filter(V a, V lim, V nlim) { return _mm_and_pd(a,_mm_or_pd(_mm_cmpge_pd(a,lim),_mm_cmple_pd(a,nlim))); }
+};
+
+template<> struct wdl_verb_simd<float>
+{
+  typedef __m128 V;
+  enum { W=4 };
+  static V load(const float *p) { return _mm_loadu_ps(p); }
+  static void store(float *p, V a) { _mm_storeu_ps(p,a); }
+  static V gather(float * const *p, int i) { return _mm_set_ps(p[3][i],p[2][i],p[1][i],p[0][i]); }
+  static void scatter(float * const *p, int i, V a)
+  {
+    _mm_store_ss(p[0]+i,a);
+    _mm_store_ss(p[1]+i,_mm_shuffle_ps(a,a,_MM_SHUFFLE(1,1,1,1)));
+    _mm_store_ss(p[2]+i,_mm_shuffle_ps(a,a,_MM_SHUFFLE(2,2,2,2)));
+    _mm_store_ss(p[3]+i,_mm_shuffle_ps(a,a,_MM_SHUFFLE(3,3,3,3)));
+  }
+  static V set1(float a) { return _mm_set1_ps(a); }
+  static V add(V a, V b) { return _mm_add_ps(a,b); }
+  static V sub(V a, V b) { return _mm_sub_ps(a,b); }
+  static V mul(V a, V b) { return _mm_mul_ps(a,b); }
+  static V denormal_filter(V a, V lim, V nlim) { return _mm_and_ps(a,_mm_or_ps(_mm_cmpge_ps(a,lim),_mm_cmple_ps(a,nlim))); }
+};
+#endif
+
+template<class T> class WDL_ReverbEngineMC
+{
+public:
+  enum { NCOMBS=sizeof(wdl_verb__combtunings)/sizeof(wdl_verb__combtunings[0]) };
+  enum { NALLPASSES=sizeof(wdl_verb__allpasstunings)/sizeof(wdl_verb__allpasstunings[0]) };
+  enum { COMBLANES=12 }; // NCOMBS, padded to 3 or 6 vectors
+  enum { MAXCHUNK=256 };
+
+  WDL_ReverbEngineMC(int nch=2)
+  {
+    m_srate=44100.0;
+    m_roomsize=0.5;
+    m_damp=0.5;
+    m_nch=nch>0?nch:1;
+    m_chunk=1;
+    SetWidth(1.0);
+    Reset(false);
+  }
+  ~WDL_ReverbEngineMC()
+  {
+  }
+
+  void SetNumChannels(int nch)
+  {
+    if (nch<1) nch=1;
+    if (m_nch!=nch)
+    {
+      m_nch=nch;
+      Reset(true);
+    }
+  }
+  int GetNumChannels() const { return m_nch; }
+
+  void SetSampleRate(double srate)
+  {
+    if (m_srate!=srate)
+    {
+      m_srate=srate;
+      Reset(true);
+    }
+  }
+
+  // inputs and outputs have GetNumChannels() channels of ns samples. outputs may be the same buffers as inputs
+  void ProcessSampleBlock(T **inputs, T **outputs, int ns)
+  {
+    const T fb=(T)m_fb, damp=(T)m_dampval, wid=(T)m_wid;
+    int pos=0;
+    while (pos < ns)
+    {
+      const int n = ns-pos < m_chunk ? ns-pos : m_chunk;
+      int c;
+      for (c = 0; c < m_nch; c ++)
+        ProcessChannelChunk(c, inputs[c]+pos, m_acc.Get()+c*m_chunk, n, fb, damp);
+
+      for (c = 0; c < m_nch; c ++)
+      {
+        const T *a=m_acc.Get()+c*m_chunk;
+        T *p0=outputs[c]+pos;
+        if (c+1 < m_nch)
+        {
+          const T *b=a+m_chunk;
+          T *p1=outputs[c+1]+pos;
+          const T m=wid<0?-wid:wid;
+          const T *x0 = wid<0 ? b : a, *x1 = wid<0 ? a : b;
+          int i;
+          for (i = 0; i < n; i ++)
+          {
+            const T l=x0[i]*(T)0.015, r=x1[i]*(T)0.015;
+            p0[i] = l*m + r*((T)1.0-m);
+            p1[i] = r*m + l*((T)1.0-m);
+          }
+          c++;
+        }
+        else
+        {
+          int i;
+          for (i = 0; i < n; i ++) p0[i] = a[i]*(T)0.015;
+        }
+      }
+      pos+=n;
+    }
+  }
+
+  void Reset(bool doclear=false) // call this after changing roomsize or dampening
+  {
+    const double sc=m_srate / 44100.0;
+    const int nlines=m_nch*(NCOMBS+NALLPASSES);
+    bool resized = m_lines.GetSize()!=nlines;
+    DelayLine *lines=m_lines.Resize(nlines,false);
+    int total=0, minsize=MAXCHUNK, c, x;
+
+    for (c = 0; c < m_nch; c ++)
+    {
+      for (x = 0; x < NCOMBS+NALLPASSES; x ++)
+      {
+        const int tuning = x < NCOMBS ? wdl_verb__combtunings[x] : wdl_verb__allpasstunings[x-NCOMBS];
+        int size=(int) ((tuning+c*wdl_verb__stereospread) * sc);
+        if (size<1) size=1;
+        DelayLine *dl=lines+c*(NCOMBS+NALLPASSES)+x;
+        if (resized || dl->size!=size) resized=true;
+        dl->size=size;
+        dl->offs=total;
+        total+=size;
+        if (size<minsize) minsize=size;
+      }
+    }
+
+    m_fb=m_roomsize;
+    m_dampval=m_damp*0.4;
+    m_chunk=minsize;
+
+    if (resized || doclear)
+    {
+      m_buf.Resize(total,false);
+      memset(m_buf.Get(),0,total*sizeof(T));
+      for (x = 0; x < nlines; x ++) lines[x].idx=0;
+    }
+
+    // like WDL_ReverbComb::Reset(), clearing leaves the state of the dampening filters alone
+    if (m_filterstore.GetSize()!=m_nch*COMBLANES)
+    {
+      m_filterstore.Resize(m_nch*COMBLANES,false);
+      memset(m_filterstore.Get(),0,m_filterstore.GetSize()*sizeof(T));
+    }
+
+    m_pad.Resize(m_chunk,false);
+    memset(m_pad.Get(),0,m_chunk*sizeof(T));
+    m_acc.Resize(m_chunk*m_nch,false);
+  }
+
+  void SetRoomSize(double sz) { m_roomsize=sz;; } // 0.3..0.99 or so
+  void SetDampening(double dmp) { m_damp=dmp; } // 0..1
+  void SetWidth(double wid)
+  {
+    if (wid<-1) wid=-1;
+    else if (wid>1) wid=1;
+    wid*=0.5;
+    if (wid>=0.0) wid+=0.5;
+    else wid-=0.5;
+    m_wid=wid;
+  } // -1..1
+
+private:
+  struct DelayLine
+  {
+    int offs, size, idx;
+  };
+
+  typedef wdl_verb_simd<T> SIMD;
+  typedef typename SIMD::V V;
+
+  // the smallest normal T. like denormal_filter_double(), smaller values are zeroed (and, unlike it, NaNs)
+  static T normal_min() { return sizeof(T)==sizeof(double) ? (T)2.2250738585072014e-308 : (T)1.17549435e-38f; }
+
+  // sample i of W combs, whose delay lines are at lp
+  static void comb_lanes(T * const *lp, int i, V &fs, V inp, V damp1, V damp, V fb, V lim, V nlim)
+  {
+    fs = SIMD::denormal_filter(SIMD::add(SIMD::mul(SIMD::gather(lp,i),damp1),SIMD::mul(fs,damp)),lim,nlim);
+    SIMD::scatter(lp,i,SIMD::add(inp,SIMD::mul(fs,fb)));
+  }
+
+  void ProcessChannelChunk(int c, const T *in, T *acc, int n, T fb, T damp)
+  {
+    DelayLine *lines=m_lines.Get()+c*(NCOMBS+NALLPASSES);
+    T *buf=m_buf.Get();
+    int x, i;
+
+    // the combs, one lane per comb, over the stretches of the chunk in which none of their delay lines wraps
+    T *fstore=m_filterstore.Get()+c*COMBLANES;
+    const V vdamp=SIMD::set1(damp), vdamp1=SIMD::set1((T)1.0-damp), vfb=SIMD::set1(fb);
+    const V lim=SIMD::set1(normal_min()), nlim=SIMD::set1(-normal_min());
+    const int W=SIMD::W;
+    const bool six = COMBLANES/W > 3; // the filter states are written out as 3 or 6 vectors so that they stay in registers
+    V fs0=SIMD::load(fstore), fs1=SIMD::load(fstore+W), fs2=SIMD::load(fstore+2*W), fs3=fs0, fs4=fs0, fs5=fs0;
+    if (six)
+    {
+      fs3=SIMD::load(fstore+3*W);
+      fs4=SIMD::load(fstore+4*W);
+      fs5=SIMD::load(fstore+5*W);
+    }
+    T *lp[COMBLANES];
+    for (x = NCOMBS; x < COMBLANES; x ++) lp[x]=m_pad.Get();
+    int done=0;
+    while (done < n)
+    {
+      int len=n-done;
+      for (x = 0; x < NCOMBS; x ++)
+      {
+        lp[x]=buf+lines[x].offs+lines[x].idx;
+        if (lines[x].size-lines[x].idx < len) len=lines[x].size-lines[x].idx;
+      }
+      const T *inp=in+done;
+      T *out=acc+done;
+      for (i = 0; i < len; i ++)
+      {
+        const V v=SIMD::set1(inp[i]);
+        T sum=(T)0.0;
+        for (x = 0; x < NCOMBS; x ++) sum+=lp[x][i];
+        out[i]=sum;
+        comb_lanes(lp,i,fs0,v,vdamp1,vdamp,vfb,lim,nlim);
+        comb_lanes(lp+W,i,fs1,v,vdamp1,vdamp,vfb,lim,nlim);
+        comb_lanes(lp+2*W,i,fs2,v,vdamp1,vdamp,vfb,lim,nlim);
+        if (six)
+        {
+          comb_lanes(lp+3*W,i,fs3,v,vdamp1,vdamp,vfb,lim,nlim);
+          comb_lanes(lp+4*W,i,fs4,v,vdamp1,vdamp,vfb,lim,nlim);
+          comb_lanes(lp+5*W,i,fs5,v,vdamp1,vdamp,vfb,lim,nlim);
+        }
+      }
+      for (x = 0; x < NCOMBS; x ++)
+      {
+        lines[x].idx+=len;
+        if (lines[x].idx>=lines[x].size) lines[x].idx=0;
+      }
+      done+=len;
+    }
+    SIMD::store(fstore,fs0);
+    SIMD::store(fstore+W,fs1);
+    SIMD::store(fstore+2*W,fs2);
+    if (six)
+    {
+      SIMD::store(fstore+3*W,fs3);
+      SIMD::store(fstore+4*W,fs4);
+      SIMD::store(fstore+5*W,fs5);
+    }
+
+    // the allpasses in series, each over the whole chunk
+    const V half=SIMD::set1((T)0.5);
+    for (x = NCOMBS; x < NCOMBS+NALLPASSES; x ++)
+    {
+      DelayLine *dl=lines+x;
+      T *b=buf+dl->offs;
+      int idx=dl->idx;
+      int done=0;
+      while (done < n)
+      {
+        const int len = n-done < dl->size-idx ? n-done : dl->size-idx;
+        T *p=acc+done, *bp=b+idx;
+        for (i = 0; i + SIMD::W <= len; i += SIMD::W)
+        {
+          const V bufout=SIMD::load(bp+i);
+          const V inp=SIMD::load(p+i);
+          SIMD::store(bp+i,SIMD::denormal_filter(SIMD::add(inp,SIMD::mul(bufout,half)),lim,nlim));
+          SIMD::store(p+i,SIMD::sub(bufout,inp));
+        }
+        for (; i < len; i ++)
+        {
+          const T bufout=bp[i];
+          const T inp=p[i];
+          bp[i] = wdl_verb_denormal_filter(inp + (bufout*(T)0.5));
+          p[i] = bufout - inp;
+        }
+        done+=len;
+        idx+=len;
+        if (idx>=dl->size) idx=0;
+      }
+      dl->idx=idx;
+    }
+  }
+
+  double m_wid;
+  double m_roomsize;
+  double m_damp;
+  double m_srate;
+  double m_fb, m_dampval; // the room size and dampening as of the last Reset()
+  int m_nch;
+  int m_chunk; // no longer than the shortest delay line
+  WDL_TypedBuf<DelayLine> m_lines; // per channel, the combs and then the allpasses
+  WDL_TypedBuf<T> m_buf;
+  WDL_TypedBuf<T> m_filterstore;
+  WDL_TypedBuf<T> m_pad; // the unused lanes of the combs read and write this
+  WDL_TypedBuf<T> m_acc;
+};
+
+
 #endif
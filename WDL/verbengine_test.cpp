@@ -0,0 +1,135 @@
+// checks that WDL_ReverbEngineMC<double> with 2 channels is bit-identical to WDL_ReverbEngine::ProcessSampleBlock(),
+// over odd block sizes, with a Reset(true) mid-stream, room size and dampening changes applied with Reset(false), sample
+// rate changes and negative widths. then times both, and WDL_ReverbEngineMC<float>, in samples per microsecond.
+//
+// c++ -O2 verbengine_test.cpp -o verbengine_test
+// (on targets with FMA, add -ffp-contract=off, so that neither engine has its multiply-adds fused)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+
+#include "verbengine.h"
+
+static double now_us()
+{
+  return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static unsigned int g_rand = 1;
+static double rnd()
+{
+  g_rand = g_rand*1664525 + 1013904223;
+  return (g_rand >> 8) * (1.0/16777216.0) * 2.0 - 1.0;
+}
+
+static const int g_blocksizes[] = { 1, 7, 64, 3, 511, 13, 1024, 2, 97, 256 };
+
+// the input: noise bursts with silence in between, so that the tails decay to denormals and get filtered
+static double input_sample(int pos)
+{
+  return (pos % 30000) < 2000 ? rnd() : 0.0;
+}
+
+int main()
+{
+  WDL_ReverbEngine ref;
+  WDL_ReverbEngineMC<double> mc(2);
+  std::vector<double> in0(1024), in1(1024), out0(1024), out1(1024), mc0(1024), mc1(1024);
+  int pos=0, nblocks=0, bad=0, x;
+
+  for (int step = 0; step < 8; step ++)
+  {
+    switch (step)
+    {
+      case 1: // a new room, while the tail is still ringing
+        ref.SetRoomSize(0.9); mc.SetRoomSize(0.9);
+        ref.SetDampening(0.2); mc.SetDampening(0.2);
+        ref.Reset(false); mc.Reset(false);
+      break;
+      case 2:
+        ref.SetWidth(-0.6); mc.SetWidth(-0.6);
+      break;
+      case 3: // clears the delay lines but not the dampening filters
+        ref.Reset(true); mc.Reset(true);
+      break;
+      case 4:
+        ref.SetSampleRate(48000.0); mc.SetSampleRate(48000.0);
+      break;
+      case 5:
+        ref.SetWidth(0.3); mc.SetWidth(0.3);
+        ref.SetDampening(0.9); mc.SetDampening(0.9);
+        ref.Reset(false); mc.Reset(false);
+      break;
+      case 6:
+        ref.SetSampleRate(22050.0); mc.SetSampleRate(22050.0);
+      break;
+      case 7:
+        ref.Reset(true); mc.Reset(true);
+        ref.SetSampleRate(96000.0); mc.SetSampleRate(96000.0);
+      break;
+    }
+
+    for (int n = 0; n < 80000; nblocks ++)
+    {
+      const int ns = g_blocksizes[nblocks % (sizeof(g_blocksizes)/sizeof(g_blocksizes[0]))];
+      for (x = 0; x < ns; x ++)
+      {
+        in0[x] = input_sample(pos+x);
+        in1[x] = input_sample(pos+x) * 0.5;
+      }
+
+      ref.ProcessSampleBlock(in0.data(), in1.data(), out0.data(), out1.data(), ns);
+      double *ins[2] = { in0.data(), in1.data() }, *outs[2] = { mc0.data(), mc1.data() };
+      mc.ProcessSampleBlock(ins, outs, ns);
+
+      if (memcmp(out0.data(), mc0.data(), ns*sizeof(double)) || memcmp(out1.data(), mc1.data(), ns*sizeof(double)))
+      {
+        if (bad++ < 10)
+        {
+          for (x = 0; x < ns && out0[x] == mc0[x] && out1[x] == mc1[x]; x ++);
+          printf("step %d, sample %d: WDL_ReverbEngine %.17g %.17g, WDL_ReverbEngineMC %.17g %.17g\n", step, pos+x, out0[x], out1[x], mc0[x], mc1[x]);
+        }
+      }
+
+      pos += ns;
+      n += ns;
+    }
+  }
+
+  printf("bit identity: %d samples, %d blocks differ\n", pos, bad);
+
+  // timing, 10 seconds at 44.1kHz in blocks of 512
+  const int ns=512, nb=44100*10/ns;
+  std::vector<float> fin(ns), fout0(ns), fout1(ns);
+  for (x = 0; x < ns; x ++) fin[x] = (float) (in0[x] = in1[x] = rnd());
+
+  WDL_ReverbEngine tref;
+  WDL_ReverbEngineMC<double> tmc(2);
+  WDL_ReverbEngineMC<float> tmcf(2);
+
+  double t0=now_us();
+  for (x = 0; x < nb; x ++) tref.ProcessSampleBlock(in0.data(), in1.data(), out0.data(), out1.data(), ns);
+  double t1=now_us();
+  for (x = 0; x < nb; x ++)
+  {
+    double *ins[2] = { in0.data(), in1.data() }, *outs[2] = { mc0.data(), mc1.data() };
+    tmc.ProcessSampleBlock(ins, outs, ns);
+  }
+  double t2=now_us();
+  for (x = 0; x < nb; x ++)
+  {
+    float *ins[2] = { fin.data(), fin.data() }, *outs[2] = { fout0.data(), fout1.data() };
+    tmcf.ProcessSampleBlock(ins, outs, ns);
+  }
+  double t3=now_us();
+
+  printf("WDL_ReverbEngine: %.1f samples/us\n", nb*ns/(t1-t0));
+  printf("WDL_ReverbEngineMC<double>: %.1f samples/us\n", nb*ns/(t2-t1));
+  printf("WDL_ReverbEngineMC<float>: %.1f samples/us\n", nb*ns/(t3-t2));
+
+  printf("%s\n", bad ? "FAILED" : "OK");
+  return bad ? 1 : 0;
+}
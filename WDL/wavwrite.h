@@ -23,7 +23,7 @@
 
 /*
 
-  This file provides a simple class for writing basic 16 or 24 bit PCM WAV files.
+  This file provides a simple class for writing basic 16, 24 or 32 bit PCM WAV files, of any number of channels.
  
 */
 
@@ -34,6 +34,7 @@
 
 #include <stdio.h>
 #include "pcmfmtcvt.h"
+#include "heapbuf.h"
 #include "wdlstring.h"
 
 class WaveWriter
@@ -85,7 +86,7 @@ class WaveWriter
         fwrite(tbuf,1,44,m_fp); // room for header
       }
       m_bps=bps;
-      m_nch=nch>1?2:1;
+      m_nch=nch>1?nch:1;
       m_srate=srate;
 
       return !!m_fp;
@@ -165,142 +166,51 @@ class WaveWriter
 
     void WriteFloats(float *samples, int nsamples)
     {
-      if (!m_fp) return;
+      void *buf=GetPcmBuf(nsamples);
+      if (!buf) return;
 
-      if (m_bps == 16)
-      {
-        while (nsamples-->0)
-        {
-          short a;
-          float_TO_INT16(a,*samples);
-          unsigned char c=a&0xff;
-          fwrite(&c,1,1,m_fp);
-          c=a>>8;
-          fwrite(&c,1,1,m_fp);
-          samples++;
-        }
-      }
-      else if (m_bps == 24)
-      {
-        while (nsamples-->0)
-        {
-          unsigned char a[3];
-          float_to_i24(samples,a);
-          fwrite(a,1,3,m_fp);
-          samples++;
-        }
-      }
+      floatsToPcm(samples,1,nsamples,buf,m_bps,1);
+      fwrite(buf,m_bps/8,nsamples,m_fp);
     }
 
     void WriteDoubles(double *samples, int nsamples)
     {
-      if (!m_fp) return;
+      void *buf=GetPcmBuf(nsamples);
+      if (!buf) return;
 
-      if (m_bps == 16)
-      {
-        while (nsamples-->0)
-        {
-          short a;
-          double_TO_INT16(a,*samples);
-          unsigned char c=a&0xff;
-          fwrite(&c,1,1,m_fp);
-          c=a>>8;
-          fwrite(&c,1,1,m_fp);
-          samples++;
-        }
-      }
-      else if (m_bps == 24)
-      {
-        while (nsamples-->0)
-        {
-          unsigned char a[3];
-          double_to_i24(samples,a);
-          fwrite(a,1,3,m_fp);
-          samples++;
-        }
-      }
+      doublesToPcm(samples,1,nsamples,buf,m_bps,1);
+      fwrite(buf,m_bps/8,nsamples,m_fp);
     }
 
+    // channels past nchsrc repeat the source channels, so mono is written to every channel
     void WriteFloatsNI(float **samples, int offs, int nsamples, int nchsrc=0)
     {
-      if (!m_fp) return;
+      void *buf=GetPcmBuf(nsamples*m_nch);
+      if (!buf) return;
 
       if (nchsrc < 1) nchsrc=m_nch;
 
-      float *tmpptrs[2]={samples[0]+offs,m_nch>1?(nchsrc>1?samples[1]+offs:samples[0]+offs):NULL};
+      float **tmpptrs=(float **)m_ptrs.Resize(m_nch*sizeof(float *),false);
+      int ch;
+      for (ch = 0; ch < m_nch; ch ++) tmpptrs[ch]=samples[ch%nchsrc]+offs;
 
-      if (m_bps == 16)
-      {
-        while (nsamples-->0)
-        {          
-          int ch;
-          for (ch = 0; ch < m_nch; ch ++)
-          {
-            short a;
-            float_TO_INT16(a,tmpptrs[ch][0]);
-            unsigned char c=a&0xff;
-            fwrite(&c,1,1,m_fp);
-            c=a>>8;
-            fwrite(&c,1,1,m_fp);
-            tmpptrs[ch]++;
-          }
-        }
-      }
-      else if (m_bps == 24)
-      {
-        while (nsamples-->0)
-        {
-          int ch;
-          for (ch = 0; ch < m_nch; ch ++)
-          {
-            unsigned char a[3];
-            float_to_i24(tmpptrs[ch],a);
-            fwrite(a,1,3,m_fp);
-            tmpptrs[ch]++;
-          }
-        }
-      }
+      floatsNIToPcm(tmpptrs,m_nch,nsamples,buf,m_bps);
+      fwrite(buf,m_bps/8*m_nch,nsamples,m_fp);
     }
 
     void WriteDoublesNI(double **samples, int offs, int nsamples, int nchsrc=0)
     {
-      if (!m_fp) return;
+      void *buf=GetPcmBuf(nsamples*m_nch);
+      if (!buf) return;
 
       if (nchsrc < 1) nchsrc=m_nch;
 
-      double *tmpptrs[2]={samples[0]+offs,m_nch>1?(nchsrc>1?samples[1]+offs:samples[0]+offs):NULL};
+      double **tmpptrs=(double **)m_ptrs.Resize(m_nch*sizeof(double *),false);
+      int ch;
+      for (ch = 0; ch < m_nch; ch ++) tmpptrs[ch]=samples[ch%nchsrc]+offs;
 
-      if (m_bps == 16)
-      {
-        while (nsamples-->0)
-        {          
-          int ch;
-          for (ch = 0; ch < m_nch; ch ++)
-          {
-            short a;
-            double_TO_INT16(a,tmpptrs[ch][0]);
-            unsigned char c=a&0xff;
-            fwrite(&c,1,1,m_fp);
-            c=a>>8;
-            fwrite(&c,1,1,m_fp);
-            tmpptrs[ch]++;
-          }
-        }
-      }
-      else if (m_bps == 24)
-      {
-        while (nsamples-->0)
-        {
-          int ch;
-          for (ch = 0; ch < m_nch; ch ++)
-          {
-            unsigned char a[3];
-            double_to_i24(tmpptrs[ch],a);
-            fwrite(a,1,3,m_fp);
-            tmpptrs[ch]++;
-          }
-        }
-      }
+      doublesNIToPcm(tmpptrs,m_nch,nsamples,buf,m_bps);
+      fwrite(buf,m_bps/8*m_nch,nsamples,m_fp);
     }
 
 
@@ -309,7 +219,15 @@ class WaveWriter
     int get_bps() { return m_bps; }
 
   private:
+    // a buffer for nsamples converted samples, or NULL if there is no file or the format isn't 16, 24 or 32 bit
+    void *GetPcmBuf(int nsamples)
+    {
+      if (!m_fp || (m_bps != 16 && m_bps != 24 && m_bps != 32) || nsamples < 1) return NULL;
+      return m_buf.Resize(nsamples*(m_bps/8),false);
+    }
+
     WDL_String m_fn;
+    WDL_HeapBuf m_buf, m_ptrs;
     FILE *m_fp;
     int m_bps,m_nch,m_srate;
 };
@@ -0,0 +1,51 @@
+# Builds the APP target of a plug-in as a command line program that renders WAVE files through it as fast as possible, without an audio device or a window (see IPlugAPP_offline.h)
+# A project makefile sets IPLUG2_ROOT, includes this file, adds the plug-in's source files to SRC and sets TARGET, e.g. projects/IPlugEffect-offline.mk
+
+PROJECT_ROOT = $(PWD)/..
+WDL_PATH = $(IPLUG2_ROOT)/WDL
+IPLUG_PATH = $(IPLUG2_ROOT)/IPlug
+IPLUG_EXTRAS_PATH = $(IPLUG_PATH)/Extras
+IPLUG_SYNTH_PATH = $(IPLUG_EXTRAS_PATH)/Synth
+IPLUG_APP_PATH = $(IPLUG_PATH)/APP
+IGRAPHICS_PATH = $(IPLUG2_ROOT)/IGraphics
+CONTROLS_PATH = $(IGRAPHICS_PATH)/Controls
+PLATFORMS_PATH = $(IGRAPHICS_PATH)/Platforms
+DRAWING_PATH = $(IGRAPHICS_PATH)/Drawing
+DEPS_PATH = $(IPLUG2_ROOT)/Dependencies
+NANOSVG_PATH = $(DEPS_PATH)/IGraphics/NanoSVG/src
+
+IPLUG_SRC = $(IPLUG_PATH)/IPlugAPIBase.cpp \
+	$(IPLUG_PATH)/IPlugParameter.cpp \
+	$(IPLUG_PATH)/IPlugPluginBase.cpp \
+	$(IPLUG_PATH)/IPlugPaths.cpp \
+	$(IPLUG_PATH)/IPlugProcessor.cpp \
+	$(IPLUG_PATH)/IPlugTimer.cpp \
+	$(IPLUG_APP_PATH)/IPlugAPP.cpp \
+	$(IPLUG_APP_PATH)/IPlugAPP_offline.cpp
+
+INCLUDE_PATHS = -I$(PROJECT_ROOT) \
+-I$(WDL_PATH) \
+-I$(IPLUG_PATH) \
+-I$(IPLUG_EXTRAS_PATH) \
+-I$(IPLUG_SYNTH_PATH) \
+-I$(IPLUG_APP_PATH) \
+-I$(IGRAPHICS_PATH) \
+-I$(CONTROLS_PATH) \
+-I$(PLATFORMS_PATH) \
+-I$(DRAWING_PATH) \
+-I$(NANOSVG_PATH)
+
+SRC = $(IPLUG_SRC)
+
+CFLAGS = $(INCLUDE_PATHS) \
+-std=c++14 \
+-O3 \
+-DNDEBUG \
+-DAPP_API \
+-DAPP_OFFLINE \
+-DIPLUG_DSP=1 \
+-DNO_IGRAPHICS \
+-DSAMPLE_TYPE_DOUBLE \
+-DWDL_NO_DEFINE_MINMAX
+
+LDFLAGS = -lpthread